@@ -1,6 +1,9 @@
 #include "remote_control.h"
-#include "esc.h"
+#include "rtos/tasks/remote_control_task.h"
 #include "failsafe.h"
+#include "flight_pipeline.h"
+#include "control_core.h"
+#include "config/control_config.h"
 #include "pico/stdlib.h"
 #include "hardware/pwm.h"
 #include "hardware/irq.h"
@@ -19,17 +22,34 @@
 // Failsafe configuration
 #define SIGNAL_LOSS_TIMEOUT_MS 1000
 
-// Channel values
-static uint16_t channel_values[5] = {0}; // Updated to include emergency stop channel
+// Pulse widths a receiver can produce, in microseconds; a frame with any
+// channel outside is not a valid signal
+#define CHANNEL_MIN_US 900
+#define CHANNEL_MAX_US 2100
 
-// Last signal time
+// Arm gesture: throttle at the bottom and yaw full right, held; full left
+// disarms the same way
+#define ARM_THROTTLE_MAX_US 1050
+#define ARM_YAW_RIGHT_US    1900
+#define ARM_YAW_LEFT_US     1100
+#define ARM_GESTURE_MS      1000
+
+// Channel values, written and read by the remote control task only
+static uint16_t channel_values[REMOTE_CONTROL_CHANNELS] = {0}; // Updated to include emergency stop channel
+
+// Last valid frame time, only meaningful once a frame has arrived
 static uint32_t last_signal_time = 0;
+static bool frame_received = false;
+
+// Armed by the held gesture on a live signal with the stop switch off;
+// disarmed by the opposite gesture, signal loss or the stop switch
+static bool armed = false;
+static bool gesture_active = false;
+static uint32_t gesture_start_time = 0;
 
 // Function prototypes
 static void pwm_irq_handler(void);
-static void update_channel_values(uint slice_num, uint16_t value);
 static void check_failsafe(void);
-static void emergency_stop(void); // Added prototype for emergency stop function
 
 void remote_control_init(void) {
     // Initialize PWM
@@ -46,72 +66,81 @@ void remote_control_init(void) {
     irq_set_enabled(PWM_IRQ_WRAP, true);
     pwm_clear_irq(pwm_gpio_to_slice_num(0));
     pwm_set_irq_enabled(pwm_gpio_to_slice_num(0), true);
-
-    // Initialize ESCs
-    esc_config_t esc_config = {1, 1000, 2000, 1500};
-    esc_init(&esc_config);
 }
 
 void remote_control_update(void) {
     // Update failsafe
     check_failsafe();
 
-    // Map channels to control functions
-    uint16_t throttle = channel_values[THROTTLE_CHANNEL];
-    uint16_t pitch = channel_values[PITCH_CHANNEL];
-    uint16_t roll = channel_values[ROLL_CHANNEL];
-    uint16_t yaw = channel_values[YAW_CHANNEL];
-
-    // Update ESCs
-    esc_set_throttle(1, throttle);
-    esc_set_throttle(2, pitch);
-    esc_set_throttle(3, roll);
-    esc_set_throttle(4, yaw);
+    // Collective throttle for the flight pipeline, which owns the ESCs
+    float throttle = (channel_values[THROTTLE_CHANNEL] - 1000.0f) / 1000.0f;
+#if FC_CONTROL_ON_CORE1
+    control_core_set_throttle(throttle);
+    control_core_set_armed(armed);
+
+    // Failsafe state for the pipeline on core 1
+    control_core_set_failsafe(isFailsafeActive());
+#else
+    flight_pipeline_set_throttle(throttle);
+    flight_pipeline_set_armed(armed);
+#endif
 }
 
 static void pwm_irq_handler(void) {
-    // Read PWM values
-    for (int i = 0; i < 5; i++) { // Updated to include emergency stop channel
-        uint slice_num = pwm_gpio_to_slice_num(i);
-        uint16_t value = pwm_get_counter(slice_num);
-        update_channel_values(slice_num, value);
+    // Read PWM values and hand the frame to the remote control task; a
+    // full ring drops it, the task still has the newer frames queued
+    remote_control_t input;
+    for (int i = 0; i < REMOTE_CONTROL_CHANNELS; i++) { // Updated to include emergency stop channel
+        input.channels[i] = pwm_get_counter(pwm_gpio_to_slice_num(i));
     }
+    PushRemoteControlInputFromISR(&input);
 
     // Clear interrupt
     pwm_clear_irq(pwm_gpio_to_slice_num(0));
 }
 
-static void update_channel_values(uint slice_num, uint16_t value) {
-    if (slice_num < 5) { // Updated to include emergency stop channel
-        channel_values[slice_num] = value;
-        last_signal_time = to_ms_since_boot(get_absolute_time());
+// Take a frame only if every channel is a plausible pulse; anything else
+// leaves the last valid frame in place and lets the signal time out
+void remote_control_apply_input(const remote_control_t *input) {
+    for (int i = 0; i < REMOTE_CONTROL_CHANNELS; i++) {
+        if (input->channels[i] < CHANNEL_MIN_US || input->channels[i] > CHANNEL_MAX_US) {
+            return;
+        }
     }
+    for (int i = 0; i < REMOTE_CONTROL_CHANNELS; i++) {
+        channel_values[i] = input->channels[i];
+    }
+    last_signal_time = to_ms_since_boot(get_absolute_time());
+    frame_received = true;
 }
 
-static void check_failsafe(void) {
-    uint32_t current_time = to_ms_since_boot(get_absolute_time());
-    if (current_time - last_signal_time > SIGNAL_LOSS_TIMEOUT_MS) {
-        // Disarm motors
-        for (int i = 1; i <= 4; i++) {
-            esc_disarm(i);
-        }
-    } else {
-        // Arm motors if signal is valid
-        for (int i = 1; i <= 4; i++) {
-            esc_arm(i);
-        }
+// True once the gesture has been held for ARM_GESTURE_MS
+static bool gesture_held(bool gesture, uint32_t current_time) {
+    if (!gesture) {
+        gesture_active = false;
+        return false;
     }
-
-    // Check for emergency stop command
-    if (channel_values[EMERGENCY_STOP_CHANNEL] > 1500) { // Assuming a value above 1500 indicates emergency stop
-        emergency_stop();
+    if (!gesture_active) {
+        gesture_active = true;
+        gesture_start_time = current_time;
     }
+    return current_time - gesture_start_time >= ARM_GESTURE_MS;
 }
 
-static void emergency_stop(void) {
-    // Disarm all motors immediately
-    for (int i = 1; i <= 4; i++) {
-        esc_disarm(i);
+static void check_failsafe(void) {
+    uint32_t current_time = to_ms_since_boot(get_absolute_time());
+    // No frame since boot counts as lost: the zeroed channels are not a signal
+    bool signal_lost = !frame_received || current_time - last_signal_time > SIGNAL_LOSS_TIMEOUT_MS;
+    bool stop_requested = channel_values[EMERGENCY_STOP_CHANNEL] > 1500; // Assuming a value above 1500 indicates emergency stop
+    bool throttle_low = channel_values[THROTTLE_CHANNEL] <= ARM_THROTTLE_MAX_US;
+
+    if (signal_lost || stop_requested) {
+        armed = false;
+        gesture_active = false;
+    } else if (!armed) {
+        armed = gesture_held(throttle_low && channel_values[YAW_CHANNEL] >= ARM_YAW_RIGHT_US, current_time);
+    } else {
+        armed = !gesture_held(throttle_low && channel_values[YAW_CHANNEL] <= ARM_YAW_LEFT_US, current_time);
     }
 }
 
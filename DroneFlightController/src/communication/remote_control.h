@@ -3,10 +3,20 @@
 
 #include <stdint.h>
 
+// One receiver frame: the pulse width of every channel in microseconds
+#define REMOTE_CONTROL_CHANNELS 5
+typedef struct {
+    uint16_t channels[REMOTE_CONTROL_CHANNELS];
+} remote_control_t;
+
 // Initialize remote control communication
 void remote_control_init(void);
 
-// Update remote control inputs
+// Take a frame queued by the receiver interrupt; task context only
+void remote_control_apply_input(const remote_control_t *input);
+
+// Evaluate signal loss and arming and pass the inputs to the pipeline;
+// called by the remote control task on every frame and timeout
 void remote_control_update(void);
 
 // Channel mapping functions
@@ -18,13 +28,4 @@ uint16_t get_yaw_channel(void);
 // Failsafe mechanism functions
 void check_failsafe(void);
 
-// ESC control function prototypes
-void esc_init(const esc_config_t *config);
-void esc_set_throttle(uint8_t channel, uint16_t throttle);
-void esc_arm(uint8_t channel);
-void esc_disarm(uint8_t channel);
-
-// Emergency stop function prototype
-void emergency_stop(void);
-
 #endif /* REMOTE_CONTROL_H */
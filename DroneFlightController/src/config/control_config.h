@@ -0,0 +1,101 @@
+//
+//  control_config.h
+//  DroneFlightController
+//
+//  Loop rates and controller gains for the cascaded angle/rate controller.
+//
+
+#ifndef CONTROL_CONFIG_H
+#define CONTROL_CONFIG_H
+
+#include "config/sensor_config.h"
+
+/* Loop Rates */
+// Inner rate loop on raw gyro, one pass per IMU data-ready sample; set the
+// rate with IMU_SAMPLE_RATE_HZ
+#define CONTROL_RATE_LOOP_HZ        IMU_SAMPLE_RATE_HZ
+#define CONTROL_ANGLE_LOOP_DIVISOR  4     // Outer angle loop runs every Nth rate loop iteration
+
+#define CONTROL_RATE_LOOP_PERIOD_US  (1000000 / CONTROL_RATE_LOOP_HZ)
+#define CONTROL_ANGLE_LOOP_HZ        (CONTROL_RATE_LOOP_HZ / CONTROL_ANGLE_LOOP_DIVISOR)
+
+// RTOS tasks cannot wake faster than the tick, so clamp to one tick
+#define CONTROL_RATE_LOOP_PERIOD_TICKS \
+    ((configTICK_RATE_HZ / CONTROL_RATE_LOOP_HZ) > 0 ? (configTICK_RATE_HZ / CONTROL_RATE_LOOP_HZ) : 1)
+
+/* Deadline Monitor */
+#define CONTROL_DEADLINE_OVERRUN_LIMIT  8   // Consecutive pipeline overruns that raise an event
+
+// Step the loop rate down on each event instead of running late; rate
+// step n runs at CONTROL_RATE_LOOP_HZ >> n, with every filter re-derived
+#define CONTROL_LOOP_RATE_ADAPTIVE  1
+#define CONTROL_LOOP_RATE_STEPS     3     // Rates tried, including the configured one
+
+// Step back up once every run for this long fit within the given share of
+// the faster rate's period; the gap to a full period is the hysteresis
+#define CONTROL_LOOP_RATE_RECOVER_MS       5000
+#define CONTROL_LOOP_RATE_RECOVER_PERCENT  50
+
+/* Core Partitioning (RP2040) */
+// Run the flight pipeline bare-metal on core 1, paced only by data-ready,
+// while FreeRTOS keeps telemetry, logging, failsafe and RC on core 0
+#ifndef FC_CONTROL_ON_CORE1
+#define FC_CONTROL_ON_CORE1  0
+#endif
+
+#define CONTROL_CORE_STATUS_DIVISOR  100  // Core 1 reports status every Nth pipeline run
+
+/* Outer Angle Loop Gains (angle error in rad -> rate setpoint in rad/s) */
+#define ANGLE_ROLL_P   4.0f
+#define ANGLE_ROLL_I   0.0f
+#define ANGLE_ROLL_D   0.0f
+
+#define ANGLE_PITCH_P  4.0f
+#define ANGLE_PITCH_I  0.0f
+#define ANGLE_PITCH_D  0.0f
+
+#define ANGLE_YAW_P    2.0f
+#define ANGLE_YAW_I    0.0f
+#define ANGLE_YAW_D    0.0f
+
+// Rate setpoint limit produced by the angle loop (rad/s)
+#define CONTROL_MAX_RATE  6.0f
+
+/* Inner Rate Loop Gains (rate error in rad/s -> normalized command) */
+#define RATE_ROLL_P    0.15f
+#define RATE_ROLL_I    0.05f
+#define RATE_ROLL_D    0.002f
+
+#define RATE_PITCH_P   0.15f
+#define RATE_PITCH_I   0.05f
+#define RATE_PITCH_D   0.002f
+
+#define RATE_YAW_P     0.25f
+#define RATE_YAW_I     0.05f
+#define RATE_YAW_D     0.0f
+
+/* Gyro Filter Chain (applied per axis at the rate loop frequency) */
+#define GYRO_LPF_HZ              150.0f  // PT1 lowpass cutoff
+#define GYRO_NOTCH_HZ            220.0f  // Static notch center (frame resonance)
+#define GYRO_NOTCH_CUTOFF_HZ     160.0f  // Static notch lower cutoff
+
+#define GYRO_FILTER_CHAIN \
+    FILTER_CHAIN_INIT2(FILTER_STAGE_PT1(GYRO_LPF_HZ, CONTROL_RATE_LOOP_HZ), \
+                       FILTER_STAGE_BIQUAD_NOTCH(GYRO_NOTCH_HZ, GYRO_NOTCH_CUTOFF_HZ, CONTROL_RATE_LOOP_HZ))
+
+/* Dynamic Notch (gyro FFT analyzer appends these stages to the gyro chain) */
+#define DYN_NOTCH_ENABLED            1
+#define DYN_NOTCH_COUNT              2       // Notches per axis (max GYRO_ANALYZER_MAX_PEAKS)
+#define DYN_NOTCH_Q                  3.0f
+#define DYN_NOTCH_MIN_HZ             80.0f   // Search band for motor noise peaks
+#define DYN_NOTCH_MAX_HZ             450.0f
+#define GYRO_ANALYZER_SAMPLE_HZ      1000    // Decimated analyzer rate
+#define GYRO_ANALYZER_WORK_PER_STEP  8       // FFT work units per rate loop iteration
+
+/* D-term Filter Chain (applied per axis inside the rate loop PID) */
+#define DTERM_LPF_HZ             100.0f  // Biquad lowpass cutoff
+
+#define DTERM_FILTER_CHAIN \
+    FILTER_CHAIN_INIT1(FILTER_STAGE_BIQUAD_LPF(DTERM_LPF_HZ, CONTROL_RATE_LOOP_HZ))
+
+#endif /* CONTROL_CONFIG_H */
@@ -26,9 +26,21 @@
 #define I2C_SDA_PIN 16
 #define I2C_SCL_PIN 17
 
+// MPU6050 INT output, configured as an active-high data-ready pulse
+#define IMU_INT_PIN 6
+
 /* Timer Configuration */
 #define TIMER_INTERVAL_MS 10  // 10ms timer interval for periodic tasks
 
+/* Memory Configuration */
+// Ceiling for statically allocated RAM counted by rtos/ram_budget.c; the
+// rest of the 264KB SRAM is left for the main stack, .data and libraries
+#define RAM_BUDGET_BYTES (96 * 1024)
+
+// Program flash given to the log store, just below the flash_storage
+// sectors at the end of flash; the firmware image must fit below it
+#define LOG_STORE_SIZE_BYTES (1024 * 1024)
+
 /* Debug UART Configuration */
 #define UART_TX_PIN 0
 #define UART_RX_PIN 1
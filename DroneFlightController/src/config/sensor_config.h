@@ -0,0 +1,62 @@
+//
+//  sensor_config.h
+//  DroneFlightController
+//
+//  Attitude estimation and sensor processing settings.
+//
+
+#ifndef SENSOR_CONFIG_H
+#define SENSOR_CONFIG_H
+
+/* IMU Sampling */
+#define IMU_SAMPLE_RATE_HZ    1000  // MPU6050 output rate and rate loop rate (1000-8000 Hz), gyro 8 kHz / (1 + SMPLRT_DIV)
+
+/* Background IMU Calibration */
+#define IMU_CAL_WINDOW_SAMPLES    256      // Samples per still-detection window
+#define IMU_CAL_GYRO_STILL_VAR    1e-4f    // Max gyro variance when still, (rad/s)^2
+#define IMU_CAL_ACCEL_STILL_VAR   2.25e-4f // Max accel variance when still, g^2
+#define IMU_CAL_GYRO_MAX_BIAS     0.35f    // Larger window means are rotation, not bias (rad/s)
+#define IMU_CAL_BIAS_WINDOWS      16       // Still windows averaged into the gyro bias
+#define IMU_CAL_FACE_ALIGNMENT    0.995f   // Min cosine between gravity and an axis for a face
+#define IMU_CAL_SAVE_BIAS_DELTA   0.002f   // Gyro bias drift that triggers a save (rad/s)
+
+/* Magnetometer Ellipsoid Fit */
+#define MAG_CAL_MIN_SAMPLES       300      // Samples before the first solve
+#define MAG_CAL_SOLVE_INTERVAL    100      // Samples between re-solves
+#define MAG_CAL_MIN_SPAN          1.0f     // Min per-axis span covered, in field radii
+#define MAG_CAL_MAX_AXIS_RATIO    2.0f     // Max ratio between ellipsoid semi-axes
+#define MAG_CAL_SAVE_DELTA        0.02f    // Relative correction change that triggers a save
+
+/* Attitude Estimator Selection */
+#define SENSOR_FUSION_KALMAN     0   // Per-axis 1-D Kalman on accelerometer angles
+#define SENSOR_FUSION_MAHONY     1   // Quaternion complementary filter with PI feedback
+#define SENSOR_FUSION_MADGWICK   2   // Quaternion gradient-descent filter
+#define SENSOR_FUSION_EKF        3   // 7-state EKF, quaternion + gyro bias
+
+#ifndef SENSOR_FUSION_ESTIMATOR
+#define SENSOR_FUSION_ESTIMATOR  SENSOR_FUSION_MAHONY
+#endif
+
+// Fuse the magnetometer into yaw (the MPU6050 has none, so off by default)
+#ifndef SENSOR_FUSION_USE_MAG
+#define SENSOR_FUSION_USE_MAG    0
+#endif
+
+// Gyro integration runs every update, accel/mag correction every Nth update
+#define ATTITUDE_CORRECTION_DIVISOR  4
+
+// Yaw counts as referenced to a heading while the magnetometer corrected
+// it within this time; otherwise the yaw axis is flown rate-only
+#define SENSOR_HEADING_TIMEOUT_US    500000
+
+/* Quaternion Estimator Gains */
+#define MAHONY_KP      0.5f   // Proportional feedback (rad/s per unit error)
+#define MAHONY_KI      0.02f  // Integral feedback, estimates gyro bias
+#define MADGWICK_BETA  0.1f   // Gradient step (rad/s)
+
+/* EKF Noise Model */
+#define EKF_GYRO_NOISE   0.005f   // Gyro noise density (rad/s/sqrt(Hz))
+#define EKF_BIAS_NOISE   0.0005f  // Gyro bias random walk (rad/s^2/sqrt(Hz))
+#define EKF_ACCEL_NOISE  0.15f    // Normalized accel standard deviation, maneuver acceleration included
+
+#endif /* SENSOR_CONFIG_H */
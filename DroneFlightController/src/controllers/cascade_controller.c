@@ -0,0 +1,246 @@
+//
+//  cascade_controller.c
+//  DroneFlightController
+//
+
+#include "cascade_controller.h"
+#include "utils/math_utils.h"
+
+#if FC_USE_FIXED_POINT
+// Loop period in microseconds as a Q31 fraction of a second
+static q31_t period_to_dt_q31(uint32_t period_us) {
+    return fx_saturate((int64_t)period_us * ((int64_t)1 << Q31_FRAC_BITS) / 1000000);
+}
+
+// Loop frequency 1/dt in Q16 computed from the integer period
+static q16_t period_to_inv_dt_q16(uint32_t period_us) {
+    return fx_saturate((int64_t)Q16_ONE * 1000000 / period_us);
+}
+#endif
+
+void cascade_init(cascade_controller_t *ctrl, uint32_t rate_loop_hz, uint32_t angle_divisor, float max_rate) {
+#if FC_USE_FIXED_POINT
+    pid_axes_q16_init(&ctrl->angle_pid);
+    pid_axes_q16_init(&ctrl->rate_pid);
+    ctrl->max_rate = q16_from_float(max_rate);
+#else
+    pid_axes_init(&ctrl->angle_pid);
+    pid_axes_init(&ctrl->rate_pid);
+    ctrl->max_rate = max_rate;
+#endif
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        ctrl->angle_hold[i] = true;
+    }
+    cascade_set_rate_loop_hz(ctrl, rate_loop_hz);
+    cascade_set_angle_divisor(ctrl, angle_divisor);
+    cascade_reset(ctrl);
+}
+
+void cascade_set_rate_loop_hz(cascade_controller_t *ctrl, uint32_t rate_loop_hz) {
+    ctrl->nominal_period_us = (rate_loop_hz > 0) ? (1000000 / rate_loop_hz) : 1000;
+    timing_jitter_init(&ctrl->rate_jitter, ctrl->nominal_period_us, ctrl->nominal_period_us / 100);
+}
+
+void cascade_set_angle_gains(cascade_controller_t *ctrl, pid_axis_t axis, float p_gain, float i_gain, float d_gain) {
+#if FC_USE_FIXED_POINT
+    pid_axes_q16_set_gains(&ctrl->angle_pid, axis, p_gain, i_gain, d_gain);
+#else
+    pid_axes_set_gains(&ctrl->angle_pid, axis, p_gain, i_gain, d_gain);
+#endif
+}
+
+void cascade_set_rate_gains(cascade_controller_t *ctrl, pid_axis_t axis, float p_gain, float i_gain, float d_gain) {
+#if FC_USE_FIXED_POINT
+    pid_axes_q16_set_gains(&ctrl->rate_pid, axis, p_gain, i_gain, d_gain);
+#else
+    pid_axes_set_gains(&ctrl->rate_pid, axis, p_gain, i_gain, d_gain);
+#endif
+}
+
+void cascade_set_dterm_filter(cascade_controller_t *ctrl, filter_chain_t *filters) {
+#if FC_USE_FIXED_POINT
+    pid_axes_q16_set_dterm_filter(&ctrl->rate_pid, filters);
+#else
+    pid_axes_set_dterm_filter(&ctrl->rate_pid, filters);
+#endif
+}
+
+void cascade_set_angle_divisor(cascade_controller_t *ctrl, uint32_t angle_divisor) {
+    ctrl->angle_divisor = (angle_divisor > 0) ? angle_divisor : 1;
+}
+
+void cascade_set_angle_hold(cascade_controller_t *ctrl, pid_axis_t axis, bool hold) {
+    if (ctrl->angle_hold[axis] == hold) {
+        return;
+    }
+    ctrl->angle_hold[axis] = hold;
+    ctrl->angle_pid.integral[axis] = 0;
+    ctrl->angle_pid.prev_error[axis] = 0;
+    ctrl->rate_setpoint[axis] = 0;
+}
+
+void cascade_reset(cascade_controller_t *ctrl) {
+#if FC_USE_FIXED_POINT
+    pid_axes_q16_reset(&ctrl->angle_pid);
+    pid_axes_q16_reset(&ctrl->rate_pid);
+#else
+    pid_axes_reset(&ctrl->angle_pid);
+    pid_axes_reset(&ctrl->rate_pid);
+#endif
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        ctrl->rate_setpoint[i] = 0;
+    }
+    ctrl->iteration = 0;
+    ctrl->last_rate_us = 0;
+    ctrl->last_angle_us = 0;
+    ctrl->rate_dt_us = ctrl->nominal_period_us;
+    ctrl->angle_dt_us = ctrl->nominal_period_us * ctrl->angle_divisor;
+    ctrl->started = false;
+}
+
+bool cascade_angle_loop_due(const cascade_controller_t *ctrl) {
+    return (ctrl->iteration % ctrl->angle_divisor) == 0;
+}
+
+// Measure dt for each loop from the sample timestamps
+// Returns true when the angle loop runs this iteration.
+static bool begin_update(cascade_controller_t *ctrl, uint32_t now_us) {
+    if (ctrl->started) {
+        uint32_t rate_dt_us = now_us - ctrl->last_rate_us;
+        ctrl->rate_dt_us = (rate_dt_us > 0) ? rate_dt_us : 1;
+        timing_jitter_record(&ctrl->rate_jitter, rate_dt_us);
+    }
+
+    bool run_angle_loop = cascade_angle_loop_due(ctrl);
+    if (run_angle_loop && ctrl->started) {
+        uint32_t angle_dt_us = now_us - ctrl->last_angle_us;
+        ctrl->angle_dt_us = (angle_dt_us > 0) ? angle_dt_us : 1;
+    }
+    return run_angle_loop;
+}
+
+static void end_update(cascade_controller_t *ctrl, uint32_t now_us, bool run_angle_loop) {
+    if (run_angle_loop) {
+        ctrl->last_angle_us = now_us;
+    }
+    ctrl->last_rate_us = now_us;
+    ctrl->iteration++;
+    ctrl->started = true;
+}
+
+// The angle loop sees the attitude that gives the wrapped error, and
+// zero error on rate-only axes so their state stays clear
+static void wrap_attitude(const cascade_controller_t *ctrl, const float *angle_setpoint,
+                          const float *attitude, float *measured) {
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        measured[i] = ctrl->angle_hold[i] ? angle_setpoint[i] - wrap_pi(angle_setpoint[i] - attitude[i])
+                                          : angle_setpoint[i];
+    }
+}
+
+#if FC_USE_FIXED_POINT
+void cascade_update_q16(cascade_controller_t *ctrl, const float *angle_setpoint, const float *attitude,
+                        const q16_t *gyro_rate, uint32_t now_us, q16_t *output) {
+    bool run_angle_loop = begin_update(ctrl, now_us);
+
+    // Only the decimated angle loop converts its float inputs
+    if (run_angle_loop) {
+        float measured[PID_AXIS_COUNT];
+        wrap_attitude(ctrl, angle_setpoint, attitude, measured);
+
+        q16_t setpoint_q16[PID_AXIS_COUNT];
+        q16_t attitude_q16[PID_AXIS_COUNT];
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            setpoint_q16[i] = q16_from_float(angle_setpoint[i]);
+            attitude_q16[i] = q16_from_float(measured[i]);
+        }
+
+        pid_compute_axes_q16(&ctrl->angle_pid, setpoint_q16, attitude_q16, ctrl->rate_setpoint,
+                             period_to_dt_q31(ctrl->angle_dt_us), period_to_inv_dt_q16(ctrl->angle_dt_us));
+
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            ctrl->rate_setpoint[i] = constrain_q16(ctrl->rate_setpoint[i], -ctrl->max_rate, ctrl->max_rate);
+        }
+    }
+
+    pid_compute_axes_q16(&ctrl->rate_pid, ctrl->rate_setpoint, gyro_rate, output,
+                         period_to_dt_q31(ctrl->rate_dt_us), period_to_inv_dt_q16(ctrl->rate_dt_us));
+
+    end_update(ctrl, now_us, run_angle_loop);
+}
+
+void cascade_update(cascade_controller_t *ctrl, const float *angle_setpoint, const float *attitude,
+                    const float *gyro_rate, uint32_t now_us, float *output) {
+    q16_t gyro_q16[PID_AXIS_COUNT];
+    q16_t output_q16[PID_AXIS_COUNT];
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        gyro_q16[i] = q16_from_float(gyro_rate[i]);
+    }
+
+    cascade_update_q16(ctrl, angle_setpoint, attitude, gyro_q16, now_us, output_q16);
+
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        output[i] = q16_to_float(output_q16[i]);
+    }
+}
+#else
+void cascade_update(cascade_controller_t *ctrl, const float *angle_setpoint, const float *attitude,
+                    const float *gyro_rate, uint32_t now_us, float *output) {
+    bool run_angle_loop = begin_update(ctrl, now_us);
+
+    if (run_angle_loop) {
+        float measured[PID_AXIS_COUNT];
+        wrap_attitude(ctrl, angle_setpoint, attitude, measured);
+
+        pid_compute_axes(&ctrl->angle_pid, angle_setpoint, measured, ctrl->rate_setpoint,
+                         (float)ctrl->angle_dt_us * 1e-6f);
+
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            ctrl->rate_setpoint[i] = constrain(ctrl->rate_setpoint[i], -ctrl->max_rate, ctrl->max_rate);
+        }
+    }
+
+    pid_compute_axes(&ctrl->rate_pid, ctrl->rate_setpoint, gyro_rate, output,
+                     (float)ctrl->rate_dt_us * 1e-6f);
+
+    end_update(ctrl, now_us, run_angle_loop);
+}
+#endif
+
+float cascade_get_rate_dt(const cascade_controller_t *ctrl) {
+    return (float)ctrl->rate_dt_us * 1e-6f;
+}
+
+float cascade_get_angle_dt(const cascade_controller_t *ctrl) {
+    return (float)ctrl->angle_dt_us * 1e-6f;
+}
+
+void cascade_get_rate_setpoint(const cascade_controller_t *ctrl, float *rate_setpoint) {
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+#if FC_USE_FIXED_POINT
+        rate_setpoint[i] = q16_to_float(ctrl->rate_setpoint[i]);
+#else
+        rate_setpoint[i] = ctrl->rate_setpoint[i];
+#endif
+    }
+}
+
+void cascade_get_rate_terms(const cascade_controller_t *ctrl, const float *output,
+                            float *p_term, float *i_term, float *d_term) {
+    // prev_error holds the error of the last iteration; D is what remains of
+    // the output, so the controller stores nothing extra per iteration
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+#if FC_USE_FIXED_POINT
+        p_term[i] = q16_to_float(q16_mul(ctrl->rate_pid.kp[i], ctrl->rate_pid.prev_error[i]));
+        i_term[i] = q16_to_float(q16_mul(ctrl->rate_pid.ki[i], ctrl->rate_pid.integral[i]));
+#else
+        p_term[i] = ctrl->rate_pid.kp[i] * ctrl->rate_pid.prev_error[i];
+        i_term[i] = ctrl->rate_pid.ki[i] * ctrl->rate_pid.integral[i];
+#endif
+        d_term[i] = output[i] - p_term[i] - i_term[i];
+    }
+}
+
+const timing_jitter_t *cascade_get_rate_jitter(const cascade_controller_t *ctrl) {
+    return &ctrl->rate_jitter;
+}
@@ -0,0 +1,104 @@
+//
+//  cascade_controller.h
+//  DroneFlightController
+//
+//  Cascaded attitude controller: an outer angle loop produces rate
+//  setpoints for an inner rate loop that runs on raw gyro data. The angle
+//  loop is decimated from the rate loop and each loop measures its own dt.
+//
+
+#ifndef CASCADE_CONTROLLER_H
+#define CASCADE_CONTROLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pid_controller.h"
+#include "utils/timing.h"
+
+typedef struct {
+#if FC_USE_FIXED_POINT
+    pid_axes_q16_t angle_pid;                 // Outer loop: angle error -> rate setpoint
+    pid_axes_q16_t rate_pid;                  // Inner loop: rate error -> actuator command
+    q16_t rate_setpoint[PID_AXIS_COUNT];      // Latest angle loop output (rad/s)
+    q16_t max_rate;                           // Rate setpoint limit (rad/s)
+#else
+    pid_axes_t angle_pid;                     // Outer loop: angle error -> rate setpoint
+    pid_axes_t rate_pid;                      // Inner loop: rate error -> actuator command
+    float rate_setpoint[PID_AXIS_COUNT];      // Latest angle loop output (rad/s)
+    float max_rate;                           // Rate setpoint limit (rad/s)
+#endif
+    bool angle_hold[PID_AXIS_COUNT];          // Axes flown by the angle loop, the others hold zero rate
+    uint32_t angle_divisor;                   // Rate loop iterations per angle loop iteration
+    uint32_t iteration;                       // Rate loop iteration counter
+    uint32_t nominal_period_us;               // Rate loop period used before the first measurement
+    uint32_t last_rate_us;                    // Timestamp of the previous rate loop iteration
+    uint32_t last_angle_us;                   // Timestamp of the previous angle loop iteration
+    uint32_t rate_dt_us;                      // Last measured rate loop dt
+    uint32_t angle_dt_us;                     // Last measured angle loop dt
+    timing_jitter_t rate_jitter;              // Measured rate loop periods
+    bool started;                             // False until the first update
+} cascade_controller_t;
+
+// Initialize both loops with cleared state and zero gains
+// rate_loop_hz seeds dt for the very first iteration
+void cascade_init(cascade_controller_t *ctrl, uint32_t rate_loop_hz, uint32_t angle_divisor, float max_rate);
+
+// Set the gains of the outer angle loop for one axis
+void cascade_set_angle_gains(cascade_controller_t *ctrl, pid_axis_t axis, float p_gain, float i_gain, float d_gain);
+
+// Set the gains of the inner rate loop for one axis
+void cascade_set_rate_gains(cascade_controller_t *ctrl, pid_axis_t axis, float p_gain, float i_gain, float d_gain);
+
+// Attach PID_AXIS_COUNT D-term filter chains to the rate loop, or NULL for none
+void cascade_set_dterm_filter(cascade_controller_t *ctrl, filter_chain_t *filters);
+
+// Change the angle loop decimation, e.g. after a loop rate change
+void cascade_set_angle_divisor(cascade_controller_t *ctrl, uint32_t angle_divisor);
+
+// Change the nominal rate loop frequency, e.g. after a loop rate change
+// Restarts the rate loop jitter histogram around the new period.
+void cascade_set_rate_loop_hz(cascade_controller_t *ctrl, uint32_t rate_loop_hz);
+
+// Fly one axis by the angle loop, or rate-only with a zero rate setpoint,
+// e.g. yaw while no heading reference is available; every axis starts
+// with the angle loop. A change clears that axis' angle loop state.
+void cascade_set_angle_hold(cascade_controller_t *ctrl, pid_axis_t axis, bool hold);
+
+// Clear the integrators and derivative history of both loops
+void cascade_reset(cascade_controller_t *ctrl);
+
+// True when the next cascade_update() will also run the angle loop, so
+// callers can skip preparing the attitude input otherwise
+bool cascade_angle_loop_due(const cascade_controller_t *ctrl);
+
+// Run one rate loop iteration, and the angle loop when it is due
+// angle_setpoint and attitude are in rad, gyro_rate in rad/s, all indexed by pid_axis_t;
+// angle errors are wrapped to +-pi, so yaw turns the short way
+// now_us is the timestamp of the gyro sample driving this iteration
+void cascade_update(cascade_controller_t *ctrl, const float *angle_setpoint, const float *attitude,
+                    const float *gyro_rate, uint32_t now_us, float *output);
+
+#if FC_USE_FIXED_POINT
+// cascade_update() with the rate loop input and output in Q16, for callers
+// that keep the rate path in fixed point from the gyro to the motors.
+// The angle loop converts its float inputs only on the iterations it runs.
+void cascade_update_q16(cascade_controller_t *ctrl, const float *angle_setpoint, const float *attitude,
+                        const q16_t *gyro_rate, uint32_t now_us, q16_t *output);
+#endif
+
+// Last measured loop periods in seconds
+float cascade_get_rate_dt(const cascade_controller_t *ctrl);
+float cascade_get_angle_dt(const cascade_controller_t *ctrl);
+
+// Rate setpoints from the last angle loop iteration in rad/s
+void cascade_get_rate_setpoint(const cascade_controller_t *ctrl, float *rate_setpoint);
+
+// P, I and D contributions of the last rate loop iteration, per axis
+// output is what that cascade_update() returned.
+void cascade_get_rate_terms(const cascade_controller_t *ctrl, const float *output,
+                            float *p_term, float *i_term, float *d_term);
+
+// Histogram of measured rate loop periods, bins of 1% of the nominal period
+const timing_jitter_t *cascade_get_rate_jitter(const cascade_controller_t *ctrl);
+
+#endif /* CASCADE_CONTROLLER_H */
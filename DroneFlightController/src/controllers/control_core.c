@@ -0,0 +1,177 @@
+//
+//  control_core.c
+//  DroneFlightController
+//
+
+#include "control_core.h"
+#include "flight_pipeline.h"
+#include "imu_data_ready.h"
+#include "utils/spsc_ring.h"
+#include "utils/profiler.h"
+#include "config/control_config.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+// Message types
+#define CONTROL_CORE_MSG_STATUS     1   // value.u[] runs, latency, max latency
+#define CONTROL_CORE_MSG_ARM        2   // value.u[0] 1 to arm, 0 to disarm
+
+// One fixed-size message, the meaning of the payload depends on type
+typedef struct {
+    uint32_t type;
+    union {
+        float f[3];
+        uint32_t u[3];
+    } value;
+} control_core_message_t;
+
+static_assert(sizeof(control_core_message_t) == CONTROL_CORE_MESSAGE_BYTES, "CONTROL_CORE_MESSAGE_BYTES is stale");
+
+// Core 0 -> core 1 set-points, single aligned words in shared SRAM that
+// core 1 reads every pass. Only the newest value matters, so unlike a
+// queued message a change can never be lost.
+static volatile float command_throttle = 0.0f;
+static volatile bool command_failsafe = false;
+
+// Core 0 -> core 1 arm and disarm commands, applied in order by the
+// pipeline, which alone talks to the ESCs. Core 0 remembers the last state
+// it queued and queues again on the next call if the ring was full.
+static SpscRing<control_core_message_t, CONTROL_CORE_COMMAND_SLOTS> command_ring;
+static bool queued_armed = false;
+
+// Core 1 -> core 0 status
+static SpscRing<control_core_message_t, CONTROL_CORE_STATUS_SLOTS> status_ring;
+
+// Set by the data-ready interrupt on core 1
+static volatile bool sample_pending = false;
+
+static void control_core_data_ready(uint32_t timestamp_us) {
+    (void)timestamp_us;
+    sample_pending = true;
+}
+
+// Hand the newest core 0 state to the pipeline before each pass
+static void control_core_apply_commands(void) {
+    control_core_message_t message;
+    while (command_ring.pop(message)) {
+        if (message.type == CONTROL_CORE_MSG_ARM) {
+            flight_pipeline_set_armed(message.value.u[0] != 0);
+        }
+    }
+    flight_pipeline_set_throttle(command_throttle);
+    flight_pipeline_set_failsafe(command_failsafe);
+}
+
+static void control_core_main(void) {
+    // Flash writes from either core must be able to park this one
+    multicore_lockout_victim_init();
+
+    // The IMU interrupt is enabled on the core that initializes it
+    bool ok = flight_pipeline_init();
+    if (ok) {
+        imu_data_ready_set_callback(control_core_data_ready);
+    }
+    multicore_fifo_push_blocking(ok ? 1u : 0u);
+    if (!ok) {
+        while (1) {
+            __wfe();
+        }
+    }
+
+    uint32_t runs = 0;
+    uint32_t max_latency_us = 0;
+    profiler_init_probe(PROFILER_PROBE_CONTROL, "control", CONTROL_RATE_LOOP_PERIOD_US);
+
+    while (1) {
+        // Any interrupt wakes the core, so an edge between the check and
+        // the wait is not lost
+        while (!sample_pending) {
+            __wfe();
+        }
+        sample_pending = false;
+
+        PROFILER_BEGIN(PROFILER_PROBE_CONTROL);
+        control_core_apply_commands();
+        if (!flight_pipeline_run()) {
+            continue;
+        }
+        PROFILER_END(PROFILER_PROBE_CONTROL);
+
+        runs++;
+        uint32_t latency_us = flight_pipeline_get_latency_us();
+        if (latency_us > max_latency_us) {
+            max_latency_us = latency_us;
+        }
+
+        if (runs % CONTROL_CORE_STATUS_DIVISOR == 0) {
+            control_core_message_t status;
+            status.type = CONTROL_CORE_MSG_STATUS;
+            status.value.u[0] = runs;
+            status.value.u[1] = latency_us;
+            status.value.u[2] = max_latency_us;
+            // A full ring only means core 0 has not looked in a while
+            if (status_ring.push(status)) {
+                max_latency_us = 0;
+            }
+        }
+    }
+}
+
+bool control_core_start(void) {
+    command_throttle = 0.0f;
+    command_failsafe = false;
+    command_ring.reset();
+    queued_armed = false;
+    status_ring.reset();
+
+    // The inter-core FIFO carries only the launch handshake, afterwards it
+    // belongs to the flash lockout
+    multicore_launch_core1(control_core_main);
+    if (multicore_fifo_pop_blocking() == 0) {
+        multicore_reset_core1();
+        return false;
+    }
+
+    // Let core 1 pause this core while it writes calibration to flash
+    multicore_lockout_victim_init();
+    return true;
+}
+
+void control_core_set_throttle(float throttle) {
+    command_throttle = throttle;
+}
+
+void control_core_set_armed(bool armed) {
+    if (armed == queued_armed) {
+        return;
+    }
+    control_core_message_t command;
+    command.type = CONTROL_CORE_MSG_ARM;
+    command.value.u[0] = armed ? 1u : 0u;
+    if (command_ring.push(command)) {
+        queued_armed = armed;
+    }
+}
+
+void control_core_set_failsafe(bool active) {
+    command_failsafe = active;
+}
+
+bool control_core_get_status(control_core_status_t *status) {
+    // Newest counters, and the worst latency over every report taken
+    control_core_message_t message;
+    bool received = false;
+    while (status_ring.pop(message)) {
+        if (message.type == CONTROL_CORE_MSG_STATUS) {
+            uint32_t max_latency_us = message.value.u[2];
+            if (received && status->max_latency_us > max_latency_us) {
+                max_latency_us = status->max_latency_us;
+            }
+            status->runs = message.value.u[0];
+            status->latency_us = message.value.u[1];
+            status->max_latency_us = max_latency_us;
+            received = true;
+        }
+    }
+    return received;
+}
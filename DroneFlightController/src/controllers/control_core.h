@@ -0,0 +1,54 @@
+//
+//  control_core.h
+//  DroneFlightController
+//
+//  Runs the flight pipeline bare-metal on RP2040 core 1. Core 1 sleeps
+//  until the IMU data-ready interrupt and then runs one pipeline pass, so
+//  the loop rate is set by the sensor and the compute time rather than the
+//  RTOS tick. Throttle and failsafe are single words in shared SRAM that
+//  core 1 reads before every pass; arm and disarm go to core 1 as commands
+//  and status returns, each through a lock-free SPSC ring. Core 1 is the
+//  only user of the ESC bus.
+//
+
+#ifndef control_core_h
+#define control_core_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Pipeline status reported by core 1
+typedef struct {
+    uint32_t runs;             // Pipeline passes completed
+    uint32_t latency_us;       // Sample-to-motor latency of the last pass
+    uint32_t max_latency_us;   // Worst latency since the previous report
+} control_core_status_t;
+
+// Ring depths and the size of one message; the rings and their indices are
+// the static RAM counted by the RAM budget
+#define CONTROL_CORE_COMMAND_SLOTS  4
+#define CONTROL_CORE_STATUS_SLOTS   16
+#define CONTROL_CORE_MESSAGE_BYTES  16
+#define CONTROL_CORE_RAM_BYTES \
+    ((CONTROL_CORE_COMMAND_SLOTS + CONTROL_CORE_STATUS_SLOTS) * CONTROL_CORE_MESSAGE_BYTES + 4 * sizeof(uint32_t))
+
+// Launch core 1 and wait for it to initialize the pipeline
+// Returns false if the pipeline failed to initialize; core 1 is then held
+// in reset.
+bool control_core_start(void);
+
+// Core 0 side, non-blocking; each overwrites the previous value and core 1
+// picks up the newest on its next pass
+void control_core_set_throttle(float throttle);
+void control_core_set_failsafe(bool active);
+
+// Queue an arm or disarm command for core 1 when the state changes; call
+// on every receiver update, a command the full ring refused is retried
+void control_core_set_armed(bool armed);
+
+// Newest status reported by core 1, with the worst latency of every report
+// since the last call
+// Returns false if nothing new arrived since the last call.
+bool control_core_get_status(control_core_status_t *status);
+
+#endif /* control_core_h */
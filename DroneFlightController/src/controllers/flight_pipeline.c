@@ -0,0 +1,433 @@
+//
+//  flight_pipeline.c
+//  DroneFlightController
+//
+
+#define LOG_MODULE LOG_MODULE_CONTROL
+
+#include "flight_pipeline.h"
+#include "cascade_controller.h"
+#include "mixer.h"
+#include "sensor_fusion.h"
+#include "gyro_analyzer.h"
+#include "esc.h"
+#include "failsafe.h"
+#include "utils/math_utils.h"
+#include "utils/filter_bank.h"
+#include "utils/deadline_monitor.h"
+#include "utils/seqlock.h"
+#include "utils/profiler.h"
+#include "utils/blackbox.h"
+#include "utils/logger.h"
+#include "config/control_config.h"
+
+// Constants for target angles
+#define TARGET_ROLL     0.0f   // Target roll angle in radians
+#define TARGET_PITCH    0.0f   // Target pitch angle in radians
+#define TARGET_YAW      0.0f   // Target yaw angle in radians
+
+// ESC pulse range for motor outputs 0 to 1
+#define ESC_MIN_US      1000.0f
+#define ESC_MAX_US      2000.0f
+
+// Rate path values from the filtered gyro to the ESC pulse: Q16 on the
+// fixed-point path, so the gyro is converted once at the sensor boundary
+#if FC_USE_FIXED_POINT
+typedef q16_t pipeline_value_t;
+#define PIPELINE_TO_FLOAT(x) q16_to_float(x)
+#else
+typedef float pipeline_value_t;
+#define PIPELINE_TO_FLOAT(x) (x)
+#endif
+
+// Filter chains for fixed configurations, coefficients computed at compile time
+static filter_chain_t gyro_filter[PID_AXIS_COUNT] = { GYRO_FILTER_CHAIN, GYRO_FILTER_CHAIN, GYRO_FILTER_CHAIN };
+static filter_chain_t dterm_filter[PID_AXIS_COUNT] = { DTERM_FILTER_CHAIN, DTERM_FILTER_CHAIN, DTERM_FILTER_CHAIN };
+
+#if DYN_NOTCH_ENABLED
+// Gyro spectrum analyzer retuning the dynamic notches in gyro_filter
+static gyro_analyzer_t gyro_analyzer;
+#endif
+
+static cascade_controller_t controller;
+
+// Attitude is refreshed at the angle loop rate
+static float attitude[PID_AXIS_COUNT] = {0.0f, 0.0f, 0.0f};
+
+// Written by the receiver, a single aligned word read once per run
+static volatile float throttle_command = 0.0f;
+
+// Set by the receiver; the motors are only written while armed
+static volatile bool armed = false;
+static bool was_armed = false;
+
+// The pipeline is the only user of the ESC bus: arming, disarming and
+// throttle writes all happen here. esc_armed is what the ESCs were last
+// told, esc_ok whether the last transfer went through.
+static bool esc_armed = false;
+static volatile bool esc_ok = true;
+
+#if FC_CONTROL_ON_CORE1
+// Failsafe state forwarded from core 0
+static volatile bool failsafe_active = false;
+#endif
+
+static uint32_t latency_us = 0;
+static timing_jitter_t latency;
+
+// Overrun detection and the loop rate step currently in use
+static deadline_monitor_t deadline;
+static uint8_t rate_step = 0;
+static uint8_t base_rate_step = 0;    // Last requested step, recovery stops there
+static uint32_t headroom_runs = 0;    // Consecutive runs with headroom at the faster rate
+static volatile uint8_t requested_rate_step = 0;
+static volatile uint32_t loop_rate_hz = CONTROL_RATE_LOOP_HZ;
+static uint32_t rejected_rate_hz = 0;  // Last rate the IMU refused, logged once
+
+// Copy of the overrun counters for readers on the other core, republished
+// after every run
+static seqlock_t deadline_lock;
+static deadline_monitor_t published_deadline;
+static const int DEADLINE_READ_ATTEMPTS = 4;
+
+// Move the whole loop to rate step n: IMU output rate, every filter
+// coefficient, the analyzer, the angle loop decimation and the deadline
+static bool apply_rate_step(uint8_t step) {
+    uint32_t rate_hz = CONTROL_RATE_LOOP_HZ >> step;
+    uint32_t angle_divisor = CONTROL_ANGLE_LOOP_DIVISOR >> step;
+    if (angle_divisor == 0) {
+        angle_divisor = 1;
+    }
+
+    if (!setSensorSampleRate(rate_hz)) {
+        if (rate_hz != rejected_rate_hz) {
+            LOG_MSG(LOG_ERROR, "IMU rejected %lu Hz", (unsigned long)rate_hz);
+            rejected_rate_hz = rate_hz;
+        }
+        return false;
+    }
+
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        filter_chain_set_sample_rate(&gyro_filter[i], (float)rate_hz);
+        filter_chain_set_sample_rate(&dterm_filter[i], (float)rate_hz);
+    }
+#if DYN_NOTCH_ENABLED
+    // Clamps the notch centers to the new Nyquist limit
+    gyro_analyzer_set_loop_rate(&gyro_analyzer, (float)rate_hz,
+                                (float)(rate_hz < GYRO_ANALYZER_SAMPLE_HZ ? rate_hz : GYRO_ANALYZER_SAMPLE_HZ));
+#endif
+    cascade_set_rate_loop_hz(&controller, rate_hz);
+    cascade_set_angle_divisor(&controller, angle_divisor);
+
+    uint32_t period_us = 1000000 / rate_hz;
+    deadline_monitor_set_deadline(&deadline, period_us);
+    timing_jitter_init(&latency, period_us / 2, period_us / TIMING_JITTER_BINS);
+    profiler_init_probe(PROFILER_PROBE_CONTROL, "control", period_us);
+
+    rate_step = step;
+    requested_rate_step = step;
+    headroom_runs = 0;
+    loop_rate_hz = rate_hz;
+    LOG_MSG(LOG_DEBUG, "Loop rate step %u: %lu Hz, angle every %lu", (unsigned)step,
+            (unsigned long)rate_hz, (unsigned long)angle_divisor);
+    return true;
+}
+
+#if FC_BLACKBOX_ENABLED
+// Fill the blackbox fields that are due; plain copies, no formatting
+static void record_frame(blackbox_frame_t *frame, uint8_t fields, const pipeline_value_t *gyro_rate,
+                         const pipeline_value_t *pid_output, const uint16_t *esc_us) {
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_GYRO)) {
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            frame->gyro[i] = PIPELINE_TO_FLOAT(gyro_rate[i]);
+        }
+    }
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_ATTITUDE)) {
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            frame->attitude[i] = attitude[i];
+        }
+    }
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_SETPOINT)) {
+        cascade_get_rate_setpoint(&controller, frame->setpoint);
+        frame->setpoint[PID_AXIS_COUNT] = throttle_command;
+    }
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_PID)) {
+        float output[PID_AXIS_COUNT];
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            output[i] = PIPELINE_TO_FLOAT(pid_output[i]);
+        }
+        cascade_get_rate_terms(&controller, output, frame->pid_p, frame->pid_i, frame->pid_d);
+    }
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_MOTOR)) {
+        for (int m = 0; m < MIXER_MOTOR_COUNT; m++) {
+            frame->motor[m] = esc_us[m];
+        }
+    }
+}
+#else
+#define record_frame(frame, fields, gyro_rate, pid_output, esc_us)  ((void)0)
+#endif
+
+// Arm or disarm every ESC; false if any of them did not take the command,
+// which is then sent again on the next run
+static bool set_escs_armed(bool arm) {
+    bool ok = true;
+    for (uint8_t channel = 1; channel <= MIXER_MOTOR_COUNT; channel++) {
+        ok &= (arm ? esc_arm(channel) : esc_disarm(channel)) == ESC_SUCCESS;
+    }
+    if (ok) {
+        esc_armed = arm;
+    }
+    return ok;
+}
+
+static void publish_deadline(void) {
+    seqlock_write_begin(&deadline_lock);
+    published_deadline = deadline;
+    seqlock_write_end(&deadline_lock);
+}
+
+// ESC pulse width for a motor output in [0, 1]
+static uint16_t motor_to_esc_us(pipeline_value_t motor) {
+#if FC_USE_FIXED_POINT
+    return (uint16_t)q16_to_int(map_unit_q16(motor, Q16_CONST(ESC_MIN_US), Q16_CONST(ESC_MAX_US)));
+#else
+    return (uint16_t)map(motor, 0.0f, 1.0f, ESC_MIN_US, ESC_MAX_US);
+#endif
+}
+
+bool flight_pipeline_init(void) {
+    // Initialize and calibrate the IMU owned by the sensor fusion module
+    if (!initializeSensorFusion()) {
+        LOG_MSG(LOG_ERROR, "Sensor fusion initialization failed");
+        return false;
+    }
+
+    esc_config_t esc_config = {1, 1000, 2000, 1500};
+    if (esc_init(&esc_config) != ESC_SUCCESS) {
+        LOG_MSG(LOG_ERROR, "ESC initialization failed");
+        return false;
+    }
+
+    // Cascaded controller: angle loop decimated from the gyro rate loop
+    cascade_init(&controller, CONTROL_RATE_LOOP_HZ, CONTROL_ANGLE_LOOP_DIVISOR, CONTROL_MAX_RATE);
+
+    cascade_set_angle_gains(&controller, PID_AXIS_ROLL, ANGLE_ROLL_P, ANGLE_ROLL_I, ANGLE_ROLL_D);
+    cascade_set_angle_gains(&controller, PID_AXIS_PITCH, ANGLE_PITCH_P, ANGLE_PITCH_I, ANGLE_PITCH_D);
+    cascade_set_angle_gains(&controller, PID_AXIS_YAW, ANGLE_YAW_P, ANGLE_YAW_I, ANGLE_YAW_D);
+
+    cascade_set_rate_gains(&controller, PID_AXIS_ROLL, RATE_ROLL_P, RATE_ROLL_I, RATE_ROLL_D);
+    cascade_set_rate_gains(&controller, PID_AXIS_PITCH, RATE_PITCH_P, RATE_PITCH_I, RATE_PITCH_D);
+    cascade_set_rate_gains(&controller, PID_AXIS_YAW, RATE_YAW_P, RATE_YAW_I, RATE_YAW_D);
+    cascade_set_dterm_filter(&controller, dterm_filter);
+
+#if DYN_NOTCH_ENABLED
+    // A full chain only loses the dynamic notch, the static filters remain
+    gyro_analyzer_init(&gyro_analyzer, gyro_filter, DYN_NOTCH_COUNT, DYN_NOTCH_Q,
+                       CONTROL_RATE_LOOP_HZ, GYRO_ANALYZER_SAMPLE_HZ,
+                       DYN_NOTCH_MIN_HZ, DYN_NOTCH_MAX_HZ, GYRO_ANALYZER_WORK_PER_STEP);
+#endif
+
+    timing_jitter_init(&latency, CONTROL_RATE_LOOP_PERIOD_US / 2, CONTROL_RATE_LOOP_PERIOD_US / TIMING_JITTER_BINS);
+    deadline_monitor_init(&deadline, CONTROL_RATE_LOOP_PERIOD_US, CONTROL_DEADLINE_OVERRUN_LIMIT);
+    seqlock_init(&deadline_lock);
+    publish_deadline();
+    return true;
+}
+
+bool flight_pipeline_run(void) {
+    // Rate changes are applied between samples by the pipeline itself. A
+    // step the IMU rejects is dropped, the loop stays where it was.
+    uint8_t step = requested_rate_step;
+    if (step != rate_step) {
+        if (apply_rate_step(step)) {
+            base_rate_step = step;
+        } else {
+            requested_rate_step = rate_step;
+        }
+    }
+
+    // Fuse the newest sample; both the estimator and the PID loops use
+    // dt measured between data-ready timestamps
+    if (!updateOrientation()) {
+        return false;
+    }
+    uint32_t sample_us = getSampleTimestamp();
+
+    // Start every flight from clean integrators and loop timing
+    bool run_armed = armed;
+    if (run_armed && !was_armed) {
+        cascade_reset(&controller);
+    }
+    was_armed = run_armed;
+
+    // Euler angles are only derived when the angle loop needs them. Yaw
+    // without a heading reference is drifting gyro integration, so it is
+    // flown rate-only until the magnetometer corrects it again.
+    if (cascade_angle_loop_due(&controller)) {
+        getFilteredOrientation(&attitude[PID_AXIS_ROLL], &attitude[PID_AXIS_PITCH], &attitude[PID_AXIS_YAW]);
+        cascade_set_angle_hold(&controller, PID_AXIS_YAW, hasHeadingReference());
+    }
+
+    // Read bias-corrected gyro rates
+    float gyro_rate[PID_AXIS_COUNT];
+    getAngularRates(&gyro_rate[PID_AXIS_ROLL], &gyro_rate[PID_AXIS_PITCH], &gyro_rate[PID_AXIS_YAW]);
+
+#if DYN_NOTCH_ENABLED
+    // Analyze the unfiltered gyro and advance the FFT by one bounded step
+    gyro_analyzer_push(&gyro_analyzer, gyro_rate);
+    gyro_analyzer_update(&gyro_analyzer);
+#endif
+
+    // Filter gyro rates through the per-axis chains
+    pipeline_value_t gyro_filtered[PID_AXIS_COUNT];
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+#if FC_USE_FIXED_POINT
+        gyro_filtered[i] = filter_chain_apply(&gyro_filter[i], q16_from_float(gyro_rate[i]));
+#else
+        gyro_filtered[i] = filter_chain_apply(&gyro_filter[i], gyro_rate[i]);
+#endif
+    }
+
+    // Run the rate loop, and the angle loop when it is due, then deadband
+    // and constrain the axis commands and mix them with throttle
+    static const float target[PID_AXIS_COUNT] = {TARGET_ROLL, TARGET_PITCH, TARGET_YAW};
+    pipeline_value_t pid_output[PID_AXIS_COUNT];
+    pipeline_value_t axis_command[PID_AXIS_COUNT];
+    pipeline_value_t motor[MIXER_MOTOR_COUNT];
+#if FC_USE_FIXED_POINT
+    cascade_update_q16(&controller, target, attitude, gyro_filtered, sample_us, pid_output);
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        axis_command[i] = constrain_q16(apply_deadband_q16(pid_output[i], Q16_CONST(0.05)), -Q16_ONE, Q16_ONE);
+    }
+    mixer_mix_q16(constrain_q16(q16_from_float(throttle_command), 0, Q16_ONE), axis_command, motor);
+#else
+    cascade_update(&controller, target, attitude, gyro_filtered, sample_us, pid_output);
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        axis_command[i] = constrain(apply_deadband(pid_output[i], 0.05f), -1.0f, 1.0f);
+    }
+    mixer_mix(constrain(throttle_command, 0.0f, 1.0f), axis_command, motor);
+#endif
+
+    // Check for emergency stop before anything reaches the motors
+#if FC_CONTROL_ON_CORE1
+    bool stop = failsafe_active;
+#else
+    bool stop = isFailsafeActive();
+#endif
+    // Arming commands only reach the ESCs on a change, throttle every run
+    uint16_t esc_us[MIXER_MOTOR_COUNT] = {0};
+    bool motors_on = run_armed && !stop;
+    bool transferred = true;
+    if (motors_on != esc_armed) {
+        transferred = set_escs_armed(motors_on);
+    }
+    if (motors_on) {
+        for (int m = 0; m < MIXER_MOTOR_COUNT; m++) {
+            esc_us[m] = motor_to_esc_us(motor[m]);
+            transferred &= esc_set_throttle((uint8_t)(m + 1), esc_us[m]) == ESC_SUCCESS;
+        }
+    }
+    esc_ok = transferred;
+
+    latency_us = timing_micros() - sample_us;
+    timing_jitter_record(&latency, latency_us);
+
+    // Overrun if the next sample was due before the motors were written,
+    // or if a sample was skipped since the previous run
+    uint32_t period_us = 1000000 / loop_rate_hz;
+    bool skipped = controller.rate_dt_us > period_us + period_us / 2;
+    bool overloaded = deadline_monitor_record(&deadline, latency_us, skipped);
+#if CONTROL_LOOP_RATE_ADAPTIVE
+    if (overloaded) {
+        if (rate_step + 1 < CONTROL_LOOP_RATE_STEPS) {
+            apply_rate_step(rate_step + 1);
+        }
+    } else if (rate_step > base_rate_step) {
+        // Step back up after a step-down once the load has dropped well
+        // below the faster rate's period for long enough
+        uint32_t faster_period_us = period_us / 2;
+        if (skipped || latency_us > faster_period_us * CONTROL_LOOP_RATE_RECOVER_PERCENT / 100) {
+            headroom_runs = 0;
+        } else if (++headroom_runs >= loop_rate_hz * CONTROL_LOOP_RATE_RECOVER_MS / 1000) {
+            apply_rate_step(rate_step - 1);
+        }
+    }
+#else
+    (void)overloaded;
+#endif
+    publish_deadline();
+
+    // Record the fields due this run, after the motors are written
+    blackbox_frame_t frame;
+    uint8_t fields = blackbox_begin(&frame, sample_us);
+    if (fields != 0) {
+        record_frame(&frame, fields, gyro_filtered, pid_output, esc_us);
+        blackbox_commit(&frame);
+    }
+
+    // Persist refined calibration only while disarmed: the flash write
+    // stalls both cores for up to one sector erase. Arming during the
+    // stall only delays the first motor write.
+    if (!run_armed) {
+        saveSensorCalibration();
+    }
+    return true;
+}
+
+void flight_pipeline_set_throttle(float throttle) {
+    throttle_command = throttle;
+}
+
+void flight_pipeline_set_armed(bool arm) {
+    armed = arm;
+}
+
+bool flight_pipeline_is_armed(void) {
+    return armed;
+}
+
+void flight_pipeline_set_failsafe(bool active) {
+#if FC_CONTROL_ON_CORE1
+    failsafe_active = active;
+#else
+    (void)active;
+#endif
+}
+
+bool flight_pipeline_esc_ok(void) {
+    return esc_ok;
+}
+
+uint32_t flight_pipeline_get_latency_us(void) {
+    return latency_us;
+}
+
+void flight_pipeline_request_rate_step(uint8_t step) {
+    if (step < CONTROL_LOOP_RATE_STEPS) {
+        requested_rate_step = step;
+    }
+}
+
+uint32_t flight_pipeline_get_loop_rate_hz(void) {
+    return loop_rate_hz;
+}
+
+bool flight_pipeline_get_deadline(deadline_monitor_t *snapshot) {
+    for (int attempt = 0; attempt < DEADLINE_READ_ATTEMPTS; attempt++) {
+        uint32_t sequence = seqlock_read_begin(&deadline_lock);
+        *snapshot = published_deadline;
+        if (!seqlock_read_retry(&deadline_lock, sequence)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const timing_jitter_t *flight_pipeline_get_latency(void) {
+    return &latency;
+}
+
+const timing_jitter_t *flight_pipeline_get_loop_jitter(void) {
+    return cascade_get_rate_jitter(&controller);
+}
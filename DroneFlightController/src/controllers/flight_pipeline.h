@@ -0,0 +1,84 @@
+//
+//  flight_pipeline.h
+//  DroneFlightController
+//
+//  The per-sample flight path: gyro read and fusion, gyro filtering,
+//  cascaded PID, motor mixing and ESC output, run once per IMU sample by
+//  a single task without queues or locks in between. Latency is measured
+//  from the sample's data-ready edge to the last ESC write.
+//
+
+#ifndef flight_pipeline_h
+#define flight_pipeline_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/timing.h"
+#include "utils/deadline_monitor.h"
+#include "utils/filter_bank.h"
+#include "utils/seqlock.h"
+#include "controllers/cascade_controller.h"
+#include "sensors/gyro_analyzer.h"
+#include "config/control_config.h"
+
+#if DYN_NOTCH_ENABLED
+#define FLIGHT_PIPELINE_ANALYZER_BYTES sizeof(gyro_analyzer_t)
+#else
+#define FLIGHT_PIPELINE_ANALYZER_BYTES 0
+#endif
+
+// Static RAM of the gyro and D-term chains, the analyzer, the controller,
+// the attitude and the timing records, for the RAM budget
+#define FLIGHT_PIPELINE_RAM_BYTES \
+    (2 * PID_AXIS_COUNT * sizeof(filter_chain_t) + FLIGHT_PIPELINE_ANALYZER_BYTES + sizeof(cascade_controller_t) + \
+     PID_AXIS_COUNT * sizeof(float) + sizeof(timing_jitter_t) + 2 * sizeof(deadline_monitor_t) + sizeof(seqlock_t))
+
+// Initialize the sensors, controller, filters and ESCs
+bool flight_pipeline_init(void);
+
+// Take the newest IMU sample through to the motors
+// Returns false if no new sample was available.
+bool flight_pipeline_run(void);
+
+// Collective throttle in [0, 1] from the receiver, read on the next run
+void flight_pipeline_set_throttle(float throttle);
+
+// Arming state from the receiver, read on the next run. Disarmed, the
+// pipeline keeps filtering and estimating but writes no motor outputs, and
+// only then may anything program flash.
+void flight_pipeline_set_armed(bool arm);
+bool flight_pipeline_is_armed(void);
+
+// Failsafe state from core 0 when the pipeline runs on core 1; on a single
+// core the pipeline reads the failsafe module directly
+void flight_pipeline_set_failsafe(bool active);
+
+// Whether the last ESC transfer succeeded. The pipeline is the only user
+// of the ESC bus; other tasks check this instead of touching the bus.
+bool flight_pipeline_esc_ok(void);
+
+// Sample-to-motor latency of the last run in microseconds
+uint32_t flight_pipeline_get_latency_us(void);
+
+// Run the loop at CONTROL_RATE_LOOP_HZ >> step from the next sample, e.g.
+// to find the highest rate a configuration sustains; out of range steps
+// are ignored
+void flight_pipeline_request_rate_step(uint8_t step);
+
+// Loop rate in use, lower than configured after overrun step-downs until
+// the load leaves headroom at the faster rate again
+uint32_t flight_pipeline_get_loop_rate_hz(void);
+
+// Consistent copy of the overrun counters, safe from any task or core; an
+// overrun is a sample not through to the motors before the next one was due
+// Returns false if the pipeline kept updating them during every attempt.
+bool flight_pipeline_get_deadline(deadline_monitor_t *snapshot);
+
+// Histogram of sample-to-motor latency, 16 bins spanning one rate loop
+// period from zero; other tasks and cores copy it with timing_jitter_read
+const timing_jitter_t *flight_pipeline_get_latency(void);
+
+// Histogram of measured rate loop periods, read the same way
+const timing_jitter_t *flight_pipeline_get_loop_jitter(void);
+
+#endif /* flight_pipeline_h */
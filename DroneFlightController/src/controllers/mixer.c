@@ -0,0 +1,79 @@
+//
+//  mixer.c
+//  DroneFlightController
+//
+
+#include "mixer.h"
+#include "pid_controller.h"
+
+// Roll, pitch and yaw contribution per motor
+static const int8_t QUAD_X_MIX[MIXER_MOTOR_COUNT][PID_AXIS_COUNT] = {
+    { -1,  1, -1 },  // Rear right, CCW
+    { -1, -1,  1 },  // Front right, CW
+    {  1,  1,  1 },  // Rear left, CW
+    {  1, -1, -1 },  // Front left, CCW
+};
+
+void mixer_mix(float throttle, const float *axis, float *motor) {
+    float mix[MIXER_MOTOR_COUNT];
+    float mix_min = 0.0f, mix_max = 0.0f;
+    for (int m = 0; m < MIXER_MOTOR_COUNT; m++) {
+        mix[m] = QUAD_X_MIX[m][PID_AXIS_ROLL] * axis[PID_AXIS_ROLL] +
+                 QUAD_X_MIX[m][PID_AXIS_PITCH] * axis[PID_AXIS_PITCH] +
+                 QUAD_X_MIX[m][PID_AXIS_YAW] * axis[PID_AXIS_YAW];
+        if (m == 0 || mix[m] < mix_min) mix_min = mix[m];
+        if (m == 0 || mix[m] > mix_max) mix_max = mix[m];
+    }
+
+    // A spread wider than the motor range is scaled to fit
+    float range = mix_max - mix_min;
+    if (range > 1.0f) {
+        float scale = 1.0f / range;
+        for (int m = 0; m < MIXER_MOTOR_COUNT; m++) {
+            mix[m] *= scale;
+        }
+        mix_min *= scale;
+        mix_max *= scale;
+    }
+
+    // Move throttle just enough that no motor leaves [0, 1]
+    if (throttle < -mix_min) throttle = -mix_min;
+    if (throttle > 1.0f - mix_max) throttle = 1.0f - mix_max;
+
+    for (int m = 0; m < MIXER_MOTOR_COUNT; m++) {
+        motor[m] = throttle + mix[m];
+    }
+}
+
+void mixer_mix_q16(q16_t throttle, const q16_t *axis, q16_t *motor) {
+    q16_t mix[MIXER_MOTOR_COUNT];
+    q16_t mix_min = 0, mix_max = 0;
+    for (int m = 0; m < MIXER_MOTOR_COUNT; m++) {
+        // The table only holds +-1, so each term is an add or a subtract
+        q16_t sum = 0;
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            sum = (QUAD_X_MIX[m][i] > 0) ? q16_add(sum, axis[i]) : q16_sub(sum, axis[i]);
+        }
+        mix[m] = sum;
+        if (m == 0 || mix[m] < mix_min) mix_min = mix[m];
+        if (m == 0 || mix[m] > mix_max) mix_max = mix[m];
+    }
+
+    // One division for the reciprocal, multiplies for the motors
+    q16_t range = q16_sub(mix_max, mix_min);
+    if (range > Q16_ONE) {
+        q16_t scale = q16_div(Q16_ONE, range);
+        for (int m = 0; m < MIXER_MOTOR_COUNT; m++) {
+            mix[m] = q16_mul(mix[m], scale);
+        }
+        mix_min = q16_mul(mix_min, scale);
+        mix_max = q16_mul(mix_max, scale);
+    }
+
+    if (throttle < -mix_min) throttle = -mix_min;
+    if (throttle > Q16_ONE - mix_max) throttle = Q16_ONE - mix_max;
+
+    for (int m = 0; m < MIXER_MOTOR_COUNT; m++) {
+        motor[m] = q16_add(throttle, mix[m]);
+    }
+}
@@ -0,0 +1,26 @@
+//
+//  mixer.h
+//  DroneFlightController
+//
+//  Quad-X motor mixer. Roll, pitch and yaw commands are combined with
+//  throttle per motor; when the result does not fit in the motor range
+//  the axis commands are scaled down together and throttle is shifted,
+//  so attitude authority is kept at low and high throttle.
+//
+
+#ifndef mixer_h
+#define mixer_h
+
+#include "utils/fixed_point.h"
+
+#define MIXER_MOTOR_COUNT 4
+
+// Motor order: rear right, front right, rear left, front left
+// throttle in [0, 1], axis commands in [-1, 1] indexed by pid_axis_t,
+// motor outputs in [0, 1]
+void mixer_mix(float throttle, const float *axis, float *motor);
+
+// mixer_mix() on Q16 values, for the fixed-point rate path
+void mixer_mix_q16(q16_t throttle, const q16_t *axis, q16_t *motor);
+
+#endif /* mixer_h */
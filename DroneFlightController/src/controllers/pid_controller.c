@@ -2,14 +2,8 @@
 #include <stdlib.h>
 #include "pid_controller.h"
 
-// PID controller gains
-static float Kp = 0.0f;  // Proportional gain
-static float Ki = 0.0f;  // Integral gain 
-static float Kd = 0.0f;  // Derivative gain
-
-// Error terms
-static float prev_error = 0.0f;
-static float integral = 0.0f;
+// Controller used by the single-loop pid_* API
+static pid_state_t default_pid = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
 
 // Initial PID values for pitch, roll, and yaw
 static float initial_pitch_p = 0.0f;
@@ -24,41 +18,190 @@ static float initial_yaw_p = 0.0f;
 static float initial_yaw_i = 0.0f;
 static float initial_yaw_d = 0.0f;
 
-void pid_init(float p_gain, float i_gain, float d_gain) {
-    Kp = p_gain;
-    Ki = i_gain;
-    Kd = d_gain;
-    prev_error = 0.0f;
-    integral = 0.0f;
+void pid_state_init(pid_state_t *pid, float p_gain, float i_gain, float d_gain) {
+    pid->kp = p_gain;
+    pid->ki = i_gain;
+    pid->kd = d_gain;
+    pid_state_reset(pid);
 }
 
-float pid_compute(float setpoint, float measured_value, float dt) {
+float pid_state_compute(pid_state_t *pid, float setpoint, float measured_value, float dt) {
     // Calculate error
     float error = setpoint - measured_value;
-    
+
     // Proportional term
-    float p_term = Kp * error;
-    
+    float p_term = pid->kp * error;
+
     // Integral term
-    integral += error * dt;
-    float i_term = Ki * integral;
-    
+    pid->integral += error * dt;
+    float i_term = pid->ki * pid->integral;
+
     // Derivative term
-    float derivative = (error - prev_error) / dt;
-    float d_term = Kd * derivative;
-    
+    float derivative = (error - pid->prev_error) / dt;
+    float d_term = pid->kd * derivative;
+
     // Save error for next iteration
-    prev_error = error;
-    
+    pid->prev_error = error;
+
     // Calculate total output
-    float output = p_term + i_term + d_term;
-    
-    return output;
+    return p_term + i_term + d_term;
+}
+
+void pid_state_reset(pid_state_t *pid) {
+    pid->prev_error = 0.0f;
+    pid->integral = 0.0f;
+}
+
+void pid_axes_init(pid_axes_t *pid) {
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        pid->kp[i] = 0.0f;
+        pid->ki[i] = 0.0f;
+        pid->kd[i] = 0.0f;
+    }
+#if !FC_USE_FIXED_POINT
+    pid->dterm_filter = NULL;
+#endif
+    pid_axes_reset(pid);
+}
+
+void pid_axes_set_gains(pid_axes_t *pid, pid_axis_t axis, float p_gain, float i_gain, float d_gain) {
+    if (axis >= PID_AXIS_COUNT) {
+        return;
+    }
+    pid->kp[axis] = p_gain;
+    pid->ki[axis] = i_gain;
+    pid->kd[axis] = d_gain;
+}
+
+void pid_axes_reset(pid_axes_t *pid) {
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        pid->integral[i] = 0.0f;
+        pid->prev_error[i] = 0.0f;
+    }
+#if !FC_USE_FIXED_POINT
+    if (pid->dterm_filter != NULL) {
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            filter_chain_reset(&pid->dterm_filter[i]);
+        }
+    }
+#endif
+}
+
+#if !FC_USE_FIXED_POINT
+void pid_axes_set_dterm_filter(pid_axes_t *pid, filter_chain_t *filters) {
+    pid->dterm_filter = filters;
+}
+#endif
+
+void pid_compute_axes(pid_axes_t *pid, const float *setpoint, const float *measured_value,
+                      float *output, float dt) {
+    // One division per loop instead of one per axis
+    const float inv_dt = 1.0f / dt;
+
+    float error[PID_AXIS_COUNT];
+    float derivative[PID_AXIS_COUNT];
+
+    // Branch-free passes over contiguous arrays so the compiler can unroll
+    // or vectorize them
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        error[i] = setpoint[i] - measured_value[i];
+        pid->integral[i] += error[i] * dt;
+        derivative[i] = (error[i] - pid->prev_error[i]) * inv_dt;
+        pid->prev_error[i] = error[i];
+    }
+
+#if !FC_USE_FIXED_POINT
+    if (pid->dterm_filter != NULL) {
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            derivative[i] = filter_chain_apply(&pid->dterm_filter[i], derivative[i]);
+        }
+    }
+#endif
+
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        output[i] = pid->kp[i] * error[i] + pid->ki[i] * pid->integral[i] + pid->kd[i] * derivative[i];
+    }
+}
+
+void pid_axes_q16_init(pid_axes_q16_t *pid) {
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        pid->kp[i] = 0;
+        pid->ki[i] = 0;
+        pid->kd[i] = 0;
+    }
+#if FC_USE_FIXED_POINT
+    pid->dterm_filter = NULL;
+#endif
+    pid_axes_q16_reset(pid);
+}
+
+void pid_axes_q16_set_gains(pid_axes_q16_t *pid, pid_axis_t axis, float p_gain, float i_gain, float d_gain) {
+    if (axis >= PID_AXIS_COUNT) {
+        return;
+    }
+    pid->kp[axis] = q16_from_float(p_gain);
+    pid->ki[axis] = q16_from_float(i_gain);
+    pid->kd[axis] = q16_from_float(d_gain);
+}
+
+void pid_axes_q16_reset(pid_axes_q16_t *pid) {
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        pid->integral[i] = 0;
+        pid->prev_error[i] = 0;
+    }
+#if FC_USE_FIXED_POINT
+    if (pid->dterm_filter != NULL) {
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            filter_chain_reset(&pid->dterm_filter[i]);
+        }
+    }
+#endif
+}
+
+#if FC_USE_FIXED_POINT
+void pid_axes_q16_set_dterm_filter(pid_axes_q16_t *pid, filter_chain_t *filters) {
+    pid->dterm_filter = filters;
+}
+#endif
+
+void pid_compute_axes_q16(pid_axes_q16_t *pid, const q16_t *setpoint, const q16_t *measured_value,
+                          q16_t *output, q31_t dt, q16_t inv_dt) {
+    q16_t error[PID_AXIS_COUNT];
+    q16_t derivative[PID_AXIS_COUNT];
+
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        error[i] = q16_sub(setpoint[i], measured_value[i]);
+        pid->integral[i] = q16_add(pid->integral[i], q16_mul_q31(error[i], dt));
+        derivative[i] = q16_mul(q16_sub(error[i], pid->prev_error[i]), inv_dt);
+        pid->prev_error[i] = error[i];
+    }
+
+#if FC_USE_FIXED_POINT
+    if (pid->dterm_filter != NULL) {
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            derivative[i] = filter_chain_apply(&pid->dterm_filter[i], derivative[i]);
+        }
+    }
+#endif
+
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        q16_t out = q16_mul(pid->kp[i], error[i]);
+        out = q16_add(out, q16_mul(pid->ki[i], pid->integral[i]));
+        out = q16_add(out, q16_mul(pid->kd[i], derivative[i]));
+        output[i] = out;
+    }
+}
+
+void pid_init(float p_gain, float i_gain, float d_gain) {
+    pid_state_init(&default_pid, p_gain, i_gain, d_gain);
+}
+
+float pid_compute(float setpoint, float measured_value, float dt) {
+    return pid_state_compute(&default_pid, setpoint, measured_value, dt);
 }
 
 void pid_reset(void) {
-    prev_error = 0.0f;
-    integral = 0.0f;
+    pid_state_reset(&default_pid);
 }
 
 void set_initial_pid_values(float pitch_p, float pitch_i, float pitch_d,
@@ -77,8 +220,22 @@ void set_initial_pid_values(float pitch_p, float pitch_i, float pitch_d,
     initial_yaw_d = yaw_d;
 }
 
+void pid_axes_load_initial_values(pid_axes_t *pid) {
+    pid_axes_set_gains(pid, PID_AXIS_ROLL, initial_roll_p, initial_roll_i, initial_roll_d);
+    pid_axes_set_gains(pid, PID_AXIS_PITCH, initial_pitch_p, initial_pitch_i, initial_pitch_d);
+    pid_axes_set_gains(pid, PID_AXIS_YAW, initial_yaw_p, initial_yaw_i, initial_yaw_d);
+    pid_axes_reset(pid);
+}
+
+void pid_axes_q16_load_initial_values(pid_axes_q16_t *pid) {
+    pid_axes_q16_set_gains(pid, PID_AXIS_ROLL, initial_roll_p, initial_roll_i, initial_roll_d);
+    pid_axes_q16_set_gains(pid, PID_AXIS_PITCH, initial_pitch_p, initial_pitch_i, initial_pitch_d);
+    pid_axes_q16_set_gains(pid, PID_AXIS_YAW, initial_yaw_p, initial_yaw_i, initial_yaw_d);
+    pid_axes_q16_reset(pid);
+}
+
 void adjust_pid_parameters(float new_p_gain, float new_i_gain, float new_d_gain) {
-    Kp = new_p_gain;
-    Ki = new_i_gain;
-    Kd = new_d_gain;
+    default_pid.kp = new_p_gain;
+    default_pid.ki = new_i_gain;
+    default_pid.kd = new_d_gain;
 }
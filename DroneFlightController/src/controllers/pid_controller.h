@@ -2,6 +2,99 @@
 #define PID_CONTROLLER_H
 
 #include <stdint.h>
+#include "utils/fixed_point.h"
+#include "utils/filter_bank.h"
+
+// Axis indices shared by every per-axis controller array
+typedef enum {
+    PID_AXIS_ROLL = 0,
+    PID_AXIS_PITCH,
+    PID_AXIS_YAW,
+    PID_AXIS_COUNT
+} pid_axis_t;
+
+// State of a single PID loop
+typedef struct {
+    float kp;          // Proportional gain
+    float ki;          // Integral gain
+    float kd;          // Derivative gain
+    float integral;    // Accumulated error
+    float prev_error;  // Error from the previous computation
+} pid_state_t;
+
+// Independent PID state for every axis, stored as a structure of arrays so
+// that pid_compute_axes() updates all axes in one pass
+typedef struct {
+    float kp[PID_AXIS_COUNT];
+    float ki[PID_AXIS_COUNT];
+    float kd[PID_AXIS_COUNT];
+    float integral[PID_AXIS_COUNT];
+    float prev_error[PID_AXIS_COUNT];
+#if !FC_USE_FIXED_POINT
+    filter_chain_t *dterm_filter;     // Optional per-axis D-term filters, NULL for none
+#endif
+} pid_axes_t;
+
+// Fixed-point per-axis PID state for FPU-less targets
+// Gains, errors and integrals are Q16
+typedef struct {
+    q16_t kp[PID_AXIS_COUNT];
+    q16_t ki[PID_AXIS_COUNT];
+    q16_t kd[PID_AXIS_COUNT];
+    q16_t integral[PID_AXIS_COUNT];
+    q16_t prev_error[PID_AXIS_COUNT];
+#if FC_USE_FIXED_POINT
+    filter_chain_t *dterm_filter;     // Optional per-axis D-term filters, NULL for none
+#endif
+} pid_axes_q16_t;
+
+// Initialize a single PID loop with gains and cleared history
+void pid_state_init(pid_state_t *pid, float p_gain, float i_gain, float d_gain);
+
+// Compute the output of a single PID loop
+float pid_state_compute(pid_state_t *pid, float setpoint, float measured_value, float dt);
+
+// Clear the integral term and previous error of a single PID loop
+void pid_state_reset(pid_state_t *pid);
+
+// Initialize every axis with zero gains and cleared history
+void pid_axes_init(pid_axes_t *pid);
+
+// Set the gains of one axis
+void pid_axes_set_gains(pid_axes_t *pid, pid_axis_t axis, float p_gain, float i_gain, float d_gain);
+
+// Clear the integral term and previous error of every axis
+void pid_axes_reset(pid_axes_t *pid);
+
+#if !FC_USE_FIXED_POINT
+// Attach PID_AXIS_COUNT D-term filter chains, or NULL to disable D-term filtering
+void pid_axes_set_dterm_filter(pid_axes_t *pid, filter_chain_t *filters);
+#endif
+
+// Compute PID outputs for all axes in one pass
+// setpoint, measured_value and output are indexed by pid_axis_t
+void pid_compute_axes(pid_axes_t *pid, const float *setpoint, const float *measured_value,
+                      float *output, float dt);
+
+// Initialize every fixed-point axis with zero gains and cleared history
+void pid_axes_q16_init(pid_axes_q16_t *pid);
+
+// Set the gains of one fixed-point axis
+void pid_axes_q16_set_gains(pid_axes_q16_t *pid, pid_axis_t axis, float p_gain, float i_gain, float d_gain);
+
+// Clear the integral term and previous error of every fixed-point axis
+void pid_axes_q16_reset(pid_axes_q16_t *pid);
+
+#if FC_USE_FIXED_POINT
+// Attach PID_AXIS_COUNT D-term filter chains, or NULL to disable D-term filtering
+void pid_axes_q16_set_dterm_filter(pid_axes_q16_t *pid, filter_chain_t *filters);
+#endif
+
+// Compute fixed-point PID outputs for all axes in one pass with saturating arithmetic
+// dt is in Q31 to keep precision at kHz loop rates, inv_dt is 1/dt in Q16
+// so the loop needs no division
+void pid_compute_axes_q16(pid_axes_q16_t *pid, const q16_t *setpoint, const q16_t *measured_value,
+                          q16_t *output, q31_t dt, q16_t inv_dt);
 
 // Initialize PID controller with gains
 void pid_init(float p_gain, float i_gain, float d_gain);
@@ -18,6 +111,10 @@ void set_initial_pid_values(float pitch_p, float pitch_i, float pitch_d,
                             float roll_p, float roll_i, float roll_d,
                             float yaw_p, float yaw_i, float yaw_d);
 
+// Load the values stored by set_initial_pid_values() into a per-axis controller
+void pid_axes_load_initial_values(pid_axes_t *pid);
+void pid_axes_q16_load_initial_values(pid_axes_q16_t *pid);
+
 // Adjust and tune PID parameters as needed
 void adjust_pid_parameters(float new_p_gain, float new_i_gain, float new_d_gain);
 
@@ -1,6 +1,9 @@
+#define LOG_MODULE LOG_MODULE_FAILSAFE
+
 #include <stdbool.h>
 #include <stdint.h>
 #include "failsafe.h"
+#include "utils/logger.h"
 
 // Failsafe state variables
 static bool failsafeEnabled = false;
@@ -23,6 +26,10 @@ bool failsafeCheck(void) {
     uint32_t currentTime = getCurrentTimeMs();
     
     if (currentTime - lastValidSignalTime > FAILSAFE_TIMEOUT_MS) {
+        if (!failsafeEnabled) {
+            LOG_MSG(LOG_WARN, "Failsafe active: no signal for %lu ms",
+                    (unsigned long)(currentTime - lastValidSignalTime));
+        }
         failsafeEnabled = true;
         return true;
     }
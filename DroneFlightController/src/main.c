@@ -1,109 +1,86 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include "STM32F401.h"
-#include "pid_controller.h"
-#include "imu_sensor.h"
-#include "esc.h"
-#include "utils/math_utils.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "flight_pipeline.h"
+#include "rtos/rtos_init.h"
+#include "control_core.h"
+#include "remote_control.h"
+#include "config/control_config.h"
 #include "utils/logger.h"
-#include "failsafe.h" // Added for emergency stop
-
-// Constants for target angles and channels
-#define TARGET_ROLL     0.0f   // Target roll angle in degrees
-#define TARGET_PITCH    0.0f   // Target pitch angle in degrees  
-#define TARGET_YAW      0.0f   // Target yaw angle in degrees
-
-#define ROLL_CHANNEL    0
-#define PITCH_CHANNEL   1
-#define YAW_CHANNEL     2
+#include "utils/blackbox.h"
+#include "utils/trace.h"
+#include "utils/log_store.h"
 
 // Function prototypes
 void SystemClock_Config(void);
 void GPIO_Init(void);
 void UART_Init(void);
-void IMU_Init(void);
-void ESC_Init(void);
 
 int main(void) {
+#if FC_LOG_TO_FLASH
+    // Find the flash log's write head and erase ahead of it, before anything
+    // is logged to flash
+    bool log_store_ok = log_store_init();
+#endif
+
     // Initialize logger
-    logger_init("flight.log", LOG_INFO, LOG_TO_FLASH);
-    logger_log(LOG_INFO, __FILE__, __LINE__, "System startup");
+    bool log_file_ok = logger_init("flight.log", LOG_INFO, FC_LOG_DESTINATION);
+    LOG_TEXT(LOG_INFO, "System startup");
+    if (!log_file_ok) {
+        LOG_TEXT(LOG_WARN, "Log file unavailable, logging to the console");
+    }
+#if FC_LOG_TO_FLASH
+    if (!log_store_ok) {
+        LOG_TEXT(LOG_WARN, "Log store flash erase failed");
+    }
+#endif
+
+    // Unformatted log messages, written out by the log task
+    if (!trace_init("flight.trc", FC_LOG_DESTINATION)) {
+        LOG_TEXT(LOG_WARN, "Trace log unavailable");
+    }
+
+    // Binary flight recorder fed by the pipeline, drained by its own task
+    if (!blackbox_init("flight.bbl", FC_LOG_DESTINATION)) {
+        LOG_TEXT(LOG_WARN, "Blackbox unavailable");
+    }
 
     // Initialize the system clock
     SystemClock_Config();
-    logger_log(LOG_INFO, __FILE__, __LINE__, "Clock configured");
+    LOG_TEXT(LOG_INFO, "Clock configured");
 
     // Initialize peripherals
     GPIO_Init();
     UART_Init();
-    IMU_Init();
-    ESC_Init();
-    
-    logger_log(LOG_INFO, __FILE__, __LINE__, "All peripherals initialized");
-
-    float prev_roll_output = 0.0f;
-    float prev_pitch_output = 0.0f;
-    float prev_yaw_output = 0.0f;
-
-    // Set initial PID values
-    set_initial_pid_values(1.0f, 0.1f, 0.01f,  // Pitch PID values
-                           1.0f, 0.1f, 0.01f,  // Roll PID values
-                           1.0f, 0.1f, 0.01f); // Yaw PID values
-
-    // Main control loop
-    while (1) {
-        // Read IMU data
-        float roll, pitch, yaw;
-        ReadIMU(&roll, &pitch, &yaw);
-
-        // Apply low-pass filter to smooth sensor readings
-        roll = low_pass_filter(roll, prev_roll_output, 0.2f);
-        pitch = low_pass_filter(pitch, prev_pitch_output, 0.2f);
-        yaw = low_pass_filter(yaw, prev_yaw_output, 0.2f);
-
-        // Update PID controllers for each axis
-        float roll_output = pid_compute(TARGET_ROLL, roll, 0.01f);
-        float pitch_output = pid_compute(TARGET_PITCH, pitch, 0.01f);
-        float yaw_output = pid_compute(TARGET_YAW, yaw, 0.01f);
-
-        // Apply deadband to outputs
-        roll_output = apply_deadband(roll_output, 0.05f);
-        pitch_output = apply_deadband(pitch_output, 0.05f);
-        yaw_output = apply_deadband(yaw_output, 0.05f);
-
-        // Constrain outputs to valid range
-        roll_output = constrain(roll_output, -1.0f, 1.0f);
-        pitch_output = constrain(pitch_output, -1.0f, 1.0f);
-        yaw_output = constrain(yaw_output, -1.0f, 1.0f);
-
-        // Scale PID outputs to ESC input range (1000-2000)
-        roll_output = map(roll_output, -1.0f, 1.0f, 1000.0f, 2000.0f);
-        pitch_output = map(pitch_output, -1.0f, 1.0f, 1000.0f, 2000.0f);
-        yaw_output = map(yaw_output, -1.0f, 1.0f, 1000.0f, 2000.0f);
-
-        // Set ESC values based on PID output
-        SetESC(ROLL_CHANNEL, roll_output);
-        SetESC(PITCH_CHANNEL, pitch_output);
-        SetESC(YAW_CHANNEL, yaw_output);
-
-        // Store outputs for next iteration
-        prev_roll_output = roll_output;
-        prev_pitch_output = pitch_output;
-        prev_yaw_output = yaw_output;
-
-        // Log sensor readings, PID outputs, and motor speeds
-        logger_log(LOG_INFO, __FILE__, __LINE__, "Sensor Readings - Roll: %f, Pitch: %f, Yaw: %f", roll, pitch, yaw);
-        logger_log(LOG_INFO, __FILE__, __LINE__, "PID Outputs - Roll: %f, Pitch: %f, Yaw: %f", roll_output, pitch_output, yaw_output);
-        logger_log(LOG_INFO, __FILE__, __LINE__, "Motor Speeds - Roll: %f, Pitch: %f, Yaw: %f", roll_output, pitch_output, yaw_output);
-
-        // Check for emergency stop
-        if (isFailsafeActive()) {
-            emergency_stop();
-        }
-
-        // Delay to maintain fixed control loop frequency
-        HAL_Delay(10); // 10ms delay for 100Hz control loop
+
+#if FC_CONTROL_ON_CORE1
+    // Core 1 initializes the IMU, controller, filters and ESCs and runs the
+    // pipeline bare-metal; FreeRTOS keeps core 0
+    if (!control_core_start()) {
+        LOG_TEXT(LOG_ERROR, "Flight pipeline initialization failed");
+    }
+
+    LOG_TEXT(LOG_INFO, "All peripherals initialized");
+#else
+    // IMU, controller, filters and ESCs
+    if (!flight_pipeline_init()) {
+        LOG_TEXT(LOG_ERROR, "Flight pipeline initialization failed");
     }
+
+    LOG_TEXT(LOG_INFO, "All peripherals initialized");
+#endif
+
+    // Receiver capture; its interrupt queues frames for the remote control
+    // task, which arms and commands the pipeline
+    remote_control_init();
+
+    // Create every task from the static RTOS object table, the control task
+    // running the pipeline on every IMU data-ready interrupt, and start the
+    // scheduler
+    rtos_init();
 }
 
 // System clock configuration
@@ -164,27 +141,3 @@ void UART_Init(void) {
     // Configure UART for debugging
     // Implementation specific to hardware setup
 }
-
-// IMU sensor initialization
-void IMU_Init(void) {
-    // Initialize and calibrate IMU sensor
-    IMUSensor imu;
-    if (!imu.initialize()) {
-        logger_log(LOG_ERROR, __FILE__, __LINE__, "IMU initialization failed");
-        return;
-    }
-    if (!imu.calibrate()) {
-        logger_log(LOG_ERROR, __FILE__, __LINE__, "IMU calibration failed");
-        return;
-    }
-}
-
-// ESC initialization
-void ESC_Init(void) {
-    // Initialize ESC communication
-    esc_config_t esc_config = {1, 1000, 2000, 1500};
-    if (esc_init(&esc_config) != ESC_SUCCESS) {
-        logger_log(LOG_ERROR, __FILE__, __LINE__, "ESC initialization failed");
-        return;
-    }
-}
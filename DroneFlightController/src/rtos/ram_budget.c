@@ -0,0 +1,75 @@
+//
+//  ram_budget.c
+//  DroneFlightController
+//
+
+#include <assert.h>
+#include "ram_budget.h"
+#include "rtos_objects.h"
+#include "controllers/flight_pipeline.h"
+#include "controllers/control_core.h"
+#include "sensors/sensor_fusion.h"
+#include "rtos/tasks/remote_control_task.h"
+#include "rtos/tasks/sensor_task.h"
+#include "utils/logger.h"
+#include "utils/blackbox.h"
+#include "utils/trace.h"
+#include "utils/log_store.h"
+#include "utils/profiler.h"
+#include "utils/flash_storage.h"
+#include "config/control_config.h"
+#include "config/hardware_config.h"
+
+// Queue storage and the SPSC rings between interrupts, tasks and cores
+#define RAM_BUDGET_QUEUE_BYTES \
+    (RTOS_QUEUE_STORAGE_BYTES + REMOTE_CONTROL_TASK_RAM_BYTES + SENSOR_TASK_RAM_BYTES + CONTROL_CORE_RAM_BYTES)
+
+// Everything the flight path keeps between samples: filters, analyzer and
+// controller, and the IMU driver with its calibrations and the estimator
+#define RAM_BUDGET_FLIGHT_BYTES (FLIGHT_PIPELINE_RAM_BYTES + SENSOR_FUSION_RAM_BYTES)
+
+#if FC_BLACKBOX_ENABLED
+#define RAM_BUDGET_BLACKBOX_BYTES BLACKBOX_RAM_BYTES
+#else
+#define RAM_BUDGET_BLACKBOX_BYTES 0
+#endif
+
+// Logger stack reserves, the logger, trace and blackbox rings and the log
+// store's pages
+#define RAM_BUDGET_LOGGER_BYTES \
+    (RTOS_LOGGER_BYTES + LOGGER_RAM_BYTES + TRACE_RAM_BYTES + RAM_BUDGET_BLACKBOX_BYTES + LOG_STORE_RAM_BYTES)
+
+// Profiler probes and the page flash_storage stages for programming
+#define RAM_BUDGET_OTHER_BYTES (PROFILER_RAM_BYTES + FLASH_STORAGE_RAM_BYTES)
+
+#define RAM_BUDGET_TOTAL_BYTES \
+    (RTOS_STACK_BYTES + RAM_BUDGET_QUEUE_BYTES + RAM_BUDGET_LOGGER_BYTES + RAM_BUDGET_FLIGHT_BYTES + \
+     RAM_BUDGET_OTHER_BYTES)
+
+static_assert(RAM_BUDGET_TOTAL_BYTES <= RAM_BUDGET_BYTES,
+              "Static RAM exceeds RAM_BUDGET_BYTES, shrink the RTOS table or raise the budget");
+
+static const ram_budget_t budget = {
+    RTOS_STACK_BYTES,
+    RAM_BUDGET_QUEUE_BYTES,
+    RAM_BUDGET_LOGGER_BYTES,
+    RAM_BUDGET_FLIGHT_BYTES,
+    RAM_BUDGET_OTHER_BYTES,
+    RAM_BUDGET_TOTAL_BYTES,
+    RAM_BUDGET_BYTES
+};
+
+const ram_budget_t *ram_budget_get(void) {
+    return &budget;
+}
+
+void ram_budget_report(void) {
+    LOG_MSG(LOG_INFO, "RAM budget       bytes");
+    LOG_MSG(LOG_INFO, "task stacks     %6lu", (unsigned long)budget.task_stacks);
+    LOG_MSG(LOG_INFO, "queues, rings   %6lu", (unsigned long)budget.queue_storage);
+    LOG_MSG(LOG_INFO, "logger buffers  %6lu", (unsigned long)budget.logger_buffers);
+    LOG_MSG(LOG_INFO, "flight state    %6lu", (unsigned long)budget.flight_state);
+    LOG_MSG(LOG_INFO, "other           %6lu", (unsigned long)budget.other);
+    LOG_MSG(LOG_INFO, "total           %6lu of %lu",
+            (unsigned long)budget.total, (unsigned long)budget.budget);
+}
@@ -0,0 +1,33 @@
+//
+//  ram_budget.h
+//  DroneFlightController
+//
+//  Statically allocated RAM by category, summed at compile time from the
+//  RTOS object table and the *_RAM_BYTES each module exports for its own
+//  static state. The build fails if the total exceeds RAM_BUDGET_BYTES in
+//  config/hardware_config.h. Single flags and counters are not itemised;
+//  a module that adds buffers or state structs adds them to its macro.
+//
+
+#ifndef ram_budget_h
+#define ram_budget_h
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t task_stacks;     // Stacks and TCBs, idle and timer tasks included
+    uint32_t queue_storage;   // Queue items and control blocks, mutexes, SPSC rings
+    uint32_t logger_buffers;  // Logger stack reserves, log rings and log store pages
+    uint32_t flight_state;    // Pipeline filters and controller, IMU driver, calibrations, estimator
+    uint32_t other;           // Profiler probes, flash storage page
+    uint32_t total;
+    uint32_t budget;
+} ram_budget_t;
+
+// The breakdown checked by the build
+const ram_budget_t *ram_budget_get(void);
+
+// Log the breakdown as a table
+void ram_budget_report(void);
+
+#endif /* ram_budget_h */
@@ -0,0 +1,101 @@
+//
+//  rtos_objects.c
+//  DroneFlightController
+//
+
+#include "rtos_objects.h"
+
+// Stack and TCB for each task in the table
+#define RTOS_TASK_STORAGE(id, name, depth, logs, priority) \
+    static StackType_t id##_stack[(depth) + (logs) * RTOS_LOGGER_STACK_WORDS]; \
+    static StaticTask_t id##_tcb;
+RTOS_TASK_TABLE(RTOS_TASK_STORAGE)
+
+// Item storage and control block for each queue
+#define RTOS_QUEUE_STORAGE(id, length, item_size) \
+    static uint8_t id##_storage[(length) * (item_size)]; \
+    static StaticQueue_t id##_queue;
+RTOS_QUEUE_TABLE(RTOS_QUEUE_STORAGE)
+
+static StaticSemaphore_t mutex_storage[RTOS_MUTEX_COUNT];
+
+typedef struct {
+    const char *name;
+    StackType_t *stack;
+    uint32_t depth;
+    UBaseType_t priority;
+    StaticTask_t *tcb;
+} rtos_task_slot_t;
+
+typedef struct {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    uint8_t *storage;
+    StaticQueue_t *queue;
+} rtos_queue_slot_t;
+
+#define RTOS_TASK_SLOT(id, name, depth, logs, priority) \
+    { name, id##_stack, sizeof(id##_stack) / sizeof(StackType_t), priority, &id##_tcb },
+static const rtos_task_slot_t task_slots[RTOS_TASK_COUNT] = {
+    RTOS_TASK_TABLE(RTOS_TASK_SLOT)
+};
+
+#define RTOS_QUEUE_SLOT(id, length, item_size) \
+    { length, item_size, id##_storage, &id##_queue },
+static const rtos_queue_slot_t queue_slots[RTOS_QUEUE_COUNT] = {
+    RTOS_QUEUE_TABLE(RTOS_QUEUE_SLOT)
+};
+
+static TaskHandle_t task_handles[RTOS_TASK_COUNT];
+static QueueHandle_t queue_handles[RTOS_QUEUE_COUNT];
+static SemaphoreHandle_t mutex_handles[RTOS_MUTEX_COUNT];
+
+// Kernel-owned idle and timer tasks
+static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t idle_tcb;
+static StackType_t timer_stack[configTIMER_TASK_STACK_DEPTH];
+static StaticTask_t timer_tcb;
+
+void rtos_create_objects(void) {
+    for (int i = 0; i < RTOS_QUEUE_COUNT; i++) {
+        const rtos_queue_slot_t *slot = &queue_slots[i];
+        queue_handles[i] = xQueueCreateStatic(slot->length, slot->item_size, slot->storage, slot->queue);
+    }
+    for (int i = 0; i < RTOS_MUTEX_COUNT; i++) {
+        mutex_handles[i] = xSemaphoreCreateMutexStatic(&mutex_storage[i]);
+    }
+}
+
+TaskHandle_t rtos_create_task(rtos_task_id_t id, TaskFunction_t entry, void *parameters) {
+    // A second create would reuse a live stack
+    if (id >= RTOS_TASK_COUNT || task_handles[id] != NULL) {
+        return NULL;
+    }
+
+    const rtos_task_slot_t *slot = &task_slots[id];
+    task_handles[id] = xTaskCreateStatic(entry, slot->name, slot->depth, parameters,
+                                         slot->priority, slot->stack, slot->tcb);
+    return task_handles[id];
+}
+
+QueueHandle_t rtos_get_queue(rtos_queue_id_t id) {
+    return queue_handles[id];
+}
+
+SemaphoreHandle_t rtos_get_mutex(rtos_mutex_id_t id) {
+    return mutex_handles[id];
+}
+
+// Memory for the idle task, required with static allocation
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *depth) {
+    *tcb = &idle_tcb;
+    *stack = idle_stack;
+    *depth = configMINIMAL_STACK_SIZE;
+}
+
+// Memory for the timer service task
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *depth) {
+    *tcb = &timer_tcb;
+    *stack = timer_stack;
+    *depth = configTIMER_TASK_STACK_DEPTH;
+}
@@ -0,0 +1,120 @@
+//
+//  rtos_objects.h
+//  DroneFlightController
+//
+//  The one table of every task, queue and mutex in the system. Each entry
+//  gets its stack, control block and storage as a static array sized at
+//  compile time, created with the FreeRTOS *Static APIs; there is no
+//  kernel heap. Stack depths are in words and checked against the
+//  high-water marks in the profiler report.
+//
+
+#ifndef rtos_objects_h
+#define rtos_objects_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "pid_controller.h"
+#include "utils/logger.h"
+#include "utils/blackbox.h"
+#include "config/control_config.h"
+
+// Stack words a task needs on top of its own depth to call logger_log
+#define RTOS_LOGGER_STACK_WORDS ((LOGGER_STACK_BYTES + sizeof(StackType_t) - 1) / sizeof(StackType_t))
+
+// The control task runs the whole flight pipeline including the estimator
+// matrix temporaries; nothing may preempt it. With the pipeline on core 1
+// there is no control task.
+#if FC_CONTROL_ON_CORE1
+#define RTOS_CONTROL_TASK(X)
+#else
+#define RTOS_CONTROL_TASK(X) \
+    X(RTOS_TASK_CONTROL,        "Control",       1024, 0, configMAX_PRIORITIES - 1)
+#endif
+
+// Drains the blackbox ring, only when the recorder is built
+#if FC_BLACKBOX_ENABLED
+#define RTOS_BLACKBOX_TASK(X) \
+    X(RTOS_TASK_BLACKBOX,       "Blackbox",      384,  0, tskIDLE_PRIORITY + 1)
+#else
+#define RTOS_BLACKBOX_TASK(X)
+#endif
+
+// Tasks: id, name, stack depth in words, calls the logger, priority
+#define RTOS_TASK_TABLE(X) \
+    RTOS_CONTROL_TASK(X) \
+    X(RTOS_TASK_REMOTE_CONTROL, "RemoteControl", 256,  0, tskIDLE_PRIORITY + 3) \
+    X(RTOS_TASK_FAILSAFE,       "Failsafe",      256,  0, tskIDLE_PRIORITY + 3) \
+    X(RTOS_TASK_COMMUNICATION,  "Comm",          256,  1, tskIDLE_PRIORITY + 3) \
+    X(RTOS_TASK_PID,            "PID",           256,  0, tskIDLE_PRIORITY + 2) \
+    X(RTOS_TASK_SENSOR,         "Sensor",        256,  0, tskIDLE_PRIORITY + 1) \
+    X(RTOS_TASK_LOG,            "Log",           256,  1, tskIDLE_PRIORITY + 1) \
+    RTOS_BLACKBOX_TASK(X)
+
+// Queues: id, length, item size in bytes
+#define RTOS_QUEUE_TABLE(X) \
+    X(RTOS_QUEUE_PID_COMMAND, 5, sizeof(pid_command_t))
+
+// Mutexes: id
+#define RTOS_MUTEX_TABLE(X) \
+    X(RTOS_MUTEX_I2C_BUS) \
+    X(RTOS_MUTEX_BARO) \
+    X(RTOS_MUTEX_GPS)
+
+#define RTOS_OBJECT_ID(id, ...) id,
+
+typedef enum {
+    RTOS_TASK_TABLE(RTOS_OBJECT_ID)
+    RTOS_TASK_COUNT
+} rtos_task_id_t;
+
+typedef enum {
+    RTOS_QUEUE_TABLE(RTOS_OBJECT_ID)
+    RTOS_QUEUE_COUNT
+} rtos_queue_id_t;
+
+typedef enum {
+    RTOS_MUTEX_TABLE(RTOS_OBJECT_ID)
+    RTOS_MUTEX_COUNT
+} rtos_mutex_id_t;
+
+// Static RAM per category in bytes, constant expressions for the budget
+#define RTOS_TASK_STACK_BYTES(id, name, depth, logs, priority) \
+    + (depth) * sizeof(StackType_t) + sizeof(StaticTask_t)
+#define RTOS_TASK_LOGGER_BYTES(id, name, depth, logs, priority) \
+    + (logs) * RTOS_LOGGER_STACK_WORDS * sizeof(StackType_t)
+#define RTOS_QUEUE_BYTES(id, length, item_size) \
+    + (length) * (item_size) + sizeof(StaticQueue_t)
+
+// Task stacks and control blocks, including the idle and timer tasks
+#define RTOS_STACK_BYTES \
+    (0 RTOS_TASK_TABLE(RTOS_TASK_STACK_BYTES) \
+     + (configMINIMAL_STACK_SIZE + configTIMER_TASK_STACK_DEPTH) * sizeof(StackType_t) \
+     + 2 * sizeof(StaticTask_t))
+
+// Stack reserved in logging tasks for the logger's buffers
+#define RTOS_LOGGER_BYTES (0 RTOS_TASK_TABLE(RTOS_TASK_LOGGER_BYTES))
+
+// Queue storage and control blocks, mutexes, and the timer command queue
+// timers.c keeps statically (16 byte messages)
+#define RTOS_QUEUE_STORAGE_BYTES \
+    (0 RTOS_QUEUE_TABLE(RTOS_QUEUE_BYTES) \
+     + RTOS_MUTEX_COUNT * sizeof(StaticSemaphore_t) \
+     + configTIMER_QUEUE_LENGTH * 16 + sizeof(StaticQueue_t))
+
+// Create every queue and mutex in the table; before any task is created
+void rtos_create_objects(void);
+
+// Create a task from its table entry with its static stack and TCB
+// Each id is created at most once. Returns NULL for an id already used.
+TaskHandle_t rtos_create_task(rtos_task_id_t id, TaskFunction_t entry, void *parameters);
+
+// Handles of the objects made by rtos_create_objects
+QueueHandle_t rtos_get_queue(rtos_queue_id_t id);
+SemaphoreHandle_t rtos_get_mutex(rtos_mutex_id_t id);
+
+#endif /* rtos_objects_h */
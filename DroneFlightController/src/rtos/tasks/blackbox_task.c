@@ -0,0 +1,35 @@
+//
+//  blackbox_task.c
+//  DroneFlightController
+//
+
+#include "blackbox_task.h"
+
+#if FC_BLACKBOX_ENABLED
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "rtos/rtos_objects.h"
+#include "utils/blackbox.h"
+
+// Drain period; with the default decimation BLACKBOX_RING_FRAMES covers
+// it at loop rates up to 4 kHz
+#define BLACKBOX_DRAIN_PERIOD_MS 20
+
+static TaskHandle_t blackboxTaskHandle = NULL;
+
+static void blackbox_task(void *pvParameters) {
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+
+    while(1) {
+        blackbox_drain();
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(BLACKBOX_DRAIN_PERIOD_MS));
+    }
+}
+
+bool blackbox_task_init(void) {
+    blackboxTaskHandle = rtos_create_task(RTOS_TASK_BLACKBOX, blackbox_task, NULL);
+    return blackboxTaskHandle != NULL;
+}
+
+#endif /* FC_BLACKBOX_ENABLED */
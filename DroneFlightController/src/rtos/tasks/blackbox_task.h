@@ -0,0 +1,22 @@
+//
+//  blackbox_task.h
+//  DroneFlightController
+//
+//  Low-priority task writing the frames the flight pipeline queued in the
+//  blackbox ring to storage.
+//
+
+#ifndef blackbox_task_h
+#define blackbox_task_h
+
+#include <stdbool.h>
+#include "utils/blackbox.h"
+
+#if FC_BLACKBOX_ENABLED
+// Create the blackbox drain task
+bool blackbox_task_init(void);
+#else
+#define blackbox_task_init()  (true)
+#endif
+
+#endif /* blackbox_task_h */
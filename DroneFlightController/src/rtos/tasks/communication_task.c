@@ -5,17 +5,26 @@
 //  Created by Vishwanath Martur on 11/1/24.
 //
 
+#define LOG_MODULE LOG_MODULE_COMMS
+
+#include "communication_task.h"
 #include <FreeRTOS.h>
 #include <task.h>
 #include <queue.h>
+#include "rtos/rtos_objects.h"
 #include "failsafe/failsafe.h"
-#include "communication/spi_driver.h"
-#include "controllers/esc.h"
+#include "utils/profiler.h"
+#include "utils/logger.h"
+#include "utils/blackbox.h"
+#include "utils/log_store.h"
+#include "controllers/flight_pipeline.h"
+#include "sensors/sensor_fusion.h"
+#include "controllers/control_core.h"
+#include "config/control_config.h"
 
 // Task configuration
-#define COMM_TASK_STACK_SIZE 256
-#define COMM_TASK_PRIORITY   3
 #define COMM_CHECK_PERIOD_MS 100
+#define COMM_PROFILE_REPORT_CHECKS 100   // Profiler report every 10 s
 
 // Communication status
 typedef enum {
@@ -30,32 +39,36 @@ static TaskHandle_t commTaskHandle = NULL;
 // Function prototypes
 static void communication_task(void *pvParameters);
 static comm_status_t check_communication_status(void);
-static void handle_communication_failure(void);
+static void report_jitter(const char *name, const timing_jitter_t *jitter);
 
 // Initialize communication task
-void communication_task_init(void) {
-    // Create the communication task
-    xTaskCreate(
-        communication_task,
-        "CommTask",
-        COMM_TASK_STACK_SIZE,
-        NULL,
-        COMM_TASK_PRIORITY,
-        &commTaskHandle
-    );
+bool communication_task_init(void) {
+    // Stack, with room for the logger, and priority from the RTOS table
+    commTaskHandle = rtos_create_task(RTOS_TASK_COMMUNICATION, communication_task, NULL);
+    return commTaskHandle != NULL;
 }
 
 // Main communication task function
 static void communication_task(void *pvParameters) {
     TickType_t xLastWakeTime;
     xLastWakeTime = xTaskGetTickCount();
+    uint32_t checks = 0;
+    uint32_t reported_events = 0;
+#if FC_CONTROL_ON_CORE1
+    control_core_status_t core_status = {0, 0, 0};
+    uint32_t core_worst_us = 0;
+#endif
+
+    profiler_init_probe(PROFILER_PROBE_COMMUNICATION, "communication", COMM_CHECK_PERIOD_MS * 1000);
+    profiler_set_task(PROFILER_PROBE_COMMUNICATION, xTaskGetCurrentTaskHandle());
 
     while (1) {
+        PROFILER_BEGIN(PROFILER_PROBE_COMMUNICATION);
+
         // Check communication status
         comm_status_t status = check_communication_status();
         
         if (status != COMM_STATUS_OK) {
-            handle_communication_failure();
             // Update failsafe system
             if (isFailsafeActive()) {
                 executeFailsafe();
@@ -64,6 +77,41 @@ static void communication_task(void *pvParameters) {
             // Reset failsafe timer on successful communication
             failsafeUpdateSignal();
         }
+        PROFILER_END(PROFILER_PROBE_COMMUNICATION);
+
+        // Report sustained control loop overruns and any rate step-down
+        deadline_monitor_t deadline;
+        if (flight_pipeline_get_deadline(&deadline) && deadline.events != reported_events) {
+            LOG_MSG(LOG_WARN,
+                    "Control loop overrun: %lu overruns, worst %lu us, now %lu Hz",
+                    (unsigned long)deadline.overruns, (unsigned long)deadline.worst_us,
+                    (unsigned long)flight_pipeline_get_loop_rate_hz());
+            reported_events = deadline.events;
+        }
+
+#if FC_CONTROL_ON_CORE1
+        // Core 1 reports every CONTROL_CORE_STATUS_DIVISOR runs, more often
+        // than this task checks; keep the worst latency until the report
+        if (control_core_get_status(&core_status) && core_status.max_latency_us > core_worst_us) {
+            core_worst_us = core_status.max_latency_us;
+        }
+#endif
+
+        // Periodic timing report of every instrumented task
+        if (++checks % COMM_PROFILE_REPORT_CHECKS == 0) {
+            profiler_report();
+#if FC_CONTROL_ON_CORE1
+            LOG_MSG(LOG_INFO, "Core 1 pipeline: %lu runs, latency %lu us, worst %lu us",
+                    (unsigned long)core_status.runs, (unsigned long)core_status.latency_us,
+                    (unsigned long)core_worst_us);
+            core_worst_us = 0;
+#endif
+            report_jitter("IMU sample period", getSampleJitter());
+            report_jitter("Rate loop period", flight_pipeline_get_loop_jitter());
+            report_jitter("Sample-to-motor latency", flight_pipeline_get_latency());
+            blackbox_report();
+            log_store_report();
+        }
 
         // Wait for the next check period
         vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(COMM_CHECK_PERIOD_MS));
@@ -72,25 +120,29 @@ static void communication_task(void *pvParameters) {
 
 // Check communication links status
 static comm_status_t check_communication_status(void) {
-    // Check SPI communication
-    if (spi_check_connection() != SPI_SUCCESS) {
-        return COMM_STATUS_ERROR;
-    }
-    
-    // Check ESC communication
-    uint16_t throttle;
-    if (esc_get_status(1, &throttle) != ESC_SUCCESS) {
+    // The ESC bus belongs to the flight pipeline, which reports whether its
+    // last transfer went through; this task never touches the bus
+    if (!flight_pipeline_esc_ok()) {
         return COMM_STATUS_ERROR;
     }
     
     return COMM_STATUS_OK;
 }
 
-// Handle communication failures
-static void handle_communication_failure(void) {
-    // Attempt to reinitialize communication
-    spi_init();
-    
-    // Notify system of communication failure
-    // This could trigger failsafe modes or emergency procedures
+// Log one timing histogram for loop tuning; name must be a string literal
+static void report_jitter(const char *name, const timing_jitter_t *jitter) {
+    timing_jitter_t h;
+    if (!timing_jitter_read(jitter, &h) || h.count == 0) {
+        return;
+    }
+    LOG_MSG(LOG_INFO, "%s: %lu samples, %lu..%lu us, bins of %lu us from %lu us", name,
+            (unsigned long)h.count, (unsigned long)h.min_us, (unsigned long)h.max_us,
+            (unsigned long)h.bin_width_us,
+            (unsigned long)(h.nominal_us - TIMING_JITTER_BINS / 2 * h.bin_width_us));
+    for (int i = 0; i < TIMING_JITTER_BINS; i += 8) {
+        LOG_MSG(LOG_INFO, "  %lu %lu %lu %lu %lu %lu %lu %lu",
+                (unsigned long)h.bins[i], (unsigned long)h.bins[i + 1], (unsigned long)h.bins[i + 2],
+                (unsigned long)h.bins[i + 3], (unsigned long)h.bins[i + 4], (unsigned long)h.bins[i + 5],
+                (unsigned long)h.bins[i + 6], (unsigned long)h.bins[i + 7]);
+    }
 }
@@ -0,0 +1,17 @@
+//
+//  communication_task.h
+//  DroneFlightController
+//
+//  Link health checks, failsafe on communication loss and the periodic
+//  profiler report.
+//
+
+#ifndef communication_task_h
+#define communication_task_h
+
+#include <stdbool.h>
+
+// Create the communication task
+bool communication_task_init(void);
+
+#endif /* communication_task_h */
@@ -1,82 +1,63 @@
 #include "control_task.h"
 #include "FreeRTOS.h"
 #include "task.h"
-#include "semphr.h"
-#include "sensors.h"
 #include "pid_controller.h"
-#include "motor_control.h"
 #include "queue.h"
+#include "rtos/rtos_objects.h"
+#include "flight_pipeline.h"
+#include "imu_data_ready.h"
+#include "utils/profiler.h"
+#include "config/control_config.h"
 
+#if !FC_CONTROL_ON_CORE1
 // Task handle
 static TaskHandle_t controlTaskHandle = NULL;
 
-// Semaphore for sensor data access
-static SemaphoreHandle_t sensorDataSemaphore = NULL;
+// Give up waiting for data-ready after a few missed samples, so a stalled
+// IMU is still noticed by the pipeline
+#define CONTROL_TASK_SAMPLE_TIMEOUT_US (4 * CONTROL_RATE_LOOP_PERIOD_US)
 
-// Queue handle for PID commands
-extern QueueHandle_t pidCommandQueue;
-
-// Control loop parameters
-#define CONTROL_TASK_STACK_SIZE 2048
-#define CONTROL_TASK_PRIORITY 3
-#define CONTROL_LOOP_FREQUENCY_HZ 100
-#define CONTROL_LOOP_PERIOD_MS (1000 / CONTROL_LOOP_FREQUENCY_HZ)
+// Data-ready interrupt: wake the pipeline task directly
+static void ControlTaskNotifyFromISR(uint32_t timestamp_us) {
+    (void)timestamp_us;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(controlTaskHandle, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
 
 // Control task implementation
 static void ControlTask(void *pvParameters) {
-    TickType_t xLastWakeTime;
-    xLastWakeTime = xTaskGetTickCount();
-    
+    const TickType_t timeout = pdMS_TO_TICKS(CONTROL_TASK_SAMPLE_TIMEOUT_US / 1000) + 1;
+
+    profiler_init_probe(PROFILER_PROBE_CONTROL, "control", CONTROL_RATE_LOOP_PERIOD_US);
+    profiler_set_task(PROFILER_PROBE_CONTROL, xTaskGetCurrentTaskHandle());
+    imu_data_ready_set_callback(ControlTaskNotifyFromISR);
+
     while(1) {
-        // Wait for sensor data to be ready
-        if(xSemaphoreTake(sensorDataSemaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
-            // Read sensor data
-            SensorData_t sensorData = GetSensorData();
-            
-            // Run PID calculations
-            PIDOutput_t pidOutput = UpdatePIDControllers(&sensorData);
-            
-            // Update motor speeds
-            UpdateMotorSpeeds(&pidOutput);
-            
-            xSemaphoreGive(sensorDataSemaphore);
-        }
-        
-        // Handle PID commands from queue
-        pid_command_t pidCommand;
-        if(xQueueReceive(pidCommandQueue, &pidCommand, 0) == pdPASS) {
-            // Process PID command
-            ProcessPIDCommand(&pidCommand);
+        // Sleep until the IMU has a sample. Edges that arrived while the
+        // pipeline was running are collapsed, it always takes the newest.
+        ulTaskNotifyTake(pdTRUE, timeout);
+
+        // Gyro, filters, PID, mixer and ESCs in one pass
+        PROFILER_BEGIN(PROFILER_PROBE_CONTROL);
+        if (flight_pipeline_run()) {
+            PROFILER_END(PROFILER_PROBE_CONTROL);
         }
-        
-        // Wait for next control loop iteration
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(CONTROL_LOOP_PERIOD_MS));
     }
 }
 
 // Initialize control task
 BaseType_t InitControlTask(void) {
-    // Create semaphore
-    sensorDataSemaphore = xSemaphoreCreateMutex();
-    if(sensorDataSemaphore == NULL) {
-        return pdFAIL;
-    }
-    
-    // Create task
-    BaseType_t result = xTaskCreate(
-        ControlTask,
-        "Control Task",
-        CONTROL_TASK_STACK_SIZE,
-        NULL,
-        CONTROL_TASK_PRIORITY,
-        &controlTaskHandle
-    );
-    
-    return result;
+    // Stack and priority come from the RTOS object table
+    controlTaskHandle = rtos_create_task(RTOS_TASK_CONTROL, ControlTask, NULL);
+    return controlTaskHandle != NULL ? pdPASS : pdFAIL;
 }
+#endif
 
 // PID task function to handle PID updates
 void pid_task(void *pvParameters) {
+    QueueHandle_t pidCommandQueue = rtos_get_queue(RTOS_QUEUE_PID_COMMAND);
+
     while(1) {
         // Wait for PID command from queue
         pid_command_t pidCommand;
@@ -86,3 +67,8 @@ void pid_task(void *pvParameters) {
         }
     }
 }
+
+// Initialize PID task
+BaseType_t InitPIDTask(void) {
+    return rtos_create_task(RTOS_TASK_PID, pid_task, NULL) != NULL ? pdPASS : pdFAIL;
+}
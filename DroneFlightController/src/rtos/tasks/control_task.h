@@ -0,0 +1,26 @@
+//
+//  control_task.h
+//  DroneFlightController
+//
+//  Highest priority task running the flight pipeline, woken by a direct
+//  task notification from the IMU data-ready interrupt.
+//
+
+#ifndef control_task_h
+#define control_task_h
+
+#include "FreeRTOS.h"
+#include "config/control_config.h"
+
+#if !FC_CONTROL_ON_CORE1
+// Create the control task
+BaseType_t InitControlTask(void);
+#endif
+
+// Apply PID tuning commands from the PID command queue
+void pid_task(void *pvParameters);
+
+// Create the PID task
+BaseType_t InitPIDTask(void);
+
+#endif /* control_task_h */
@@ -8,7 +8,11 @@
 #include "failsafe_task.h"
 #include "FreeRTOS.h"
 #include "task.h"
-#include "sensors.h"
+#include "rtos/rtos_objects.h"
+#include "utils/profiler.h"
+#include <math.h>
+#include "sensor_fusion.h"
+#include "utils/math_utils.h"
 #include "flight_controller.h"
 #include "battery.h"
 
@@ -35,11 +39,16 @@ static void checkDroneOrientation(void);
 static void initiateEmergencyLanding(void);
 
 void failsafeTask(void *pvParameters) {
+    profiler_init_probe(PROFILER_PROBE_FAILSAFE, "failsafe", 100000);
+    profiler_set_task(PROFILER_PROBE_FAILSAFE, xTaskGetCurrentTaskHandle());
+
     while(1) {
         // Check various safety parameters
+        PROFILER_BEGIN(PROFILER_PROBE_FAILSAFE);
         checkBatteryVoltage();
         checkSignalStrength();
         checkDroneOrientation();
+        PROFILER_END(PROFILER_PROBE_FAILSAFE);
         
         // Sleep for 100ms
         vTaskDelay(pdMS_TO_TICKS(100));
@@ -63,10 +72,15 @@ static void checkSignalStrength(void) {
 }
 
 static void checkDroneOrientation(void) {
-    float pitch = getSensorPitch();
-    float roll = getSensorRoll();
+    // Snapshot published by the estimator, never blocks the control loop
+    fusion_state_t state;
+    if(!getFusionState(&state)) {
+        return;
+    }
+    float roll = rad_to_deg(state.attitude[0]);
+    float pitch = rad_to_deg(state.attitude[1]);
     
-    if(abs(pitch) > CRITICAL_ANGLE_THRESHOLD || abs(roll) > CRITICAL_ANGLE_THRESHOLD) {
+    if(fabsf(pitch) > CRITICAL_ANGLE_THRESHOLD || fabsf(roll) > CRITICAL_ANGLE_THRESHOLD) {
         currentState = FAILSAFE_CRITICAL;
         initiateEmergencyLanding();
     }
@@ -77,11 +91,7 @@ static void initiateEmergencyLanding(void) {
     setEmergencyLandingMode();
 }
 
-void initFailsafeTask(void) {
-    xTaskCreate(failsafeTask,
-                "Failsafe",
-                configMINIMAL_STACK_SIZE,
-                NULL,
-                tskIDLE_PRIORITY + 3,
-                &failsafeTaskHandle);
+bool initFailsafeTask(void) {
+    failsafeTaskHandle = rtos_create_task(RTOS_TASK_FAILSAFE, failsafeTask, NULL);
+    return failsafeTaskHandle != NULL;
 }
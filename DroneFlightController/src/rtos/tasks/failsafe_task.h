@@ -0,0 +1,17 @@
+//
+//  failsafe_task.h
+//  DroneFlightController
+//
+//  Periodic battery, signal and attitude checks that trigger an emergency
+//  landing.
+//
+
+#ifndef failsafe_task_h
+#define failsafe_task_h
+
+#include <stdbool.h>
+
+// Create the failsafe task
+bool initFailsafeTask(void);
+
+#endif /* failsafe_task_h */
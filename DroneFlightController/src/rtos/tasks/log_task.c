@@ -0,0 +1,41 @@
+//
+//  log_task.c
+//  DroneFlightController
+//
+
+#include "log_task.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "rtos/rtos_objects.h"
+#include "utils/logger.h"
+#include "utils/trace.h"
+#include "utils/log_store.h"
+#include "controllers/flight_pipeline.h"
+
+// Drain period; TRACE_RING_RECORDS absorbs the bursts of a profiler report
+// and LOGGER_RING_SLOTS the formatted messages of one period
+#define LOG_DRAIN_PERIOD_MS 50
+
+static TaskHandle_t logTaskHandle = NULL;
+
+static void log_task(void *pvParameters) {
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+
+    while(1) {
+        logger_drain();
+        trace_drain();
+#if FC_LOG_TO_FLASH
+        // Programs and erases stall both cores, so never while armed; pages
+        // filled in flight wait in the store's queue until disarm
+        if (!flight_pipeline_is_armed()) {
+            log_store_service();
+        }
+#endif
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+    }
+}
+
+bool log_task_init(void) {
+    logTaskHandle = rtos_create_task(RTOS_TASK_LOG, log_task, NULL);
+    return logTaskHandle != NULL;
+}
@@ -0,0 +1,18 @@
+//
+//  log_task.h
+//  DroneFlightController
+//
+//  Low-priority task that owns log output, writing out the messages other
+//  tasks and interrupts queued with logger_log and, unformatted, with
+//  TRACE_LOG, and programming the log store's pages into flash.
+//
+
+#ifndef log_task_h
+#define log_task_h
+
+#include <stdbool.h>
+
+// Create the log task
+bool log_task_init(void);
+
+#endif /* log_task_h */
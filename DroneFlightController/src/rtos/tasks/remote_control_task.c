@@ -1,37 +1,51 @@
+#include "remote_control_task.h"
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
-#include "remote_control.h"
+#include "rtos/rtos_objects.h"
 
 // Task handle
 static TaskHandle_t remoteControlTaskHandle = NULL;
 
-// Queue handle for remote control inputs
-extern QueueHandle_t remoteControlQueue;
+// Signal loss and arming are re-evaluated at least this often, also when
+// the receiver has stopped sending frames
+#define REMOTE_CONTROL_UPDATE_MS 20
+
+// Remote control inputs from the receiver interrupt
+static remote_control_ring_t remoteControlRing;
+
+// Queue an input from the receiver interrupt and wake the task
+bool PushRemoteControlInputFromISR(const remote_control_t *input) {
+    bool queued = remoteControlRing.push(*input);
+    if (remoteControlTaskHandle != NULL) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(remoteControlTaskHandle, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+    return queued;
+}
 
 // Remote control task implementation
 static void remote_control_task(void *pvParameters) {
+    remote_control_t remoteControlInput[REMOTE_CONTROL_RING_SIZE];
+    const TickType_t timeout = pdMS_TO_TICKS(REMOTE_CONTROL_UPDATE_MS);
+
     while(1) {
-        // Wait for remote control input from queue
-        remote_control_t remoteControlInput;
-        if(xQueueReceive(remoteControlQueue, &remoteControlInput, portMAX_DELAY) == pdPASS) {
-            // Process remote control input
-            ProcessRemoteControlInput(&remoteControlInput);
+        // Wait for the receiver interrupt, then take everything it queued
+        ulTaskNotifyTake(pdTRUE, timeout);
+
+        uint32_t count = remoteControlRing.popBatch(remoteControlInput, REMOTE_CONTROL_RING_SIZE);
+        for(uint32_t i = 0; i < count; i++) {
+            remote_control_apply_input(&remoteControlInput[i]);
         }
+
+        // Arming, signal loss and the commands to the pipeline
+        remote_control_update();
     }
 }
 
 // Initialize remote control task
 BaseType_t InitRemoteControlTask(void) {
-    // Create task
-    BaseType_t result = xTaskCreate(
-        remote_control_task,
-        "Remote Control Task",
-        configMINIMAL_STACK_SIZE,
-        NULL,
-        REMOTE_CONTROL_TASK_PRIORITY,
-        &remoteControlTaskHandle
-    );
-    
-    return result;
+    // Stack and priority come from the RTOS object table
+    remoteControlTaskHandle = rtos_create_task(RTOS_TASK_REMOTE_CONTROL, remote_control_task, NULL);
+    return remoteControlTaskHandle != NULL ? pdPASS : pdFAIL;
 }
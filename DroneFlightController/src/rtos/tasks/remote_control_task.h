@@ -0,0 +1,30 @@
+//
+//  remote_control_task.h
+//  DroneFlightController
+//
+//  Applies receiver inputs queued by the receiver interrupt.
+//
+
+#ifndef remote_control_task_h
+#define remote_control_task_h
+
+#include "FreeRTOS.h"
+#include "remote_control.h"
+#include "utils/spsc_ring.h"
+
+// Receiver frames buffered between the interrupt and the task
+#define REMOTE_CONTROL_RING_SIZE  8
+
+typedef SpscRing<remote_control_t, REMOTE_CONTROL_RING_SIZE> remote_control_ring_t;
+
+// Static RAM of the ring, for the RAM budget
+#define REMOTE_CONTROL_TASK_RAM_BYTES sizeof(remote_control_ring_t)
+
+// Create the remote control task
+BaseType_t InitRemoteControlTask(void);
+
+// Queue an input and wake the task; interrupt context only
+// Returns false if the input was dropped because the ring is full.
+bool PushRemoteControlInputFromISR(const remote_control_t *input);
+
+#endif /* remote_control_task_h */
@@ -8,57 +8,40 @@
 #include "sensor_task.h"
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
 #include "semphr.h"
-#include "imu.h"
+#include "rtos/rtos_objects.h"
+#include "utils/profiler.h"
 #include "barometer.h"
 #include "gps.h"
 
 // Task handle
 static TaskHandle_t sensor_task_handle = NULL;
 
-// Queue handles for sensor data
-static QueueHandle_t imu_queue = NULL;
-static QueueHandle_t baro_queue = NULL;
-static QueueHandle_t gps_queue = NULL;
-
-// Semaphores for sensor access
-static SemaphoreHandle_t imu_semaphore = NULL;
-static SemaphoreHandle_t baro_semaphore = NULL;
-static SemaphoreHandle_t gps_semaphore = NULL;
+// Rings of sensor readings
+static baro_ring_t baro_ring;
+static gps_ring_t gps_ring;
 
 // Sensor task function
 static void sensor_task(void *pvParameters) {
-    // Initialize sensors
-    imu_init();
+    // Initialize sensors; the IMU belongs to the flight pipeline
     barometer_init();
     gps_init();
-    
-    // Create queues
-    imu_queue = xQueueCreate(5, sizeof(imu_data_t));
-    baro_queue = xQueueCreate(5, sizeof(baro_data_t));
-    gps_queue = xQueueCreate(5, sizeof(gps_data_t));
-    
-    // Create semaphores
-    imu_semaphore = xSemaphoreCreateMutex();
-    baro_semaphore = xSemaphoreCreateMutex();
-    gps_semaphore = xSemaphoreCreateMutex();
+
+    // Mutexes for sensor access, created before the scheduler started
+    SemaphoreHandle_t baro_semaphore = rtos_get_mutex(RTOS_MUTEX_BARO);
+    SemaphoreHandle_t gps_semaphore = rtos_get_mutex(RTOS_MUTEX_GPS);
+
+    profiler_init_probe(PROFILER_PROBE_SENSOR, "sensor", 10000);
+    profiler_set_task(PROFILER_PROBE_SENSOR, xTaskGetCurrentTaskHandle());
     
     while(1) {
-        // Read IMU data
-        if(xSemaphoreTake(imu_semaphore, portMAX_DELAY) == pdTRUE) {
-            imu_data_t imu_data;
-            if(imu_read(&imu_data) == 0) {
-                xQueueSend(imu_queue, &imu_data, 0);
-            }
-            xSemaphoreGive(imu_semaphore);
-        }
-        
+        PROFILER_BEGIN(PROFILER_PROBE_SENSOR);
+
         // Read barometer data
         if(xSemaphoreTake(baro_semaphore, portMAX_DELAY) == pdTRUE) {
             baro_data_t baro_data;
             if(barometer_read(&baro_data) == 0) {
-                xQueueSend(baro_queue, &baro_data, 0);
+                baro_ring.push(baro_data);
             }
             xSemaphoreGive(baro_semaphore);
         }
@@ -67,10 +50,11 @@ static void sensor_task(void *pvParameters) {
         if(xSemaphoreTake(gps_semaphore, portMAX_DELAY) == pdTRUE) {
             gps_data_t gps_data;
             if(gps_read(&gps_data) == 0) {
-                xQueueSend(gps_queue, &gps_data, 0);
+                gps_ring.push(gps_data);
             }
             xSemaphoreGive(gps_semaphore);
         }
+        PROFILER_END(PROFILER_PROBE_SENSOR);
         
         // Delay for next sensor reading
         vTaskDelay(pdMS_TO_TICKS(10));
@@ -78,21 +62,15 @@ static void sensor_task(void *pvParameters) {
 }
 
 // Function to start sensor task
-void start_sensor_task(void) {
-    xTaskCreate(sensor_task,
-                "Sensor Task",
-                configMINIMAL_STACK_SIZE,
-                NULL,
-                tskIDLE_PRIORITY + 1,
-                &sensor_task_handle);
+bool start_sensor_task(void) {
+    sensor_task_handle = rtos_create_task(RTOS_TASK_SENSOR, sensor_task, NULL);
+    return sensor_task_handle != NULL;
 }
 
-// Function to get queue handles
-QueueHandle_t get_imu_queue(void) { return imu_queue; }
-QueueHandle_t get_baro_queue(void) { return baro_queue; }
-QueueHandle_t get_gps_queue(void) { return gps_queue; }
+// Function to get ring buffers
+baro_ring_t *get_baro_ring(void) { return &baro_ring; }
+gps_ring_t *get_gps_ring(void) { return &gps_ring; }
 
 // Function to get semaphore handles
-SemaphoreHandle_t get_imu_semaphore(void) { return imu_semaphore; }
-SemaphoreHandle_t get_baro_semaphore(void) { return baro_semaphore; }
-SemaphoreHandle_t get_gps_semaphore(void) { return gps_semaphore; }
+SemaphoreHandle_t get_baro_semaphore(void) { return rtos_get_mutex(RTOS_MUTEX_BARO); }
+SemaphoreHandle_t get_gps_semaphore(void) { return rtos_get_mutex(RTOS_MUTEX_GPS); }
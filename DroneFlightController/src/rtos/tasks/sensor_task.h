@@ -0,0 +1,39 @@
+//
+//  sensor_task.h
+//  DroneFlightController
+//
+//  Low-rate sensors polled from a FreeRTOS task. Readings are handed to
+//  their single consumer through lock-free SPSC rings.
+//
+
+#ifndef sensor_task_h
+#define sensor_task_h
+
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "utils/spsc_ring.h"
+#include "barometer.h"
+#include "gps.h"
+
+// Readings buffered per sensor; new readings are dropped while full
+#define SENSOR_TASK_RING_SIZE  8
+
+typedef SpscRing<baro_data_t, SENSOR_TASK_RING_SIZE> baro_ring_t;
+typedef SpscRing<gps_data_t, SENSOR_TASK_RING_SIZE> gps_ring_t;
+
+// Static RAM of the rings, for the RAM budget
+#define SENSOR_TASK_RAM_BYTES (sizeof(baro_ring_t) + sizeof(gps_ring_t))
+
+// Create the sensor task
+bool start_sensor_task(void);
+
+// Rings of new readings, one consumer each
+baro_ring_t *get_baro_ring(void);
+gps_ring_t *get_gps_ring(void);
+
+// Bus guards for the barometer and GPS
+SemaphoreHandle_t get_baro_semaphore(void);
+SemaphoreHandle_t get_gps_semaphore(void);
+
+#endif /* sensor_task_h */
@@ -0,0 +1,227 @@
+//
+//  attitude_ekf.c
+//  DroneFlightController
+//
+
+#include "attitude_ekf.h"
+#include "utils/math_utils.h"
+#include <stddef.h>
+
+// Initial standard deviations
+static const float INITIAL_QUATERNION_VAR = 0.1f;
+static const float INITIAL_BIAS_VAR = 0.0025f;   // (0.05 rad/s)^2
+
+AttitudeEKF::AttitudeEKF()
+    : gyroNoiseSq(0.0f), biasNoiseSq(0.0f), accelNoiseSq(0.0f),
+      correctionDt(0.0f), correctionDivisor(1), iteration(0), aligned(false) {
+    reset();
+}
+
+void AttitudeEKF::initialize(float gyroNoise, float biasNoise, float accelNoise, uint16_t correctionDivisor) {
+    gyroNoiseSq = gyroNoise * gyroNoise;
+    biasNoiseSq = biasNoise * biasNoise;
+    accelNoiseSq = accelNoise * accelNoise;
+    this->correctionDivisor = (correctionDivisor > 0) ? correctionDivisor : 1;
+    reset();
+}
+
+void AttitudeEKF::reset() {
+    state = Vector<STATES>(Matrix<STATES, 1>::zeros());
+    state[0] = 1.0f;
+
+    covariance = SymMatrix<STATES>::zeros();
+    for (int i = 0; i < 4; i++) {
+        covariance(i, i) = INITIAL_QUATERNION_VAR;
+    }
+    for (int i = 4; i < STATES; i++) {
+        covariance(i, i) = INITIAL_BIAS_VAR;
+    }
+
+    rateSum[0] = rateSum[1] = rateSum[2] = 0.0f;
+    correctionDt = 0.0f;
+    iteration = 0;
+    aligned = false;
+}
+
+bool AttitudeEKF::correctionDue() const {
+    return iteration == 0;
+}
+
+void AttitudeEKF::update(const float* gyro, const float* accel, float dt) {
+    const float wx = gyro[0] - state[4];
+    const float wy = gyro[1] - state[5];
+    const float wz = gyro[2] - state[6];
+
+    // Quaternion propagation every sample, q' = 0.5 * q (x) omega
+    const float q0 = state[0], q1 = state[1], q2 = state[2], q3 = state[3];
+    const float half_dt = 0.5f * dt;
+    state[0] = q0 + (-q1 * wx - q2 * wy - q3 * wz) * half_dt;
+    state[1] = q1 + (q0 * wx + q2 * wz - q3 * wy) * half_dt;
+    state[2] = q2 + (q0 * wy - q1 * wz + q3 * wx) * half_dt;
+    state[3] = q3 + (q0 * wz + q1 * wy - q2 * wx) * half_dt;
+    normalizeQuaternion();
+
+    rateSum[0] += wx;
+    rateSum[1] += wy;
+    rateSum[2] += wz;
+    correctionDt += dt;
+
+    if (++iteration < correctionDivisor) {
+        return;
+    }
+    iteration = 0;
+
+    propagateCovariance(correctionDt);
+    correctionDt = 0.0f;
+    rateSum[0] = rateSum[1] = rateSum[2] = 0.0f;
+
+    if (accel != NULL) {
+        correctGravity(accel);
+    }
+}
+
+// P = F * P * F^T + Q over the interval since the last correction, using
+// the mean bias-corrected rate of that interval
+void AttitudeEKF::propagateCovariance(float dt) {
+    const float inv_n = 1.0f / correctionDivisor;
+    const float hx = 0.5f * dt * rateSum[0] * inv_n;
+    const float hy = 0.5f * dt * rateSum[1] * inv_n;
+    const float hz = 0.5f * dt * rateSum[2] * inv_n;
+    const float q0 = state[0], q1 = state[1], q2 = state[2], q3 = state[3];
+    const float hdt = 0.5f * dt;
+
+    Matrix<STATES, STATES> f = Matrix<STATES, STATES>::identity();
+
+    // d(q')/dq = 0.5 * Omega(omega)
+    f(0, 1) = -hx; f(0, 2) = -hy; f(0, 3) = -hz;
+    f(1, 0) = hx;  f(1, 2) = hz;  f(1, 3) = -hy;
+    f(2, 0) = hy;  f(2, 1) = -hz; f(2, 3) = hx;
+    f(3, 0) = hz;  f(3, 1) = hy;  f(3, 2) = -hx;
+
+    // d(q')/d(bias) = -0.5 * Xi(q)
+    f(0, 4) = hdt * q1;  f(0, 5) = hdt * q2;  f(0, 6) = hdt * q3;
+    f(1, 4) = -hdt * q0; f(1, 5) = hdt * q3;  f(1, 6) = -hdt * q2;
+    f(2, 4) = -hdt * q3; f(2, 5) = -hdt * q0; f(2, 6) = hdt * q1;
+    f(3, 4) = hdt * q2;  f(3, 5) = -hdt * q1; f(3, 6) = -hdt * q0;
+
+    covariance = quadratic_form(f, covariance);
+
+    // Gyro noise enters the quaternion through Xi(q), and Xi * Xi^T = I - q * q^T
+    const float q_noise = 0.25f * gyroNoiseSq * dt;
+    for (int r = 0; r < 4; r++) {
+        float *row = &covariance(r, r);
+        for (int c = r; c < 4; c++) {
+            float identity = (r == c) ? 1.0f : 0.0f;
+            row[c - r] += q_noise * (identity - state[r] * state[c]);
+        }
+    }
+    for (int i = 4; i < STATES; i++) {
+        covariance(i, i) += biasNoiseSq * dt;
+    }
+}
+
+void AttitudeEKF::correctGravity(const float* accel) {
+    float norm_sq = accel[0] * accel[0] + accel[1] * accel[1] + accel[2] * accel[2];
+    if (norm_sq <= 0.0f) {
+        return;
+    }
+    const float inv_norm = fast_inv_sqrt(norm_sq);
+    const float z[MEASUREMENTS] = {accel[0] * inv_norm, accel[1] * inv_norm, accel[2] * inv_norm};
+
+    // Seed from gravity instead of converging from identity
+    if (!aligned) {
+        quaternion_t q;
+        quaternion_from_gravity(&q, z);
+        state[0] = q.w;
+        state[1] = q.x;
+        state[2] = q.y;
+        state[3] = q.z;
+        aligned = true;
+    }
+
+    const float q0 = state[0], q1 = state[1], q2 = state[2], q3 = state[3];
+
+    // Predicted gravity direction in the body frame and its Jacobian
+    const float h[MEASUREMENTS] = {
+        2.0f * (q1 * q3 - q0 * q2),
+        2.0f * (q0 * q1 + q2 * q3),
+        q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3
+    };
+
+    Matrix<MEASUREMENTS, STATES> jacobian = Matrix<MEASUREMENTS, STATES>::zeros();
+    jacobian(0, 0) = -2.0f * q2; jacobian(0, 1) = 2.0f * q3;  jacobian(0, 2) = -2.0f * q0; jacobian(0, 3) = 2.0f * q1;
+    jacobian(1, 0) = 2.0f * q1;  jacobian(1, 1) = 2.0f * q0;  jacobian(1, 2) = 2.0f * q3;  jacobian(1, 3) = 2.0f * q2;
+    jacobian(2, 0) = 2.0f * q0;  jacobian(2, 1) = -2.0f * q1; jacobian(2, 2) = -2.0f * q2; jacobian(2, 3) = 2.0f * q3;
+
+    // S = H * P * H^T + R, reusing H * P for the gain
+    const Matrix<MEASUREMENTS, STATES> hp = jacobian * covariance;
+    const Matrix<MEASUREMENTS, MEASUREMENTS> hph = multiply_transposed(hp, jacobian);
+    SymMatrix<MEASUREMENTS> innovation_cov;
+    for (int r = 0; r < MEASUREMENTS; r++) {
+        for (int c = r; c < MEASUREMENTS; c++) {
+            innovation_cov(r, c) = hph(r, c);
+        }
+        innovation_cov(r, r) += accelNoiseSq;
+    }
+
+    // K^T = S^-1 * H * P
+    Matrix<MEASUREMENTS, STATES> gain_t;
+    if (!cholesky_solve(innovation_cov, hp, gain_t)) {
+        return;
+    }
+
+    float innovation[MEASUREMENTS];
+    for (int k = 0; k < MEASUREMENTS; k++) {
+        innovation[k] = z[k] - h[k];
+    }
+
+    for (int i = 0; i < STATES; i++) {
+        float correction = 0.0f;
+        for (int k = 0; k < MEASUREMENTS; k++) {
+            correction += gain_t(k, i) * innovation[k];
+        }
+        state[i] += correction;
+    }
+
+    // P = P - K * S * K^T = P - (H * P)^T * K^T, upper triangle only,
+    // walking the packed storage in order
+    int index = 0;
+    for (int r = 0; r < STATES; r++) {
+        for (int c = r; c < STATES; c++) {
+            float sum = 0.0f;
+            for (int k = 0; k < MEASUREMENTS; k++) {
+                sum += hp(k, r) * gain_t(k, c);
+            }
+            covariance.data[index++] -= sum;
+        }
+    }
+
+    normalizeQuaternion();
+}
+
+void AttitudeEKF::normalizeQuaternion() {
+    float inv = fast_inv_sqrt(state[0] * state[0] + state[1] * state[1] +
+                              state[2] * state[2] + state[3] * state[3]);
+    for (int i = 0; i < 4; i++) {
+        state[i] *= inv;
+    }
+}
+
+void AttitudeEKF::getQuaternion(quaternion_t& q) const {
+    q.w = state[0];
+    q.x = state[1];
+    q.y = state[2];
+    q.z = state[3];
+}
+
+void AttitudeEKF::getBias(float* bias) const {
+    bias[0] = state[4];
+    bias[1] = state[5];
+    bias[2] = state[6];
+}
+
+void AttitudeEKF::getEuler(float& roll, float& pitch, float& yaw) const {
+    quaternion_t q;
+    getQuaternion(q);
+    quaternion_to_euler(&q, &roll, &pitch, &yaw);
+}
@@ -0,0 +1,68 @@
+//
+//  attitude_ekf.h
+//  DroneFlightController
+//
+//  Extended Kalman filter over attitude quaternion and gyro bias
+//  (7 states) built on utils/matrix.h. The quaternion is propagated on
+//  every gyro sample; the covariance propagation and the accelerometer
+//  update run together at the decimated correction rate.
+//
+//  Cost per correction with the generic kernels, in multiply-accumulates:
+//  covariance propagation 539, gravity update about 380, so roughly 920
+//  MACs and 3 square roots. Per gyro sample the cost is the same
+//  quaternion integration as the complementary estimators.
+//
+
+#ifndef attitude_ekf_h
+#define attitude_ekf_h
+
+#include <stdint.h>
+#include "attitude_estimator.h"
+#include "utils/matrix.h"
+
+class AttitudeEKF {
+public:
+    static const int STATES = 7;        // q0..q3, gyro bias x/y/z
+    static const int MEASUREMENTS = 3;  // Normalized accelerometer
+
+    AttitudeEKF();
+
+    // Set noise densities and the correction decimation, then reset
+    // gyroNoise in rad/s/sqrt(Hz), biasNoise in rad/s^2/sqrt(Hz),
+    // accelNoise as the standard deviation of the normalized accel vector
+    void initialize(float gyroNoise, float biasNoise, float accelNoise, uint16_t correctionDivisor);
+
+    // Identity attitude, zero bias, initial covariance
+    void reset();
+
+    // True when the next update will run the covariance and accel correction
+    bool correctionDue() const;
+
+    // Propagate one gyro sample (rad/s) over dt seconds and correct with
+    // accel when due; accel may be NULL
+    void update(const float* gyro, const float* accel, float dt);
+
+    void getQuaternion(quaternion_t& q) const;
+    void getBias(float* bias) const;
+    void getEuler(float& roll, float& pitch, float& yaw) const;
+
+private:
+    void propagateCovariance(float dt);
+    void correctGravity(const float* accel);
+    void normalizeQuaternion();
+
+    Vector<STATES> state;
+    SymMatrix<STATES> covariance;
+
+    float gyroNoiseSq;
+    float biasNoiseSq;
+    float accelNoiseSq;
+
+    float rateSum[3];            // Bias-corrected rates summed since the last correction
+    float correctionDt;
+    uint16_t correctionDivisor;
+    uint16_t iteration;
+    bool aligned;
+};
+
+#endif /* attitude_ekf_h */
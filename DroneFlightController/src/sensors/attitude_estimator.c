@@ -0,0 +1,252 @@
+//
+//  attitude_estimator.c
+//  DroneFlightController
+//
+
+#include "attitude_estimator.h"
+#include "config/sensor_config.h"
+#include "utils/math_utils.h"
+#include <math.h>
+#include <stddef.h>
+
+// Normalize a 3-vector in place, false if it is zero
+static bool normalize3(float *v) {
+    float norm_sq = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+    if (norm_sq <= 0.0f) {
+        return false;
+    }
+    float inv = fast_inv_sqrt(norm_sq);
+    v[0] *= inv;
+    v[1] *= inv;
+    v[2] *= inv;
+    return true;
+}
+
+// Runs once per alignment, so trigonometry is acceptable here
+void quaternion_from_gravity(quaternion_t *q, const float *accel) {
+    float roll = atan2f(accel[1], accel[2]);
+    float pitch = atan2f(-accel[0], sqrtf(accel[1] * accel[1] + accel[2] * accel[2]));
+    float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+    float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+
+    q->w = cr * cp;
+    q->x = sr * cp;
+    q->y = cr * sp;
+    q->z = -sr * sp;
+}
+
+void quaternion_to_euler(const quaternion_t *q, float *roll, float *pitch, float *yaw) {
+    const float q0 = q->w, q1 = q->x, q2 = q->y, q3 = q->z;
+
+    float sin_pitch = 2.0f * (q0 * q2 - q1 * q3);
+    if (sin_pitch > 1.0f) sin_pitch = 1.0f;
+    if (sin_pitch < -1.0f) sin_pitch = -1.0f;
+
+    *roll = atan2f(2.0f * (q0 * q1 + q2 * q3), 1.0f - 2.0f * (q1 * q1 + q2 * q2));
+    *pitch = asinf(sin_pitch);
+    *yaw = atan2f(2.0f * (q0 * q3 + q1 * q2), 1.0f - 2.0f * (q2 * q2 + q3 * q3));
+}
+
+// Earth west and north expressed in the body frame by cross products, so
+// only the final angle needs trigonometry
+float tilt_compensated_heading(const float *accel, const float *mag) {
+    float up[3] = {accel[0], accel[1], accel[2]};
+    if (!normalize3(up)) {
+        return 0.0f;
+    }
+
+    // west = up x mag, north = west x up; both have the same length
+    float west[3] = {
+        up[1] * mag[2] - up[2] * mag[1],
+        up[2] * mag[0] - up[0] * mag[2],
+        up[0] * mag[1] - up[1] * mag[0]
+    };
+    float north_x = west[1] * up[2] - west[2] * up[1];
+    return atan2f(west[0], north_x);
+}
+
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_MADGWICK
+// Normalized gradient of the gravity (and magnetic) alignment error,
+// written as J^T f for the objective functions of Madgwick's paper
+static void compute_correction(attitude_estimator_t *est, const float *a, const float *m, float dt) {
+    (void)dt;
+    const float q0 = est->q.w, q1 = est->q.x, q2 = est->q.y, q3 = est->q.z;
+
+    // Gravity objective
+    float f0 = 2.0f * (q1 * q3 - q0 * q2) - a[0];
+    float f1 = 2.0f * (q0 * q1 + q2 * q3) - a[1];
+    float f2 = 2.0f * (0.5f - q1 * q1 - q2 * q2) - a[2];
+
+    float s0 = -2.0f * q2 * f0 + 2.0f * q1 * f1;
+    float s1 = 2.0f * q3 * f0 + 2.0f * q0 * f1 - 4.0f * q1 * f2;
+    float s2 = -2.0f * q0 * f0 + 2.0f * q3 * f1 - 4.0f * q2 * f2;
+    float s3 = 2.0f * q1 * f0 + 2.0f * q2 * f1;
+
+    if (m != NULL) {
+        // Earth field direction, flattened onto the x-z plane
+        float hx = 2.0f * (m[0] * (0.5f - q2 * q2 - q3 * q3) + m[1] * (q1 * q2 - q0 * q3) + m[2] * (q1 * q3 + q0 * q2));
+        float hy = 2.0f * (m[0] * (q1 * q2 + q0 * q3) + m[1] * (0.5f - q1 * q1 - q3 * q3) + m[2] * (q2 * q3 - q0 * q1));
+        float h_sq = hx * hx + hy * hy;
+        float bx = (h_sq > 0.0f) ? h_sq * fast_inv_sqrt(h_sq) : 0.0f;
+        float bz = 2.0f * (m[0] * (q1 * q3 - q0 * q2) + m[1] * (q2 * q3 + q0 * q1) + m[2] * (0.5f - q1 * q1 - q2 * q2));
+
+        // Magnetic objective
+        float g0 = 2.0f * bx * (0.5f - q2 * q2 - q3 * q3) + 2.0f * bz * (q1 * q3 - q0 * q2) - m[0];
+        float g1 = 2.0f * bx * (q1 * q2 - q0 * q3) + 2.0f * bz * (q0 * q1 + q2 * q3) - m[1];
+        float g2 = 2.0f * bx * (q0 * q2 + q1 * q3) + 2.0f * bz * (0.5f - q1 * q1 - q2 * q2) - m[2];
+
+        s0 += -2.0f * bz * q2 * g0 + (-2.0f * bx * q3 + 2.0f * bz * q1) * g1 + 2.0f * bx * q2 * g2;
+        s1 += 2.0f * bz * q3 * g0 + (2.0f * bx * q2 + 2.0f * bz * q0) * g1 + (2.0f * bx * q3 - 4.0f * bz * q1) * g2;
+        s2 += (-4.0f * bx * q2 - 2.0f * bz * q0) * g0 + (2.0f * bx * q1 + 2.0f * bz * q3) * g1 + (2.0f * bx * q0 - 4.0f * bz * q2) * g2;
+        s3 += (-4.0f * bx * q3 + 2.0f * bz * q1) * g0 + (-2.0f * bx * q0 + 2.0f * bz * q2) * g1 + 2.0f * bx * q1 * g2;
+    }
+
+    float norm_sq = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+    if (norm_sq <= 0.0f) {
+        est->step[0] = est->step[1] = est->step[2] = est->step[3] = 0.0f;
+        return;
+    }
+    float inv = est->gain_p * fast_inv_sqrt(norm_sq);
+    est->step[0] = s0 * inv;
+    est->step[1] = s1 * inv;
+    est->step[2] = s2 * inv;
+    est->step[3] = s3 * inv;
+}
+#else
+// Rate feedback from the cross product between measured and estimated
+// reference directions, with an integral term absorbing gyro bias
+static void compute_correction(attitude_estimator_t *est, const float *a, const float *m, float dt) {
+    const float q0 = est->q.w, q1 = est->q.x, q2 = est->q.y, q3 = est->q.z;
+
+    // Estimated gravity direction in the body frame
+    float vx = 2.0f * (q1 * q3 - q0 * q2);
+    float vy = 2.0f * (q0 * q1 + q2 * q3);
+    float vz = 2.0f * (q0 * q0 - 0.5f + q3 * q3);
+
+    float ex = a[1] * vz - a[2] * vy;
+    float ey = a[2] * vx - a[0] * vz;
+    float ez = a[0] * vy - a[1] * vx;
+
+    if (m != NULL) {
+        // Earth field direction, flattened onto the x-z plane
+        float hx = 2.0f * (m[0] * (0.5f - q2 * q2 - q3 * q3) + m[1] * (q1 * q2 - q0 * q3) + m[2] * (q1 * q3 + q0 * q2));
+        float hy = 2.0f * (m[0] * (q1 * q2 + q0 * q3) + m[1] * (0.5f - q1 * q1 - q3 * q3) + m[2] * (q2 * q3 - q0 * q1));
+        float h_sq = hx * hx + hy * hy;
+        float bx = (h_sq > 0.0f) ? h_sq * fast_inv_sqrt(h_sq) : 0.0f;
+        float bz = 2.0f * (m[0] * (q1 * q3 - q0 * q2) + m[1] * (q2 * q3 + q0 * q1) + m[2] * (0.5f - q1 * q1 - q2 * q2));
+
+        // Estimated field direction in the body frame
+        float wx = 2.0f * (bx * (0.5f - q2 * q2 - q3 * q3) + bz * (q1 * q3 - q0 * q2));
+        float wy = 2.0f * (bx * (q1 * q2 - q0 * q3) + bz * (q0 * q1 + q2 * q3));
+        float wz = 2.0f * (bx * (q0 * q2 + q1 * q3) + bz * (0.5f - q1 * q1 - q2 * q2));
+
+        ex += m[1] * wz - m[2] * wy;
+        ey += m[2] * wx - m[0] * wz;
+        ez += m[0] * wy - m[1] * wx;
+    }
+
+    if (est->gain_i > 0.0f) {
+        est->integral[0] += est->gain_i * ex * dt;
+        est->integral[1] += est->gain_i * ey * dt;
+        est->integral[2] += est->gain_i * ez * dt;
+    }
+
+    est->feedback[0] = est->gain_p * ex + est->integral[0];
+    est->feedback[1] = est->gain_p * ey + est->integral[1];
+    est->feedback[2] = est->gain_p * ez + est->integral[2];
+}
+#endif
+
+void attitude_estimator_init(attitude_estimator_t *est, float gain_p, float gain_i, uint16_t correction_divisor) {
+    est->gain_p = gain_p;
+    est->gain_i = gain_i;
+    est->correction_divisor = (correction_divisor > 0) ? correction_divisor : 1;
+    attitude_estimator_reset(est);
+}
+
+void attitude_estimator_reset(attitude_estimator_t *est) {
+    est->q.w = 1.0f;
+    est->q.x = 0.0f;
+    est->q.y = 0.0f;
+    est->q.z = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        est->feedback[i] = 0.0f;
+        est->integral[i] = 0.0f;
+    }
+    for (int i = 0; i < 4; i++) {
+        est->step[i] = 0.0f;
+    }
+    est->correction_dt = 0.0f;
+    est->iteration = 0;
+    est->aligned = false;
+}
+
+bool attitude_estimator_correction_due(const attitude_estimator_t *est) {
+    return est->iteration == 0;
+}
+
+void attitude_estimator_update(attitude_estimator_t *est, const float *gyro, const float *accel,
+                               const float *mag, float dt) {
+    est->correction_dt += dt;
+
+    if (est->iteration == 0 && accel != NULL) {
+        float a[3] = {accel[0], accel[1], accel[2]};
+        float m[3];
+        const float *m_used = NULL;
+
+        // Skip the correction in free fall, keep the held one
+        if (normalize3(a)) {
+            // Seed from gravity instead of converging from identity
+            if (!est->aligned) {
+                quaternion_from_gravity(&est->q, a);
+                est->aligned = true;
+            }
+            if (mag != NULL) {
+                m[0] = mag[0];
+                m[1] = mag[1];
+                m[2] = mag[2];
+                if (normalize3(m)) {
+                    m_used = m;
+                }
+            }
+            compute_correction(est, a, m_used, est->correction_dt);
+        }
+        est->correction_dt = 0.0f;
+    }
+
+    if (++est->iteration >= est->correction_divisor) {
+        est->iteration = 0;
+    }
+
+    // Integrate q' = 0.5 * q (x) omega, plus the held correction
+    float gx = gyro[0] + est->feedback[0];
+    float gy = gyro[1] + est->feedback[1];
+    float gz = gyro[2] + est->feedback[2];
+
+    const float q0 = est->q.w, q1 = est->q.x, q2 = est->q.y, q3 = est->q.z;
+    float half_dt = 0.5f * dt;
+    float dq0 = (-q1 * gx - q2 * gy - q3 * gz) * half_dt - est->step[0] * dt;
+    float dq1 = (q0 * gx + q2 * gz - q3 * gy) * half_dt - est->step[1] * dt;
+    float dq2 = (q0 * gy - q1 * gz + q3 * gx) * half_dt - est->step[2] * dt;
+    float dq3 = (q0 * gz + q1 * gy - q2 * gx) * half_dt - est->step[3] * dt;
+
+    float w = q0 + dq0;
+    float x = q1 + dq1;
+    float y = q2 + dq2;
+    float z = q3 + dq3;
+    float inv = fast_inv_sqrt(w * w + x * x + y * y + z * z);
+    est->q.w = w * inv;
+    est->q.x = x * inv;
+    est->q.y = y * inv;
+    est->q.z = z * inv;
+}
+
+void attitude_estimator_get_bias(const attitude_estimator_t *est, float *bias) {
+    bias[0] = -est->integral[0];
+    bias[1] = -est->integral[1];
+    bias[2] = -est->integral[2];
+}
+
+void attitude_estimator_get_euler(const attitude_estimator_t *est, float *roll, float *pitch, float *yaw) {
+    quaternion_to_euler(&est->q, roll, pitch, yaw);
+}
@@ -0,0 +1,68 @@
+//
+//  attitude_estimator.h
+//  DroneFlightController
+//
+//  Quaternion attitude estimator (Mahony or Madgwick, chosen with
+//  SENSOR_FUSION_ESTIMATOR). The gyro is integrated on every update while
+//  the accelerometer/magnetometer correction is computed at a decimated rate
+//  and held in between. The hot path uses no trigonometry; Euler angles are
+//  only derived when requested.
+//
+
+#ifndef attitude_estimator_h
+#define attitude_estimator_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Unit quaternion rotating the body frame into the earth frame
+typedef struct {
+    float w, x, y, z;
+} quaternion_t;
+
+// Attitude with zero yaw that maps the body-frame gravity vector accel to earth z
+void quaternion_from_gravity(quaternion_t *q, const float *accel);
+
+// Roll, pitch and yaw in radians of a unit quaternion
+void quaternion_to_euler(const quaternion_t *q, float *roll, float *pitch, float *yaw);
+
+// Yaw in radians of the body x axis from magnetic north, tilt-compensated
+// with the gravity vector accel; same convention as quaternion_to_euler
+float tilt_compensated_heading(const float *accel, const float *mag);
+
+typedef struct {
+    quaternion_t q;
+    float feedback[3];          // Mahony: held rate correction, Madgwick: unused
+    float integral[3];          // Mahony integral term (negated gyro bias)
+    float step[4];              // Madgwick: held normalized gradient, Mahony: unused
+    float gain_p;               // Mahony Kp or Madgwick beta
+    float gain_i;               // Mahony Ki
+    float correction_dt;        // Time accumulated since the last correction
+    uint16_t correction_divisor;
+    uint16_t iteration;
+    bool aligned;               // False until seeded from the accelerometer
+} attitude_estimator_t;
+
+// Initialize to identity attitude
+// gain_p is Kp for Mahony or beta for Madgwick, gain_i is Mahony Ki
+void attitude_estimator_init(attitude_estimator_t *est, float gain_p, float gain_i, uint16_t correction_divisor);
+
+// Clear the attitude and feedback state
+void attitude_estimator_reset(attitude_estimator_t *est);
+
+// True when the next update will apply an accel/mag correction, so callers
+// can skip reading those sensors otherwise
+bool attitude_estimator_correction_due(const attitude_estimator_t *est);
+
+// Integrate one gyro sample (rad/s) over dt seconds
+// accel (any unit) is used when a correction is due; mag may be NULL
+void attitude_estimator_update(attitude_estimator_t *est, const float *gyro, const float *accel,
+                               const float *mag, float dt);
+
+// Current gyro bias estimate (rad/s), zero for estimators without one
+void attitude_estimator_get_bias(const attitude_estimator_t *est, float *bias);
+
+// Roll, pitch and yaw in radians derived from the current quaternion
+void attitude_estimator_get_euler(const attitude_estimator_t *est, float *roll, float *pitch, float *yaw);
+
+#endif /* attitude_estimator_h */
@@ -0,0 +1,309 @@
+//
+//  gyro_analyzer.c
+//  DroneFlightController
+//
+
+#include "gyro_analyzer.h"
+#include <math.h>
+#include <stddef.h>
+
+#define FFT_MASK        (GYRO_ANALYZER_FFT_SIZE - 1)
+#define FFT_BINS        (GYRO_ANALYZER_FFT_SIZE / 2)
+
+// PT1 factor applied to each new peak estimate
+#define PEAK_SMOOTHING  0.3f
+
+// A peak must exceed the band mean by this factor to move a notch
+#define PEAK_THRESHOLD  2.0f
+
+static void configure_rates(gyro_analyzer_t *analyzer, float loop_hz, float analyzer_hz) {
+    uint16_t decimation = 1;
+    if (analyzer_hz > 0.0f && loop_hz > analyzer_hz) {
+        decimation = (uint16_t)(loop_hz / analyzer_hz + 0.5f);
+    }
+
+    analyzer->loop_hz = loop_hz;
+    analyzer->decimation = decimation;
+    analyzer->sample_hz = loop_hz / decimation;
+    analyzer->bin_hz = analyzer->sample_hz / GYRO_ANALYZER_FFT_SIZE;
+
+    // Peaks can only be resolved below the analyzer Nyquist frequency
+    float limit = analyzer->sample_hz * 0.45f;
+    if (analyzer->max_hz > limit) {
+        analyzer->max_hz = limit;
+    }
+
+    // Restart collection so no frame mixes two sample rates
+    analyzer->accumulated = 0;
+    analyzer->write_index = 0;
+    analyzer->filled = 0;
+    analyzer->phase = GYRO_ANALYZER_WINDOW;
+    analyzer->position = 0;
+    for (int axis = 0; axis < GYRO_ANALYZER_AXES; axis++) {
+        analyzer->accumulator[axis] = 0.0f;
+    }
+}
+
+bool gyro_analyzer_init(gyro_analyzer_t *analyzer, filter_chain_t *gyro_chains, uint8_t peak_count,
+                        float notch_q, float loop_hz, float analyzer_hz,
+                        float min_hz, float max_hz, uint16_t work_per_step) {
+    if (peak_count > GYRO_ANALYZER_MAX_PEAKS) {
+        peak_count = GYRO_ANALYZER_MAX_PEAKS;
+    }
+
+    analyzer->peak_count = peak_count;
+    analyzer->min_hz = min_hz;
+    analyzer->max_hz = max_hz;
+    analyzer->smoothing = PEAK_SMOOTHING;
+    analyzer->work_per_step = (work_per_step > 0) ? work_per_step : 1;
+    analyzer->axis = 0;
+    analyzer->fft_stage = 0;
+    analyzer->read_start = 0;
+    analyzer->analyses = 0;
+    configure_rates(analyzer, loop_hz, analyzer_hz);
+
+    // Hann window, twiddle factors and bit-reversal permutation
+    for (int i = 0; i < GYRO_ANALYZER_FFT_SIZE; i++) {
+        analyzer->window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (GYRO_ANALYZER_FFT_SIZE - 1));
+
+        uint8_t reversed = 0;
+        for (int bit = 0; bit < GYRO_ANALYZER_FFT_LOG2; bit++) {
+            if (i & (1 << bit)) {
+                reversed |= (uint8_t)(1 << (GYRO_ANALYZER_FFT_LOG2 - 1 - bit));
+            }
+        }
+        analyzer->bit_reverse[i] = reversed;
+    }
+    for (int k = 0; k < FFT_BINS; k++) {
+        analyzer->twiddle_re[k] = cosf(2.0f * (float)M_PI * k / GYRO_ANALYZER_FFT_SIZE);
+        analyzer->twiddle_im[k] = -sinf(2.0f * (float)M_PI * k / GYRO_ANALYZER_FFT_SIZE);
+    }
+
+    // Check every chain first so a failure leaves no axis half configured
+    for (int axis = 0; axis < GYRO_ANALYZER_AXES; axis++) {
+        if (gyro_chains[axis].count + peak_count > FILTER_CHAIN_MAX_STAGES) {
+            analyzer->peak_count = 0;
+            return false;
+        }
+    }
+
+    // Dynamic notches start at the top of the band where they cost the least phase
+    for (int axis = 0; axis < GYRO_ANALYZER_AXES; axis++) {
+        for (int peak = 0; peak < peak_count; peak++) {
+            analyzer->notch[axis][peak] = filter_chain_add(&gyro_chains[axis], FILTER_BIQUAD_NOTCH,
+                                                           analyzer->max_hz, notch_q, loop_hz);
+            analyzer->center_hz[axis][peak] = analyzer->max_hz;
+        }
+    }
+
+    return true;
+}
+
+void gyro_analyzer_push(gyro_analyzer_t *analyzer, const float *gyro) {
+    for (int axis = 0; axis < GYRO_ANALYZER_AXES; axis++) {
+        analyzer->accumulator[axis] += gyro[axis];
+    }
+
+    if (++analyzer->accumulated < analyzer->decimation) {
+        return;
+    }
+
+    // Boxcar average doubles as the anti-alias filter for decimation
+    float scale = 1.0f / analyzer->decimation;
+    for (int axis = 0; axis < GYRO_ANALYZER_AXES; axis++) {
+        analyzer->samples[axis][analyzer->write_index] = analyzer->accumulator[axis] * scale;
+        analyzer->accumulator[axis] = 0.0f;
+    }
+    analyzer->accumulated = 0;
+    analyzer->write_index = (analyzer->write_index + 1) & FFT_MASK;
+    if (analyzer->filled < GYRO_ANALYZER_FFT_SIZE) {
+        analyzer->filled++;
+    }
+}
+
+static void step_window(gyro_analyzer_t *analyzer) {
+    const float *samples = analyzer->samples[analyzer->axis];
+
+    // Reading starts at the oldest sample and always outpaces new writes,
+    // so the frame stays coherent across several steps
+    if (analyzer->position == 0) {
+        analyzer->read_start = analyzer->write_index;
+    }
+
+    for (uint16_t n = 0; n < analyzer->work_per_step && analyzer->position < GYRO_ANALYZER_FFT_SIZE; n++) {
+        uint16_t i = analyzer->position++;
+        uint8_t target = analyzer->bit_reverse[i];
+        analyzer->re[target] = samples[(analyzer->read_start + i) & FFT_MASK] * analyzer->window[i];
+        analyzer->im[target] = 0.0f;
+    }
+
+    if (analyzer->position == GYRO_ANALYZER_FFT_SIZE) {
+        analyzer->phase = GYRO_ANALYZER_FFT;
+        analyzer->fft_stage = 0;
+        analyzer->position = 0;
+    }
+}
+
+static void step_fft(gyro_analyzer_t *analyzer) {
+    const uint8_t stage = analyzer->fft_stage;
+    const uint16_t half = (uint16_t)(1 << stage);
+    const uint8_t twiddle_shift = (uint8_t)(GYRO_ANALYZER_FFT_LOG2 - 1 - stage);
+    float *re = analyzer->re;
+    float *im = analyzer->im;
+
+    // Butterflies of one radix-2 stage enumerated linearly so the stage can
+    // be split across cycles
+    for (uint16_t n = 0; n < analyzer->work_per_step && analyzer->position < FFT_BINS; n++) {
+        uint16_t b = analyzer->position++;
+        uint16_t j = b & (half - 1);
+        uint16_t top = (uint16_t)(((b >> stage) << (stage + 1)) + j);
+        uint16_t bottom = top + half;
+        uint16_t k = (uint16_t)(j << twiddle_shift);
+
+        float tr = analyzer->twiddle_re[k];
+        float ti = analyzer->twiddle_im[k];
+        float xr = re[bottom] * tr - im[bottom] * ti;
+        float xi = re[bottom] * ti + im[bottom] * tr;
+
+        re[bottom] = re[top] - xr;
+        im[bottom] = im[top] - xi;
+        re[top] += xr;
+        im[top] += xi;
+    }
+
+    if (analyzer->position == FFT_BINS) {
+        analyzer->position = 0;
+        if (++analyzer->fft_stage == GYRO_ANALYZER_FFT_LOG2) {
+            analyzer->phase = GYRO_ANALYZER_MAGNITUDE;
+        }
+    }
+}
+
+static void step_magnitude(gyro_analyzer_t *analyzer) {
+    for (uint16_t n = 0; n < analyzer->work_per_step && analyzer->position < FFT_BINS; n++) {
+        uint16_t k = analyzer->position++;
+        analyzer->magnitude[k] = analyzer->re[k] * analyzer->re[k] + analyzer->im[k] * analyzer->im[k];
+    }
+
+    if (analyzer->position == FFT_BINS) {
+        analyzer->phase = GYRO_ANALYZER_PEAKS;
+        analyzer->position = 0;
+    }
+}
+
+static void step_peaks(gyro_analyzer_t *analyzer) {
+    const float *mag = analyzer->magnitude;
+    int min_bin = (int)(analyzer->min_hz / analyzer->bin_hz);
+    int max_bin = (int)(analyzer->max_hz / analyzer->bin_hz) + 1;
+    if (min_bin < 1) min_bin = 1;
+    if (max_bin > FFT_BINS - 2) max_bin = FFT_BINS - 2;
+
+    float band_sum = 0.0f;
+    for (int k = min_bin; k <= max_bin; k++) {
+        band_sum += mag[k];
+    }
+    float threshold = PEAK_THRESHOLD * band_sum / (max_bin - min_bin + 1);
+
+    // Strongest local maxima in the band, kept sorted by magnitude
+    int peak_bin[GYRO_ANALYZER_MAX_PEAKS];
+    float peak_mag[GYRO_ANALYZER_MAX_PEAKS];
+    int found = 0;
+    for (int k = min_bin; k <= max_bin; k++) {
+        if (mag[k] <= threshold || mag[k] <= mag[k - 1] || mag[k] < mag[k + 1]) {
+            continue;
+        }
+        int slot = found;
+        while (slot > 0 && peak_mag[slot - 1] < mag[k]) {
+            if (slot < analyzer->peak_count) {
+                peak_bin[slot] = peak_bin[slot - 1];
+                peak_mag[slot] = peak_mag[slot - 1];
+            }
+            slot--;
+        }
+        if (slot < analyzer->peak_count) {
+            peak_bin[slot] = k;
+            peak_mag[slot] = mag[k];
+            if (found < analyzer->peak_count) {
+                found++;
+            }
+        }
+    }
+
+    // Assign peaks to notches in frequency order so notches do not swap
+    for (int a = 1; a < found; a++) {
+        for (int b = a; b > 0 && peak_bin[b] < peak_bin[b - 1]; b--) {
+            int tmp = peak_bin[b];
+            peak_bin[b] = peak_bin[b - 1];
+            peak_bin[b - 1] = tmp;
+        }
+    }
+
+    uint8_t axis = analyzer->axis;
+    for (int p = 0; p < found; p++) {
+        int k = peak_bin[p];
+
+        // Parabolic interpolation between neighbouring bins
+        float y0 = mag[k - 1];
+        float y1 = mag[k];
+        float y2 = mag[k + 1];
+        float denom = y0 - 2.0f * y1 + y2;
+        float offset = (denom != 0.0f) ? 0.5f * (y0 - y2) / denom : 0.0f;
+
+        float frequency = (k + offset) * analyzer->bin_hz;
+        if (frequency < analyzer->min_hz) frequency = analyzer->min_hz;
+        if (frequency > analyzer->max_hz) frequency = analyzer->max_hz;
+
+        float center = analyzer->center_hz[axis][p];
+        center += analyzer->smoothing * (frequency - center);
+        analyzer->center_hz[axis][p] = center;
+        filter_stage_set_cutoff(analyzer->notch[axis][p], center, analyzer->loop_hz);
+    }
+
+    analyzer->analyses++;
+    analyzer->axis = (uint8_t)((axis + 1) % GYRO_ANALYZER_AXES);
+    analyzer->phase = GYRO_ANALYZER_WINDOW;
+    analyzer->position = 0;
+}
+
+void gyro_analyzer_update(gyro_analyzer_t *analyzer) {
+    if (analyzer->filled < GYRO_ANALYZER_FFT_SIZE || analyzer->peak_count == 0) {
+        return;
+    }
+
+    switch (analyzer->phase) {
+        case GYRO_ANALYZER_WINDOW:
+            step_window(analyzer);
+            break;
+        case GYRO_ANALYZER_FFT:
+            step_fft(analyzer);
+            break;
+        case GYRO_ANALYZER_MAGNITUDE:
+            step_magnitude(analyzer);
+            break;
+        case GYRO_ANALYZER_PEAKS:
+            step_peaks(analyzer);
+            break;
+    }
+}
+
+void gyro_analyzer_set_loop_rate(gyro_analyzer_t *analyzer, float loop_hz, float analyzer_hz) {
+    configure_rates(analyzer, loop_hz, analyzer_hz);
+
+    for (int axis = 0; axis < GYRO_ANALYZER_AXES; axis++) {
+        for (int peak = 0; peak < analyzer->peak_count; peak++) {
+            float center = analyzer->center_hz[axis][peak];
+            if (center > analyzer->max_hz) {
+                center = analyzer->max_hz;
+                analyzer->center_hz[axis][peak] = center;
+            }
+            filter_stage_set_cutoff(analyzer->notch[axis][peak], center, loop_hz);
+        }
+    }
+}
+
+float gyro_analyzer_get_center(const gyro_analyzer_t *analyzer, uint8_t axis, uint8_t peak) {
+    if (axis >= GYRO_ANALYZER_AXES || peak >= analyzer->peak_count) {
+        return 0.0f;
+    }
+    return analyzer->center_hz[axis][peak];
+}
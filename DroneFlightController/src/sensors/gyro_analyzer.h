@@ -0,0 +1,96 @@
+//
+//  gyro_analyzer.h
+//  DroneFlightController
+//
+//  Streaming gyro spectrum analyzer driving dynamic notch filters.
+//  Samples are collected every control cycle while a windowed radix-2 FFT
+//  runs incrementally, a bounded amount of work per cycle, one axis at a
+//  time. The strongest peaks in the noise band retune notch stages that
+//  live in the gyro filter chains.
+//
+
+#ifndef gyro_analyzer_h
+#define gyro_analyzer_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/filter_bank.h"
+
+#define GYRO_ANALYZER_AXES       3
+#define GYRO_ANALYZER_FFT_LOG2   6
+#define GYRO_ANALYZER_FFT_SIZE   (1 << GYRO_ANALYZER_FFT_LOG2)
+#define GYRO_ANALYZER_MAX_PEAKS  2    // Dynamic notches per axis
+
+// Analysis phases, one axis at a time
+typedef enum {
+    GYRO_ANALYZER_WINDOW = 0,   // Copy, window and bit-reverse the sample buffer
+    GYRO_ANALYZER_FFT,          // Butterfly stages
+    GYRO_ANALYZER_MAGNITUDE,    // Squared magnitude of the positive bins
+    GYRO_ANALYZER_PEAKS         // Peak search and notch retune
+} gyro_analyzer_phase_t;
+
+typedef struct {
+    // Dynamic notch stages owned by the gyro filter chains
+    filter_stage_t *notch[GYRO_ANALYZER_AXES][GYRO_ANALYZER_MAX_PEAKS];
+    float center_hz[GYRO_ANALYZER_AXES][GYRO_ANALYZER_MAX_PEAKS];
+    uint8_t peak_count;
+
+    // Decimated input ring per axis
+    float samples[GYRO_ANALYZER_AXES][GYRO_ANALYZER_FFT_SIZE];
+    float accumulator[GYRO_ANALYZER_AXES];
+    uint16_t decimation;
+    uint16_t accumulated;
+    uint16_t write_index;
+    uint16_t filled;
+
+    // FFT workspace for the axis under analysis
+    float re[GYRO_ANALYZER_FFT_SIZE];
+    float im[GYRO_ANALYZER_FFT_SIZE];
+    float magnitude[GYRO_ANALYZER_FFT_SIZE / 2];
+
+    // Tables built once at init
+    float window[GYRO_ANALYZER_FFT_SIZE];
+    float twiddle_re[GYRO_ANALYZER_FFT_SIZE / 2];
+    float twiddle_im[GYRO_ANALYZER_FFT_SIZE / 2];
+    uint8_t bit_reverse[GYRO_ANALYZER_FFT_SIZE];
+
+    // Incremental progress
+    gyro_analyzer_phase_t phase;
+    uint8_t axis;
+    uint8_t fft_stage;
+    uint16_t position;
+    uint16_t read_start;
+    uint16_t work_per_step;
+
+    // Frequencies
+    float loop_hz;           // Rate at which samples are pushed and notches run
+    float sample_hz;         // Analyzer rate after decimation
+    float bin_hz;
+    float min_hz;
+    float max_hz;
+    float smoothing;         // PT1 factor applied to peak frequency updates
+
+    uint32_t analyses;       // Completed per-axis analyses
+} gyro_analyzer_t;
+
+// Initialize the analyzer and append peak_count notch stages to each gyro chain
+// loop_hz is the rate of gyro_analyzer_push(); the analyzer decimates to about
+// analyzer_hz. work_per_step bounds the samples, butterflies or bins handled
+// per gyro_analyzer_update() call.
+bool gyro_analyzer_init(gyro_analyzer_t *analyzer, filter_chain_t *gyro_chains, uint8_t peak_count,
+                        float notch_q, float loop_hz, float analyzer_hz,
+                        float min_hz, float max_hz, uint16_t work_per_step);
+
+// Feed one unfiltered gyro sample per axis, called every control cycle
+void gyro_analyzer_push(gyro_analyzer_t *analyzer, const float *gyro);
+
+// Advance the analysis by one bounded step, called every control cycle
+void gyro_analyzer_update(gyro_analyzer_t *analyzer);
+
+// Re-derive rates and notch coefficients after a loop rate change
+void gyro_analyzer_set_loop_rate(gyro_analyzer_t *analyzer, float loop_hz, float analyzer_hz);
+
+// Current notch center frequency for one axis and peak
+float gyro_analyzer_get_center(const gyro_analyzer_t *analyzer, uint8_t axis, uint8_t peak);
+
+#endif /* gyro_analyzer_h */
@@ -0,0 +1,242 @@
+//
+//  imu_calibration.c
+//  DroneFlightController
+//
+
+#define LOG_MODULE LOG_MODULE_SENSORS
+
+#include "imu_calibration.h"
+#include "config/sensor_config.h"
+#include "utils/flash_storage.h"
+#include "utils/logger.h"
+#include <math.h>
+
+// Plausible range of a solved accel correction
+static const float ACCEL_MAX_OFFSET = 0.2f;   // g
+static const float ACCEL_MIN_SCALE = 0.8f;
+static const float ACCEL_MAX_SCALE = 1.2f;
+
+// Accel magnitude range accepted for a face capture (g)
+static const float FACE_MIN_NORM = 0.8f;
+static const float FACE_MAX_NORM = 1.2f;
+
+// Faces averaged before further captures stop refining them
+static const uint8_t FACE_MAX_WINDOWS = 8;
+
+static void welford3_reset(welford3_t *w) {
+    w->count = 0;
+    for (int i = 0; i < 3; i++) {
+        w->mean[i] = 0.0f;
+        w->m2[i] = 0.0f;
+    }
+}
+
+// Numerically stable update, no large sums of squares in float
+static void welford3_add(welford3_t *w, const float *x) {
+    w->count++;
+    float inv_n = 1.0f / (float)w->count;
+    for (int i = 0; i < 3; i++) {
+        float delta = x[i] - w->mean[i];
+        w->mean[i] += delta * inv_n;
+        w->m2[i] += delta * (x[i] - w->mean[i]);
+    }
+}
+
+// Largest per-axis sample variance
+static float welford3_max_variance(const welford3_t *w) {
+    if (w->count < 2) {
+        return 0.0f;
+    }
+    float max_m2 = w->m2[0];
+    if (w->m2[1] > max_m2) max_m2 = w->m2[1];
+    if (w->m2[2] > max_m2) max_m2 = w->m2[2];
+    return max_m2 / (float)(w->count - 1);
+}
+
+static void clear_accel_correction(imu_calibration_data_t *data) {
+    for (int i = 0; i < 3; i++) {
+        data->accel_offset[i] = 0.0f;
+        data->accel_scale[i] = 1.0f;
+    }
+    data->accel_valid = false;
+}
+
+void imu_calibration_init(imu_calibration_t *cal, uint16_t window_size) {
+    for (int i = 0; i < 3; i++) {
+        cal->data.gyro_bias[i] = 0.0f;
+        cal->saved_gyro_bias[i] = 0.0f;
+    }
+    cal->data.gyro_valid = false;
+    clear_accel_correction(&cal->data);
+
+    welford3_reset(&cal->gyro_window);
+    welford3_reset(&cal->accel_window);
+    cal->window_size = (window_size > 1) ? window_size : 2;
+    cal->bias_windows = 0;
+    for (int i = 0; i < 6; i++) {
+        cal->face[i] = 0.0f;
+        cal->face_windows[i] = 0;
+    }
+    cal->faces_seen = 0;
+    cal->still = false;
+    cal->dirty = false;
+}
+
+// Offset and scale per axis from the +1 g and -1 g faces
+static void solve_accel(imu_calibration_t *cal) {
+    imu_calibration_data_t solved = cal->data;
+    for (int axis = 0; axis < 3; axis++) {
+        float pos = cal->face[axis * 2];
+        float neg = cal->face[axis * 2 + 1];
+        float span = pos - neg;
+        if (span <= 0.0f) {
+            return;
+        }
+        solved.accel_offset[axis] = 0.5f * (pos + neg);
+        solved.accel_scale[axis] = 2.0f / span;
+
+        if (fabsf(solved.accel_offset[axis]) > ACCEL_MAX_OFFSET ||
+            solved.accel_scale[axis] < ACCEL_MIN_SCALE || solved.accel_scale[axis] > ACCEL_MAX_SCALE) {
+            return;
+        }
+    }
+    solved.accel_valid = true;
+    cal->data = solved;
+    cal->dirty = true;
+}
+
+// Record the face the gravity vector points along, if any
+static void capture_face(imu_calibration_t *cal, const float *mean) {
+    int axis = 0;
+    for (int i = 1; i < 3; i++) {
+        if (fabsf(mean[i]) > fabsf(mean[axis])) {
+            axis = i;
+        }
+    }
+
+    float norm = sqrtf(mean[0] * mean[0] + mean[1] * mean[1] + mean[2] * mean[2]);
+    if (norm < FACE_MIN_NORM || norm > FACE_MAX_NORM ||
+        fabsf(mean[axis]) < IMU_CAL_FACE_ALIGNMENT * norm) {
+        return;
+    }
+
+    int face = axis * 2 + (mean[axis] < 0.0f ? 1 : 0);
+    if (cal->face_windows[face] >= FACE_MAX_WINDOWS) {
+        return;
+    }
+    cal->face_windows[face]++;
+    cal->face[face] += (mean[axis] - cal->face[face]) / (float)cal->face_windows[face];
+
+    bool new_face = (cal->faces_seen & (1u << face)) == 0;
+    cal->faces_seen |= (uint8_t)(1u << face);
+    LOG_MSG(LOG_DEBUG, "Accel face %d: %f g over %u windows", face, cal->face[face],
+            (unsigned)cal->face_windows[face]);
+
+    // Solve when the set completes and again when a face finishes
+    // averaging, rather than storing after every window
+    if (cal->faces_seen == 0x3F && (new_face || cal->face_windows[face] == FACE_MAX_WINDOWS)) {
+        solve_accel(cal);
+    }
+}
+
+// Fold a still window's mean rate into the gyro bias
+static void update_gyro_bias(imu_calibration_t *cal, const float *mean) {
+    if (cal->bias_windows < IMU_CAL_BIAS_WINDOWS) {
+        cal->bias_windows++;
+    }
+
+    // Running mean until the window count saturates, then an exponential
+    // average that follows temperature drift
+    float weight = 1.0f / (float)cal->bias_windows;
+    bool moved = !cal->data.gyro_valid;
+    for (int i = 0; i < 3; i++) {
+        cal->data.gyro_bias[i] += (mean[i] - cal->data.gyro_bias[i]) * weight;
+        if (fabsf(cal->data.gyro_bias[i] - cal->saved_gyro_bias[i]) > IMU_CAL_SAVE_BIAS_DELTA) {
+            moved = true;
+        }
+    }
+    cal->data.gyro_valid = true;
+    if (moved) {
+        cal->dirty = true;
+    }
+}
+
+static void complete_window(imu_calibration_t *cal) {
+    const float *gyro_mean = cal->gyro_window.mean;
+    cal->still = welford3_max_variance(&cal->gyro_window) < IMU_CAL_GYRO_STILL_VAR &&
+                 welford3_max_variance(&cal->accel_window) < IMU_CAL_ACCEL_STILL_VAR &&
+                 fabsf(gyro_mean[0]) < IMU_CAL_GYRO_MAX_BIAS &&
+                 fabsf(gyro_mean[1]) < IMU_CAL_GYRO_MAX_BIAS &&
+                 fabsf(gyro_mean[2]) < IMU_CAL_GYRO_MAX_BIAS;
+
+    if (cal->still) {
+        update_gyro_bias(cal, gyro_mean);
+        capture_face(cal, cal->accel_window.mean);
+    }
+
+    welford3_reset(&cal->gyro_window);
+    welford3_reset(&cal->accel_window);
+}
+
+void imu_calibration_feed(imu_calibration_t *cal, const float *accel, const float *gyro) {
+    welford3_add(&cal->gyro_window, gyro);
+    welford3_add(&cal->accel_window, accel);
+
+    if (cal->gyro_window.count >= cal->window_size) {
+        complete_window(cal);
+    }
+}
+
+void imu_calibration_apply(const imu_calibration_t *cal, float *accel, float *gyro) {
+    for (int i = 0; i < 3; i++) {
+        accel[i] = (accel[i] - cal->data.accel_offset[i]) * cal->data.accel_scale[i];
+        gyro[i] -= cal->data.gyro_bias[i];
+    }
+}
+
+bool imu_calibration_is_still(const imu_calibration_t *cal) {
+    return cal->still;
+}
+
+bool imu_calibration_is_valid(const imu_calibration_t *cal) {
+    return cal->data.gyro_valid;
+}
+
+bool imu_calibration_needs_save(const imu_calibration_t *cal) {
+    return cal->dirty;
+}
+
+bool imu_calibration_load(imu_calibration_t *cal) {
+    imu_calibration_data_t stored;
+    if (!flash_storage_read(FLASH_STORAGE_IMU_CALIBRATION, &stored, sizeof(stored))) {
+        return false;
+    }
+
+    cal->data = stored;
+    if (!cal->data.accel_valid) {
+        clear_accel_correction(&cal->data);
+    }
+    for (int i = 0; i < 3; i++) {
+        if (!cal->data.gyro_valid) {
+            cal->data.gyro_bias[i] = 0.0f;
+        }
+        cal->saved_gyro_bias[i] = cal->data.gyro_bias[i];
+    }
+
+    // The stored bias counts as one window, so the first still window of
+    // this boot pulls it halfway toward today's temperature
+    cal->bias_windows = cal->data.gyro_valid ? 1 : 0;
+    cal->dirty = false;
+    return true;
+}
+
+bool imu_calibration_save(imu_calibration_t *cal) {
+    if (!flash_storage_write(FLASH_STORAGE_IMU_CALIBRATION, &cal->data, sizeof(cal->data))) {
+        return false;
+    }
+    for (int i = 0; i < 3; i++) {
+        cal->saved_gyro_bias[i] = cal->data.gyro_bias[i];
+    }
+    cal->dirty = false;
+    return true;
+}
@@ -0,0 +1,74 @@
+//
+//  imu_calibration.h
+//  DroneFlightController
+//
+//  Incremental IMU calibration fed one raw sample at a time. Samples are
+//  grouped into windows whose mean and variance are tracked with Welford's
+//  method; a window with low gyro and accel variance counts as still. Still
+//  windows refine the gyro bias, and still windows with gravity along one
+//  axis capture that face of the accelerometer. Once all six faces have
+//  been seen the per-axis accel offset and scale are solved.
+//
+
+#ifndef imu_calibration_h
+#define imu_calibration_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Running mean and sum of squared deviations over three axes
+typedef struct {
+    uint32_t count;
+    float mean[3];
+    float m2[3];
+} welford3_t;
+
+// Persisted correction, calibrated = (raw - offset) * scale for accel,
+// raw - bias for gyro
+typedef struct {
+    float gyro_bias[3];      // rad/s
+    float accel_offset[3];   // g
+    float accel_scale[3];
+    bool gyro_valid;
+    bool accel_valid;
+} imu_calibration_data_t;
+
+typedef struct {
+    imu_calibration_data_t data;
+    welford3_t gyro_window;
+    welford3_t accel_window;
+    uint16_t window_size;
+    uint16_t bias_windows;      // Still windows folded into the gyro bias
+    float face[6];              // Mean raw reading along the axis for +X, -X, +Y, -Y, +Z, -Z
+    uint8_t face_windows[6];    // Still windows averaged into each face
+    uint8_t faces_seen;         // Bitmask of captured faces
+    float saved_gyro_bias[3];   // Bias at the last load or save
+    bool still;                 // Result of the last completed window
+    bool dirty;                 // Changed enough since the last save to store again
+} imu_calibration_t;
+
+// Start with no correction, windows of window_size samples
+void imu_calibration_init(imu_calibration_t *cal, uint16_t window_size);
+
+// Feed one uncalibrated sample, accel in g and gyro in rad/s
+void imu_calibration_feed(imu_calibration_t *cal, const float *accel, const float *gyro);
+
+// Correct a sample in place with the current calibration
+void imu_calibration_apply(const imu_calibration_t *cal, float *accel, float *gyro);
+
+// True if the last completed window was still
+bool imu_calibration_is_still(const imu_calibration_t *cal);
+
+// True once a gyro bias is available, from storage or a still window
+bool imu_calibration_is_valid(const imu_calibration_t *cal);
+
+// True when the calibration has changed enough to be worth storing
+bool imu_calibration_needs_save(const imu_calibration_t *cal);
+
+// Load the stored calibration, false if none is stored
+bool imu_calibration_load(imu_calibration_t *cal);
+
+// Store the current calibration and clear the dirty flag
+bool imu_calibration_save(imu_calibration_t *cal);
+
+#endif /* imu_calibration_h */
@@ -0,0 +1,62 @@
+//
+//  imu_data_ready.c
+//  DroneFlightController
+//
+
+#include "imu_data_ready.h"
+#include "utils/timing.h"
+#include "utils/profiler.h"
+#include "config/sensor_config.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+static uint32_t data_ready_pin;
+static volatile uint32_t data_ready_us;
+static volatile uint32_t data_ready_sequence;
+static volatile imu_data_ready_callback_t data_ready_callback;
+
+// Raw handler so other users of the bank IRQ keep their own callbacks
+static void data_ready_isr(void) {
+    if (gpio_get_irq_event_mask(data_ready_pin) & GPIO_IRQ_EDGE_RISE) {
+        PROFILER_BEGIN(PROFILER_PROBE_IMU_ISR);
+        gpio_acknowledge_irq(data_ready_pin, GPIO_IRQ_EDGE_RISE);
+        uint32_t timestamp = timing_micros();
+        data_ready_us = timestamp;
+        data_ready_sequence = data_ready_sequence + 1;
+
+        imu_data_ready_callback_t callback = data_ready_callback;
+        if (callback) {
+            callback(timestamp);
+        }
+        PROFILER_END(PROFILER_PROBE_IMU_ISR);
+    }
+}
+
+void imu_data_ready_init(uint32_t pin) {
+    data_ready_pin = pin;
+    data_ready_sequence = 0;
+    profiler_init_probe(PROFILER_PROBE_IMU_ISR, "imu_isr", 1000000 / IMU_SAMPLE_RATE_HZ);
+
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
+    gpio_add_raw_irq_handler(pin, data_ready_isr);
+    gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+bool imu_data_ready_last(uint32_t *timestamp_us, uint32_t *sequence) {
+    // Both words must come from the same edge
+    uint32_t status = save_and_disable_interrupts();
+    uint32_t timestamp = data_ready_us;
+    uint32_t count = data_ready_sequence;
+    restore_interrupts(status);
+
+    *timestamp_us = timestamp;
+    *sequence = count;
+    return count != 0;
+}
+
+void imu_data_ready_set_callback(imu_data_ready_callback_t callback) {
+    data_ready_callback = callback;
+}
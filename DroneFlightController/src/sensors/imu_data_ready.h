@@ -0,0 +1,30 @@
+//
+//  imu_data_ready.h
+//  DroneFlightController
+//
+//  Timestamps the IMU data-ready interrupt. The GPIO edge handler records
+//  the microsecond time a sample became available, so sample timing does
+//  not depend on when a task got around to reading it.
+//
+
+#ifndef imu_data_ready_h
+#define imu_data_ready_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Called from the interrupt with the edge timestamp
+typedef void (*imu_data_ready_callback_t)(uint32_t timestamp_us);
+
+// Configure the pin as an input and enable the rising-edge interrupt
+void imu_data_ready_init(uint32_t pin);
+
+// Timestamp of the most recent data-ready edge and the number of edges
+// seen so far; false before the first edge
+bool imu_data_ready_last(uint32_t *timestamp_us, uint32_t *sequence);
+
+// Run callback in interrupt context on every edge, after the timestamp is
+// recorded; NULL removes it
+void imu_data_ready_set_callback(imu_data_ready_callback_t callback);
+
+#endif /* imu_data_ready_h */
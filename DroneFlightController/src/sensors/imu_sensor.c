@@ -1,19 +1,36 @@
 #include "imu_sensor.h"
+#include "attitude_estimator.h"
+#include "imu_data_ready.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include "i2c_driver.h"
+#include "utils/timing.h"
+#include "config/sensor_config.h"
+#include "config/hardware_config.h"
+#include <math.h>
+
+static_assert(MPU6050_GYRO_OUTPUT_HZ % IMU_SAMPLE_RATE_HZ == 0 &&
+              MPU6050_GYRO_OUTPUT_HZ / IMU_SAMPLE_RATE_HZ <= 256,
+              "IMU_SAMPLE_RATE_HZ must be 8 kHz divided by 1 to 256");
+
+// Radians per second for one gyro LSB
+static const float GYRO_RAD_PER_LSB = (float)(M_PI / 180.0) / MPU6050_GYRO_LSB_PER_DPS;
+
+// Big-endian register pair to signed value
+static inline int16_t read_be16(const uint8_t* data) {
+    return (int16_t)((data[0] << 8) | data[1]);
+}
 
 // Constructor
-IMUSensor::IMUSensor() : initialized(false), calibrated(false) {
-    // Initialize calibration data to zero
+IMUSensor::IMUSensor() : initialized(false) {
+    imu_calibration_init(&calibration, IMU_CAL_WINDOW_SAMPLES);
     for(int i = 0; i < 3; i++) {
-        calibrationData.accelBias[i] = 0.0f;
-        calibrationData.gyroBias[i] = 0.0f;
-        calibrationData.magBias[i] = 0.0f;
-        sensorData.accel[i] = 0.0f;
-        sensorData.gyro[i] = 0.0f;
-        sensorData.mag[i] = 0.0f;
+        latestSample.accel[i] = 0.0f;
+        latestSample.gyro[i] = 0.0f;
     }
+    latestSample.temperature = 0.0f;
+    latestSample.timestamp_us = 0;
+    dataReadySequence = 0;
 }
 
 // Destructor
@@ -30,53 +47,109 @@ bool IMUSensor::initialize() {
     if(!configureSensorRegisters()) {
         return false;
     }
+
+    // Timestamp samples at the data-ready edge rather than at the read
+    imu_data_ready_init(IMU_INT_PIN);
     
     initialized = true;
     return true;
 }
 
+bool IMUSensor::sample() {
+    if(!initialized) return false;
+
+    // An edge seen before the read announced the sample about to be read;
+    // one arriving during the read is left for the next call. Once edges
+    // arrive, no new edge means no new sample: the registers still hold
+    // the one already read. Only without a working interrupt is the read
+    // start the timestamp.
+    uint32_t timestamp = timing_micros();
+    uint32_t edgeUs, edgeSequence;
+    if(imu_data_ready_last(&edgeUs, &edgeSequence)) {
+        if(edgeSequence == dataReadySequence) {
+            return false;
+        }
+        dataReadySequence = edgeSequence;
+        timestamp = edgeUs;
+    }
+
+    // One transaction for the contiguous block, so all axes come from the
+    // same sensor sample
+    uint8_t raw[MPU6050_BURST_LENGTH];
+    if(i2c_read(MPU6050_ADDRESS, MPU6050_ACCEL_XOUT_H, raw, MPU6050_BURST_LENGTH) != I2C_SUCCESS) {
+        return false;
+    }
+
+    imu_sample_t data;
+    convertRaw(&raw[0], &raw[8], data);
+    data.timestamp_us = timestamp;
+    data.temperature = read_be16(&raw[6]) / 340.0f + 36.53f;
+
+    latestSample = data;
+    return true;
+}
+
+const imu_sample_t& IMUSensor::getSample() const {
+    return latestSample;
+}
+
 bool IMUSensor::readAccelerometer(float& x, float& y, float& z) {
     if(!initialized) return false;
     
-    updateSensorData();
-    x = sensorData.accel[0];
-    y = sensorData.accel[1];
-    z = sensorData.accel[2];
+    x = latestSample.accel[0];
+    y = latestSample.accel[1];
+    z = latestSample.accel[2];
     return true;
 }
 
 bool IMUSensor::readGyroscope(float& x, float& y, float& z) {
     if(!initialized) return false;
     
-    updateSensorData();
-    x = sensorData.gyro[0];
-    y = sensorData.gyro[1];
-    z = sensorData.gyro[2];
+    x = latestSample.gyro[0];
+    y = latestSample.gyro[1];
+    z = latestSample.gyro[2];
     return true;
 }
 
 bool IMUSensor::readMagnetometer(float& x, float& y, float& z) {
-    if(!initialized) return false;
-    
-    updateSensorData();
-    x = sensorData.mag[0];
-    y = sensorData.mag[1];
-    z = sensorData.mag[2];
+    float field[3];
+    x = 0.0f;
+    y = 0.0f;
+    z = 0.0f;
+    if(!initialized || !readRawMagnetometer(field)) {
+        return false;
+    }
+
+    // Hard and soft iron would bias heading, so report nothing until the
+    // fit has seen enough orientations
+    magCalibration.addSample(field);
+    if(!magCalibration.isValid()) {
+        return false;
+    }
+    magCalibration.apply(field, field);
+
+    x = field[0];
+    y = field[1];
+    z = field[2];
     return true;
 }
 
 bool IMUSensor::getOrientation(float& roll, float& pitch, float& yaw) {
     if(!initialized) return false;
     
-    // Calculate orientation from accelerometer and magnetometer data
-    // Using basic AHRS algorithm
-    float ax = sensorData.accel[0];
-    float ay = sensorData.accel[1];
-    float az = sensorData.accel[2];
+    // Roll and pitch from gravity, yaw from the tilt-compensated heading
+    float ax = latestSample.accel[0];
+    float ay = latestSample.accel[1];
+    float az = latestSample.accel[2];
     
     roll = atan2f(ay, az);
     pitch = atan2f(-ax, sqrtf(ay * ay + az * az));
-    yaw = atan2f(sensorData.mag[1], sensorData.mag[0]);
+
+    float mag[3];
+    yaw = 0.0f;
+    if(readMagnetometer(mag[0], mag[1], mag[2])) {
+        yaw = tilt_compensated_heading(latestSample.accel, mag);
+    }
     
     return true;
 }
@@ -91,41 +164,45 @@ bool IMUSensor::getLinearAcceleration(float& x, float& y, float& z) {
 
 bool IMUSensor::calibrate() {
     if(!initialized) return false;
-    
-    // Collect multiple samples and average them
-    const int numSamples = 100;
-    float accelSum[3] = {0};
-    float gyroSum[3] = {0};
-    float magSum[3] = {0};
-    
-    for(int i = 0; i < numSamples; i++) {
-        updateSensorData();
-        for(int j = 0; j < 3; j++) {
-            accelSum[j] += sensorData.accel[j];
-            gyroSum[j] += sensorData.gyro[j];
-            magSum[j] += sensorData.mag[j];
-        }
-        vTaskDelay(pdMS_TO_TICKS(10)); // Wait between samples
-    }
-    
-    // Calculate average bias
-    for(int i = 0; i < 3; i++) {
-        calibrationData.accelBias[i] = accelSum[i] / numSamples;
-        calibrationData.gyroBias[i] = gyroSum[i] / numSamples;
-        calibrationData.magBias[i] = magSum[i] / numSamples;
-    }
-    
-    calibrated = true;
+
+    // No samples are taken here: a stored calibration is usable at once,
+    // and without one the gyro bias becomes valid after the first still
+    // window. Gravity is never mistaken for accel bias; the accel offset
+    // and scale only change once all six faces have been seen.
+    imu_calibration_init(&calibration, IMU_CAL_WINDOW_SAMPLES);
+    imu_calibration_load(&calibration);
+    magCalibration.reset();
+    magCalibration.load();
     return true;
 }
 
 void IMUSensor::resetCalibration() {
-    for(int i = 0; i < 3; i++) {
-        calibrationData.accelBias[i] = 0.0f;
-        calibrationData.gyroBias[i] = 0.0f;
-        calibrationData.magBias[i] = 0.0f;
+    imu_calibration_init(&calibration, IMU_CAL_WINDOW_SAMPLES);
+    magCalibration.reset();
+}
+
+bool IMUSensor::isCalibrated() const {
+    return imu_calibration_is_valid(&calibration);
+}
+
+bool IMUSensor::isStill() const {
+    return imu_calibration_is_still(&calibration);
+}
+
+bool IMUSensor::saveCalibration() {
+    // Writing flash stalls both cores, so never with the craft moving
+    if(!imu_calibration_is_still(&calibration)) {
+        return false;
     }
-    calibrated = false;
+
+    // At most one record per call keeps each stall to a single erase
+    if(imu_calibration_needs_save(&calibration)) {
+        return imu_calibration_save(&calibration);
+    }
+    if(magCalibration.needsSave()) {
+        return magCalibration.save();
+    }
+    return false;
 }
 
 bool IMUSensor::isInitialized() const {
@@ -147,8 +224,8 @@ bool IMUSensor::configureSensorRegisters() {
     // Example configuration for MPU6050
     uint8_t data = 0;
 
-    // Set sample rate to 1kHz
-    data = 0x07;
+    // Set the output data rate, also the data-ready rate
+    data = (uint8_t)(MPU6050_GYRO_OUTPUT_HZ / IMU_SAMPLE_RATE_HZ - 1);
     if(i2c_write_byte(MPU6050_ADDRESS, MPU6050_SMPLRT_DIV, data) != I2C_SUCCESS) {
         return false;
     }
@@ -171,28 +248,44 @@ bool IMUSensor::configureSensorRegisters() {
         return false;
     }
 
+    // Pulse INT high on every new sample, cleared by the burst read
+    if(i2c_write_byte(MPU6050_ADDRESS, MPU6050_INT_PIN_CFG, MPU6050_INT_RD_CLEAR) != I2C_SUCCESS) {
+        return false;
+    }
+    if(i2c_write_byte(MPU6050_ADDRESS, MPU6050_INT_ENABLE, MPU6050_INT_DATA_RDY_EN) != I2C_SUCCESS) {
+        return false;
+    }
+
     return true;
 }
 
-void IMUSensor::updateSensorData() {
-    // Here you would implement the actual I2C/SPI communication
-    // with the IMU hardware to read the latest sensor values
-    // For now, we'll just simulate some values
-    for(int i = 0; i < 3; i++) {
-        sensorData.accel[i] = 0.0f; // Replace with actual sensor reading
-        sensorData.gyro[i] = 0.0f;  // Replace with actual sensor reading
-        sensorData.mag[i] = 0.0f;   // Replace with actual sensor reading
-    }
-    
-    if(calibrated) {
-        applyCalibration();
+bool IMUSensor::setSampleRate(uint32_t rateHz) {
+    if(!initialized || rateHz == 0) return false;
+
+    uint32_t divider = MPU6050_GYRO_OUTPUT_HZ / rateHz;
+    if(divider < 1 || divider > 256 || divider * rateHz != MPU6050_GYRO_OUTPUT_HZ) {
+        return false;
     }
+    return i2c_write_byte(MPU6050_ADDRESS, MPU6050_SMPLRT_DIV, (uint8_t)(divider - 1)) == I2C_SUCCESS;
 }
 
-void IMUSensor::applyCalibration() {
+// The MPU6050 has no magnetometer of its own; boards with an auxiliary
+// one read it here, in any unit since the fit normalizes it
+bool IMUSensor::readRawMagnetometer(float* raw) {
+    raw[0] = 0.0f;
+    raw[1] = 0.0f;
+    raw[2] = 0.0f;
+    return false;
+}
+
+// Scale raw accel and gyro registers, feed the background calibration
+// with the uncorrected values and apply the current correction
+void IMUSensor::convertRaw(const uint8_t* accelRaw, const uint8_t* gyroRaw, imu_sample_t& data) {
     for(int i = 0; i < 3; i++) {
-        sensorData.accel[i] -= calibrationData.accelBias[i];
-        sensorData.gyro[i] -= calibrationData.gyroBias[i];
-        sensorData.mag[i] -= calibrationData.magBias[i];
+        data.accel[i] = read_be16(&accelRaw[i * 2]) / MPU6050_ACCEL_LSB_PER_G;
+        data.gyro[i] = read_be16(&gyroRaw[i * 2]) * GYRO_RAD_PER_LSB;
     }
+
+    imu_calibration_feed(&calibration, data.accel, data.gyro);
+    imu_calibration_apply(&calibration, data.accel, data.gyro);
 }
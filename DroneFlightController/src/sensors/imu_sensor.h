@@ -2,6 +2,38 @@
 #define imu_sensor_h
 
 #include <stdint.h>
+#include "imu_calibration.h"
+#include "mag_calibration.h"
+
+/* MPU6050 Registers */
+#define MPU6050_ADDRESS         0x68
+#define MPU6050_SMPLRT_DIV      0x19
+#define MPU6050_CONFIG          0x1A
+#define MPU6050_GYRO_CONFIG     0x1B
+#define MPU6050_ACCEL_CONFIG    0x1C
+#define MPU6050_INT_PIN_CFG     0x37
+#define MPU6050_INT_ENABLE      0x38
+#define MPU6050_ACCEL_XOUT_H    0x3B  // Start of the accel/temp/gyro block
+#define MPU6050_PWR_MGMT_1      0x6B
+
+#define MPU6050_GYRO_OUTPUT_HZ      8000   // Gyro output rate with the DLPF disabled
+#define MPU6050_INT_RD_CLEAR        0x10   // Any register read clears the interrupt
+#define MPU6050_INT_DATA_RDY_EN     0x01
+
+// ACCEL_XOUT_H (0x3B) through GYRO_ZOUT_L (0x48)
+#define MPU6050_BURST_LENGTH    14
+
+/* Scale factors for the configured full-scale ranges */
+#define MPU6050_ACCEL_LSB_PER_G     16384.0f  // +/- 2g
+#define MPU6050_GYRO_LSB_PER_DPS    131.0f    // +/- 250 deg/s
+
+// One coherent accel/temp/gyro sample from a single burst read
+typedef struct {
+    uint32_t timestamp_us;   // Data-ready edge, or the read start without one
+    float accel[3];          // g, calibrated
+    float gyro[3];           // rad/s, calibrated
+    float temperature;       // deg C
+} imu_sample_t;
 
 class IMUSensor {
 public:
@@ -12,9 +44,20 @@ public:
     // Initialize the IMU sensor
     bool initialize();
     
-    // Read sensor data
+    // Burst-read accel, temperature and gyro in one transaction and cache it
+    // Returns false without reading if no data-ready edge arrived since the
+    // last sample, or if the read failed.
+    bool sample();
+
+    // Most recent sample captured by sample()
+    const imu_sample_t& getSample() const;
+
+    // Read axes of the cached sample
     bool readAccelerometer(float& x, float& y, float& z);
     bool readGyroscope(float& x, float& y, float& z);
+
+    // Read the magnetometer, feed the ellipsoid fit and apply its correction
+    // Returns false if there is no magnetometer or no valid fit yet.
     bool readMagnetometer(float& x, float& y, float& z);
     
     // Get processed data
@@ -22,9 +65,20 @@ public:
     bool getAngularVelocity(float& x, float& y, float& z);
     bool getLinearAcceleration(float& x, float& y, float& z);
     
-    // Calibration
+    // Load the stored calibration and keep refining it in the background
+    // from every sample; returns immediately
     bool calibrate();
     void resetCalibration();
+
+    // True once a gyro bias is available, stored or measured this boot
+    bool isCalibrated() const;
+
+    // True if the most recent calibration window was still
+    bool isStill() const;
+
+    // Store the calibration if it changed, only while the craft is still
+    // Returns true if a record was written.
+    bool saveCalibration();
     
     // Status checks
     bool isInitialized() const;
@@ -33,29 +87,26 @@ public:
     // Sensor register configuration
     bool configureSensorRegisters();
 
+    // Change the output data rate, which is also the data-ready rate;
+    // rateHz must divide the 8 kHz gyro output rate
+    bool setSampleRate(uint32_t rateHz);
+
 private:
     // Internal state
     bool initialized;
-    bool calibrated;
-    
-    // Calibration data
-    struct CalibrationData {
-        float accelBias[3];
-        float gyroBias[3];
-        float magBias[3];
-    } calibrationData;
-    
-    // Raw sensor readings
-    struct SensorData {
-        float accel[3];
-        float gyro[3];
-        float mag[3];
-    } sensorData;
+    
+    // Background calibration, fed with every raw sample
+    imu_calibration_t calibration;
+    MagCalibration magCalibration;
+    
+    // Latest burst sample
+    imu_sample_t latestSample;
+    uint32_t dataReadySequence;    // Data-ready edge consumed by the last burst read
     
     // Private helper functions
     bool performSelfTest();
-    void updateSensorData();
-    void applyCalibration();
+    bool readRawMagnetometer(float* raw);
+    void convertRaw(const uint8_t* accelRaw, const uint8_t* gyroRaw, imu_sample_t& data);
 };
 
 #endif /* imu_sensor_h */
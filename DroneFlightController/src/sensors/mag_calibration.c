@@ -0,0 +1,280 @@
+//
+//  mag_calibration.c
+//  DroneFlightController
+//
+
+#include "mag_calibration.h"
+#include "config/sensor_config.h"
+#include "utils/flash_storage.h"
+#include <math.h>
+
+// Jacobi sweeps for the 3x3 eigen decomposition, converges in 4-6
+static const int EIGEN_MAX_SWEEPS = 10;
+
+// Eigen decomposition a = v * diag(lambda) * v^T of a symmetric 3x3
+// matrix by cyclic Jacobi rotations; a is destroyed
+static void symmetric_eigen3(float a[3][3], float v[3][3], float lambda[3]) {
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            v[r][c] = (r == c) ? 1.0f : 0.0f;
+        }
+    }
+
+    for (int sweep = 0; sweep < EIGEN_MAX_SWEEPS; sweep++) {
+        float off = fabsf(a[0][1]) + fabsf(a[0][2]) + fabsf(a[1][2]);
+        float diag = fabsf(a[0][0]) + fabsf(a[1][1]) + fabsf(a[2][2]);
+        if (off <= 1e-7f * diag) {
+            break;
+        }
+
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (a[p][q] == 0.0f) {
+                    continue;
+                }
+                // Rotation angle zeroing a[p][q]
+                float theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+                float t = (theta >= 0.0f ? 1.0f : -1.0f) / (fabsf(theta) + sqrtf(theta * theta + 1.0f));
+                float c = 1.0f / sqrtf(t * t + 1.0f);
+                float s = t * c;
+
+                for (int k = 0; k < 3; k++) {
+                    float akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    float apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    float vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        lambda[i] = a[i][i];
+    }
+}
+
+MagCalibration::MagCalibration() {
+    reset();
+    savedCorrection = correction;
+}
+
+void MagCalibration::reset() {
+    for (int i = 0; i < PARAMETERS * (PARAMETERS + 1) / 2; i++) {
+        normal[i] = 0.0;
+    }
+    for (int i = 0; i < PARAMETERS; i++) {
+        rhs[i] = 0.0;
+    }
+    count = 0;
+    sinceSolve = 0;
+    sampleScale = 0.0f;
+
+    for (int i = 0; i < 3; i++) {
+        minScaled[i] = 0.0f;
+        maxScaled[i] = 0.0f;
+        correction.offset[i] = 0.0f;
+    }
+    correction.fieldRadius = 0.0f;
+    for (int i = 0; i < 9; i++) {
+        correction.transform[i] = (i % 4 == 0) ? 1.0f : 0.0f;
+    }
+    correction.valid = false;
+}
+
+void MagCalibration::addSample(const float* raw) {
+    // The first sample fixes the scale that keeps the quadric terms near 1
+    if (sampleScale == 0.0f) {
+        float norm_sq = raw[0] * raw[0] + raw[1] * raw[1] + raw[2] * raw[2];
+        if (norm_sq <= 0.0f) {
+            return;
+        }
+        sampleScale = 1.0f / sqrtf(norm_sq);
+    }
+
+    const float x = raw[0] * sampleScale;
+    const float y = raw[1] * sampleScale;
+    const float z = raw[2] * sampleScale;
+    const float scaled[3] = {x, y, z};
+    for (int i = 0; i < 3; i++) {
+        if (count == 0 || scaled[i] < minScaled[i]) minScaled[i] = scaled[i];
+        if (count == 0 || scaled[i] > maxScaled[i]) maxScaled[i] = scaled[i];
+    }
+
+    // Design row for x'Mx + 2v'x = 1
+    const double d[PARAMETERS] = {
+        (double)(x * x), (double)(y * y), (double)(z * z),
+        2.0 * x * y, 2.0 * x * z, 2.0 * y * z,
+        2.0 * x, 2.0 * y, 2.0 * z
+    };
+    int index = 0;
+    for (int r = 0; r < PARAMETERS; r++) {
+        for (int c = r; c < PARAMETERS; c++) {
+            normal[index++] += d[r] * d[c];
+        }
+        rhs[r] += d[r];
+    }
+    count++;
+
+    if (count >= MAG_CAL_MIN_SAMPLES && ++sinceSolve >= MAG_CAL_SOLVE_INTERVAL) {
+        sinceSolve = 0;
+        solve();
+    }
+}
+
+bool MagCalibration::solve() {
+    if (count < MAG_CAL_MIN_SAMPLES) {
+        return false;
+    }
+
+    // A fit from one side of the sphere is unconstrained along the others
+    for (int i = 0; i < 3; i++) {
+        if (maxScaled[i] - minScaled[i] < MAG_CAL_MIN_SPAN) {
+            return false;
+        }
+    }
+
+    // Averaged normal equations, in float once the sums are formed
+    const double inv_count = 1.0 / count;
+    SymMatrix<PARAMETERS> s;
+    Matrix<PARAMETERS, 1> b;
+    for (int i = 0; i < SymMatrix<PARAMETERS>::SIZE; i++) {
+        s.data[i] = (float)(normal[i] * inv_count);
+    }
+    for (int i = 0; i < PARAMETERS; i++) {
+        b(i, 0) = (float)(rhs[i] * inv_count);
+    }
+
+    Matrix<PARAMETERS, 1> p;
+    if (!cholesky_solve(s, b, p)) {
+        return false;
+    }
+
+    // Center c = -M^-1 v, then (x - c)'M(x - c) = 1 + c'Mc
+    SymMatrix<3> m;
+    m(0, 0) = p(0, 0); m(1, 1) = p(1, 0); m(2, 2) = p(2, 0);
+    m(0, 1) = p(3, 0); m(0, 2) = p(4, 0); m(1, 2) = p(5, 0);
+    Matrix<3, 1> neg_v;
+    neg_v(0, 0) = -p(6, 0);
+    neg_v(1, 0) = -p(7, 0);
+    neg_v(2, 0) = -p(8, 0);
+
+    Matrix<3, 1> center;
+    if (!cholesky_solve(m, neg_v, center)) {
+        return false;
+    }
+    float k = 1.0f;
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            k += center(r, 0) * m(r, c) * center(c, 0);
+        }
+    }
+
+    // The soft-iron transform is the symmetric square root of M / k, which
+    // maps the ellipsoid onto the unit sphere without rotating it
+    float a[3][3], v[3][3], lambda[3];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            a[r][c] = m(r, c) / k;
+        }
+    }
+    symmetric_eigen3(a, v, lambda);
+
+    float min_lambda = lambda[0], max_lambda = lambda[0];
+    for (int i = 1; i < 3; i++) {
+        if (lambda[i] < min_lambda) min_lambda = lambda[i];
+        if (lambda[i] > max_lambda) max_lambda = lambda[i];
+    }
+    if (min_lambda <= 0.0f ||
+        max_lambda > MAG_CAL_MAX_AXIS_RATIO * MAG_CAL_MAX_AXIS_RATIO * min_lambda) {
+        return false;
+    }
+
+    // Keep the mean radius, the geometric mean of the semi-axes, so the
+    // transform has unit determinant and the output stays in raw units
+    float radius = 1.0f / cbrtf(sqrtf(lambda[0] * lambda[1] * lambda[2]));
+    float root[3];
+    for (int i = 0; i < 3; i++) {
+        root[i] = sqrtf(lambda[i]) * radius;
+    }
+    correction.fieldRadius = radius / sampleScale;
+
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            correction.transform[r * 3 + c] = v[r][0] * root[0] * v[c][0] +
+                                              v[r][1] * root[1] * v[c][1] +
+                                              v[r][2] * root[2] * v[c][2];
+        }
+        correction.offset[r] = center(r, 0) / sampleScale;
+    }
+    correction.valid = true;
+    return true;
+}
+
+// 9 MACs per sample
+void MagCalibration::apply(const float* raw, float* corrected) const {
+    const float x = raw[0] - correction.offset[0];
+    const float y = raw[1] - correction.offset[1];
+    const float z = raw[2] - correction.offset[2];
+    const float* t = correction.transform;
+    corrected[0] = t[0] * x + t[1] * y + t[2] * z;
+    corrected[1] = t[3] * x + t[4] * y + t[5] * z;
+    corrected[2] = t[6] * x + t[7] * y + t[8] * z;
+}
+
+bool MagCalibration::isValid() const {
+    return correction.valid;
+}
+
+uint32_t MagCalibration::getSampleCount() const {
+    return count;
+}
+
+// Offset relative to the field radius, transform relative to unity
+bool MagCalibration::changedSinceSave() const {
+    if (correction.valid != savedCorrection.valid) {
+        return true;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (fabsf(correction.offset[i] - savedCorrection.offset[i]) > MAG_CAL_SAVE_DELTA * correction.fieldRadius) {
+            return true;
+        }
+    }
+    for (int i = 0; i < 9; i++) {
+        if (fabsf(correction.transform[i] - savedCorrection.transform[i]) > MAG_CAL_SAVE_DELTA) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MagCalibration::needsSave() const {
+    return correction.valid && changedSinceSave();
+}
+
+bool MagCalibration::load() {
+    Correction stored;
+    if (!flash_storage_read(FLASH_STORAGE_MAG_CALIBRATION, &stored, sizeof(stored)) || !stored.valid) {
+        return false;
+    }
+    correction = stored;
+    savedCorrection = stored;
+    return true;
+}
+
+bool MagCalibration::save() {
+    if (!flash_storage_write(FLASH_STORAGE_MAG_CALIBRATION, &correction, sizeof(correction))) {
+        return false;
+    }
+    savedCorrection = correction;
+    return true;
+}
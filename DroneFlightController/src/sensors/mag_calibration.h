@@ -0,0 +1,75 @@
+//
+//  mag_calibration.h
+//  DroneFlightController
+//
+//  Streaming ellipsoid-fit magnetometer calibration. Each raw sample adds
+//  its terms to the normal equations of the general quadric fit
+//  x'Mx + 2v'x = 1, so memory is fixed however many samples are seen.
+//  A periodic solve turns the fit into a hard-iron offset and a symmetric
+//  soft-iron transform, applied per sample as one 3x3 multiply:
+//  corrected = transform * (raw - offset).
+//
+
+#ifndef mag_calibration_h
+#define mag_calibration_h
+
+#include <stdint.h>
+#include "utils/matrix.h"
+
+class MagCalibration {
+public:
+    static const int PARAMETERS = 9;    // Quadric coefficients, M (6) and v (3)
+
+    MagCalibration();
+
+    // Drop the statistics and the correction
+    void reset();
+
+    // Accumulate one raw sample (any unit) and re-solve periodically
+    void addSample(const float* raw);
+
+    // Fit the accumulated samples now
+    // Returns false without changing the correction if there are too few
+    // samples, the orientations seen do not cover the sphere or the fit is
+    // not an ellipsoid.
+    bool solve();
+
+    // Apply the current correction, output in the raw unit with the mean
+    // field radius; raw and corrected may alias
+    void apply(const float* raw, float* corrected) const;
+
+    bool isValid() const;
+    uint32_t getSampleCount() const;
+
+    // True when the correction has moved enough since the last load or save
+    bool needsSave() const;
+    bool load();
+    bool save();
+
+private:
+    struct Correction {
+        float offset[3];
+        float transform[9];   // Row-major, unit determinant
+        float fieldRadius;    // Mean field magnitude in the raw unit
+        bool valid;
+    };
+
+    bool changedSinceSave() const;
+
+    // Upper triangle of D'D and D'1, double so long runs do not lose the
+    // small terms
+    double normal[PARAMETERS * (PARAMETERS + 1) / 2];
+    double rhs[PARAMETERS];
+    uint32_t count;
+    uint16_t sinceSolve;
+
+    // Samples are scaled to roughly unit field before accumulating
+    float sampleScale;
+    float minScaled[3];
+    float maxScaled[3];
+
+    Correction correction;
+    Correction savedCorrection;
+};
+
+#endif /* mag_calibration_h */
@@ -6,10 +6,42 @@
 //
 
 #include "sensor_fusion.h"
+#include <math.h>
+#include <stddef.h>
 #include "imu_sensor.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "utils/fixed_point.h"
+#include "config/sensor_config.h"
+#include "utils/timing.h"
+#include "utils/seqlock.h"
+#include "attitude_estimator.h"
 
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_EKF
+// Quaternion + gyro bias EKF, float in both arithmetic modes
+static AttitudeEKF ekf;
+
+// Euler angles derived lazily from the quaternion
+static float euler[3] = {0.0f, 0.0f, 0.0f};
+static bool euler_valid = false;
+#elif SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+// Quaternion estimator, float in both arithmetic modes
+static attitude_estimator_t estimator;
+
+// Euler angles derived lazily from the quaternion
+static float euler[3] = {0.0f, 0.0f, 0.0f};
+static bool euler_valid = false;
+#elif FC_USE_FIXED_POINT
+// Kalman filter state variables (angles and bias in Q16, covariance in Q31)
+static q16_t angle[3] = {0, 0, 0}; // Roll, pitch, yaw
+static q16_t bias[3] = {0, 0, 0};  // Gyro bias estimates
+static q31_t P[3][2][2];  // Error covariance matrix
+
+// Kalman filter parameters
+static const q31_t Q_angle = Q31_CONST(0.001);    // Process noise for angle
+static const q31_t Q_bias = Q31_CONST(0.003);     // Process noise for bias
+static const q31_t R_measure = Q31_CONST(0.03);   // Measurement noise
+#else
 // Kalman filter state variables
 static float angle[3] = {0.0f, 0.0f, 0.0f}; // Roll, pitch, yaw
 static float bias[3] = {0.0f, 0.0f, 0.0f};  // Gyro bias estimates
@@ -19,47 +51,301 @@ static float P[3][2][2];  // Error covariance matrix
 static const float Q_angle = 0.001f;    // Process noise for angle
 static const float Q_bias = 0.003f;     // Process noise for bias
 static const float R_measure = 0.03f;   // Measurement noise
+#endif /* SENSOR_FUSION_ESTIMATOR */
+
+// Bias-corrected angular rates from the latest update
+static float rate[3] = {0.0f, 0.0f, 0.0f};
 
 // IMU sensor instance
 static IMUSensor imu;
 
+// Timestamp of the last sample fused and the measured sample intervals
+static uint32_t last_sample_us = 0;
+static bool heading_seen = false;
+static uint32_t last_heading_us = 0;
+static bool sample_started = false;
+static timing_jitter_t sample_jitter;
+
+// Estimator output published once per fused sample
+static seqlock_t state_lock;
+static fusion_published_state_t published_state;
+
+// Copies overlapping an update before a reader gives up
+static const int STATE_READ_ATTEMPTS = 4;
+
 bool initializeSensorFusion() {
+    timing_jitter_init(&sample_jitter, 1000000 / IMU_SAMPLE_RATE_HZ, 1000000 / IMU_SAMPLE_RATE_HZ / 100);
+    sample_started = false;
+    seqlock_init(&state_lock);
+
     // Initialize IMU
     if (!imu.initialize()) {
         return false;
     }
+    // Loads the stored calibration, refinement runs in the background
+    if (!imu.calibrate()) {
+        return false;
+    }
     
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_EKF
+    ekf.initialize(EKF_GYRO_NOISE, EKF_BIAS_NOISE, EKF_ACCEL_NOISE, ATTITUDE_CORRECTION_DIVISOR);
+#elif SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_MADGWICK
+    attitude_estimator_init(&estimator, MADGWICK_BETA, 0.0f, ATTITUDE_CORRECTION_DIVISOR);
+#elif SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_MAHONY
+    attitude_estimator_init(&estimator, MAHONY_KP, MAHONY_KI, ATTITUDE_CORRECTION_DIVISOR);
+#else
     // Initialize error covariance matrices
     for (int i = 0; i < 3; i++) {
-        P[i][0][0] = 0.0f;
-        P[i][0][1] = 0.0f;
-        P[i][1][0] = 0.0f;
-        P[i][1][1] = 0.0f;
+        P[i][0][0] = 0;
+        P[i][0][1] = 0;
+        P[i][1][0] = 0;
+        P[i][1][1] = 0;
     }
+#endif
     
     return true;
 }
 
-void updateOrientation(float dt) {
-    float accel_x, accel_y, accel_z;
-    float gyro_x, gyro_y, gyro_z;
-    
-    // Read sensor data
-    imu.readAccelerometer(accel_x, accel_y, accel_z);
-    imu.readGyroscope(gyro_x, gyro_y, gyro_z);
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_EKF
+static void fuseSample(const imu_sample_t& sample, float dt) {
+    ekf.update(sample.gyro, sample.accel, dt);
+    euler_valid = false;
+
+    float gyro_bias[3];
+    ekf.getBias(gyro_bias);
+    rate[0] = sample.gyro[0] - gyro_bias[0];
+    rate[1] = sample.gyro[1] - gyro_bias[1];
+    rate[2] = sample.gyro[2] - gyro_bias[2];
+}
+#elif SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+static void fuseSample(const imu_sample_t& sample, float dt) {
+    const float *mag_used = NULL;
+
+#if SENSOR_FUSION_USE_MAG
+    // Mag is only needed on correction iterations
+    float mag[3];
+    if (attitude_estimator_correction_due(&estimator) &&
+        imu.readMagnetometer(mag[0], mag[1], mag[2])) {
+        mag_used = mag;
+    }
+#endif
+
+    attitude_estimator_update(&estimator, sample.gyro, sample.accel, mag_used, dt);
+    euler_valid = false;
+    if (mag_used != NULL) {
+        heading_seen = true;
+        last_heading_us = sample.timestamp_us;
+    }
+
+    float gyro_bias[3];
+    attitude_estimator_get_bias(&estimator, gyro_bias);
+    rate[0] = sample.gyro[0] - gyro_bias[0];
+    rate[1] = sample.gyro[1] - gyro_bias[1];
+    rate[2] = sample.gyro[2] - gyro_bias[2];
+}
+#else
+#if SENSOR_FUSION_USE_MAG
+// Tilt-compensated heading unwrapped to within half a turn of reference,
+// so the yaw innovation never jumps by 2*pi
+static bool readHeading(const imu_sample_t& sample, float reference, float* heading) {
+    float mag[3];
+    if (!imu.readMagnetometer(mag[0], mag[1], mag[2])) {
+        return false;
+    }
+    float h = tilt_compensated_heading(sample.accel, mag);
+    *heading = h + 2.0f * (float)M_PI * roundf((reference - h) / (2.0f * (float)M_PI));
+    return true;
+}
+#endif
+
+static void fuseSample(const imu_sample_t& sample, float dt) {
+    float accel_x = sample.accel[0], accel_y = sample.accel[1], accel_z = sample.accel[2];
+    float gyro_x = sample.gyro[0], gyro_y = sample.gyro[1], gyro_z = sample.gyro[2];
     
     // Calculate angles from accelerometer
     float accel_roll = atan2f(accel_y, accel_z);
     float accel_pitch = atan2f(-accel_x, sqrtf(accel_y * accel_y + accel_z * accel_z));
     
+#if FC_USE_FIXED_POINT
+    // Convert once at the sensor boundary, the filter itself is integer only
+    q31_t dt_q31 = q31_from_float(dt);
+
+    updateKalmanFilterQ16(0, q16_from_float(accel_roll), q16_from_float(gyro_x), dt_q31);  // Roll
+    updateKalmanFilterQ16(1, q16_from_float(accel_pitch), q16_from_float(gyro_y), dt_q31); // Pitch
+
+#if SENSOR_FUSION_USE_MAG
+    float heading;
+    if (readHeading(sample, q16_to_float(angle[2]), &heading)) {
+        updateKalmanFilterQ16(2, q16_from_float(heading), q16_from_float(gyro_z), dt_q31);  // Yaw
+        heading_seen = true;
+        last_heading_us = sample.timestamp_us;
+    } else
+#endif
+    {
+        // Simple complementary filter for yaw using gyro
+        angle[2] = q16_add(angle[2], q16_mul_q31(q16_sub(q16_from_float(gyro_z), bias[2]), dt_q31));
+    }
+
+    rate[0] = gyro_x - q16_to_float(bias[0]);
+    rate[1] = gyro_y - q16_to_float(bias[1]);
+    rate[2] = gyro_z - q16_to_float(bias[2]);
+#else
     // Update each angle using Kalman filter
     updateKalmanFilter(0, accel_roll, gyro_x, dt);  // Roll
     updateKalmanFilter(1, accel_pitch, gyro_y, dt); // Pitch
     
-    // Simple complementary filter for yaw using gyro
-    angle[2] += (gyro_z - bias[2]) * dt;
+#if SENSOR_FUSION_USE_MAG
+    float heading;
+    if (readHeading(sample, angle[2], &heading)) {
+        updateKalmanFilter(2, heading, gyro_z, dt);  // Yaw
+        heading_seen = true;
+        last_heading_us = sample.timestamp_us;
+    } else
+#endif
+    {
+        // Simple complementary filter for yaw using gyro
+        angle[2] += (gyro_z - bias[2]) * dt;
+    }
+
+    rate[0] = gyro_x - bias[0];
+    rate[1] = gyro_y - bias[1];
+    rate[2] = gyro_z - bias[2];
+#endif
+}
+#endif /* SENSOR_FUSION_ESTIMATOR */
+
+// Seconds since the previous fused sample from the sample timestamps
+static float measureSampleDt(uint32_t timestamp_us) {
+    float dt = 1.0f / IMU_SAMPLE_RATE_HZ;
+    if (sample_started) {
+        uint32_t period_us = timestamp_us - last_sample_us;
+        timing_jitter_record(&sample_jitter, period_us);
+        dt = (float)period_us * 1e-6f;
+    }
+    last_sample_us = timestamp_us;
+    sample_started = true;
+    return dt;
+}
+
+// Publish the estimator output for the sample just fused
+static void publishState(uint32_t timestamp_us) {
+    seqlock_write_begin(&state_lock);
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_EKF
+    ekf.getQuaternion(published_state.q);
+#elif SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+    published_state.q = estimator.q;
+#elif FC_USE_FIXED_POINT
+    for (int i = 0; i < 3; i++) {
+        published_state.angle[i] = q16_to_float(angle[i]);
+    }
+#else
+    for (int i = 0; i < 3; i++) {
+        published_state.angle[i] = angle[i];
+    }
+#endif
+    for (int i = 0; i < 3; i++) {
+        published_state.rate[i] = rate[i];
+    }
+    published_state.timestamp_us = timestamp_us;
+    seqlock_write_end(&state_lock);
 }
 
+bool updateOrientation(void) {
+    // One burst read per cycle; a failed read, or a wake-up without a new
+    // data-ready edge, is not fused again, which would count its interval
+    // twice
+    if (!imu.sample()) {
+        return false;
+    }
+    const imu_sample_t& sample = imu.getSample();
+    if (sample_started && sample.timestamp_us == last_sample_us) {
+        return false;
+    }
+    fuseSample(sample, measureSampleDt(sample.timestamp_us));
+    publishState(sample.timestamp_us);
+    return true;
+}
+
+bool setSensorSampleRate(uint32_t rate_hz) {
+    if (!imu.setSampleRate(rate_hz)) {
+        return false;
+    }
+    timing_jitter_init(&sample_jitter, 1000000 / rate_hz, 1000000 / rate_hz / 100);
+    return true;
+}
+
+bool hasHeadingReference(void) {
+    return heading_seen && last_sample_us - last_heading_us < SENSOR_HEADING_TIMEOUT_US;
+}
+
+uint32_t getSampleTimestamp(void) {
+    return last_sample_us;
+}
+
+const timing_jitter_t* getSampleJitter(void) {
+    return &sample_jitter;
+}
+
+bool getFusionState(fusion_state_t* state) {
+    fusion_published_state_t snapshot;
+    for (int attempt = 0; attempt < STATE_READ_ATTEMPTS; attempt++) {
+        uint32_t sequence = seqlock_read_begin(&state_lock);
+        if (sequence == 0) {
+            return false;
+        }
+        snapshot = published_state;
+        if (seqlock_read_retry(&state_lock, sequence)) {
+            continue;
+        }
+
+#if SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+        quaternion_to_euler(&snapshot.q, &state->attitude[0], &state->attitude[1], &state->attitude[2]);
+#else
+        for (int i = 0; i < 3; i++) {
+            state->attitude[i] = snapshot.angle[i];
+        }
+#endif
+        for (int i = 0; i < 3; i++) {
+            state->rate[i] = snapshot.rate[i];
+        }
+        state->timestamp_us = snapshot.timestamp_us;
+        return true;
+    }
+    return false;
+}
+
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_KALMAN
+#if FC_USE_FIXED_POINT
+static void updateKalmanFilterQ16(int index, q16_t measurement, q16_t gyro_rate, q31_t dt_q31) {
+    // Predict
+    q16_t rate = q16_sub(gyro_rate, bias[index]);
+    angle[index] = q16_add(angle[index], q16_mul_q31(rate, dt_q31));
+
+    q31_t dt_P11 = q31_mul(dt_q31, P[index][1][1]);
+    q31_t p00_rate = q31_add(q31_sub(q31_sub(dt_P11, P[index][0][1]), P[index][1][0]), Q_angle);
+    P[index][0][0] = q31_add(P[index][0][0], q31_mul(dt_q31, p00_rate));
+    P[index][0][1] = q31_sub(P[index][0][1], dt_P11);
+    P[index][1][0] = q31_sub(P[index][1][0], dt_P11);
+    P[index][1][1] = q31_add(P[index][1][1], q31_mul(Q_bias, dt_q31));
+
+    // Update
+    q16_t y = q16_sub(measurement, angle[index]);
+    q31_t S = q31_add(P[index][0][0], R_measure);
+    q31_t K[2] = {q31_div(P[index][0][0], S), q31_div(P[index][1][0], S)};
+
+    angle[index] = q16_add(angle[index], q16_mul_q31(y, K[0]));
+    bias[index] = q16_add(bias[index], q16_mul_q31(y, K[1]));
+
+    q31_t P00_temp = P[index][0][0];
+    q31_t P01_temp = P[index][0][1];
+
+    P[index][0][0] = q31_sub(P[index][0][0], q31_mul(K[0], P00_temp));
+    P[index][0][1] = q31_sub(P[index][0][1], q31_mul(K[0], P01_temp));
+    P[index][1][0] = q31_sub(P[index][1][0], q31_mul(K[1], P00_temp));
+    P[index][1][1] = q31_sub(P[index][1][1], q31_mul(K[1], P01_temp));
+}
+#else
+
 static void updateKalmanFilter(int index, float measurement, float gyro_rate, float dt) {
     // Predict
     float rate = gyro_rate - bias[index];
@@ -86,9 +372,54 @@ static void updateKalmanFilter(int index, float measurement, float gyro_rate, fl
     P[index][1][0] -= K[1] * P00_temp;
     P[index][1][1] -= K[1] * P01_temp;
 }
+#endif
+#endif /* SENSOR_FUSION_ESTIMATOR */
 
 void getFilteredOrientation(float* roll, float* pitch, float* yaw) {
+#if SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+    // Trigonometry only runs when the angles are actually requested
+    if (!euler_valid) {
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_EKF
+        ekf.getEuler(euler[0], euler[1], euler[2]);
+#else
+        attitude_estimator_get_euler(&estimator, &euler[0], &euler[1], &euler[2]);
+#endif
+        euler_valid = true;
+    }
+    *roll = euler[0];
+    *pitch = euler[1];
+    *yaw = euler[2];
+#elif FC_USE_FIXED_POINT
+    *roll = q16_to_float(angle[0]);
+    *pitch = q16_to_float(angle[1]);
+    *yaw = q16_to_float(angle[2]);
+#else
     *roll = angle[0];
     *pitch = angle[1];
     *yaw = angle[2];
+#endif
+}
+
+#if SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+void getAttitudeQuaternion(quaternion_t* q) {
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_EKF
+    ekf.getQuaternion(*q);
+#else
+    *q = estimator.q;
+#endif
+}
+#endif
+
+bool isSensorCalibrated(void) {
+    return imu.isCalibrated();
+}
+
+bool saveSensorCalibration(void) {
+    return imu.saveCalibration();
+}
+
+void getAngularRates(float* roll_rate, float* pitch_rate, float* yaw_rate) {
+    *roll_rate = rate[0];
+    *pitch_rate = rate[1];
+    *yaw_rate = rate[2];
 }
@@ -9,23 +9,116 @@
 #define sensor_fusion_h
 
 #include <stdbool.h>
+#include "utils/fixed_point.h"
+#include "config/sensor_config.h"
+#include "imu_sensor.h"
+#include "utils/timing.h"
+
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_EKF
+#include "attitude_ekf.h"
+#elif SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+#include "attitude_estimator.h"
+#endif
+
+// Consistent snapshot of the estimator output, for tasks other than the
+// one running the estimator
+typedef struct {
+    float attitude[3];       // Roll, pitch, yaw in radians
+    float rate[3];           // Bias-corrected angular rates in rad/s
+    uint32_t timestamp_us;   // Data-ready timestamp of the sample
+} fusion_state_t;
+
+// What the estimator publishes for getFusionState; quaternion modes publish
+// the quaternion and readers pay for the trigonometry
+typedef struct {
+#if SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+    quaternion_t q;
+#else
+    float angle[3];
+#endif
+    float rate[3];
+    uint32_t timestamp_us;
+} fusion_published_state_t;
+
+// Estimator state: the filter and the lazily derived Euler angles, or the
+// per-axis Kalman angles, biases and 2x2 covariances
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_EKF
+#define SENSOR_FUSION_ESTIMATOR_RAM_BYTES (sizeof(AttitudeEKF) + 4 * sizeof(float))
+#elif SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+#define SENSOR_FUSION_ESTIMATOR_RAM_BYTES (sizeof(attitude_estimator_t) + 4 * sizeof(float))
+#else
+#define SENSOR_FUSION_ESTIMATOR_RAM_BYTES ((3 + 3 + 3 * 2 * 2) * sizeof(uint32_t))
+#endif
+
+// Static RAM of the IMU driver with its IMU and magnetometer calibrations,
+// the estimator, the rates, the jitter histogram and the published state,
+// for the RAM budget
+#define SENSOR_FUSION_RAM_BYTES \
+    (sizeof(IMUSensor) + SENSOR_FUSION_ESTIMATOR_RAM_BYTES + 3 * sizeof(float) + 4 * sizeof(uint32_t) + \
+     sizeof(timing_jitter_t) + sizeof(seqlock_t) + sizeof(fusion_published_state_t))
 
 // Initialize the sensor fusion system
 bool initializeSensorFusion(void);
 
-// Update orientation estimates using sensor fusion
-void updateOrientation(float dt);
+// Burst-read one IMU sample and fuse it, with dt measured between the
+// data-ready timestamps of consecutive samples
+// Returns false if no new sample was available.
+bool updateOrientation(void);
+
+// Change the IMU output rate; dt stays measured, only the jitter
+// histogram is recentred
+bool setSensorSampleRate(uint32_t rate_hz);
+
+// True while the magnetometer has corrected yaw within
+// SENSOR_HEADING_TIMEOUT_US; otherwise yaw is integrated gyro and drifts
+bool hasHeadingReference(void);
+
+// Data-ready timestamp of the last sample fused, in microseconds
+uint32_t getSampleTimestamp(void);
+
+// Histogram of measured intervals between fused samples, bins of 1% of
+// the nominal sample period
+const timing_jitter_t* getSampleJitter(void);
+
+// Copy the state published after the last fused sample without blocking
+// the estimator
+// Returns false before the first sample, or if every attempt overlapped an
+// update.
+bool getFusionState(fusion_state_t* state);
 
 // Get the current orientation estimates
 void getOrientation(float* roll, float* pitch, float* yaw);
 
+// Get the filtered roll, pitch and yaw in radians
+// Estimator task only, other tasks use getFusionState.
+void getFilteredOrientation(float* roll, float* pitch, float* yaw);
+
+#if SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_KALMAN
+// Get the current attitude quaternion
+void getAttitudeQuaternion(quaternion_t* q);
+#endif
+
 // Get the current angular rates
+// Estimator task only, other tasks use getFusionState.
 void getAngularRates(float* roll_rate, float* pitch_rate, float* yaw_rate);
 
 // Reset the sensor fusion state
 void resetSensorFusion(void);
 
+// True once the IMU has a usable calibration, stored or measured this boot
+bool isSensorCalibrated(void);
+
+// Store the IMU and magnetometer calibration if changed and the craft is still
+// Returns true if a record was written.
+bool saveSensorCalibration(void);
+
 // Internal Kalman filter update function
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_KALMAN
+#if FC_USE_FIXED_POINT
+static void updateKalmanFilterQ16(int index, q16_t measurement, q16_t gyro_rate, q31_t dt_q31);
+#else
 static void updateKalmanFilter(int index, float measurement, float gyro_rate, float dt);
+#endif
+#endif
 
 #endif /* sensor_fusion_h */
@@ -0,0 +1,247 @@
+//
+//  blackbox.c
+//  DroneFlightController
+//
+
+#include "blackbox.h"
+
+#if FC_BLACKBOX_ENABLED
+
+#include <stdio.h>
+#include <string.h>
+#include "utils/spsc_ring.h"
+#include "utils/timing.h"
+#include "utils/logger.h"
+#include "utils/log_store.h"
+#include "config/control_config.h"
+
+// Pipeline to drain task; on core 1 builds this crosses the cores
+static SpscRing<blackbox_frame_t, BLACKBOX_RING_FRAMES> ring;
+
+// File output, or the log store's blackbox stream
+static FILE *output = NULL;
+static bool to_flash = false;
+
+// Decimation state, pipeline only
+static uint16_t decimation[BLACKBOX_FIELD_COUNT] = {
+    BLACKBOX_DECIMATION_GYRO,
+    BLACKBOX_DECIMATION_ATTITUDE,
+    BLACKBOX_DECIMATION_SETPOINT,
+    BLACKBOX_DECIMATION_PID,
+    BLACKBOX_DECIMATION_MOTOR
+};
+static uint16_t countdown[BLACKBOX_FIELD_COUNT];
+static uint16_t sequence = 0;
+static uint32_t begin_us = 0;
+
+// Counters, each written by one side only
+static volatile uint32_t frames = 0;
+static volatile uint32_t dropped = 0;
+static volatile uint32_t cost_total_us = 0;
+static volatile uint32_t cost_max_us = 0;
+static volatile uint32_t bytes_written = 0;
+static volatile uint32_t write_errors = 0;
+
+// Drain side packing buffer
+static uint8_t write_buffer[BLACKBOX_WRITE_BUFFER_SIZE];
+static uint32_t write_length = 0;
+
+// The stream layout is the in-memory layout of these types
+static_assert(sizeof(blackbox_file_header_t) == 8, "blackbox file header must be packed");
+static_assert(sizeof(blackbox_frame_header_t) == 8, "blackbox frame header must be packed");
+
+static const uint8_t field_size[BLACKBOX_FIELD_COUNT] = {
+    BLACKBOX_FIELD_GYRO_SIZE,
+    BLACKBOX_FIELD_ATTITUDE_SIZE,
+    BLACKBOX_FIELD_SETPOINT_SIZE,
+    BLACKBOX_FIELD_PID_SIZE,
+    BLACKBOX_FIELD_MOTOR_SIZE
+};
+
+static void write_out(const void *data, uint32_t size) {
+    if (to_flash) {
+        log_store_append(LOG_STORE_STREAM_BLACKBOX, data, size);
+        bytes_written += size;
+    } else if (fwrite(data, 1, size, output) == size) {
+        bytes_written += size;
+    } else {
+        write_errors++;
+    }
+}
+
+static bool is_open(void) {
+    return to_flash || output != NULL;
+}
+
+// Push written bytes on to the storage; the log store only takes a partly
+// filled page once it has aged
+static void sync_output(void) {
+    if (to_flash) {
+        log_store_sync(LOG_STORE_STREAM_BLACKBOX);
+    } else {
+        fflush(output);
+    }
+}
+
+static void flush_buffer(void) {
+    if (write_length > 0) {
+        write_out(write_buffer, write_length);
+        write_length = 0;
+    }
+}
+
+// Append the header and the fields present, in field order
+static void pack_frame(const blackbox_frame_t *frame) {
+    uint32_t size = sizeof(blackbox_frame_header_t);
+    for (int f = 0; f < BLACKBOX_FIELD_COUNT; f++) {
+        if (frame->header.fields & BLACKBOX_FIELD_BIT(f)) {
+            size += field_size[f];
+        }
+    }
+    if (write_length + size > sizeof(write_buffer)) {
+        flush_buffer();
+    }
+
+    uint8_t *out = &write_buffer[write_length];
+    memcpy(out, &frame->header, sizeof(blackbox_frame_header_t));
+    out += sizeof(blackbox_frame_header_t);
+
+    uint8_t fields = frame->header.fields;
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_GYRO)) {
+        memcpy(out, frame->gyro, BLACKBOX_FIELD_GYRO_SIZE);
+        out += BLACKBOX_FIELD_GYRO_SIZE;
+    }
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_ATTITUDE)) {
+        memcpy(out, frame->attitude, BLACKBOX_FIELD_ATTITUDE_SIZE);
+        out += BLACKBOX_FIELD_ATTITUDE_SIZE;
+    }
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_SETPOINT)) {
+        memcpy(out, frame->setpoint, BLACKBOX_FIELD_SETPOINT_SIZE);
+        out += BLACKBOX_FIELD_SETPOINT_SIZE;
+    }
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_PID)) {
+        memcpy(out, frame->pid_p, sizeof(frame->pid_p));
+        memcpy(out + 12, frame->pid_i, sizeof(frame->pid_i));
+        memcpy(out + 24, frame->pid_d, sizeof(frame->pid_d));
+        out += BLACKBOX_FIELD_PID_SIZE;
+    }
+    if (fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_MOTOR)) {
+        memcpy(out, frame->motor, BLACKBOX_FIELD_MOTOR_SIZE);
+    }
+    write_length += size;
+}
+
+bool blackbox_init(const char *path, LogDestination destination) {
+    if (destination == LOG_TO_FLASH) {
+        to_flash = true;
+    } else if (destination == LOG_TO_FILE) {
+        output = fopen(path, "ab");
+    }
+    if (!is_open()) {
+        return false;
+    }
+
+    blackbox_file_header_t header = {
+        BLACKBOX_MAGIC, BLACKBOX_VERSION, BLACKBOX_FIELD_COUNT, CONTROL_RATE_LOOP_HZ
+    };
+    write_out(&header, sizeof(header));
+    sync_output();
+    return true;
+}
+
+void blackbox_set_decimation(blackbox_field_t field, uint16_t divisor) {
+    if (field < BLACKBOX_FIELD_COUNT) {
+        decimation[field] = divisor;
+    }
+}
+
+uint8_t blackbox_begin(blackbox_frame_t *frame, uint32_t timestamp_us) {
+    if (!is_open()) {
+        return 0;
+    }
+    begin_us = timing_micros();
+
+    // Each field is due when its countdown expires
+    uint8_t fields = 0;
+    for (int f = 0; f < BLACKBOX_FIELD_COUNT; f++) {
+        if (decimation[f] == 0) {
+            continue;
+        }
+        if (countdown[f] == 0) {
+            fields |= BLACKBOX_FIELD_BIT(f);
+            countdown[f] = decimation[f];
+        }
+        countdown[f]--;
+    }
+
+    if (fields == 0) {
+        return 0;
+    }
+
+    frame->header.sync = BLACKBOX_SYNC;
+    frame->header.fields = fields;
+    frame->header.sequence = sequence++;
+    frame->header.timestamp_us = timestamp_us;
+    return fields;
+}
+
+void blackbox_commit(const blackbox_frame_t *frame) {
+    if (ring.push(*frame)) {
+        frames++;
+    } else {
+        dropped++;
+    }
+
+    uint32_t cost_us = timing_micros() - begin_us;
+    cost_total_us += cost_us;
+    if (cost_us > cost_max_us) {
+        cost_max_us = cost_us;
+    }
+}
+
+uint32_t blackbox_drain(void) {
+    if (!is_open()) {
+        return 0;
+    }
+
+    // Pack in small batches so the stack copy stays bounded
+    blackbox_frame_t batch[4];
+    uint32_t drained = 0;
+    uint32_t count;
+    while ((count = ring.popBatch(batch, 4)) > 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            pack_frame(&batch[i]);
+        }
+        drained += count;
+    }
+
+    // At most one write per drain unless the buffer filled
+    if (drained > 0) {
+        flush_buffer();
+    }
+    sync_output();
+    return drained;
+}
+
+void blackbox_get_stats(blackbox_stats_t *stats) {
+    uint32_t committed = frames + dropped;
+    stats->frames = frames;
+    stats->dropped = dropped;
+    stats->bytes_written = bytes_written;
+    stats->write_errors = write_errors;
+    // The microsecond timer is coarser than one frame; the mean over many
+    // frames is still unbiased since begin falls at a random timer phase
+    stats->cost_mean_ns = committed > 0 ? (uint32_t)((uint64_t)cost_total_us * 1000 / committed) : 0;
+    stats->cost_max_us = cost_max_us;
+}
+
+void blackbox_report(void) {
+    blackbox_stats_t s;
+    blackbox_get_stats(&s);
+    LOG_MSG(LOG_INFO,
+            "Blackbox %lu frames, %lu dropped, %lu bytes, %lu write errors, %lu ns/frame (max %lu us)",
+            (unsigned long)s.frames, (unsigned long)s.dropped, (unsigned long)s.bytes_written,
+            (unsigned long)s.write_errors, (unsigned long)s.cost_mean_ns, (unsigned long)s.cost_max_us);
+}
+
+#endif /* FC_BLACKBOX_ENABLED */
@@ -0,0 +1,156 @@
+//
+//  blackbox.h
+//  DroneFlightController
+//
+//  Binary flight recorder. The flight pipeline fills one fixed-layout
+//  frame per run into a RAM ring without formatting or I/O; a low-priority
+//  task drains the ring and writes each frame packed, with only the fields
+//  that were due. Each field has its own decimation so slow signals do not
+//  cost bandwidth at the loop rate. Frames that do not fit in the ring are
+//  dropped and counted, the recorder never blocks the pipeline.
+//
+//  Stream layout, all little-endian:
+//    file header   blackbox_file_header_t
+//    per frame     blackbox_frame_header_t, then each field whose bit is
+//                  set in fields, in blackbox_field_t order, of
+//                  BLACKBOX_FIELD_*_SIZE bytes
+//  Each boot appends a new file header and its frames to the same file.
+//
+
+#ifndef blackbox_h
+#define blackbox_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/logger.h"
+
+#ifndef FC_BLACKBOX_ENABLED
+#define FC_BLACKBOX_ENABLED 1
+#endif
+
+// Recorded fields, one bit each in a frame's field mask
+typedef enum {
+    BLACKBOX_FIELD_GYRO = 0,   // Filtered rates, rad/s, float[3]
+    BLACKBOX_FIELD_ATTITUDE,   // Roll, pitch, yaw, rad, float[3]
+    BLACKBOX_FIELD_SETPOINT,   // Rate setpoints rad/s and throttle, float[4]
+    BLACKBOX_FIELD_PID,        // Rate loop P, I and D terms per axis, float[3][3]
+    BLACKBOX_FIELD_MOTOR,      // ESC pulse widths in us, 0 when stopped, uint16_t[4]
+    BLACKBOX_FIELD_COUNT
+} blackbox_field_t;
+
+#define BLACKBOX_FIELD_BIT(field)  (1u << (field))
+
+// Packed size of each field in the stream
+#define BLACKBOX_FIELD_GYRO_SIZE      12
+#define BLACKBOX_FIELD_ATTITUDE_SIZE  12
+#define BLACKBOX_FIELD_SETPOINT_SIZE  16
+#define BLACKBOX_FIELD_PID_SIZE       36
+#define BLACKBOX_FIELD_MOTOR_SIZE     8
+
+#define BLACKBOX_MAGIC    0x42424346u   // "FCBB"
+#define BLACKBOX_VERSION  1
+#define BLACKBOX_SYNC     0xB5
+
+typedef struct {
+    uint32_t magic;          // BLACKBOX_MAGIC
+    uint8_t version;         // BLACKBOX_VERSION
+    uint8_t field_count;     // BLACKBOX_FIELD_COUNT
+    uint16_t loop_rate_hz;   // Configured rate loop frequency
+} blackbox_file_header_t;
+
+typedef struct {
+    uint8_t sync;            // BLACKBOX_SYNC
+    uint8_t fields;          // BLACKBOX_FIELD_BIT of each field that follows
+    uint16_t sequence;       // Frames recorded, gaps are dropped frames
+    uint32_t timestamp_us;   // Data-ready timestamp of the sample
+} blackbox_frame_header_t;
+
+// One frame as the pipeline fills it; only the fields due are written
+typedef struct {
+    blackbox_frame_header_t header;
+    float gyro[3];
+    float attitude[3];
+    float setpoint[4];
+    float pid_p[3];
+    float pid_i[3];
+    float pid_d[3];
+    uint16_t motor[4];
+} blackbox_frame_t;
+
+// Default decimation per field, in pipeline runs between samples
+#ifndef BLACKBOX_DECIMATION_GYRO
+#define BLACKBOX_DECIMATION_GYRO      2
+#endif
+#ifndef BLACKBOX_DECIMATION_ATTITUDE
+#define BLACKBOX_DECIMATION_ATTITUDE  8
+#endif
+#ifndef BLACKBOX_DECIMATION_SETPOINT
+#define BLACKBOX_DECIMATION_SETPOINT  8
+#endif
+#ifndef BLACKBOX_DECIMATION_PID
+#define BLACKBOX_DECIMATION_PID       2
+#endif
+#ifndef BLACKBOX_DECIMATION_MOTOR
+#define BLACKBOX_DECIMATION_MOTOR     2
+#endif
+
+// Frames buffered between drains, a power of two
+#define BLACKBOX_RING_FRAMES  64
+
+// Bytes collected by the drain before one write to storage
+#define BLACKBOX_WRITE_BUFFER_SIZE  512
+
+// Static RAM of the recorder, for the RAM budget
+#define BLACKBOX_RAM_BYTES \
+    (BLACKBOX_RING_FRAMES * sizeof(blackbox_frame_t) + BLACKBOX_WRITE_BUFFER_SIZE)
+
+typedef struct {
+    uint32_t frames;         // Frames pushed to the ring
+    uint32_t dropped;        // Frames lost to a full ring
+    uint32_t bytes_written;  // Packed bytes handed to storage
+    uint32_t write_errors;   // Failed or short writes
+    uint32_t cost_mean_ns;   // Mean pipeline time per frame, filling included
+    uint32_t cost_max_us;
+} blackbox_stats_t;
+
+#if FC_BLACKBOX_ENABLED
+
+// Open the output and write the stream header. LOG_TO_FILE writes to
+// path, LOG_TO_FLASH to the blackbox stream of the log store.
+// Returns false if the output could not be opened; nothing is recorded then.
+bool blackbox_init(const char *path, LogDestination destination);
+
+// Record field every decimation pipeline runs, 0 to stop recording it
+void blackbox_set_decimation(blackbox_field_t field, uint16_t divisor);
+
+// Start this run's frame; pipeline only
+// Returns the mask of fields due, the caller fills those and commits. 0
+// means nothing is due and the frame must not be committed.
+uint8_t blackbox_begin(blackbox_frame_t *frame, uint32_t timestamp_us);
+
+// Queue the frame begun by blackbox_begin; never blocks
+void blackbox_commit(const blackbox_frame_t *frame);
+
+// Write out every queued frame; drain task only
+// Returns the number of frames written.
+uint32_t blackbox_drain(void);
+
+// Counters, for telemetry
+void blackbox_get_stats(blackbox_stats_t *stats);
+
+// Log the counters and the per-frame cost
+void blackbox_report(void);
+
+#else
+
+#define blackbox_init(path, destination)             (false)
+#define blackbox_set_decimation(field, divisor)      ((void)0)
+#define blackbox_begin(frame, timestamp_us)          ((void)(frame), (uint8_t)0)
+#define blackbox_commit(frame)                       ((void)0)
+#define blackbox_drain()                             ((uint32_t)0)
+#define blackbox_get_stats(stats)                    ((void)0)
+#define blackbox_report()                            ((void)0)
+
+#endif /* FC_BLACKBOX_ENABLED */
+
+#endif /* blackbox_h */
@@ -0,0 +1,17 @@
+//
+//  crc32.c
+//  DroneFlightController
+//
+
+#include "crc32.h"
+
+uint32_t crc32(const uint8_t *data, uint32_t size) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,15 @@
+//
+//  crc32.h
+//  DroneFlightController
+//
+
+#ifndef crc32_h
+#define crc32_h
+
+#include <stdint.h>
+
+// CRC-32 (IEEE, reflected), bitwise without a table; fast enough for
+// records read at boot and pages written at flash speed
+uint32_t crc32(const uint8_t *data, uint32_t size);
+
+#endif /* crc32_h */
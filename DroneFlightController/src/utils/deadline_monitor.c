@@ -0,0 +1,43 @@
+//
+//  deadline_monitor.c
+//  DroneFlightController
+//
+
+#include "deadline_monitor.h"
+
+void deadline_monitor_init(deadline_monitor_t *monitor, uint32_t deadline_us, uint16_t limit) {
+    monitor->deadline_us = deadline_us;
+    monitor->limit = (limit > 0) ? limit : 1;
+    monitor->consecutive = 0;
+    monitor->iterations = 0;
+    monitor->overruns = 0;
+    monitor->events = 0;
+    monitor->worst_us = 0;
+}
+
+void deadline_monitor_set_deadline(deadline_monitor_t *monitor, uint32_t deadline_us) {
+    monitor->deadline_us = deadline_us;
+    monitor->consecutive = 0;
+}
+
+bool deadline_monitor_record(deadline_monitor_t *monitor, uint32_t elapsed_us, bool overrun) {
+    monitor->iterations++;
+    if (elapsed_us > monitor->worst_us) {
+        monitor->worst_us = elapsed_us;
+    }
+
+    if (!overrun && elapsed_us <= monitor->deadline_us) {
+        monitor->consecutive = 0;
+        return false;
+    }
+
+    monitor->overruns++;
+    if (++monitor->consecutive < monitor->limit) {
+        return false;
+    }
+
+    // Start counting the next run from zero
+    monitor->consecutive = 0;
+    monitor->events++;
+    return true;
+}
@@ -0,0 +1,37 @@
+//
+//  deadline_monitor.h
+//  DroneFlightController
+//
+//  Counts iterations of a periodic loop that overran their deadline and
+//  raises an event after a run of consecutive overruns, so sustained
+//  overload is reported instead of being absorbed by the scheduler.
+//
+
+#ifndef deadline_monitor_h
+#define deadline_monitor_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint32_t deadline_us;    // Longest allowed time per iteration
+    uint16_t limit;          // Consecutive overruns that raise an event
+    uint16_t consecutive;    // Current run of overruns
+    uint32_t iterations;
+    uint32_t overruns;       // Total overruns
+    uint32_t events;         // Runs of limit consecutive overruns
+    uint32_t worst_us;       // Longest iteration seen
+} deadline_monitor_t;
+
+// Clear the counters and set the deadline and the event threshold
+void deadline_monitor_init(deadline_monitor_t *monitor, uint32_t deadline_us, uint16_t limit);
+
+// Change the deadline and restart the current run, keeping the totals
+void deadline_monitor_set_deadline(deadline_monitor_t *monitor, uint32_t deadline_us);
+
+// Count one iteration that took elapsed_us; overrun forces it to count as
+// an overrun, e.g. when a sample was missed
+// Returns true when this iteration completed a run of limit overruns.
+bool deadline_monitor_record(deadline_monitor_t *monitor, uint32_t elapsed_us, bool overrun);
+
+#endif /* deadline_monitor_h */
@@ -0,0 +1,233 @@
+//
+//  filter_bank.c
+//  DroneFlightController
+//
+
+#include "filter_bank.h"
+#include <stddef.h>
+#include <math.h>
+
+#define FILTER_PI_F   3.14159265358979f
+#define FILTER_PI_2_F 1.57079632679490f
+#define FILTER_PI_4_F 0.78539816339745f
+
+static const float pt_stage_term[3] = {
+    (float)FILTER_PT1_STAGE_TERM,
+    (float)FILTER_PT2_STAGE_TERM,
+    (float)FILTER_PT3_STAGE_TERM
+};
+
+// Same series as FILTER_TAN_POLY so runtime and compile-time coefficients match
+static inline float tan_poly(float x) {
+    float x2 = x * x;
+    return x * (1.0f + x2 * (1.0f / 3.0f + x2 * (2.0f / 15.0f + x2 * (17.0f / 315.0f +
+           x2 * (62.0f / 2835.0f + x2 * (1382.0f / 155925.0f))))));
+}
+
+// tan(x) on [0, pi/2) without libm
+static inline float tan_approx(float x) {
+    if (x <= FILTER_PI_4_F) {
+        return tan_poly(x);
+    }
+    return 1.0f / tan_poly(FILTER_PI_2_F - x);
+}
+
+static inline filter_coeff_t to_coeff(float value) {
+#if FC_USE_FIXED_POINT
+    return (filter_coeff_t)(value * 1073741824.0f + (value >= 0.0f ? 0.5f : -0.5f));
+#else
+    return value;
+#endif
+}
+
+#if FC_USE_FIXED_POINT
+// Q16 sample times Q2.30 coefficient, accumulated in Q46
+static inline int64_t mac_q30(int64_t acc, q16_t sample, filter_coeff_t coeff) {
+    return acc + (int64_t)sample * coeff;
+}
+
+static inline q16_t acc_to_q16(int64_t acc) {
+    return fx_saturate((acc + (1 << 29)) >> 30);
+}
+#endif
+
+static void compute_coefficients(filter_stage_t *stage, float sample_hz) {
+    // A stage at or above Nyquist has nothing left to remove, and pulling
+    // its cutoff down would only add phase lag, so it passes the signal
+    // through until a faster sample rate brings it back in range. Unity
+    // gain with no feedback is exact on both PTn and biquad stages.
+    if (stage->cutoff_hz >= sample_hz * 0.5f) {
+        stage->coeff[0] = to_coeff(1.0f);
+        for (int i = 1; i < 5; i++) {
+            stage->coeff[i] = 0;
+        }
+        return;
+    }
+
+    // Keep the prewarp argument inside (0, pi/2)
+    float nyquist_limit = sample_hz * 0.49f;
+    float cutoff = stage->cutoff_hz;
+    if (cutoff > nyquist_limit) {
+        cutoff = nyquist_limit;
+    }
+    if (cutoff < 0.0f) {
+        cutoff = 0.0f;
+    }
+
+    switch (stage->type) {
+        case FILTER_PT1:
+        case FILTER_PT2:
+        case FILTER_PT3: {
+            // Same gain as FILTER_PT_GAIN_K
+            float k = tan_approx(FILTER_PI_F * cutoff / sample_hz);
+            float term = pt_stage_term[stage->type - FILTER_PT1];
+            stage->coeff[0] = to_coeff(k * (sqrtf(term * (2.0f + (term + 2.0f) * k * k)) - term * k) / (1.0f + k * k));
+            break;
+        }
+        case FILTER_BIQUAD_LPF: {
+            float k = tan_approx(FILTER_PI_F * cutoff / sample_hz);
+            float k2 = k * k;
+            float norm = 1.0f / (1.0f + k / stage->q + k2);
+            stage->coeff[0] = to_coeff(k2 * norm);
+            stage->coeff[1] = to_coeff(2.0f * k2 * norm);
+            stage->coeff[2] = stage->coeff[0];
+            stage->coeff[3] = to_coeff(2.0f * (k2 - 1.0f) * norm);
+            stage->coeff[4] = to_coeff((1.0f - k / stage->q + k2) * norm);
+            break;
+        }
+        case FILTER_BIQUAD_NOTCH: {
+            float k = tan_approx(FILTER_PI_F * cutoff / sample_hz);
+            float k2 = k * k;
+            float norm = 1.0f / (1.0f + k / stage->q + k2);
+            stage->coeff[0] = to_coeff((1.0f + k2) * norm);
+            stage->coeff[1] = to_coeff(2.0f * (k2 - 1.0f) * norm);
+            stage->coeff[2] = stage->coeff[0];
+            stage->coeff[3] = stage->coeff[1];
+            stage->coeff[4] = to_coeff((1.0f - k / stage->q + k2) * norm);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void filter_stage_init(filter_stage_t *stage, filter_type_t type, float cutoff_hz, float q, float sample_hz) {
+    stage->type = type;
+    stage->cutoff_hz = cutoff_hz;
+    stage->q = (q > 0.0f) ? q : (float)BIQUAD_Q_BUTTERWORTH;
+    for (int i = 0; i < 5; i++) {
+        stage->coeff[i] = 0;
+    }
+    filter_stage_reset(stage);
+    compute_coefficients(stage, sample_hz);
+}
+
+void filter_stage_set_cutoff(filter_stage_t *stage, float cutoff_hz, float sample_hz) {
+    stage->cutoff_hz = cutoff_hz;
+    compute_coefficients(stage, sample_hz);
+}
+
+void filter_stage_reset(filter_stage_t *stage) {
+    for (int i = 0; i < 4; i++) {
+        stage->state[i] = 0;
+    }
+}
+
+filter_sample_t filter_stage_apply(filter_stage_t *stage, filter_sample_t input) {
+    filter_coeff_t *c = stage->coeff;
+    filter_sample_t *s = stage->state;
+
+    switch (stage->type) {
+#if FC_USE_FIXED_POINT
+        case FILTER_PT3:
+            s[0] = q16_add(s[0], acc_to_q16(mac_q30(0, q16_sub(input, s[0]), c[0])));
+            s[1] = q16_add(s[1], acc_to_q16(mac_q30(0, q16_sub(s[0], s[1]), c[0])));
+            s[2] = q16_add(s[2], acc_to_q16(mac_q30(0, q16_sub(s[1], s[2]), c[0])));
+            return s[2];
+        case FILTER_PT2:
+            s[0] = q16_add(s[0], acc_to_q16(mac_q30(0, q16_sub(input, s[0]), c[0])));
+            s[1] = q16_add(s[1], acc_to_q16(mac_q30(0, q16_sub(s[0], s[1]), c[0])));
+            return s[1];
+        case FILTER_PT1:
+            s[0] = q16_add(s[0], acc_to_q16(mac_q30(0, q16_sub(input, s[0]), c[0])));
+            return s[0];
+        case FILTER_BIQUAD_LPF:
+        case FILTER_BIQUAD_NOTCH: {
+            int64_t acc = mac_q30(0, input, c[0]);
+            acc = mac_q30(acc, s[0], c[1]);
+            acc = mac_q30(acc, s[1], c[2]);
+            acc = mac_q30(acc, s[2], -c[3]);
+            acc = mac_q30(acc, s[3], -c[4]);
+            q16_t output = acc_to_q16(acc);
+            s[1] = s[0];
+            s[0] = input;
+            s[3] = s[2];
+            s[2] = output;
+            return output;
+        }
+#else
+        case FILTER_PT3:
+            s[0] += c[0] * (input - s[0]);
+            s[1] += c[0] * (s[0] - s[1]);
+            s[2] += c[0] * (s[1] - s[2]);
+            return s[2];
+        case FILTER_PT2:
+            s[0] += c[0] * (input - s[0]);
+            s[1] += c[0] * (s[0] - s[1]);
+            return s[1];
+        case FILTER_PT1:
+            s[0] += c[0] * (input - s[0]);
+            return s[0];
+        case FILTER_BIQUAD_LPF:
+        case FILTER_BIQUAD_NOTCH: {
+            float output = c[0] * input + c[1] * s[0] + c[2] * s[1] - c[3] * s[2] - c[4] * s[3];
+            s[1] = s[0];
+            s[0] = input;
+            s[3] = s[2];
+            s[2] = output;
+            return output;
+        }
+#endif
+        default:
+            return input;
+    }
+}
+
+void filter_chain_init(filter_chain_t *chain) {
+    chain->count = 0;
+    for (int i = 0; i < FILTER_CHAIN_MAX_STAGES; i++) {
+        chain->stage[i].type = FILTER_NONE;
+    }
+}
+
+filter_stage_t *filter_chain_add(filter_chain_t *chain, filter_type_t type, float cutoff_hz, float q, float sample_hz) {
+    if (chain->count >= FILTER_CHAIN_MAX_STAGES) {
+        return NULL;
+    }
+    filter_stage_t *stage = &chain->stage[chain->count++];
+    filter_stage_init(stage, type, cutoff_hz, q, sample_hz);
+    return stage;
+}
+
+void filter_chain_set_sample_rate(filter_chain_t *chain, float sample_hz) {
+    for (int i = 0; i < chain->count; i++) {
+        compute_coefficients(&chain->stage[i], sample_hz);
+    }
+}
+
+void filter_chain_reset(filter_chain_t *chain) {
+    for (int i = 0; i < chain->count; i++) {
+        filter_stage_reset(&chain->stage[i]);
+    }
+}
+
+filter_sample_t filter_chain_apply(filter_chain_t *chain, filter_sample_t input) {
+    for (int i = 0; i < chain->count; i++) {
+        input = filter_stage_apply(&chain->stage[i], input);
+    }
+    return input;
+}
+
+float filter_notch_q(float center_hz, float cutoff_hz) {
+    return center_hz * cutoff_hz / (center_hz * center_hz - cutoff_hz * cutoff_hz);
+}
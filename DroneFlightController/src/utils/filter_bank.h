@@ -0,0 +1,175 @@
+//
+//  filter_bank.h
+//  DroneFlightController
+//
+//  PT1/PT2/PT3 lowpass and biquad lowpass/notch stages, chained per gyro
+//  axis and per D-term axis. Stages for fixed configurations can be built
+//  entirely at compile time with the FILTER_STAGE_* initializers; the
+//  runtime path recomputes coefficients without libm trig calls.
+//
+
+#ifndef filter_bank_h
+#define filter_bank_h
+
+#include <stdint.h>
+#include "fixed_point.h"
+
+#define FILTER_CHAIN_MAX_STAGES 4
+
+// Stage types
+typedef enum {
+    FILTER_NONE = 0,
+    FILTER_PT1,
+    FILTER_PT2,
+    FILTER_PT3,
+    FILTER_BIQUAD_LPF,
+    FILTER_BIQUAD_NOTCH
+} filter_type_t;
+
+// Samples are Q16 and coefficients Q2.30 on the fixed-point path
+#if FC_USE_FIXED_POINT
+typedef q16_t filter_sample_t;
+typedef int32_t filter_coeff_t;
+#define FILTER_COEFF_CONST(x) ((filter_coeff_t)((x) * 1073741824.0 + ((x) >= 0 ? 0.5 : -0.5)))
+#else
+typedef float filter_sample_t;
+typedef float filter_coeff_t;
+#define FILTER_COEFF_CONST(x) ((filter_coeff_t)(x))
+#endif
+
+// One filter stage
+// PTn: coeff[0] is the per-stage gain, state[0..order-1] the cascaded outputs
+// Biquad: coeff is b0, b1, b2, a1, a2 and state is x1, x2, y1, y2 (direct form I,
+// which tolerates coefficient changes between samples)
+typedef struct {
+    filter_type_t type;
+    float cutoff_hz;            // Cutoff, or notch center frequency
+    float q;                    // Biquad quality factor, unused by PTn
+    filter_coeff_t coeff[5];
+    filter_sample_t state[4];
+} filter_stage_t;
+
+// Ordered list of stages applied to one signal
+typedef struct {
+    uint8_t count;
+    filter_stage_t stage[FILTER_CHAIN_MAX_STAGES];
+} filter_chain_t;
+
+/* Compile-time coefficient helpers */
+
+#define FILTER_PI    3.14159265358979323846
+#define FILTER_PI_2  (FILTER_PI / 2.0)
+#define FILTER_PI_4  (FILTER_PI / 4.0)
+
+#define BIQUAD_Q_BUTTERWORTH 0.70710678118654752440
+
+// Per-order term 2g / (1 - g), where g = 2^(-1/n) is the power gain each
+// of the n stages needs for the chain to have -3 dB at the cutoff
+#define FILTER_PT1_STAGE_TERM 2.0
+#define FILTER_PT2_STAGE_TERM 4.828427125
+#define FILTER_PT3_STAGE_TERM 7.694644204
+
+// Taylor series of tan(x), accurate to ~2e-4 on [0, pi/4]
+#define FILTER_TAN_POLY(x) \
+    ((x) * (1.0 + (x) * (x) * (1.0 / 3.0 + (x) * (x) * (2.0 / 15.0 + (x) * (x) * \
+    (17.0 / 315.0 + (x) * (x) * (62.0 / 2835.0 + (x) * (x) * (1382.0 / 155925.0)))))))
+
+// tan(x) on [0, pi/2) folded onto the accurate range with tan(x) = 1 / tan(pi/2 - x)
+#define FILTER_TAN_CONST(x) \
+    ((x) <= FILTER_PI_4 ? FILTER_TAN_POLY(x) : 1.0 / FILTER_TAN_POLY(FILTER_PI_2 - (x)))
+
+// Bilinear prewarp term K = tan(pi * f / fs)
+#define FILTER_K_CONST(f, fs) FILTER_TAN_CONST(FILTER_PI * (double)(f) / (double)(fs))
+
+// Gain of one PT stage, exact for the discrete stage at any fc / fs:
+// k = K (sqrt(term (2 + (term + 2) K^2)) - term K) / (1 + K^2).
+// GCC folds __builtin_sqrt of a constant, so this stays a constant.
+#define FILTER_PT_GAIN_K(k, term) \
+    ((k) * (__builtin_sqrt((term) * (2.0 + ((term) + 2.0) * (k) * (k))) - (term) * (k)) / (1.0 + (k) * (k)))
+#define FILTER_PT_GAIN_CONST(fc, fs, term) FILTER_PT_GAIN_K(FILTER_K_CONST(fc, fs), term)
+
+// Notch quality factor from its center frequency and lower cutoff
+// Pass prewarped FILTER_K_CONST values for the cutoff to land at -3 dB
+// after the bilinear transform.
+#define FILTER_NOTCH_Q(center, cutoff) \
+    ((double)(center) * (double)(cutoff) / ((double)(center) * (double)(center) - (double)(cutoff) * (double)(cutoff)))
+
+#define FILTER_BIQUAD_NORM_CONST(k, q)  (1.0 / (1.0 + (k) / (q) + (k) * (k)))
+
+/* Compile-time stage initializers */
+
+#define FILTER_STAGE_PTN(type, order_term, fc, fs) \
+    { (type), (float)(fc), 0.0f, \
+      { FILTER_COEFF_CONST(FILTER_PT_GAIN_CONST(fc, fs, order_term)), 0, 0, 0, 0 }, \
+      { 0, 0, 0, 0 } }
+
+#define FILTER_STAGE_PT1(fc, fs) FILTER_STAGE_PTN(FILTER_PT1, FILTER_PT1_STAGE_TERM, fc, fs)
+#define FILTER_STAGE_PT2(fc, fs) FILTER_STAGE_PTN(FILTER_PT2, FILTER_PT2_STAGE_TERM, fc, fs)
+#define FILTER_STAGE_PT3(fc, fs) FILTER_STAGE_PTN(FILTER_PT3, FILTER_PT3_STAGE_TERM, fc, fs)
+
+#define FILTER_STAGE_BIQUAD_LPF_Q(fc, fs, q) \
+    { FILTER_BIQUAD_LPF, (float)(fc), (float)(q), \
+      { FILTER_COEFF_CONST(FILTER_K_CONST(fc, fs) * FILTER_K_CONST(fc, fs) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(fc, fs), q)), \
+        FILTER_COEFF_CONST(2.0 * FILTER_K_CONST(fc, fs) * FILTER_K_CONST(fc, fs) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(fc, fs), q)), \
+        FILTER_COEFF_CONST(FILTER_K_CONST(fc, fs) * FILTER_K_CONST(fc, fs) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(fc, fs), q)), \
+        FILTER_COEFF_CONST(2.0 * (FILTER_K_CONST(fc, fs) * FILTER_K_CONST(fc, fs) - 1.0) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(fc, fs), q)), \
+        FILTER_COEFF_CONST((1.0 - FILTER_K_CONST(fc, fs) / (q) + FILTER_K_CONST(fc, fs) * FILTER_K_CONST(fc, fs)) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(fc, fs), q)) }, \
+      { 0, 0, 0, 0 } }
+
+#define FILTER_STAGE_BIQUAD_LPF(fc, fs) FILTER_STAGE_BIQUAD_LPF_Q(fc, fs, BIQUAD_Q_BUTTERWORTH)
+
+#define FILTER_STAGE_BIQUAD_NOTCH_Q(center, fs, q) \
+    { FILTER_BIQUAD_NOTCH, (float)(center), (float)(q), \
+      { FILTER_COEFF_CONST((1.0 + FILTER_K_CONST(center, fs) * FILTER_K_CONST(center, fs)) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(center, fs), q)), \
+        FILTER_COEFF_CONST(2.0 * (FILTER_K_CONST(center, fs) * FILTER_K_CONST(center, fs) - 1.0) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(center, fs), q)), \
+        FILTER_COEFF_CONST((1.0 + FILTER_K_CONST(center, fs) * FILTER_K_CONST(center, fs)) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(center, fs), q)), \
+        FILTER_COEFF_CONST(2.0 * (FILTER_K_CONST(center, fs) * FILTER_K_CONST(center, fs) - 1.0) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(center, fs), q)), \
+        FILTER_COEFF_CONST((1.0 - FILTER_K_CONST(center, fs) / (q) + FILTER_K_CONST(center, fs) * FILTER_K_CONST(center, fs)) * FILTER_BIQUAD_NORM_CONST(FILTER_K_CONST(center, fs), q)) }, \
+      { 0, 0, 0, 0 } }
+
+#define FILTER_STAGE_BIQUAD_NOTCH(center, cutoff, fs) \
+    FILTER_STAGE_BIQUAD_NOTCH_Q(center, fs, FILTER_NOTCH_Q(FILTER_K_CONST(center, fs), FILTER_K_CONST(cutoff, fs)))
+
+// Chain initializers for fixed configurations
+#define FILTER_CHAIN_INIT1(a)          { 1, { a } }
+#define FILTER_CHAIN_INIT2(a, b)       { 2, { a, b } }
+#define FILTER_CHAIN_INIT3(a, b, c)    { 3, { a, b, c } }
+#define FILTER_CHAIN_INIT4(a, b, c, d) { 4, { a, b, c, d } }
+
+/* Runtime API */
+
+// Initialize a stage and compute its coefficients
+// For notches cutoff_hz is the center frequency; q is ignored by PTn stages
+void filter_stage_init(filter_stage_t *stage, filter_type_t type, float cutoff_hz, float q, float sample_hz);
+
+// Recompute coefficients for a new cutoff without touching the filter state
+// A cutoff at or above sample_hz / 2 turns the stage into a pass-through.
+void filter_stage_set_cutoff(filter_stage_t *stage, float cutoff_hz, float sample_hz);
+
+// Clear the stage history
+void filter_stage_reset(filter_stage_t *stage);
+
+// Filter one sample through one stage
+filter_sample_t filter_stage_apply(filter_stage_t *stage, filter_sample_t input);
+
+// Remove all stages from a chain
+void filter_chain_init(filter_chain_t *chain);
+
+// Append a stage, returns the stage or NULL when the chain is full
+filter_stage_t *filter_chain_add(filter_chain_t *chain, filter_type_t type, float cutoff_hz, float q, float sample_hz);
+
+// Recompute every stage for a new sample rate, e.g. after a loop rate change
+// Stages at or above the new Nyquist pass the signal through.
+void filter_chain_set_sample_rate(filter_chain_t *chain, float sample_hz);
+
+// Clear the history of every stage
+void filter_chain_reset(filter_chain_t *chain);
+
+// Filter one sample through every stage in order
+filter_sample_t filter_chain_apply(filter_chain_t *chain, filter_sample_t input);
+
+// Notch quality factor from center frequency and lower cutoff, as
+// FILTER_NOTCH_Q; pass prewarped frequencies for an exact -3 dB cutoff
+float filter_notch_q(float center_hz, float cutoff_hz);
+
+#endif /* filter_bank_h */
@@ -0,0 +1,127 @@
+//
+//  fixed_point.h
+//  DroneFlightController
+//
+//  Saturating fixed-point arithmetic for targets without an FPU.
+//  Q16 (Q15.16) holds angles, rates, gains and PWM values.
+//  Q31 (Q0.31) holds coefficients and covariances in [-1, 1).
+//
+
+#ifndef fixed_point_h
+#define fixed_point_h
+
+#include <stdint.h>
+
+// Build-time selection of the fixed-point control and filter path
+#ifndef FC_USE_FIXED_POINT
+#define FC_USE_FIXED_POINT 0
+#endif
+
+typedef int32_t q16_t;
+typedef int32_t q31_t;
+
+#define Q16_FRAC_BITS 16
+#define Q31_FRAC_BITS 31
+
+#define Q16_ONE       ((q16_t)0x00010000)
+#define Q16_MAX       ((q16_t)INT32_MAX)
+#define Q16_MIN       ((q16_t)INT32_MIN)
+#define Q31_MAX       ((q31_t)INT32_MAX)
+#define Q31_MIN       ((q31_t)INT32_MIN)
+
+// Constant conversion usable in static initializers
+#define Q16_CONST(x)  ((q16_t)((x) * 65536.0 + ((x) >= 0 ? 0.5 : -0.5)))
+#define Q31_CONST(x)  ((q31_t)((x) >= 1.0 ? 2147483647.0 : (x) * 2147483648.0))
+
+// Clamp a 64-bit intermediate into the 32-bit range
+static inline int32_t fx_saturate(int64_t value) {
+    if (value > INT32_MAX) return INT32_MAX;
+    if (value < INT32_MIN) return INT32_MIN;
+    return (int32_t)value;
+}
+
+// Conversions
+static inline q16_t q16_from_float(float value) {
+    float scaled = value * 65536.0f;
+    if (scaled >= 2147483647.0f) return Q16_MAX;
+    if (scaled <= -2147483648.0f) return Q16_MIN;
+    return (q16_t)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+}
+
+static inline float q16_to_float(q16_t value) {
+    return (float)value * (1.0f / 65536.0f);
+}
+
+static inline q16_t q16_from_int(int32_t value) {
+    return fx_saturate((int64_t)value * Q16_ONE);
+}
+
+static inline int32_t q16_to_int(q16_t value) {
+    // Round to nearest
+    return (int32_t)(((int64_t)value + (Q16_ONE >> 1)) >> Q16_FRAC_BITS);
+}
+
+static inline q31_t q31_from_float(float value) {
+    if (value >= 1.0f) return Q31_MAX;
+    if (value <= -1.0f) return Q31_MIN;
+    return (q31_t)(value * 2147483648.0f);
+}
+
+static inline float q31_to_float(q31_t value) {
+    return (float)value * (1.0f / 2147483648.0f);
+}
+
+// Saturating Q16 arithmetic
+static inline q16_t q16_add(q16_t a, q16_t b) {
+    return fx_saturate((int64_t)a + b);
+}
+
+static inline q16_t q16_sub(q16_t a, q16_t b) {
+    return fx_saturate((int64_t)a - b);
+}
+
+static inline q16_t q16_mul(q16_t a, q16_t b) {
+    // Round to nearest so small products such as error * dt do not vanish
+    return fx_saturate(((int64_t)a * b + (1 << (Q16_FRAC_BITS - 1))) >> Q16_FRAC_BITS);
+}
+
+static inline q16_t q16_div(q16_t a, q16_t b) {
+    if (b == 0) {
+        return (a >= 0) ? Q16_MAX : Q16_MIN;
+    }
+    return fx_saturate((int64_t)a * Q16_ONE / b);
+}
+
+static inline q16_t q16_abs(q16_t a) {
+    return (a == Q16_MIN) ? Q16_MAX : (a < 0 ? -a : a);
+}
+
+// Saturating Q31 arithmetic
+static inline q31_t q31_add(q31_t a, q31_t b) {
+    return fx_saturate((int64_t)a + b);
+}
+
+static inline q31_t q31_sub(q31_t a, q31_t b) {
+    return fx_saturate((int64_t)a - b);
+}
+
+static inline q31_t q31_mul(q31_t a, q31_t b) {
+    return fx_saturate(((int64_t)a * b) >> Q31_FRAC_BITS);
+}
+
+// Q31 quotient a / b, valid when |a| < |b|
+static inline q31_t q31_div(q31_t a, q31_t b) {
+    if (b == 0) {
+        return (a >= 0) ? Q31_MAX : Q31_MIN;
+    }
+    return fx_saturate((int64_t)a * ((int64_t)1 << Q31_FRAC_BITS) / b);
+}
+
+// Scale a Q16 value by a Q31 coefficient, result in Q16
+// Rounds to nearest: integrators add one product per sample, and a
+// truncated product would drift them by up to one step per sample
+static inline q16_t q16_mul_q31(q16_t a, q31_t coeff) {
+    return fx_saturate(((int64_t)a * coeff + ((int64_t)1 << (Q31_FRAC_BITS - 1))) >> Q31_FRAC_BITS);
+}
+
+#endif /* fixed_point_h */
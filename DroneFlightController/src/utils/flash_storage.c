@@ -0,0 +1,90 @@
+//
+//  flash_storage.c
+//  DroneFlightController
+//
+
+#include "flash_storage.h"
+#include <assert.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "pico/flash.h"
+#include "utils/crc32.h"
+
+#define FLASH_STORAGE_MAGIC  0x54534346u  // "FCST"
+
+// Sector of a key, counted back from the end of flash
+#define FLASH_STORAGE_OFFSET(key) \
+    (PICO_FLASH_SIZE_BYTES - ((uint32_t)(key) + 1) * FLASH_SECTOR_SIZE)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t key;
+    uint16_t size;
+    uint32_t crc;
+} flash_record_header_t;
+
+typedef struct {
+    uint32_t offset;
+    const uint8_t *page;
+} flash_program_args_t;
+
+// One page staged for programming, kept off the task stacks
+static uint8_t page_buffer[FLASH_PAGE_SIZE];
+static_assert(sizeof(page_buffer) == FLASH_STORAGE_RAM_BYTES, "FLASH_STORAGE_RAM_BYTES must match the flash page");
+
+static const uint8_t *record_address(flash_storage_key_t key) {
+    return (const uint8_t *)(XIP_BASE + FLASH_STORAGE_OFFSET(key));
+}
+
+// Runs with the other core and interrupts locked out of flash
+static void erase_and_program(void *param) {
+    const flash_program_args_t *args = (const flash_program_args_t *)param;
+    flash_range_erase(args->offset, FLASH_SECTOR_SIZE);
+    flash_range_program(args->offset, args->page, FLASH_PAGE_SIZE);
+}
+
+bool flash_storage_read(flash_storage_key_t key, void *data, uint16_t size) {
+    if (key >= FLASH_STORAGE_KEY_COUNT || size > FLASH_STORAGE_MAX_PAYLOAD) {
+        return false;
+    }
+
+    flash_record_header_t header;
+    const uint8_t *record = record_address(key);
+    memcpy(&header, record, sizeof(header));
+    if (header.magic != FLASH_STORAGE_MAGIC || header.key != key || header.size != size) {
+        return false;
+    }
+
+    const uint8_t *payload = record + sizeof(header);
+    if (crc32(payload, size) != header.crc) {
+        return false;
+    }
+    memcpy(data, payload, size);
+    return true;
+}
+
+bool flash_storage_write(flash_storage_key_t key, const void *data, uint16_t size) {
+    if (key >= FLASH_STORAGE_KEY_COUNT || size > FLASH_STORAGE_MAX_PAYLOAD) {
+        return false;
+    }
+
+    flash_record_header_t header;
+    header.magic = FLASH_STORAGE_MAGIC;
+    header.key = (uint16_t)key;
+    header.size = size;
+    header.crc = crc32((const uint8_t *)data, size);
+
+    // Erased flash reads as 0xFF, pad the rest of the page the same way
+    memset(page_buffer, 0xFF, sizeof(page_buffer));
+    memcpy(page_buffer, &header, sizeof(header));
+    memcpy(page_buffer + sizeof(header), data, size);
+
+    flash_program_args_t args;
+    args.offset = FLASH_STORAGE_OFFSET(key);
+    args.page = page_buffer;
+    if (flash_safe_execute(erase_and_program, &args, 100) != PICO_OK) {
+        return false;
+    }
+
+    return memcmp(record_address(key), page_buffer, sizeof(header) + size) == 0;
+}
@@ -0,0 +1,38 @@
+//
+//  flash_storage.h
+//  DroneFlightController
+//
+//  Small persistent records kept at the end of the program flash. Each key
+//  owns one sector and holds a single CRC-protected record of up to one
+//  flash page. Writes erase and program the sector, which stalls execution
+//  from flash for tens of milliseconds, so they must not run in flight.
+//
+
+#ifndef flash_storage_h
+#define flash_storage_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Record keys, one flash sector each counted back from the end of flash
+typedef enum {
+    FLASH_STORAGE_IMU_CALIBRATION = 0,
+    FLASH_STORAGE_MAG_CALIBRATION,
+    FLASH_STORAGE_KEY_COUNT
+} flash_storage_key_t;
+
+// Largest payload a record can hold (one page minus the header)
+#define FLASH_STORAGE_MAX_PAYLOAD  244
+
+// Static RAM of the page staged for programming, for the RAM budget
+#define FLASH_STORAGE_RAM_BYTES  256
+
+// Copy the stored record into data
+// Returns false if the record is missing, corrupt or not exactly size bytes.
+bool flash_storage_read(flash_storage_key_t key, void *data, uint16_t size);
+
+// Replace the stored record with size bytes from data
+// Returns false if the payload is too large or the write did not verify.
+bool flash_storage_write(flash_storage_key_t key, const void *data, uint16_t size);
+
+#endif /* flash_storage_h */
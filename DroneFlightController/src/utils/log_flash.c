@@ -0,0 +1,65 @@
+//
+//  log_flash.c
+//  DroneFlightController
+//
+
+#include "log_flash.h"
+#include <assert.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "pico/flash.h"
+#include "utils/flash_storage.h"
+
+// The region ends where the flash_storage sectors begin
+#define LOG_FLASH_REGION_OFFSET \
+    (PICO_FLASH_SIZE_BYTES - FLASH_STORAGE_KEY_COUNT * FLASH_SECTOR_SIZE - LOG_STORE_SIZE_BYTES)
+
+static_assert(LOG_FLASH_PAGE_SIZE == FLASH_PAGE_SIZE, "log flash page must be the SDK flash page");
+static_assert(LOG_FLASH_SECTOR_SIZE == FLASH_SECTOR_SIZE, "log flash sector must be the SDK flash sector");
+
+typedef struct {
+    uint32_t offset;
+    const uint8_t *page;
+} log_flash_args_t;
+
+static const uint8_t *region_address(uint32_t offset) {
+    return (const uint8_t *)(XIP_BASE + LOG_FLASH_REGION_OFFSET + offset);
+}
+
+// Both run with the other core and interrupts locked out of flash
+static void program_page(void *param) {
+    const log_flash_args_t *args = (const log_flash_args_t *)param;
+    flash_range_program(LOG_FLASH_REGION_OFFSET + args->offset, args->page, FLASH_PAGE_SIZE);
+}
+
+static void erase_sector(void *param) {
+    const log_flash_args_t *args = (const log_flash_args_t *)param;
+    flash_range_erase(LOG_FLASH_REGION_OFFSET + args->offset, FLASH_SECTOR_SIZE);
+}
+
+void log_flash_read(uint32_t offset, void *data, uint32_t size) {
+    memcpy(data, region_address(offset), size);
+}
+
+bool log_flash_program(uint32_t offset, const uint8_t *page) {
+    log_flash_args_t args = { offset, page };
+    if (flash_safe_execute(program_page, &args, 10) != PICO_OK) {
+        return false;
+    }
+    return memcmp(region_address(offset), page, LOG_FLASH_PAGE_SIZE) == 0;
+}
+
+bool log_flash_erase(uint32_t offset) {
+    log_flash_args_t args = { offset, NULL };
+    if (flash_safe_execute(erase_sector, &args, 500) != PICO_OK) {
+        return false;
+    }
+
+    const uint32_t *word = (const uint32_t *)region_address(offset);
+    for (uint32_t i = 0; i < LOG_FLASH_SECTOR_SIZE / sizeof(uint32_t); i++) {
+        if (word[i] != 0xFFFFFFFFu) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+//
+//  log_flash.h
+//  DroneFlightController
+//
+//  Raw access to the program flash region the log store owns. Offsets are
+//  relative to the start of the region. NOR flash semantics: an erase sets
+//  a whole sector to 0xFF and a program can only clear bits, so each page
+//  is programmed once between erases. The host simulation in
+//  tools/log_store_sim provides the same functions.
+//
+//  The region is in the program flash, so a program or erase parks the
+//  other core and stops execution from flash for its duration: about
+//  0.5 ms per page and 45 ms per sector, typically.
+//
+
+#ifndef log_flash_h
+#define log_flash_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config/hardware_config.h"
+
+#define LOG_FLASH_PAGE_SIZE    256
+#define LOG_FLASH_SECTOR_SIZE  4096
+#define LOG_FLASH_PAGES_PER_SECTOR  (LOG_FLASH_SECTOR_SIZE / LOG_FLASH_PAGE_SIZE)
+#define LOG_FLASH_SECTOR_COUNT (LOG_STORE_SIZE_BYTES / LOG_FLASH_SECTOR_SIZE)
+
+// Copy size bytes at offset into data
+void log_flash_read(uint32_t offset, void *data, uint32_t size);
+
+// Program one page at a page-aligned offset
+// Returns false if the page did not verify.
+bool log_flash_program(uint32_t offset, const uint8_t *page);
+
+// Erase the sector at a sector-aligned offset
+// Returns false if the sector did not read back erased.
+bool log_flash_erase(uint32_t offset);
+
+#endif /* log_flash_h */
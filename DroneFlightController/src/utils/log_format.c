@@ -0,0 +1,297 @@
+//
+//  log_format.c
+//  DroneFlightController
+//
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "log_format.h"
+
+#define LOG_FORMAT_MAX_DECIMALS 9
+
+// Output cursor; characters past the end are dropped
+typedef struct {
+    char *buffer;
+    uint32_t size;
+    uint32_t length;
+} format_out_t;
+
+static void put_char(format_out_t *out, char c) {
+    if (out->length + 1 < out->size) {
+        out->buffer[out->length++] = c;
+    }
+}
+
+static void put_repeat(format_out_t *out, char c, int count) {
+    while (count-- > 0) {
+        put_char(out, c);
+    }
+}
+
+// Conversion spec after parsing
+typedef struct {
+    bool left;
+    bool zero;
+    char sign;          // '+', ' ' or 0
+    int width;
+    int precision;      // -1 when not given
+} format_spec_t;
+
+// Write prefix and digits padded to the field width
+static void put_field(format_out_t *out, const format_spec_t *spec, const char *prefix,
+                      const char *digits, int digit_count) {
+    int prefix_length = 0;
+    while (prefix[prefix_length] != '\0') {
+        prefix_length++;
+    }
+    int pad = spec->width - prefix_length - digit_count;
+
+    if (!spec->left && !spec->zero) {
+        put_repeat(out, ' ', pad);
+    }
+    for (int i = 0; i < prefix_length; i++) {
+        put_char(out, prefix[i]);
+    }
+    if (!spec->left && spec->zero) {
+        put_repeat(out, '0', pad);
+    }
+    for (int i = 0; i < digit_count; i++) {
+        put_char(out, digits[i]);
+    }
+    if (spec->left) {
+        put_repeat(out, ' ', pad);
+    }
+}
+
+// Digits of value in base, most significant first; returns the count
+static int to_digits(uint64_t value, uint32_t base, bool upper, char *digits) {
+    const char *set = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char reversed[24];
+    int count = 0;
+    do {
+        reversed[count++] = set[value % base];
+        value /= base;
+    } while (value != 0);
+    for (int i = 0; i < count; i++) {
+        digits[i] = reversed[count - 1 - i];
+    }
+    return count;
+}
+
+static void put_integer(format_out_t *out, format_spec_t spec, uint64_t magnitude, bool negative,
+                        uint32_t base, bool upper, const char *base_prefix) {
+    char digits[32];
+    int count = 0;
+
+    // Precision is the minimum digit count and disables zero padding
+    if (spec.precision >= 0) {
+        spec.zero = false;
+        if (!(spec.precision == 0 && magnitude == 0)) {
+            char value_digits[24];
+            int value_count = to_digits(magnitude, base, upper, value_digits);
+            int lead = spec.precision - value_count;
+            while (lead-- > 0 && count < (int)sizeof(digits) - value_count) {
+                digits[count++] = '0';
+            }
+            for (int i = 0; i < value_count; i++) {
+                digits[count++] = value_digits[i];
+            }
+        }
+    } else {
+        count = to_digits(magnitude, base, upper, digits);
+    }
+
+    char prefix[4] = {0};
+    int p = 0;
+    if (negative) {
+        prefix[p++] = '-';
+    } else if (spec.sign != 0) {
+        prefix[p++] = spec.sign;
+    }
+    for (int i = 0; base_prefix[i] != '\0'; i++) {
+        prefix[p++] = base_prefix[i];
+    }
+    put_field(out, &spec, prefix, digits, count);
+}
+
+static void put_float(format_out_t *out, format_spec_t spec, double value) {
+    int decimals = (spec.precision < 0) ? 6 : spec.precision;
+    if (decimals > LOG_FORMAT_MAX_DECIMALS) {
+        decimals = LOG_FORMAT_MAX_DECIMALS;
+    }
+
+    bool negative = value < 0.0;
+    if (negative) {
+        value = -value;
+    }
+
+    char prefix[2] = {0};
+    if (negative) {
+        prefix[0] = '-';
+    } else if (spec.sign != 0) {
+        prefix[0] = spec.sign;
+    }
+
+    if (value != value) {
+        spec.zero = false;
+        put_field(out, &spec, "", "nan", 3);
+        return;
+    }
+    if (value >= 18446744073709551616.0) {
+        spec.zero = false;
+        put_field(out, &spec, prefix, "inf", 3);
+        return;
+    }
+
+    // Round once at the last decimal, then split into integer and fraction
+    uint64_t scale = 1;
+    for (int i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+    uint64_t whole = (uint64_t)value;
+    uint64_t fraction = (uint64_t)((value - (double)whole) * (double)scale + 0.5);
+    if (fraction >= scale) {
+        whole++;
+        fraction -= scale;
+    }
+
+    char digits[24 + 1 + LOG_FORMAT_MAX_DECIMALS];
+    int count = to_digits(whole, 10, false, digits);
+    if (decimals > 0) {
+        digits[count++] = '.';
+        for (int i = decimals - 1; i >= 0; i--) {
+            digits[count + i] = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        count += decimals;
+    }
+    put_field(out, &spec, prefix, digits, count);
+}
+
+uint32_t log_vformat(char *buffer, uint32_t size, const char *format, va_list args) {
+    format_out_t out = { buffer, size, 0 };
+
+    for (const char *f = format; *f != '\0'; f++) {
+        if (*f != '%') {
+            put_char(&out, *f);
+            continue;
+        }
+        const char *start = f++;
+
+        format_spec_t spec = { false, false, 0, 0, -1 };
+        for (;; f++) {
+            if (*f == '-') spec.left = true;
+            else if (*f == '0') spec.zero = true;
+            else if (*f == '+') spec.sign = '+';
+            else if (*f == ' ' && spec.sign == 0) spec.sign = ' ';
+            else break;
+        }
+
+        if (*f == '*') {
+            spec.width = va_arg(args, int);
+            if (spec.width < 0) {
+                spec.left = true;
+                spec.width = -spec.width;
+            }
+            f++;
+        } else {
+            while (*f >= '0' && *f <= '9') {
+                spec.width = spec.width * 10 + (*f++ - '0');
+            }
+        }
+
+        if (*f == '.') {
+            f++;
+            spec.precision = 0;
+            if (*f == '*') {
+                spec.precision = va_arg(args, int);
+                f++;
+            } else {
+                while (*f >= '0' && *f <= '9') {
+                    spec.precision = spec.precision * 10 + (*f++ - '0');
+                }
+            }
+        }
+
+        // Length modifiers: h and hh promote to int anyway
+        int longs = 0;
+        bool size_t_arg = false;
+        for (;; f++) {
+            if (*f == 'l') longs++;
+            else if (*f == 'z') size_t_arg = true;
+            else if (*f != 'h') break;
+        }
+
+        switch (*f) {
+            case 'd':
+            case 'i': {
+                int64_t value;
+                if (longs >= 2) value = va_arg(args, long long);
+                else if (longs == 1) value = va_arg(args, long);
+                else if (size_t_arg) value = (int64_t)va_arg(args, size_t);
+                else value = va_arg(args, int);
+                uint64_t magnitude = (value < 0) ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+                put_integer(&out, spec, magnitude, value < 0, 10, false, "");
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o': {
+                uint64_t value;
+                if (longs >= 2) value = va_arg(args, unsigned long long);
+                else if (longs == 1) value = va_arg(args, unsigned long);
+                else if (size_t_arg) value = va_arg(args, size_t);
+                else value = va_arg(args, unsigned int);
+                spec.sign = 0;
+                uint32_t base = (*f == 'u') ? 10 : (*f == 'o') ? 8 : 16;
+                put_integer(&out, spec, value, false, base, *f == 'X', "");
+                break;
+            }
+            case 'p':
+                spec.sign = 0;
+                put_integer(&out, spec, (uint64_t)(uintptr_t)va_arg(args, void *), false, 16, false, "0x");
+                break;
+            case 'f':
+            case 'F':
+                put_float(&out, spec, va_arg(args, double));
+                break;
+            case 'c': {
+                char c = (char)va_arg(args, int);
+                spec.zero = false;
+                put_field(&out, &spec, "", &c, 1);
+                break;
+            }
+            case 's': {
+                const char *text = va_arg(args, const char *);
+                if (text == NULL) {
+                    text = "(null)";
+                }
+                int length = 0;
+                while (text[length] != '\0' && (spec.precision < 0 || length < spec.precision)) {
+                    length++;
+                }
+                spec.zero = false;
+                put_field(&out, &spec, "", text, length);
+                break;
+            }
+            case '%':
+                put_char(&out, '%');
+                break;
+            default:
+                // Unknown conversion: copy it through and stop at the end
+                for (const char *c = start; c <= f && *c != '\0'; c++) {
+                    put_char(&out, *c);
+                }
+                if (*f == '\0') {
+                    f--;
+                }
+                break;
+        }
+    }
+
+    if (size > 0) {
+        buffer[out.length] = '\0';
+    }
+    return out.length;
+}
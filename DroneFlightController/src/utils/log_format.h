@@ -0,0 +1,26 @@
+//
+//  log_format.h
+//  DroneFlightController
+//
+//  printf-style formatter for logger_log. It keeps all of its state on the
+//  caller's stack and uses no heap, locale or library globals, so unlike
+//  newlib's vsnprintf it can run from any task, interrupt or core at once.
+//
+//  Supported: flags - 0 + and space, width and precision (also *), the
+//  hh h l ll z length modifiers and the d i u x X o c s p f % conversions.
+//  %f prints up to 9 decimals and magnitudes below 2^64; larger values
+//  print as inf, and exact halves round up rather than to even. Anything else is copied through as written.
+//
+
+#ifndef log_format_h
+#define log_format_h
+
+#include <stdint.h>
+#include <stdarg.h>
+
+// Format into buffer, always terminated when size > 0, truncating as
+// vsnprintf does. Returns the number of characters stored, excluding the
+// terminator.
+uint32_t log_vformat(char *buffer, uint32_t size, const char *format, va_list args);
+
+#endif /* log_format_h */
@@ -0,0 +1,318 @@
+//
+//  log_store.c
+//  DroneFlightController
+//
+
+#include "log_store.h"
+#include <string.h>
+#include "utils/mpsc_ring.h"
+#include "utils/crc32.h"
+#include "utils/timing.h"
+#include "utils/logger.h"
+
+#define LOG_STORE_PAGE_COUNT  (LOG_FLASH_SECTOR_COUNT * LOG_FLASH_PAGES_PER_SECTOR)
+
+static_assert(sizeof(log_store_page_header_t) == 12, "log store page header must be packed");
+static_assert((LOG_STORE_PAGE_COUNT & (LOG_STORE_PAGE_COUNT - 1)) == 0,
+              "log store region must be a power of two pages so sequences wrap cleanly");
+static_assert(LOG_FLASH_SECTOR_COUNT > LOG_STORE_ERASE_AHEAD + 1, "log store region too small");
+
+// Stream writers to the log task
+static MpscRing<log_store_pending_t, LOG_STORE_PAGE_QUEUE> queue;
+
+// Page each stream is filling, and when its first byte came; writer only
+static log_store_pending_t filling[LOG_STORE_STREAM_COUNT];
+static uint32_t filling_since_us[LOG_STORE_STREAM_COUNT];
+
+// Write position, log task only. ready counts the erased pages from the
+// head onwards; head + ready is always on a sector boundary.
+static uint32_t head = 0;
+static uint32_t ready = 0;
+static uint32_t boot_head = 0;
+
+// Page staged for programming
+static uint8_t page_buffer[LOG_FLASH_PAGE_SIZE];
+
+// Counters; pages_dropped is shared by every writer
+static volatile uint32_t pages_written = 0;
+static volatile uint32_t pages_dropped = 0;
+static volatile uint32_t program_errors = 0;
+static volatile uint32_t erases = 0;
+static volatile uint32_t erase_errors = 0;
+static volatile uint32_t erase_waits = 0;
+static volatile uint32_t service_max_us = 0;
+
+static uint32_t page_offset(uint32_t sequence) {
+    return (sequence % LOG_STORE_PAGE_COUNT) * LOG_FLASH_PAGE_SIZE;
+}
+
+static uint32_t page_crc(const uint8_t *page, uint16_t length) {
+    return crc32(page + sizeof(uint32_t), sizeof(log_store_page_header_t) - sizeof(uint32_t) + length);
+}
+
+// Header of the page at a sequence's position, and whether it holds that
+// sequence: right magic and position, plausible length and a valid CRC
+static bool read_valid_page(uint32_t sequence, log_store_page_header_t *header) {
+    log_flash_read(page_offset(sequence), header, sizeof(*header));
+    if (header->magic != LOG_STORE_PAGE_MAGIC ||
+        header->sequence % LOG_STORE_PAGE_COUNT != sequence % LOG_STORE_PAGE_COUNT ||
+        header->length > LOG_STORE_PAGE_PAYLOAD) {
+        return false;
+    }
+    log_flash_read(page_offset(sequence), page_buffer, LOG_FLASH_PAGE_SIZE);
+    return page_crc(page_buffer, header->length) == header->crc;
+}
+
+static bool is_erased(uint32_t offset, uint32_t size) {
+    uint32_t words[16];
+    for (uint32_t at = 0; at < size; at += sizeof(words)) {
+        log_flash_read(offset + at, words, sizeof(words));
+        for (uint32_t i = 0; i < 16; i++) {
+            if (words[i] != 0xFFFFFFFFu) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Erase the sector at the end of the ready pages
+static bool erase_next(void) {
+    uint32_t offset = page_offset(head + ready);
+    if (!log_flash_erase(offset)) {
+        erase_errors++;
+        return false;
+    }
+    erases++;
+    ready += LOG_FLASH_PAGES_PER_SECTOR;
+    return true;
+}
+
+// Newest page whose header is valid; a torn page may carry any sequence,
+// so a candidate that fails its CRC is excluded and the scan repeated
+static bool find_newest(uint32_t *newest) {
+    uint32_t below = 0xFFFFFFFFu;
+    bool limited = false;
+    for (;;) {
+        bool found = false;
+        uint32_t best = 0;
+        for (uint32_t index = 0; index < LOG_STORE_PAGE_COUNT; index++) {
+            log_store_page_header_t header;
+            log_flash_read(index * LOG_FLASH_PAGE_SIZE, &header, sizeof(header));
+            if (header.magic != LOG_STORE_PAGE_MAGIC ||
+                header.sequence % LOG_STORE_PAGE_COUNT != index ||
+                (limited && header.sequence >= below) ||
+                (found && header.sequence <= best)) {
+                continue;
+            }
+            best = header.sequence;
+            found = true;
+        }
+        if (!found) {
+            return false;
+        }
+
+        log_store_page_header_t header;
+        if (read_valid_page(best, &header)) {
+            *newest = best;
+            return true;
+        }
+        below = best;
+        limited = true;
+    }
+}
+
+bool log_store_init(void) {
+    // Pages queued before a reset never reached the flash
+    while (queue.peek() != NULL) {
+        queue.release();
+    }
+    for (int s = 0; s < LOG_STORE_STREAM_COUNT; s++) {
+        filling[s].length = 0;
+    }
+
+    uint32_t newest;
+    if (find_newest(&newest)) {
+        // Pages after the newest valid one in its sector were erased with
+        // it; skip any a power loss left torn
+        head = newest + 1;
+        ready = 0;
+        uint32_t sector_end = newest - newest % LOG_FLASH_PAGES_PER_SECTOR + LOG_FLASH_PAGES_PER_SECTOR;
+        for (uint32_t sequence = sector_end; sequence > head; sequence--) {
+            if (!is_erased(page_offset(sequence - 1), LOG_FLASH_PAGE_SIZE)) {
+                head = sequence;
+                break;
+            }
+        }
+        ready = sector_end - head;
+    } else {
+        head = 0;
+        ready = 0;
+    }
+    boot_head = head;
+
+    // An erase-ahead sector may have been cut short by the power loss, or
+    // still hold the previous lap; erase only those not reading blank
+    while (ready <= LOG_STORE_ERASE_AHEAD * LOG_FLASH_PAGES_PER_SECTOR) {
+        if (is_erased(page_offset(head + ready), LOG_FLASH_SECTOR_SIZE)) {
+            ready += LOG_FLASH_PAGES_PER_SECTOR;
+        } else if (!erase_next()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hand a stream's page to the log task, or drop it if the queue is full
+static void queue_page(log_store_stream_t stream) {
+    log_store_pending_t *page = &filling[stream];
+    if (page->length == 0) {
+        return;
+    }
+
+    uint32_t ticket;
+    log_store_pending_t *slot = queue.claim(ticket);
+    if (slot == NULL) {
+        __atomic_fetch_add(&pages_dropped, 1, __ATOMIC_RELAXED);
+    } else {
+        slot->length = page->length;
+        slot->stream = (uint8_t)stream;
+        memcpy(slot->payload, page->payload, page->length);
+        queue.commit(ticket);
+    }
+    page->length = 0;
+}
+
+void log_store_append(log_store_stream_t stream, const void *data, uint32_t size) {
+    if (stream >= LOG_STORE_STREAM_COUNT) {
+        return;
+    }
+
+    log_store_pending_t *page = &filling[stream];
+    const uint8_t *bytes = (const uint8_t *)data;
+    while (size > 0) {
+        if (page->length == 0) {
+            filling_since_us[stream] = timing_micros();
+        }
+        uint32_t room = LOG_STORE_PAGE_PAYLOAD - page->length;
+        uint32_t chunk = size < room ? size : room;
+        memcpy(&page->payload[page->length], bytes, chunk);
+        page->length += (uint16_t)chunk;
+        bytes += chunk;
+        size -= chunk;
+
+        if (page->length == LOG_STORE_PAGE_PAYLOAD) {
+            queue_page(stream);
+        }
+    }
+}
+
+void log_store_sync(log_store_stream_t stream) {
+    if (stream >= LOG_STORE_STREAM_COUNT || filling[stream].length == 0) {
+        return;
+    }
+    if (timing_micros() - filling_since_us[stream] >= LOG_STORE_SYNC_MS * 1000u) {
+        queue_page(stream);
+    }
+}
+
+void log_store_flush(log_store_stream_t stream) {
+    if (stream < LOG_STORE_STREAM_COUNT) {
+        queue_page(stream);
+    }
+}
+
+uint32_t log_store_service(void) {
+    uint32_t start_us = timing_micros();
+    uint32_t programmed = 0;
+
+    const log_store_pending_t *pending;
+    while ((pending = queue.peek()) != NULL) {
+        // Only when the erase-ahead fell behind, e.g. after an erase error
+        if (ready == 0) {
+            erase_waits++;
+            if (!erase_next()) {
+                break;
+            }
+        }
+
+        log_store_page_header_t header;
+        header.sequence = head;
+        header.length = pending->length;
+        header.stream = pending->stream;
+        header.magic = LOG_STORE_PAGE_MAGIC;
+
+        // Erased flash reads as 0xFF, pad the rest of the page the same way
+        memset(page_buffer, 0xFF, sizeof(page_buffer));
+        memcpy(page_buffer, &header, sizeof(header));
+        memcpy(page_buffer + sizeof(header), pending->payload, pending->length);
+        header.crc = page_crc(page_buffer, pending->length);
+        memcpy(page_buffer, &header.crc, sizeof(header.crc));
+
+        // A failed page keeps its position; its CRC no longer matches
+        bool ok = log_flash_program(page_offset(head), page_buffer);
+        head++;
+        ready--;
+        queue.release();
+        if (ok) {
+            pages_written++;
+            programmed++;
+        } else {
+            program_errors++;
+            __atomic_fetch_add(&pages_dropped, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    // At most one erase per call keeps each call to a single sector stall
+    if (ready <= LOG_STORE_ERASE_AHEAD * LOG_FLASH_PAGES_PER_SECTOR) {
+        erase_next();
+    }
+
+    uint32_t elapsed_us = timing_micros() - start_us;
+    if (elapsed_us > service_max_us) {
+        service_max_us = elapsed_us;
+    }
+    return programmed;
+}
+
+void log_store_get_stats(log_store_stats_t *stats) {
+    stats->head = head;
+    stats->boot_head = boot_head;
+    // The sector at the far end of the ready pages was erased last, once
+    // per lap including this one
+    uint32_t end = head + ready;
+    stats->erase_count = end > 0 ? (end - 1) / LOG_STORE_PAGE_COUNT + 1 : 0;
+    stats->pages_written = pages_written;
+    stats->pages_dropped = pages_dropped;
+    stats->program_errors = program_errors;
+    stats->erases = erases;
+    stats->erase_errors = erase_errors;
+    stats->erase_waits = erase_waits;
+    stats->service_max_us = service_max_us;
+}
+
+void log_store_report(void) {
+    log_store_stats_t s;
+    log_store_get_stats(&s);
+    LOG_MSG(LOG_INFO,
+            "Log store head %lu, %lu pages, %lu dropped, %lu erases (wear %lu), %lu errors, %lu waits, max %lu us",
+            (unsigned long)s.head, (unsigned long)s.pages_written, (unsigned long)s.pages_dropped,
+            (unsigned long)s.erases, (unsigned long)s.erase_count,
+            (unsigned long)(s.program_errors + s.erase_errors), (unsigned long)s.erase_waits,
+            (unsigned long)s.service_max_us);
+}
+
+uint32_t log_store_oldest(void) {
+    return head > LOG_STORE_PAGE_COUNT ? head - LOG_STORE_PAGE_COUNT : 0;
+}
+
+bool log_store_read(uint32_t *sequence, log_store_page_header_t *header, uint8_t *payload) {
+    while (*sequence < head) {
+        uint32_t at = (*sequence)++;
+        if (read_valid_page(at, header) && header->sequence == at) {
+            memcpy(payload, page_buffer + sizeof(*header), header->length);
+            return true;
+        }
+    }
+    return false;
+}
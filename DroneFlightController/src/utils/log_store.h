@@ -0,0 +1,126 @@
+//
+//  log_store.h
+//  DroneFlightController
+//
+//  Append-only log store in a flash region written as a circular log of
+//  pages, the LOG_TO_FLASH backend of the text logger, the trace log and
+//  the blackbox. Each stream collects its bytes in a RAM page; full pages
+//  go to a lock-free queue and the log task programs them in order. Every
+//  page is self-describing, so the stream bytes are rebuilt by reading the
+//  pages back in sequence order.
+//
+//  Page numbers ("sequences") count every page position since the region
+//  was first written and never repeat; a page lives at sequence modulo
+//  the region size. Writing resumes at the recovered head after every
+//  boot, so each sector is erased once per lap of the region and all wear
+//  evenly, and the lap count is each sector's erase count.
+//
+//  Appending never touches the flash. The service keeps
+//  LOG_STORE_ERASE_AHEAD sectors erased beyond the head and erases at most
+//  one more per call, but every program and erase runs with interrupts off
+//  and the other core locked out (about 0.5 ms a page, up to 400 ms a
+//  sector), so it must only be called while the motors are disarmed. In
+//  flight full pages wait in the queue and are dropped once it is full.
+//  At boot the head is found again from the page headers; a page torn by
+//  a power loss fails its CRC and is skipped.
+//
+
+#ifndef log_store_h
+#define log_store_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/log_flash.h"
+
+// Streams sharing the store, one writer each
+typedef enum {
+    LOG_STORE_STREAM_TEXT = 0,   // logger_log lines
+    LOG_STORE_STREAM_TRACE,      // trace.h records
+    LOG_STORE_STREAM_BLACKBOX,   // blackbox.h frames
+    LOG_STORE_STREAM_COUNT
+} log_store_stream_t;
+
+#define LOG_STORE_PAGE_MAGIC  0xA7
+
+// Start of every programmed page
+typedef struct {
+    uint32_t crc;            // CRC-32 of the rest of the header and the payload
+    uint32_t sequence;       // Page number since the region was first written
+    uint16_t length;         // Payload bytes
+    uint8_t stream;          // log_store_stream_t
+    uint8_t magic;           // LOG_STORE_PAGE_MAGIC
+} log_store_page_header_t;
+
+#define LOG_STORE_PAGE_PAYLOAD  (LOG_FLASH_PAGE_SIZE - sizeof(log_store_page_header_t))
+
+// Full pages queued for the log task, a power of two
+#define LOG_STORE_PAGE_QUEUE  16
+
+// Erased sectors kept ready beyond the head
+#define LOG_STORE_ERASE_AHEAD  2
+
+// Age at which log_store_sync() queues a partly filled page
+#define LOG_STORE_SYNC_MS  500
+
+// A page being filled or waiting to be programmed
+typedef struct {
+    uint16_t length;
+    uint8_t stream;
+    uint8_t payload[LOG_STORE_PAGE_PAYLOAD];
+} log_store_pending_t;
+
+// Static RAM of the stream pages, the queue and the page being programmed,
+// for the RAM budget
+#define LOG_STORE_RAM_BYTES \
+    (LOG_STORE_STREAM_COUNT * (sizeof(log_store_pending_t) + sizeof(uint32_t)) + \
+     LOG_STORE_PAGE_QUEUE * (sizeof(uint32_t) + sizeof(log_store_pending_t)) + LOG_FLASH_PAGE_SIZE)
+
+typedef struct {
+    uint32_t head;             // Sequence the next page gets
+    uint32_t boot_head;        // Head recovered at boot
+    uint32_t erase_count;      // Erases of the most worn sector
+    uint32_t pages_written;
+    uint32_t pages_dropped;    // Queue full or program failed
+    uint32_t program_errors;
+    uint32_t erases;
+    uint32_t erase_errors;
+    uint32_t erase_waits;      // Queued pages that found no erased page ready
+    uint32_t service_max_us;   // Longest log_store_service call
+} log_store_stats_t;
+
+// Find the write head and make sure the sectors ahead of it are erased
+// Erases here stall for tens of milliseconds, so call it at boot.
+// Returns false if the flash could not be erased.
+bool log_store_init(void);
+
+// Append bytes to a stream; only that stream's writer may call it
+// Never touches the flash. Full pages that find the queue full are dropped.
+void log_store_append(log_store_stream_t stream, const void *data, uint32_t size);
+
+// Queue the stream's partly filled page if it is older than
+// LOG_STORE_SYNC_MS, bounding what a power loss can take; stream writer only
+void log_store_sync(log_store_stream_t stream);
+
+// Queue the stream's partly filled page now; stream writer only
+void log_store_flush(log_store_stream_t stream);
+
+// Program the queued pages and keep the erase-ahead; log task only, and
+// only while disarmed
+// Returns the number of pages programmed.
+uint32_t log_store_service(void);
+
+void log_store_get_stats(log_store_stats_t *stats);
+
+// Log the counters through the logger
+void log_store_report(void);
+
+// Read back, not while logging
+// Sequence of the oldest page that may still be in the region.
+uint32_t log_store_oldest(void);
+
+// Next valid page at or after *sequence and before the head; advances
+// *sequence past it. payload takes LOG_STORE_PAGE_PAYLOAD bytes.
+// Returns false when the head is reached.
+bool log_store_read(uint32_t *sequence, log_store_page_header_t *header, uint8_t *payload);
+
+#endif /* log_store_h */
@@ -2,42 +2,74 @@
 #include <time.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include "logger.h"
+#include "utils/log_format.h"
+#include "utils/mpsc_ring.h"
+#include "utils/timing.h"
+#include "utils/log_store.h"
+#include "pico/platform.h"
 
-#define MAX_LOG_LENGTH 1024
 #define LOG_TIMESTAMP_FORMAT "%Y-%m-%d %H:%M:%S"
 
 static FILE* log_file = NULL;
-static LogLevel current_log_level = LOG_INFO;
+static volatile LogLevel current_log_level = LOG_INFO;
 static LogDestination current_log_destination = LOG_TO_FILE;
 
-void logger_init(const char* destination, LogLevel level, LogDestination log_dest) {
+// Every module passes every level until told otherwise
+volatile uint8_t logger_module_levels[LOG_MODULE_COUNT];
+
+// Every task and interrupt on a core to the log task; a ring per core
+// keeps the claim from being contended across cores
+static MpscRing<logger_message_t, LOGGER_RING_SLOTS> rings[LOGGER_CORES];
+
+// Dropped messages per ring, and the total last reported by the drain
+static volatile uint32_t dropped[LOGGER_CORES];
+static uint32_t dropped_reported = 0;
+
+// Drain side line buffer, and the last timestamp formatted into it
+static char line_buffer[LOG_LINE_LENGTH];
+static char timestamp[LOG_TIMESTAMP_LENGTH];
+static time_t timestamp_time = (time_t)-1;
+
+bool logger_init(const char* destination, LogLevel level, LogDestination log_dest) {
     current_log_level = level;
     current_log_destination = log_dest;
 
     if (log_dest == LOG_TO_FILE) {
         log_file = fopen(destination, "a");
         if (log_file == NULL) {
+            // No filesystem: keep the messages on the console rather than
+            // dropping every one of them
             fprintf(stderr, "Error: Could not open log file %s\n", destination);
-            return;
+            log_file = stdout;
+            return false;
         }
-    } else if (log_dest == LOG_TO_FLASH || log_dest == LOG_TO_EXTERNAL_STORAGE) {
-        // Initialize flash memory or external storage logging
-        // This is a placeholder for actual implementation
     }
+    return true;
 }
 
 void logger_close(void) {
-    if (log_file != NULL) {
+    logger_drain();
+    if (current_log_destination == LOG_TO_FLASH) {
+        log_store_flush(LOG_STORE_STREAM_TEXT);
+    }
+    if (log_file != NULL && log_file != stdout) {
         fclose(log_file);
-        log_file = NULL;
     }
+    log_file = NULL;
 }
 
 void logger_set_level(LogLevel level) {
     current_log_level = level;
 }
 
+void logger_set_module_level(LogModule module, LogLevel level) {
+    if (module < LOG_MODULE_COUNT) {
+        logger_module_levels[module] = (uint8_t)level;
+    }
+}
+
 static const char* level_to_string(LogLevel level) {
     switch (level) {
         case LOG_DEBUG: return "DEBUG";
@@ -53,38 +85,115 @@ void logger_log(LogLevel level, const char* file, int line, const char* format,
         return;
     }
 
-    time_t now;
-    time(&now);
-    struct tm* timeinfo = localtime(&now);
-    char timestamp[32];
-    strftime(timestamp, sizeof(timestamp), LOG_TIMESTAMP_FORMAT, timeinfo);
+    uint32_t core = get_core_num() % LOGGER_CORES;
+    uint32_t ticket;
+    logger_message_t* message = rings[core].claim(ticket);
+    if (message == NULL) {
+        __atomic_fetch_add(&dropped[core], 1, __ATOMIC_RELAXED);
+        return;
+    }
 
-    char message[MAX_LOG_LENGTH];
+    message->file = file;
+    message->line = (uint16_t)line;
+    message->level = (uint8_t)level;
+    message->timestamp_us = timing_micros();
+
+    // Not vsnprintf: newlib's keeps state in the shared reent structure
+    // and allocates for %f, which is unsafe from interrupts and core 1
     va_list args;
     va_start(args, format);
-    vsnprintf(message, MAX_LOG_LENGTH, format, args);
+    log_vformat(message->text, MAX_LOG_LENGTH, format, args);
     va_end(args);
 
-    if (current_log_destination == LOG_TO_FILE && log_file != NULL) {
-        fprintf(log_file, "[%s] [%s] %s:%d - %s\n", 
-                timestamp, 
-                level_to_string(level), 
-                file, 
-                line, 
-                message);
+    rings[core].commit(ticket);
+}
+
+// Hand one formatted line to the destination
+static void write_line(const char* text) {
+    if (current_log_destination == LOG_TO_FILE) {
+        if (log_file != NULL) {
+            fputs(text, log_file);
+        }
+    } else {
+        log_to_flash(text);
+    }
+}
+
+// Format one line stamped with wall-clock time, back-dated from now by
+// the message's age
+static void write_message(LogLevel level, const char* file, int line, uint32_t timestamp_us,
+                          time_t now, uint32_t now_us, const char* text) {
+    time_t when = now - (time_t)((now_us - timestamp_us) / 1000000u);
+    if (when != timestamp_time) {
+        struct tm* timeinfo = localtime(&when);
+        strftime(timestamp, sizeof(timestamp), LOG_TIMESTAMP_FORMAT, timeinfo);
+        timestamp_time = when;
+    }
+
+    snprintf(line_buffer, sizeof(line_buffer), "[%s] [%s] %s:%d - %s\n",
+             timestamp,
+             level_to_string(level),
+             file,
+             line,
+             text);
+    write_line(line_buffer);
+}
+
+uint32_t logger_drain(void) {
+    time_t now;
+    time(&now);
+    uint32_t now_us = timing_micros();
+
+    // Merge the per-core rings oldest first
+    uint32_t drained = 0;
+    for (;;) {
+        const logger_message_t* oldest = NULL;
+        uint32_t oldest_core = 0;
+        for (uint32_t core = 0; core < LOGGER_CORES; core++) {
+            const logger_message_t* message = rings[core].peek();
+            if (message != NULL &&
+                (oldest == NULL || (int32_t)(message->timestamp_us - oldest->timestamp_us) < 0)) {
+                oldest = message;
+                oldest_core = core;
+            }
+        }
+        if (oldest == NULL) {
+            break;
+        }
+
+        write_message((LogLevel)oldest->level, oldest->file, oldest->line, oldest->timestamp_us,
+                      now, now_us, oldest->text);
+        rings[oldest_core].release();
+        drained++;
+    }
+
+    bool wrote = drained > 0;
+    uint32_t total_dropped = logger_get_dropped();
+    if (total_dropped != dropped_reported) {
+        char text[48];
+        snprintf(text, sizeof(text), "%lu messages dropped, ring full",
+                 (unsigned long)(total_dropped - dropped_reported));
+        write_message(LOG_WARN, __FILE__, __LINE__, now_us, now, now_us, text);
+        dropped_reported = total_dropped;
+        wrote = true;
+    }
+
+    if (wrote && current_log_destination == LOG_TO_FILE && log_file != NULL) {
         fflush(log_file);
-    } else if (current_log_destination == LOG_TO_FLASH || current_log_destination == LOG_TO_EXTERNAL_STORAGE) {
-        // Log to flash memory or external storage
-        // This is a placeholder for actual implementation
+    } else if (current_log_destination == LOG_TO_FLASH) {
+        log_store_sync(LOG_STORE_STREAM_TEXT);
     }
+    return drained;
 }
 
-void log_to_flash(const char* message) {
-    // Placeholder function to log data to flash memory
-    // Implement actual flash memory logging here
+uint32_t logger_get_dropped(void) {
+    uint32_t total = 0;
+    for (uint32_t core = 0; core < LOGGER_CORES; core++) {
+        total += __atomic_load_n(&dropped[core], __ATOMIC_RELAXED);
+    }
+    return total;
 }
 
-void log_to_external_storage(const char* message) {
-    // Placeholder function to log data to external storage
-    // Implement actual external storage logging here
+void log_to_flash(const char* message) {
+    log_store_append(LOG_STORE_STREAM_TEXT, message, (uint32_t)strlen(message));
 }
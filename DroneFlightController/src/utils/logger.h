@@ -1,6 +1,30 @@
 #ifndef logger_h
 #define logger_h
 
+#include <stdint.h>
+
+// logger_log may be called from any task, interrupt or core. It formats
+// the message with the reentrant log_vformat straight into a slot of a
+// lock-free ring for the calling core and returns; it never blocks and
+// never touches the output. When the ring is full the message is counted
+// as dropped. The log task owns the output and writes queued messages out
+// with logger_drain().
+
+// Longest formatted message, including the terminator; longer ones are
+// truncated
+#define MAX_LOG_LENGTH 120
+
+// Messages buffered per core between drains, a power of two; covers the
+// boot messages logged before the scheduler starts the log task
+#define LOGGER_RING_SLOTS 32
+
+// Cores with their own ring, indexed by the calling core's number
+#define LOGGER_CORES 2
+
+// Stack a logger_log call takes from the calling task: log_vformat
+// formats into the ring slot, not a stack buffer
+#define LOGGER_STACK_BYTES 512
+
 // Log levels
 typedef enum {
     LOG_DEBUG,
@@ -9,29 +33,157 @@ typedef enum {
     LOG_ERROR
 } LogLevel;
 
+// Above every level: as a build or runtime level it turns logging off
+#define LOG_LEVEL_NONE 4
+
+// Modules a call site logs under. A source file picks its module by
+// defining LOG_MODULE before its first #include; files that do not
+// log under LOG_MODULE_SYSTEM.
+typedef enum {
+    LOG_MODULE_SYSTEM = 0,    // Startup, RTOS, logging and storage
+    LOG_MODULE_SENSORS,       // IMU, calibration and sensor fusion
+    LOG_MODULE_CONTROL,       // Flight pipeline and controllers
+    LOG_MODULE_FAILSAFE,      // Failsafe and battery supervision
+    LOG_MODULE_COMMS,         // Links and remote control
+    LOG_MODULE_COUNT
+} LogModule;
+
+// One queued message
+typedef struct {
+    const char* file;
+    uint32_t timestamp_us;
+    uint16_t line;
+    uint8_t level;
+    char text[MAX_LOG_LENGTH];
+} logger_message_t;
+
+// Longest line written out: timestamp, level, file:line and the message
+#define LOG_LINE_LENGTH (MAX_LOG_LENGTH + 96)
+#define LOG_TIMESTAMP_LENGTH 32
+
+// Static RAM of the rings and the drain's line buffers, for the RAM budget
+#define LOGGER_RAM_BYTES \
+    (LOGGER_CORES * LOGGER_RING_SLOTS * (sizeof(uint32_t) + sizeof(logger_message_t)) + \
+     LOG_LINE_LENGTH + LOG_TIMESTAMP_LENGTH)
+
 // Log destinations
 typedef enum {
     LOG_TO_FILE,
-    LOG_TO_FLASH,
-    LOG_TO_EXTERNAL_STORAGE
+    LOG_TO_FLASH
 } LogDestination;
 
+// Where main() sends the text log, the trace log and the blackbox. The
+// default is stdio files, which need a filesystem behind the C library
+// such as semihosting or a retargeted SD card driver; without one the
+// text log goes to the stdio console and the trace log and blackbox are
+// reported unavailable. The on-chip log store (FC_LOG_TO_FLASH) only
+// programs flash while disarmed, so in flight it keeps no more than
+// LOG_STORE_PAGE_QUEUE pages and drops the rest.
+#ifndef FC_LOG_TO_FLASH
+#define FC_LOG_TO_FLASH 0
+#endif
+#define FC_LOG_DESTINATION (FC_LOG_TO_FLASH ? LOG_TO_FLASH : LOG_TO_FILE)
+
 // Initialize logger with destination, minimum log level, and log destination
-void logger_init(const char* destination, LogLevel level, LogDestination log_dest);
+// Returns false if the log file could not be opened; the text log then
+// goes to stdout, the stdio console.
+bool logger_init(const char* destination, LogLevel level, LogDestination log_dest);
 
-// Close logger and free resources
+// Write out queued messages, close logger and free resources
 void logger_close(void);
 
 // Set minimum log level
 void logger_set_level(LogLevel level);
 
+// Set the minimum level a module's LOG_MSG and LOG_TEXT calls pass on,
+// on top of the build level; LOG_LEVEL_NONE silences the module
+void logger_set_module_level(LogModule module, LogLevel level);
+
+// Runtime module levels, read inline by the macros below
+extern volatile uint8_t logger_module_levels[LOG_MODULE_COUNT];
+
 // Log a message with specified level, source file, line number and format string
 void logger_log(LogLevel level, const char* file, int line, const char* format, ...);
 
-// Log data to flash memory
+// Write out every queued message; log task only
+// Returns the number of messages written.
+uint32_t logger_drain(void);
+
+// Messages lost to a full ring since boot
+uint32_t logger_get_dropped(void);
+
+// Log data to the text stream of the flash log store; log task only
 void log_to_flash(const char* message);
 
-// Log data to external storage
-void log_to_external_storage(const char* message);
+// Build levels: calls below them compile to nothing, arguments and
+// file name included. 0 debug, 1 info, 2 warn, 3 error, 4 none.
+// FC_LOG_LEVEL sets every module; FC_LOG_LEVEL_<MODULE> overrides one.
+#ifndef FC_LOG_LEVEL
+#define FC_LOG_LEVEL 1
+#endif
+#ifndef FC_LOG_LEVEL_SYSTEM
+#define FC_LOG_LEVEL_SYSTEM FC_LOG_LEVEL
+#endif
+#ifndef FC_LOG_LEVEL_SENSORS
+#define FC_LOG_LEVEL_SENSORS FC_LOG_LEVEL
+#endif
+#ifndef FC_LOG_LEVEL_CONTROL
+#define FC_LOG_LEVEL_CONTROL FC_LOG_LEVEL
+#endif
+#ifndef FC_LOG_LEVEL_FAILSAFE
+#define FC_LOG_LEVEL_FAILSAFE FC_LOG_LEVEL
+#endif
+#ifndef FC_LOG_LEVEL_COMMS
+#define FC_LOG_LEVEL_COMMS FC_LOG_LEVEL
+#endif
+
+#ifndef LOG_MODULE
+#define LOG_MODULE LOG_MODULE_SYSTEM
+#endif
+
+#define LOG_BUILD_LEVEL(module) \
+    ((module) == LOG_MODULE_SENSORS  ? FC_LOG_LEVEL_SENSORS : \
+     (module) == LOG_MODULE_CONTROL  ? FC_LOG_LEVEL_CONTROL : \
+     (module) == LOG_MODULE_FAILSAFE ? FC_LOG_LEVEL_FAILSAFE : \
+     (module) == LOG_MODULE_COMMS    ? FC_LOG_LEVEL_COMMS : FC_LOG_LEVEL_SYSTEM)
+
+// Whether a call at level in this file's module is logged. The build
+// check is a constant, so a call below it is removed before any of its
+// arguments are evaluated; the runtime check is one byte load.
+#define LOG_ENABLED(level) \
+    ((int)(level) >= LOG_BUILD_LEVEL(LOG_MODULE) && \
+     (int)(level) >= (int)logger_module_levels[LOG_MODULE])
+
+// File name the macros record: the base name where the compiler has
+// __FILE_NAME__, which keeps build paths out of the flash image
+#ifdef __FILE_NAME__
+#define LOG_FILE __FILE_NAME__
+#else
+#define LOG_FILE __FILE__
+#endif
+
+// Log from a call site through the text logger, formatted on the device
+#define LOG_TEXT(level, ...) do { \
+    if (LOG_ENABLED(level)) { \
+        logger_log((level), LOG_FILE, __LINE__, __VA_ARGS__); \
+    } \
+} while (0)
+
+// Log from a call site. With FC_LOG_DEFERRED the message is queued
+// unformatted for tools/trace_decode, otherwise formatted and written now.
+#ifndef FC_LOG_DEFERRED
+#define FC_LOG_DEFERRED 1
+#endif
+
+#if FC_LOG_DEFERRED
+#include "utils/trace.h"
+#define LOG_MSG(level, ...) do { \
+    if (LOG_ENABLED(level)) { \
+        TRACE_LOG((level), __VA_ARGS__); \
+    } \
+} while (0)
+#else
+#define LOG_MSG(level, ...)  LOG_TEXT(level, __VA_ARGS__)
+#endif
 
 #endif /* logger_h */
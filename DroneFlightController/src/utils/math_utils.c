@@ -7,6 +7,8 @@
 
 #include "math_utils.h"
 #include <math.h>
+#include <string.h>
+#include <stdint.h>
 
 // Constrain a value between min and max
 float constrain(float value, float min, float max) {
@@ -62,3 +64,60 @@ float apply_deadband(float value, float deadband) {
     }
     return value;
 }
+
+// Wrap an angle in radians to [-pi, pi]
+float wrap_pi(float radians) {
+    const float two_pi = 2.0f * (float)M_PI;
+    return radians - two_pi * floorf((radians + (float)M_PI) / two_pi);
+}
+
+// Approximate 1/sqrt(x) with a bit-level initial guess and one Newton step
+// The constants minimize the maximum relative error rather than using the
+// classic 0x5f3759df / 1.5 / 0.5 set.
+float fast_inv_sqrt(float x) {
+    uint32_t bits;
+    float y;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5f1ffff9u - (bits >> 1);
+    memcpy(&y, &bits, sizeof(y));
+    return y * (0.703952253f * (2.38924456f - x * y * y));
+}
+
+// Constrain a Q16 value between min and max
+q16_t constrain_q16(q16_t value, q16_t min, q16_t max) {
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+// Map a Q16 value from one range to another
+q16_t map_q16(q16_t value, q16_t in_min, q16_t in_max, q16_t out_min, q16_t out_max) {
+    int64_t span_in = (int64_t)in_max - in_min;
+    if (span_in == 0) {
+        return out_min;
+    }
+    // Full precision, but the 64-bit divide is a library call on the M0+
+    int64_t scaled = ((int64_t)value - in_min) * ((int64_t)out_max - out_min) / span_in;
+    return fx_saturate(scaled + out_min);
+}
+
+// Map a Q16 value in [0, 1] onto [out_min, out_max]
+q16_t map_unit_q16(q16_t value, q16_t out_min, q16_t out_max) {
+    // The input span is Q16_ONE, a power of two, so the divide is a shift
+    int64_t scaled = ((int64_t)value * ((int64_t)out_max - out_min)) >> Q16_FRAC_BITS;
+    return fx_saturate(scaled + out_min);
+}
+
+// Low-pass filter on Q16 samples with a Q31 smoothing factor
+q16_t low_pass_filter_q16(q16_t input, q16_t prev_output, q31_t alpha) {
+    // prev + alpha * (input - prev) needs one multiply instead of two
+    return q16_add(prev_output, q16_mul_q31(q16_sub(input, prev_output), alpha));
+}
+
+// Deadband function on Q16 values
+q16_t apply_deadband_q16(q16_t value, q16_t deadband) {
+    if (q16_abs(value) < deadband) {
+        return 0;
+    }
+    return value;
+}
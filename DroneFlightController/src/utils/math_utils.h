@@ -8,6 +8,8 @@
 #ifndef math_utils_h
 #define math_utils_h
 
+#include "fixed_point.h"
+
 // Constrain a value between min and max
 float constrain(float value, float min, float max);
 
@@ -32,4 +34,28 @@ float low_pass_filter(float input, float prev_output, float alpha);
 // Deadband function to ignore small values
 float apply_deadband(float value, float deadband);
 
+// Wrap an angle in radians to [-pi, pi]
+float wrap_pi(float radians);
+
+// Approximate 1/sqrt(x) for x > 0 without a divide or sqrt (relative error < 0.1%)
+float fast_inv_sqrt(float x);
+
+// Fixed-point counterparts used when FC_USE_FIXED_POINT is enabled
+
+// Constrain a Q16 value between min and max
+q16_t constrain_q16(q16_t value, q16_t min, q16_t max);
+
+// Map a Q16 value from one range to another; divides by the input span
+q16_t map_q16(q16_t value, q16_t in_min, q16_t in_max, q16_t out_min, q16_t out_max);
+
+// Map a Q16 value in [0, 1] onto [out_min, out_max] with a multiply and a
+// shift, no divide; for motor outputs and other unit ranges
+q16_t map_unit_q16(q16_t value, q16_t out_min, q16_t out_max);
+
+// Low-pass filter on Q16 samples with a Q31 smoothing factor
+q16_t low_pass_filter_q16(q16_t input, q16_t prev_output, q31_t alpha);
+
+// Deadband function on Q16 values
+q16_t apply_deadband_q16(q16_t value, q16_t deadband);
+
 #endif /* math_utils_h */
@@ -0,0 +1,302 @@
+//
+//  matrix.h
+//  DroneFlightController
+//
+//  Header-only fixed-dimension matrix library for the estimators.
+//  Dimensions are template parameters, storage is inline (no heap) and
+//  row-major, and every loop has compile-time bounds so the compiler can
+//  fully unroll or vectorize it. Covariances use packed symmetric storage.
+//  Multiply-accumulate counts are noted per kernel so the cost of a filter
+//  built on top can be predicted from its dimensions.
+//
+
+#ifndef matrix_h
+#define matrix_h
+
+#ifndef __cplusplus
+#error "matrix.h is C++ only"
+#endif
+
+#include <math.h>
+
+template <int R, int C>
+struct Matrix {
+    float data[R][C];
+
+    float &operator()(int r, int c) { return data[r][c]; }
+    const float &operator()(int r, int c) const { return data[r][c]; }
+
+    static Matrix zeros() {
+        Matrix out;
+        for (int r = 0; r < R; r++) {
+            for (int c = 0; c < C; c++) {
+                out.data[r][c] = 0.0f;
+            }
+        }
+        return out;
+    }
+
+    static Matrix identity() {
+        Matrix out = zeros();
+        for (int i = 0; i < R && i < C; i++) {
+            out.data[i][i] = 1.0f;
+        }
+        return out;
+    }
+};
+
+// Column vector
+template <int N>
+struct Vector : Matrix<N, 1> {
+    Vector() {}
+    Vector(const Matrix<N, 1> &m) : Matrix<N, 1>(m) {}
+
+    float &operator[](int i) { return this->data[i][0]; }
+    const float &operator[](int i) const { return this->data[i][0]; }
+};
+
+// Symmetric N x N matrix, upper triangle packed row by row
+template <int N>
+struct SymMatrix {
+    static const int SIZE = N * (N + 1) / 2;
+    float data[SIZE];
+
+    static int index(int r, int c) {
+        if (r > c) {
+            int t = r;
+            r = c;
+            c = t;
+        }
+        return r * N - (r * (r - 1)) / 2 + (c - r);
+    }
+
+    float &operator()(int r, int c) { return data[index(r, c)]; }
+    const float &operator()(int r, int c) const { return data[index(r, c)]; }
+
+    static SymMatrix zeros() {
+        SymMatrix out;
+        for (int i = 0; i < SIZE; i++) {
+            out.data[i] = 0.0f;
+        }
+        return out;
+    }
+
+    static SymMatrix diagonal(float value) {
+        SymMatrix out = zeros();
+        for (int i = 0; i < N; i++) {
+            out(i, i) = value;
+        }
+        return out;
+    }
+
+    // Full row-major copy for the kernels, whose inner loops would
+    // otherwise recompute the packed index on every access; N*N copies
+    void unpack(float (&out)[N][N]) const {
+        int i = 0;
+        for (int r = 0; r < N; r++) {
+            for (int c = r; c < N; c++) {
+                out[r][c] = data[i];
+                out[c][r] = data[i];
+                i++;
+            }
+        }
+    }
+};
+
+/* General matrices */
+
+template <int R, int C>
+Matrix<R, C> operator+(const Matrix<R, C> &a, const Matrix<R, C> &b) {
+    Matrix<R, C> out;
+    for (int r = 0; r < R; r++) {
+        for (int c = 0; c < C; c++) {
+            out.data[r][c] = a.data[r][c] + b.data[r][c];
+        }
+    }
+    return out;
+}
+
+template <int R, int C>
+Matrix<R, C> operator-(const Matrix<R, C> &a, const Matrix<R, C> &b) {
+    Matrix<R, C> out;
+    for (int r = 0; r < R; r++) {
+        for (int c = 0; c < C; c++) {
+            out.data[r][c] = a.data[r][c] - b.data[r][c];
+        }
+    }
+    return out;
+}
+
+template <int R, int C>
+Matrix<R, C> operator*(const Matrix<R, C> &a, float s) {
+    Matrix<R, C> out;
+    for (int r = 0; r < R; r++) {
+        for (int c = 0; c < C; c++) {
+            out.data[r][c] = a.data[r][c] * s;
+        }
+    }
+    return out;
+}
+
+// A * B, R*K*C MACs
+template <int R, int K, int C>
+Matrix<R, C> operator*(const Matrix<R, K> &a, const Matrix<K, C> &b) {
+    Matrix<R, C> out = Matrix<R, C>::zeros();
+    for (int r = 0; r < R; r++) {
+        for (int k = 0; k < K; k++) {
+            const float a_rk = a.data[r][k];
+            for (int c = 0; c < C; c++) {
+                out.data[r][c] += a_rk * b.data[k][c];
+            }
+        }
+    }
+    return out;
+}
+
+// A * B^T without forming the transpose, R*K*C MACs
+template <int R, int K, int C>
+Matrix<R, C> multiply_transposed(const Matrix<R, K> &a, const Matrix<C, K> &b) {
+    Matrix<R, C> out;
+    for (int r = 0; r < R; r++) {
+        for (int c = 0; c < C; c++) {
+            float sum = 0.0f;
+            for (int k = 0; k < K; k++) {
+                sum += a.data[r][k] * b.data[c][k];
+            }
+            out.data[r][c] = sum;
+        }
+    }
+    return out;
+}
+
+template <int R, int C>
+Matrix<C, R> transpose(const Matrix<R, C> &a) {
+    Matrix<C, R> out;
+    for (int r = 0; r < R; r++) {
+        for (int c = 0; c < C; c++) {
+            out.data[c][r] = a.data[r][c];
+        }
+    }
+    return out;
+}
+
+/* Symmetric matrices */
+
+template <int N>
+SymMatrix<N> operator+(const SymMatrix<N> &a, const SymMatrix<N> &b) {
+    SymMatrix<N> out;
+    for (int i = 0; i < SymMatrix<N>::SIZE; i++) {
+        out.data[i] = a.data[i] + b.data[i];
+    }
+    return out;
+}
+
+template <int N>
+SymMatrix<N> operator-(const SymMatrix<N> &a, const SymMatrix<N> &b) {
+    SymMatrix<N> out;
+    for (int i = 0; i < SymMatrix<N>::SIZE; i++) {
+        out.data[i] = a.data[i] - b.data[i];
+    }
+    return out;
+}
+
+// P * B for symmetric P, N*N*C MACs
+template <int N, int C>
+Matrix<N, C> operator*(const SymMatrix<N> &p, const Matrix<N, C> &b) {
+    float full[N][N];
+    p.unpack(full);
+    Matrix<N, C> out = Matrix<N, C>::zeros();
+    for (int r = 0; r < N; r++) {
+        for (int k = 0; k < N; k++) {
+            const float p_rk = full[r][k];
+            for (int c = 0; c < C; c++) {
+                out.data[r][c] += p_rk * b.data[k][c];
+            }
+        }
+    }
+    return out;
+}
+
+// B * P for symmetric P, R*N*N MACs
+template <int R, int N>
+Matrix<R, N> operator*(const Matrix<R, N> &b, const SymMatrix<N> &p) {
+    float full[N][N];
+    p.unpack(full);
+    Matrix<R, N> out = Matrix<R, N>::zeros();
+    for (int r = 0; r < R; r++) {
+        for (int k = 0; k < N; k++) {
+            const float b_rk = b.data[r][k];
+            for (int c = 0; c < N; c++) {
+                out.data[r][c] += b_rk * full[k][c];
+            }
+        }
+    }
+    return out;
+}
+
+// F * P * F^T, only the upper triangle of the result is computed
+// M*N*N + N*M*(M+1)/2 MACs
+template <int M, int N>
+SymMatrix<M> quadratic_form(const Matrix<M, N> &f, const SymMatrix<N> &p) {
+    const Matrix<M, N> fp = f * p;
+    SymMatrix<M> out;
+    int i = 0;
+    for (int r = 0; r < M; r++) {
+        for (int c = r; c < M; c++) {
+            float sum = 0.0f;
+            for (int k = 0; k < N; k++) {
+                sum += fp.data[r][k] * f.data[c][k];
+            }
+            out.data[i++] = sum;
+        }
+    }
+    return out;
+}
+
+// Solve S * X = B for symmetric positive definite S by Cholesky
+// decomposition. Returns false if S is not positive definite.
+// About N^3/6 + N*N*C MACs and N square roots.
+template <int N, int C>
+bool cholesky_solve(const SymMatrix<N> &s, const Matrix<N, C> &b, Matrix<N, C> &x) {
+    // S = L * L^T, L stored row-major in the lower triangle
+    float l[N][N];
+    float inv_diag[N];
+    for (int r = 0; r < N; r++) {
+        for (int c = 0; c <= r; c++) {
+            float sum = s(r, c);
+            for (int k = 0; k < c; k++) {
+                sum -= l[r][k] * l[c][k];
+            }
+            if (r == c) {
+                if (sum <= 0.0f) {
+                    return false;
+                }
+                l[r][r] = sqrtf(sum);
+                inv_diag[r] = 1.0f / l[r][r];
+            } else {
+                l[r][c] = sum * inv_diag[c];
+            }
+        }
+    }
+
+    // Forward substitution L * Y = B, then back substitution L^T * X = Y
+    for (int col = 0; col < C; col++) {
+        for (int r = 0; r < N; r++) {
+            float sum = b.data[r][col];
+            for (int k = 0; k < r; k++) {
+                sum -= l[r][k] * x.data[k][col];
+            }
+            x.data[r][col] = sum * inv_diag[r];
+        }
+        for (int r = N - 1; r >= 0; r--) {
+            float sum = x.data[r][col];
+            for (int k = r + 1; k < N; k++) {
+                sum -= l[k][r] * x.data[k][col];
+            }
+            x.data[r][col] = sum * inv_diag[r];
+        }
+    }
+    return true;
+}
+
+#endif /* matrix_h */
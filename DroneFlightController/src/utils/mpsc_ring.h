@@ -0,0 +1,104 @@
+//
+//  mpsc_ring.h
+//  DroneFlightController
+//
+//  Header-only multi-producer single-consumer ring of fixed-size slots.
+//  A producer claims a slot with one compare-and-swap on the head, fills
+//  it in place and commits it; every slot carries a sequence number that
+//  tells the consumer when it is committed and the producers when it is
+//  free again. Producers never block: a full ring makes claim() fail.
+//  Usable from any task, interrupt or core. The Cortex-M0+ has no
+//  exclusive access instructions, so there the SDK implements the atomic
+//  operations with interrupts masked and a hardware spinlock held for a
+//  few cycles.
+//
+//  The consumer takes slots in claim order, so a producer preempted
+//  between claim and commit holds back the slots claimed after it until
+//  it resumes; nothing is lost unless the ring fills meanwhile.
+//
+
+#ifndef mpsc_ring_h
+#define mpsc_ring_h
+
+#ifndef __cplusplus
+#error "mpsc_ring.h is C++ only"
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+template <typename T, uint32_t N>
+class MpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscRing capacity must be a power of two");
+
+public:
+    static const uint32_t CAPACITY = N;
+
+    MpscRing() : head(0), tail(0) {
+        for (uint32_t i = 0; i < N; i++) {
+            slots[i].sequence = i;
+        }
+    }
+
+    // Producer side
+    // Reserve the next slot for the caller; returns NULL without blocking
+    // if the ring is full. ticket identifies the slot to commit().
+    T *claim(uint32_t &ticket) {
+        uint32_t pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        for (;;) {
+            Slot &slot = slots[pos & MASK];
+            uint32_t sequence = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+            int32_t lag = (int32_t)(sequence - pos);
+            if (lag == 0) {
+                // Free for this lap; a failed exchange reloads pos
+                if (__atomic_compare_exchange_n(&head, &pos, pos + 1, true,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    ticket = pos;
+                    return &slot.item;
+                }
+            } else if (lag < 0) {
+                // The consumer has not released this slot from the last lap
+                return NULL;
+            } else {
+                // Another producer took it first
+                pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    // Publish a claimed slot to the consumer
+    void commit(uint32_t ticket) {
+        __atomic_store_n(&slots[ticket & MASK].sequence, ticket + 1, __ATOMIC_RELEASE);
+    }
+
+    // Consumer side
+    // Oldest committed slot, or NULL if the next one in order is not
+    // committed yet. The slot stays valid until release().
+    const T *peek() {
+        Slot &slot = slots[tail & MASK];
+        if (__atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE) != tail + 1) {
+            return NULL;
+        }
+        return &slot.item;
+    }
+
+    // Hand the slot returned by peek() back to the producers
+    void release() {
+        __atomic_store_n(&slots[tail & MASK].sequence, tail + N, __ATOMIC_RELEASE);
+        tail++;
+    }
+
+private:
+    static const uint32_t MASK = N - 1;
+
+    struct Slot {
+        uint32_t sequence;   // Position + 1 once committed, position + N once free
+        T item;
+    };
+
+    uint32_t head;   // Next position to claim, all producers
+    uint32_t tail;   // Next position to consume, consumer only
+    Slot slots[N];
+};
+
+#endif /* mpsc_ring_h */
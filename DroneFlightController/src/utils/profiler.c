@@ -0,0 +1,145 @@
+//
+//  profiler.c
+//  DroneFlightController
+//
+
+#include "profiler.h"
+
+#if FC_PROFILER_ENABLED
+
+#include "utils/seqlock.h"
+#include "utils/logger.h"
+
+// Each probe is written only by the task or interrupt it measures and read
+// by others through its seqlock
+typedef struct {
+    const char *name;
+    uint32_t period_us;
+    TaskHandle_t task;
+
+    seqlock_t lock;
+    volatile bool reset_pending;
+    uint32_t window_start_us;
+    uint32_t last_start_us;
+    uint32_t last_end_us;
+    uint32_t count;
+    uint32_t exec_min_us;
+    uint32_t exec_max_us;
+    uint64_t exec_total_us;
+    uint32_t period_min_us;
+    uint32_t period_max_us;
+    uint32_t deadline_misses;
+} probe_state_t;
+
+static probe_state_t probes[PROFILER_PROBE_COUNT];
+static_assert(sizeof(probe_state_t) <= PROFILER_PROBE_BYTES, "Raise PROFILER_PROBE_BYTES");
+
+// Copies overlapping an update before a reader gives up
+static const int STATS_READ_ATTEMPTS = 4;
+
+void profiler_init_probe(profiler_probe_t probe, const char *name, uint32_t period_us) {
+    probe_state_t *p = &probes[probe];
+    p->name = name;
+    p->period_us = period_us;
+    p->reset_pending = true;
+}
+
+void profiler_set_task(profiler_probe_t probe, TaskHandle_t task) {
+    probes[probe].task = task;
+}
+
+void profiler_end(profiler_probe_t probe, uint32_t start_us) {
+    uint32_t end_us = timing_micros();
+    uint32_t exec_us = end_us - start_us;
+    probe_state_t *p = &probes[probe];
+
+    seqlock_write_begin(&p->lock);
+    if (p->reset_pending) {
+        p->reset_pending = false;
+        p->count = 0;
+        p->exec_total_us = 0;
+        p->deadline_misses = 0;
+        p->period_min_us = UINT32_MAX;
+        p->period_max_us = 0;
+        p->window_start_us = start_us;
+    }
+
+    if (p->count > 0) {
+        uint32_t period_us = start_us - p->last_start_us;
+        if (period_us < p->period_min_us) p->period_min_us = period_us;
+        if (period_us > p->period_max_us) p->period_max_us = period_us;
+    }
+    if (p->count == 0 || exec_us < p->exec_min_us) p->exec_min_us = exec_us;
+    if (p->count == 0 || exec_us > p->exec_max_us) p->exec_max_us = exec_us;
+    if (p->period_us > 0 && exec_us > p->period_us) {
+        p->deadline_misses++;
+    }
+
+    p->exec_total_us += exec_us;
+    p->last_start_us = start_us;
+    p->last_end_us = end_us;
+    p->count++;
+    seqlock_write_end(&p->lock);
+}
+
+bool profiler_get_stats(profiler_probe_t probe, profiler_stats_t *stats) {
+    probe_state_t *p = &probes[probe];
+
+    for (int attempt = 0; attempt < STATS_READ_ATTEMPTS; attempt++) {
+        uint32_t sequence = seqlock_read_begin(&p->lock);
+        uint32_t count = p->count;
+        uint32_t exec_min_us = p->exec_min_us;
+        uint32_t exec_max_us = p->exec_max_us;
+        uint64_t exec_total_us = p->exec_total_us;
+        uint32_t period_min_us = p->period_min_us;
+        uint32_t period_max_us = p->period_max_us;
+        uint32_t deadline_misses = p->deadline_misses;
+        uint32_t window_us = p->last_end_us - p->window_start_us;
+        if (seqlock_read_retry(&p->lock, sequence)) {
+            continue;
+        }
+
+        bool has_period = count > 1;
+        stats->count = count;
+        stats->exec_min_us = count > 0 ? exec_min_us : 0;
+        stats->exec_max_us = count > 0 ? exec_max_us : 0;
+        stats->exec_mean_us = count > 0 ? (uint32_t)(exec_total_us / count) : 0;
+        stats->period_min_us = has_period ? period_min_us : 0;
+        stats->period_max_us = has_period ? period_max_us : 0;
+        stats->deadline_misses = deadline_misses;
+        stats->load_permille = window_us > 0 ? (uint32_t)(exec_total_us * 1000 / window_us) : 0;
+
+        // Scans the stack, so only on request and outside the copy
+        stats->stack_free_words = p->task ? (uint32_t)uxTaskGetStackHighWaterMark(p->task) : 0;
+        return true;
+    }
+    return false;
+}
+
+void profiler_reset(void) {
+    // Applied by each probe's owner on its next execution
+    for (int i = 0; i < PROFILER_PROBE_COUNT; i++) {
+        probes[i].reset_pending = true;
+    }
+}
+
+void profiler_report(void) {
+    LOG_MSG(LOG_INFO,
+            "Probe            count  exec min/mean/max us  period min/max us  misses  load  stack");
+    for (int i = 0; i < PROFILER_PROBE_COUNT; i++) {
+        profiler_stats_t s;
+        if (probes[i].name == NULL || !profiler_get_stats((profiler_probe_t)i, &s)) {
+            continue;
+        }
+        LOG_MSG(LOG_INFO,
+                "%-14s %7lu  %5lu/%5lu/%5lu       %6lu/%6lu      %6lu  %3lu.%lu%%  %5lu",
+                probes[i].name, (unsigned long)s.count,
+                (unsigned long)s.exec_min_us, (unsigned long)s.exec_mean_us, (unsigned long)s.exec_max_us,
+                (unsigned long)s.period_min_us, (unsigned long)s.period_max_us,
+                (unsigned long)s.deadline_misses,
+                (unsigned long)(s.load_permille / 10), (unsigned long)(s.load_permille % 10),
+                (unsigned long)s.stack_free_words);
+    }
+}
+
+#endif /* FC_PROFILER_ENABLED */
@@ -0,0 +1,94 @@
+//
+//  profiler.h
+//  DroneFlightController
+//
+//  Execution time, period jitter, deadline misses and CPU load per task
+//  and interrupt, from the microsecond timer (the Cortex-M0+ has no cycle
+//  counter). A probe pair costs two timer reads and a handful of integer
+//  updates. With FC_PROFILER_ENABLED set to 0 the probes expand to nothing
+//  and the module is not compiled.
+//
+
+#ifndef profiler_h
+#define profiler_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef FC_PROFILER_ENABLED
+#define FC_PROFILER_ENABLED 1
+#endif
+
+// Instrumented tasks and interrupts
+typedef enum {
+    PROFILER_PROBE_CONTROL = 0,    // Flight pipeline, task or core 1 loop
+    PROFILER_PROBE_SENSOR,         // Barometer and GPS task
+    PROFILER_PROBE_FAILSAFE,       // Failsafe supervision task
+    PROFILER_PROBE_COMMUNICATION,  // Link supervision task
+    PROFILER_PROBE_IMU_ISR,        // IMU data-ready interrupt
+    PROFILER_PROBE_COUNT
+} profiler_probe_t;
+
+// Static RAM of the probes, for the RAM budget; each probe's state is
+// checked against PROFILER_PROBE_BYTES
+#define PROFILER_PROBE_BYTES 80
+#if FC_PROFILER_ENABLED
+#define PROFILER_RAM_BYTES (PROFILER_PROBE_COUNT * PROFILER_PROBE_BYTES)
+#else
+#define PROFILER_RAM_BYTES 0
+#endif
+
+typedef struct {
+    uint32_t count;             // Completed executions
+    uint32_t exec_min_us;
+    uint32_t exec_max_us;
+    uint32_t exec_mean_us;
+    uint32_t period_min_us;     // Start-to-start intervals
+    uint32_t period_max_us;
+    uint32_t deadline_misses;   // Executions longer than the period
+    uint32_t load_permille;     // Share of time spent executing since reset
+    uint32_t stack_free_words;  // Stack high-water mark, 0 if not a task
+} profiler_stats_t;
+
+#if FC_PROFILER_ENABLED
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "utils/timing.h"
+
+// Set the expected period (0 if aperiodic) and clear the statistics
+void profiler_init_probe(profiler_probe_t probe, const char *name, uint32_t period_us);
+
+// Task whose stack high-water mark is reported with the probe
+void profiler_set_task(profiler_probe_t probe, TaskHandle_t task);
+
+// Account one execution that started at start_us and ends now
+void profiler_end(profiler_probe_t probe, uint32_t start_us);
+
+// Consistent copy of one probe's statistics, for telemetry
+bool profiler_get_stats(profiler_probe_t probe, profiler_stats_t *stats);
+
+// Clear every probe's statistics, keeping names and periods
+void profiler_reset(void);
+
+// Log a table of every probe
+void profiler_report(void);
+
+// Probe pair around one execution, in the same scope
+#define PROFILER_BEGIN(probe)  uint32_t profiler_start_##probe = timing_micros()
+#define PROFILER_END(probe)    profiler_end(probe, profiler_start_##probe)
+
+#else
+
+#define profiler_init_probe(probe, name, period_us)  ((void)0)
+#define profiler_set_task(probe, task)               ((void)0)
+#define profiler_get_stats(probe, stats)             (false)
+#define profiler_reset()                             ((void)0)
+#define profiler_report()                            ((void)0)
+
+#define PROFILER_BEGIN(probe)
+#define PROFILER_END(probe)
+
+#endif /* FC_PROFILER_ENABLED */
+
+#endif /* profiler_h */
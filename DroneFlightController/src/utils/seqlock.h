@@ -0,0 +1,51 @@
+//
+//  seqlock.h
+//  DroneFlightController
+//
+//  Sequence lock for single-writer multi-reader publication. The writer
+//  never waits: it makes the sequence odd, updates the data and makes it
+//  even again. Readers copy the data and retry if the sequence was odd or
+//  changed during the copy. Works between tasks, interrupts and cores as
+//  long as a reader never preempts the writer it is waiting for.
+//
+
+#ifndef seqlock_h
+#define seqlock_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/sync.h"
+
+typedef struct {
+    volatile uint32_t sequence;   // Odd while a write is in progress
+} seqlock_t;
+
+static inline void seqlock_init(seqlock_t *lock) {
+    lock->sequence = 0;
+}
+
+// Writer side, around the update of the protected data
+static inline void seqlock_write_begin(seqlock_t *lock) {
+    lock->sequence = lock->sequence + 1;
+    __dmb();
+}
+
+static inline void seqlock_write_end(seqlock_t *lock) {
+    __dmb();
+    lock->sequence = lock->sequence + 1;
+}
+
+// Reader side, before copying the protected data
+static inline uint32_t seqlock_read_begin(const seqlock_t *lock) {
+    uint32_t sequence = lock->sequence;
+    __dmb();
+    return sequence;
+}
+
+// After copying: true if the copy may be torn and must be retried
+static inline bool seqlock_read_retry(const seqlock_t *lock, uint32_t start) {
+    __dmb();
+    return (start & 1u) != 0 || lock->sequence != start;
+}
+
+#endif /* seqlock_h */
@@ -0,0 +1,127 @@
+//
+//  spsc_ring.h
+//  DroneFlightController
+//
+//  Header-only single-producer single-consumer ring buffer. Capacity is a
+//  power-of-two template parameter and storage is inline (no heap). The
+//  producer only writes head and the consumer only writes tail, so push and
+//  pop never disable interrupts or take a lock; a barrier orders each copy
+//  against the index update. Safe between an interrupt and a task and
+//  between the two cores, with one producer and one consumer per ring.
+//  The indices sit on separate cache lines so a producer and consumer on
+//  cached cores do not contend for the same line.
+//
+
+#ifndef spsc_ring_h
+#define spsc_ring_h
+
+#ifndef __cplusplus
+#error "spsc_ring.h is C++ only"
+#endif
+
+#include <stdint.h>
+#include "hardware/sync.h"
+
+// Index separation; the RP2040 has no data cache, hosts and cached cores
+// override with their line size
+#ifndef SPSC_RING_CACHE_LINE
+#define SPSC_RING_CACHE_LINE 32
+#endif
+
+template <typename T, uint32_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    static const uint32_t CAPACITY = N;
+
+    SpscRing() : head(0), tail(0) {}
+
+    // Empty the ring; only while neither side is using it
+    void reset() {
+        head = 0;
+        tail = 0;
+    }
+
+    // Producer side
+    // Returns false without blocking if the ring is full.
+    bool push(const T &item) {
+        uint32_t h = head;
+        if (h - tail >= N) {
+            return false;
+        }
+        slots[h & MASK] = item;
+
+        // The slot must be visible before the new head
+        __dmb();
+        head = h + 1;
+        return true;
+    }
+
+    // Push up to count items with one index update
+    // Returns the number pushed, less than count if the ring filled.
+    uint32_t pushBatch(const T *items, uint32_t count) {
+        uint32_t h = head;
+        uint32_t space = N - (h - tail);
+        if (count > space) {
+            count = space;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            slots[(h + i) & MASK] = items[i];
+        }
+
+        __dmb();
+        head = h + count;
+        return count;
+    }
+
+    // Consumer side
+    // Returns false without blocking if the ring is empty.
+    bool pop(T &item) {
+        uint32_t t = tail;
+        if (head == t) {
+            return false;
+        }
+
+        // Read the slot only after seeing the head that published it
+        __dmb();
+        item = slots[t & MASK];
+
+        // Finish the copy before handing the slot back to the producer
+        __dmb();
+        tail = t + 1;
+        return true;
+    }
+
+    // Pop up to max items with one index update
+    // Returns the number popped.
+    uint32_t popBatch(T *items, uint32_t max) {
+        uint32_t t = tail;
+        uint32_t available = head - t;
+        if (max > available) {
+            max = available;
+        }
+
+        __dmb();
+        for (uint32_t i = 0; i < max; i++) {
+            items[i] = slots[(t + i) & MASK];
+        }
+
+        __dmb();
+        tail = t + max;
+        return max;
+    }
+
+    // Snapshot of the fill level; exact only from the producer or consumer
+    uint32_t size() const { return head - tail; }
+    bool empty() const { return head == tail; }
+
+private:
+    static const uint32_t MASK = N - 1;
+
+    alignas(SPSC_RING_CACHE_LINE) volatile uint32_t head;   // Items pushed, producer only
+    alignas(SPSC_RING_CACHE_LINE) volatile uint32_t tail;   // Items popped, consumer only
+    alignas(SPSC_RING_CACHE_LINE) T slots[N];
+};
+
+#endif /* spsc_ring_h */
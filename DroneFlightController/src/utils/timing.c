@@ -0,0 +1,79 @@
+//
+//  timing.c
+//  DroneFlightController
+//
+
+#include "timing.h"
+#include "pico/stdlib.h"
+
+// Copies overlapping an update before a reader gives up
+static const int JITTER_READ_ATTEMPTS = 4;
+
+uint32_t timing_micros(void) {
+    return time_us_32();
+}
+
+float timing_elapsed_s(uint32_t start_us, uint32_t end_us) {
+    // Unsigned subtraction handles counter wrap
+    return (float)(end_us - start_us) * 1e-6f;
+}
+
+void timing_wait_until(uint32_t *deadline_us, uint32_t period_us) {
+    while ((int32_t)(*deadline_us - timing_micros()) > 0) {
+        tight_loop_contents();
+    }
+
+    uint32_t now = timing_micros();
+    *deadline_us += period_us;
+    if ((int32_t)(*deadline_us - now) <= 0) {
+        *deadline_us = now + period_us;
+    }
+}
+
+void timing_jitter_init(timing_jitter_t *jitter, uint32_t nominal_us, uint32_t bin_width_us) {
+    seqlock_write_begin(&jitter->lock);
+    jitter->nominal_us = nominal_us;
+    jitter->bin_width_us = (bin_width_us > 0) ? bin_width_us : 1;
+    seqlock_write_end(&jitter->lock);
+    timing_jitter_reset(jitter);
+}
+
+void timing_jitter_reset(timing_jitter_t *jitter) {
+    seqlock_write_begin(&jitter->lock);
+    for (int i = 0; i < TIMING_JITTER_BINS; i++) {
+        jitter->bins[i] = 0;
+    }
+    jitter->count = 0;
+    jitter->min_us = UINT32_MAX;
+    jitter->max_us = 0;
+    seqlock_write_end(&jitter->lock);
+}
+
+void timing_jitter_record(timing_jitter_t *jitter, uint32_t period_us) {
+    int32_t deviation = (int32_t)(period_us - jitter->nominal_us);
+    int32_t width = (int32_t)jitter->bin_width_us;
+
+    // Floor division so a deviation of -1 lands just below the centre
+    int32_t offset = (deviation >= 0) ? deviation / width : -((width - 1 - deviation) / width);
+    int32_t bin = TIMING_JITTER_BINS / 2 + offset;
+    if (bin < 0) bin = 0;
+    if (bin >= TIMING_JITTER_BINS) bin = TIMING_JITTER_BINS - 1;
+
+    seqlock_write_begin(&jitter->lock);
+    jitter->bins[bin]++;
+    jitter->count++;
+    if (period_us < jitter->min_us) jitter->min_us = period_us;
+    if (period_us > jitter->max_us) jitter->max_us = period_us;
+    seqlock_write_end(&jitter->lock);
+}
+
+bool timing_jitter_read(const timing_jitter_t *jitter, timing_jitter_t *copy) {
+    for (int attempt = 0; attempt < JITTER_READ_ATTEMPTS; attempt++) {
+        uint32_t sequence = seqlock_read_begin(&jitter->lock);
+        *copy = *jitter;
+        if (!seqlock_read_retry(&jitter->lock, sequence)) {
+            return true;
+        }
+    }
+    return false;
+}
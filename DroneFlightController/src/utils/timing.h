@@ -0,0 +1,54 @@
+//
+//  timing.h
+//  DroneFlightController
+//
+
+#ifndef timing_h
+#define timing_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/seqlock.h"
+
+// Microseconds since boot, wraps after ~71 minutes
+uint32_t timing_micros(void);
+
+// Seconds elapsed between two timestamps, wrap-safe
+float timing_elapsed_s(uint32_t start_us, uint32_t end_us);
+
+// Busy-wait until the deadline, then advance it by period_us
+// If the deadline has already passed it is re-anchored to now so an
+// overrun does not trigger a burst of back-to-back iterations
+void timing_wait_until(uint32_t *deadline_us, uint32_t period_us);
+
+// Histogram of measured periods around a nominal period, for loop tuning
+// Bin i counts deviations in [(i - TIMING_JITTER_BINS / 2) * bin_width_us,
+// (i - TIMING_JITTER_BINS / 2 + 1) * bin_width_us); the first and last bins
+// also collect everything beyond them. One task or core records; others
+// copy it out with timing_jitter_read.
+#define TIMING_JITTER_BINS  16
+
+typedef struct {
+    seqlock_t lock;
+    uint32_t nominal_us;
+    uint32_t bin_width_us;
+    uint32_t bins[TIMING_JITTER_BINS];
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+} timing_jitter_t;
+
+// Clear the histogram and set its centre and resolution
+void timing_jitter_init(timing_jitter_t *jitter, uint32_t nominal_us, uint32_t bin_width_us);
+
+// Clear the counts, keeping the configuration
+void timing_jitter_reset(timing_jitter_t *jitter);
+
+// Count one measured period
+void timing_jitter_record(timing_jitter_t *jitter, uint32_t period_us);
+
+// Consistent copy of a histogram recorded by another task or core
+// Returns false if it was being updated during every attempt.
+bool timing_jitter_read(const timing_jitter_t *jitter, timing_jitter_t *copy);
+
+#endif /* timing_h */
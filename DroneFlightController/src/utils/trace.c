@@ -0,0 +1,106 @@
+//
+//  trace.c
+//  DroneFlightController
+//
+
+#include "trace.h"
+#include <stdio.h>
+#include "utils/mpsc_ring.h"
+#include "utils/timing.h"
+#include "utils/log_store.h"
+
+typedef struct {
+    trace_record_header_t header;
+    uint32_t args[TRACE_MAX_ARGS];
+} trace_record_t;
+
+// Any task, interrupt or core to the log task
+static MpscRing<trace_record_t, TRACE_RING_RECORDS> ring;
+
+// File output, or the log store's trace stream
+static FILE *output = NULL;
+static bool to_flash = false;
+static volatile LogLevel trace_level = LOG_INFO;
+static volatile uint32_t dropped = 0;
+
+static void write_out(const void *data, uint32_t size) {
+    if (to_flash) {
+        log_store_append(LOG_STORE_STREAM_TRACE, data, size);
+    } else {
+        fwrite(data, size, 1, output);
+    }
+}
+
+// The log store only takes a partly filled page once it has aged
+static void sync_output(void) {
+    if (to_flash) {
+        log_store_sync(LOG_STORE_STREAM_TRACE);
+    } else {
+        fflush(output);
+    }
+}
+
+bool trace_init(const char *path, LogDestination destination) {
+    if (destination == LOG_TO_FLASH) {
+        to_flash = true;
+    } else if (destination == LOG_TO_FILE) {
+        output = fopen(path, "ab");
+    }
+    if (!to_flash && output == NULL) {
+        return false;
+    }
+
+    trace_file_header_t header = { TRACE_MAGIC, TRACE_VERSION, {0, 0, 0} };
+    write_out(&header, sizeof(header));
+    sync_output();
+    return true;
+}
+
+void trace_set_level(LogLevel level) {
+    trace_level = level;
+}
+
+void trace_write(LogLevel level, uint16_t id, uint8_t nargs, const uint32_t *args) {
+    if (level < trace_level) {
+        return;
+    }
+
+    uint32_t ticket;
+    trace_record_t *record = ring.claim(ticket);
+    if (record == NULL) {
+        // Counted with the same atomic claim uses, shared by every producer
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    record->header.id = id;
+    record->header.level = (uint8_t)level;
+    record->header.nargs = nargs;
+    record->header.timestamp_us = timing_micros();
+    for (uint8_t i = 0; i < nargs; i++) {
+        record->args[i] = args[i];
+    }
+    ring.commit(ticket);
+}
+
+uint32_t trace_drain(void) {
+    if (!to_flash && output == NULL) {
+        return 0;
+    }
+
+    uint32_t drained = 0;
+    const trace_record_t *record;
+    while ((record = ring.peek()) != NULL) {
+        write_out(record, sizeof(trace_record_header_t) + record->header.nargs * sizeof(uint32_t));
+        ring.release();
+        drained++;
+    }
+    if (drained > 0 || to_flash) {
+        sync_output();
+    }
+    return drained;
+}
+
+uint32_t trace_get_dropped(void) {
+    return dropped;
+}
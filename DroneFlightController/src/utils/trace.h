@@ -0,0 +1,148 @@
+//
+//  trace.h
+//  DroneFlightController
+//
+//  Deferred-formatting log. Each TRACE_LOG call site interns its
+//  "file:line" and format string in the fc_trace section at build time;
+//  its offset there is the message ID. A call copies the ID, a timestamp
+//  and up to TRACE_MAX_ARGS raw 32-bit arguments into a lock-free ring,
+//  with no formatting. The log task writes the records out and
+//  tools/trace_decode rebuilds the text from the firmware ELF.
+//
+//  Arguments are captured as 32 bits: integers up to 32 bits, floats as
+//  their bit pattern (doubles are narrowed), pointers as addresses. A %s
+//  argument decodes only if it points into a section of the ELF, such as
+//  a string literal.
+//
+//  Stream layout, all little-endian:
+//    file header   trace_file_header_t
+//    per message   trace_record_header_t, then nargs 32-bit arguments
+//  Each boot appends a new file header and its records to the same file.
+//
+//  A call with more than TRACE_MAX_ARGS arguments fails to compile. The
+//  message ID is 16 bits, so fc_trace must stay within 64 KB; link with
+//  utils/trace.ld, which fails the link when it does not.
+//
+
+#ifndef trace_h
+#define trace_h
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "utils/logger.h"
+
+#define TRACE_MAX_ARGS  12
+
+#define TRACE_MAGIC    0x52544346u   // "FCTR"
+#define TRACE_VERSION  1
+
+typedef struct {
+    uint32_t magic;          // TRACE_MAGIC
+    uint8_t version;         // TRACE_VERSION
+    uint8_t reserved[3];
+} trace_file_header_t;
+
+typedef struct {
+    uint16_t id;             // Offset of "file:line\x1f" format in fc_trace
+    uint8_t level;           // LogLevel
+    uint8_t nargs;
+    uint32_t timestamp_us;
+} trace_record_header_t;
+
+// Messages buffered between drains, a power of two
+#define TRACE_RING_RECORDS  32
+
+// Static RAM of the trace ring, for the RAM budget
+#define TRACE_RAM_BYTES \
+    (TRACE_RING_RECORDS * (sizeof(uint32_t) + sizeof(trace_record_header_t) + TRACE_MAX_ARGS * sizeof(uint32_t)))
+
+// Open the output and write the stream header. LOG_TO_FILE writes to
+// path, LOG_TO_FLASH to the trace stream of the log store.
+bool trace_init(const char *path, LogDestination destination);
+
+// Minimum level recorded
+void trace_set_level(LogLevel level);
+
+// Queue one message; never blocks, counts a drop if the ring is full
+void trace_write(LogLevel level, uint16_t id, uint8_t nargs, const uint32_t *args);
+
+// Write out every queued message; log task only
+// Returns the number of messages written.
+uint32_t trace_drain(void);
+
+// Messages lost to a full ring
+uint32_t trace_get_dropped(void);
+
+// Start of the interned strings, defined by the linker
+extern const char __start_fc_trace[];
+
+// Argument capture
+#ifdef __cplusplus
+static inline uint32_t trace_arg(float value) {
+    uint32_t word;
+    memcpy(&word, &value, sizeof(word));
+    return word;
+}
+static inline uint32_t trace_arg(double value) { return trace_arg((float)value); }
+template <typename T>
+static inline uint32_t trace_arg(T value) { return (uint32_t)(uintptr_t)value; }
+#else
+static inline uint32_t trace_arg_float(float value) {
+    uint32_t word;
+    memcpy(&word, &value, sizeof(word));
+    return word;
+}
+static inline uint32_t trace_arg_double(double value) { return trace_arg_float((float)value); }
+static inline uint32_t trace_arg_pointer(const void *value) { return (uint32_t)(uintptr_t)value; }
+static inline uint32_t trace_arg_word(uint32_t value) { return value; }
+#define trace_arg(value) _Generic((value), \
+    float: trace_arg_float, \
+    double: trace_arg_double, \
+    char *: trace_arg_pointer, \
+    const char *: trace_arg_pointer, \
+    void *: trace_arg_pointer, \
+    const void *: trace_arg_pointer, \
+    default: trace_arg_word)(value)
+#endif
+
+#define TRACE_STR_(x) #x
+#define TRACE_STR(x) TRACE_STR_(x)
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+
+// Arguments after the format; counts past TRACE_MAX_ARGS so that too many
+// trip the static_assert in TRACE_LOG
+#define TRACE_NARGS(...) TRACE_NARGS_(__VA_ARGS__, 20, 19, 18, 17, 16, 15, 14, 13, \
+                                      12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 0)
+#define TRACE_NARGS_(fmt, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, \
+                     a13, a14, a15, a16, a17, a18, a19, a20, n, ...) n
+#define TRACE_FORMAT(fmt, ...) fmt
+
+#define TRACE_ARGS(...) TRACE_CAT(TRACE_ARGS_, TRACE_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define TRACE_ARGS_0(f)
+#define TRACE_ARGS_1(f, a) , trace_arg(a)
+#define TRACE_ARGS_2(f, a, ...) , trace_arg(a) TRACE_ARGS_1(f, __VA_ARGS__)
+#define TRACE_ARGS_3(f, a, ...) , trace_arg(a) TRACE_ARGS_2(f, __VA_ARGS__)
+#define TRACE_ARGS_4(f, a, ...) , trace_arg(a) TRACE_ARGS_3(f, __VA_ARGS__)
+#define TRACE_ARGS_5(f, a, ...) , trace_arg(a) TRACE_ARGS_4(f, __VA_ARGS__)
+#define TRACE_ARGS_6(f, a, ...) , trace_arg(a) TRACE_ARGS_5(f, __VA_ARGS__)
+#define TRACE_ARGS_7(f, a, ...) , trace_arg(a) TRACE_ARGS_6(f, __VA_ARGS__)
+#define TRACE_ARGS_8(f, a, ...) , trace_arg(a) TRACE_ARGS_7(f, __VA_ARGS__)
+#define TRACE_ARGS_9(f, a, ...) , trace_arg(a) TRACE_ARGS_8(f, __VA_ARGS__)
+#define TRACE_ARGS_10(f, a, ...) , trace_arg(a) TRACE_ARGS_9(f, __VA_ARGS__)
+#define TRACE_ARGS_11(f, a, ...) , trace_arg(a) TRACE_ARGS_10(f, __VA_ARGS__)
+#define TRACE_ARGS_12(f, a, ...) , trace_arg(a) TRACE_ARGS_11(f, __VA_ARGS__)
+
+// Log a printf-style message without formatting it on the device
+#define TRACE_LOG(level, ...) do { \
+    static_assert(TRACE_NARGS(__VA_ARGS__) <= TRACE_MAX_ARGS, "TRACE_LOG takes at most TRACE_MAX_ARGS arguments"); \
+    static const char trace_site_[] __attribute__((section("fc_trace"))) = \
+        LOG_FILE ":" TRACE_STR(__LINE__) "\x1f" TRACE_FORMAT(__VA_ARGS__, 0); \
+    const uint32_t trace_args_[TRACE_MAX_ARGS + 1] = { 0 TRACE_ARGS(__VA_ARGS__) }; \
+    trace_write((level), (uint16_t)(trace_site_ - __start_fc_trace), \
+                TRACE_NARGS(__VA_ARGS__), &trace_args_[1]); \
+} while (0)
+
+#endif /* trace_h */
@@ -0,0 +1,505 @@
+//
+//  attitude_bench.cpp
+//  DroneFlightController
+//
+//  Host accuracy and cost test of the quaternion attitude estimator and the
+//  7-state EKF against the per-axis Kalman filter they replace. All run on
+//  the same synthetic 1 kHz IMU trace, generated from an exactly integrated
+//  true attitude with a constant gyro bias and sensor noise:
+//
+//    hover        small attitude changes around level
+//    steep        pitch swung to +-80 degrees, near the Euler singularity
+//    aggressive   fast three-axis rotation with maneuver acceleration
+//
+//  The tilt error is the angle between the estimated and the true gravity
+//  direction, so it means the same for Euler angles and quaternions; yaw
+//  has no reference without a magnetometer and is left out. Time is per
+//  update, in TSC ticks where the host has one, and is split into the gyro
+//  integration every sample pays and the correction every
+//  ATTITUDE_CORRECTION_DIVISOR-th sample adds. Exits 1 if the quaternion
+//  estimator or the EKF exceeds the tilt or bias limits below. Build once
+//  per complementary estimator, the default Mahony and once with
+//  -DSENSOR_FUSION_ESTIMATOR=SENSOR_FUSION_MADGWICK.
+//
+//  Build: c++ -std=c++17 -O2 -I../../src -o attitude_bench attitude_bench.cpp
+//             ../../src/sensors/attitude_estimator.c ../../src/sensors/attitude_ekf.c
+//             ../../src/utils/math_utils.c
+//  Usage: attitude_bench [passes]
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "sensors/attitude_estimator.h"
+#include "sensors/attitude_ekf.h"
+#include "config/sensor_config.h"
+
+namespace {
+
+const int SAMPLE_HZ = IMU_SAMPLE_RATE_HZ;
+const float DT = 1.0f / SAMPLE_HZ;
+const int SEGMENTS = 3;
+const char *SEGMENT_NAMES[SEGMENTS] = {"hover", "steep", "aggressive"};
+const double SEGMENT_SECONDS = 20.0;
+const double SETTLE_SECONDS = 1.0;
+
+const double GYRO_BIAS[3] = {0.02, -0.015, 0.01};  // rad/s
+const double GYRO_NOISE = 0.01;                     // rad/s per sample
+const double ACCEL_NOISE = 0.03;                    // g per sample
+
+const double DEG = 180.0 / M_PI;
+
+// Limits for the estimators under test, degrees and rad/s
+const double MAX_TILT_RMS = 3.0;
+const double MAX_TILT = 6.0;
+const double MAX_BIAS_ERROR = 0.03;
+
+// Divisor that leaves only the gyro integration in the timed updates
+const uint16_t NO_CORRECTION = 65535;
+
+// Results are stored so the timed loops are not optimized away
+volatile float sink;
+
+// IMU samples and the true gravity direction in the body frame
+struct Trace {
+    std::vector<float> gyro;
+    std::vector<float> accel;
+    std::vector<double> gravity;
+    int samples = 0;
+};
+
+// Standard normal values from a fixed seed, Box-Muller on the usual LCG
+struct Noise {
+    uint32_t seed = 1;
+
+    double uniform() {
+        seed = seed * 1664525u + 1013904223u;
+        return ((seed >> 8) + 0.5) / 16777216.0;
+    }
+
+    double normal() {
+        return std::sqrt(-2.0 * std::log(uniform())) * std::cos(2.0 * M_PI * uniform());
+    }
+};
+
+// Body rates of each segment, rad/s; t is the time within the segment
+void body_rate(int segment, double t, double *rate) {
+    if (segment == 0) {
+        rate[0] = 0.4 * std::sin(2.0 * M_PI * 0.7 * t);
+        rate[1] = 0.4 * std::sin(2.0 * M_PI * 0.5 * t + 1.0);
+        rate[2] = 0.2 * std::sin(2.0 * M_PI * 0.3 * t + 2.0);
+    } else if (segment == 1) {
+        // Derivative of an 80 degree pitch swing at 0.1 Hz
+        rate[0] = 0.0;
+        rate[1] = (80.0 / DEG) * 2.0 * M_PI * 0.1 * std::cos(2.0 * M_PI * 0.1 * t);
+        rate[2] = 0.0;
+    } else {
+        rate[0] = 5.0 * std::sin(2.0 * M_PI * 1.5 * t);
+        rate[1] = 4.0 * std::sin(2.0 * M_PI * 1.1 * t + 1.0);
+        rate[2] = 2.0 * std::sin(2.0 * M_PI * 0.4 * t + 2.0);
+    }
+}
+
+// Body-frame earth z of a body-to-earth quaternion, what a level
+// accelerometer at rest reads
+void gravity_of(const double *q, double *g) {
+    g[0] = 2.0 * (q[1] * q[3] - q[0] * q[2]);
+    g[1] = 2.0 * (q[0] * q[1] + q[2] * q[3]);
+    g[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+}
+
+Trace make_trace() {
+    Trace trace;
+    trace.samples = (int)(SEGMENTS * SEGMENT_SECONDS * SAMPLE_HZ);
+    trace.gyro.resize(trace.samples * 3);
+    trace.accel.resize(trace.samples * 3);
+    trace.gravity.resize(trace.samples * 3);
+
+    Noise noise;
+    double q[4] = {1.0, 0.0, 0.0, 0.0};
+    for (int n = 0; n < trace.samples; n++) {
+        int segment = (int)(n / (SEGMENT_SECONDS * SAMPLE_HZ));
+        double t = n / (double)SAMPLE_HZ - segment * SEGMENT_SECONDS;
+        double rate[3];
+        body_rate(segment, t, rate);
+
+        // The accelerometer sees gravity plus any maneuver acceleration
+        double g[3];
+        gravity_of(q, g);
+        double maneuver[3] = {0.0, 0.0, 0.0};
+        if (segment == 2) {
+            maneuver[0] = 0.2 * std::sin(2.0 * M_PI * 1.5 * t);
+            maneuver[1] = 0.2 * std::sin(2.0 * M_PI * 1.1 * t);
+        }
+        for (int i = 0; i < 3; i++) {
+            trace.gravity[n * 3 + i] = g[i];
+            trace.gyro[n * 3 + i] = (float)(rate[i] + GYRO_BIAS[i] + GYRO_NOISE * noise.normal());
+            trace.accel[n * 3 + i] = (float)(g[i] + maneuver[i] + ACCEL_NOISE * noise.normal());
+        }
+
+        // Exact rotation by the body rate over one sample, q = q (x) exp(rate dt / 2)
+        double norm = std::sqrt(rate[0] * rate[0] + rate[1] * rate[1] + rate[2] * rate[2]);
+        double half = 0.5 * norm / SAMPLE_HZ;
+        double s = (norm > 0.0) ? std::sin(half) / norm : 0.0;
+        double r[4] = {std::cos(half), rate[0] * s, rate[1] * s, rate[2] * s};
+        double next[4] = {
+            q[0] * r[0] - q[1] * r[1] - q[2] * r[2] - q[3] * r[3],
+            q[0] * r[1] + q[1] * r[0] + q[2] * r[3] - q[3] * r[2],
+            q[0] * r[2] - q[1] * r[3] + q[2] * r[0] + q[3] * r[1],
+            q[0] * r[3] + q[1] * r[2] - q[2] * r[1] + q[3] * r[0],
+        };
+        for (int i = 0; i < 4; i++) {
+            q[i] = next[i];
+        }
+    }
+    return trace;
+}
+
+// The SENSOR_FUSION_KALMAN path of sensor_fusion.c, float build: one 1-D
+// Kalman filter per axis on accelerometer angles and integrated yaw. It
+// lives in file statics behind the IMU driver there, so it is copied here.
+class KalmanReference {
+public:
+    const char *name() const { return "kalman"; }
+    bool estimates_bias() const { return true; }
+    bool decimated() const { return false; }
+
+    // Corrects on every sample, whatever the divisor
+    void reset(uint16_t = ATTITUDE_CORRECTION_DIVISOR) {
+        for (int i = 0; i < 3; i++) {
+            angle[i] = 0.0f;
+            bias[i] = 0.0f;
+            P[i][0][0] = P[i][0][1] = P[i][1][0] = P[i][1][1] = 0.0f;
+        }
+    }
+
+    void update(const float *gyro, const float *accel, float dt) {
+        float accel_roll = atan2f(accel[1], accel[2]);
+        float accel_pitch = atan2f(-accel[0], sqrtf(accel[1] * accel[1] + accel[2] * accel[2]));
+        update_axis(0, accel_roll, gyro[0], dt);
+        update_axis(1, accel_pitch, gyro[1], dt);
+        angle[2] += (gyro[2] - bias[2]) * dt;
+    }
+
+    void gravity(double *g) const {
+        g[0] = -std::sin(angle[1]);
+        g[1] = std::cos(angle[1]) * std::sin(angle[0]);
+        g[2] = std::cos(angle[1]) * std::cos(angle[0]);
+    }
+
+    void get_bias(float *out) const {
+        for (int i = 0; i < 3; i++) {
+            out[i] = bias[i];
+        }
+    }
+
+    void euler(float *out) const {
+        for (int i = 0; i < 3; i++) {
+            out[i] = angle[i];
+        }
+    }
+
+private:
+    void update_axis(int index, float measurement, float gyro_rate, float dt) {
+        float rate = gyro_rate - bias[index];
+        angle[index] += dt * rate;
+
+        P[index][0][0] += dt * (dt * P[index][1][1] - P[index][0][1] - P[index][1][0] + Q_angle);
+        P[index][0][1] -= dt * P[index][1][1];
+        P[index][1][0] -= dt * P[index][1][1];
+        P[index][1][1] += Q_bias * dt;
+
+        float y = measurement - angle[index];
+        float S = P[index][0][0] + R_measure;
+        float K[2] = {P[index][0][0] / S, P[index][1][0] / S};
+
+        angle[index] += K[0] * y;
+        bias[index] += K[1] * y;
+
+        float P00_temp = P[index][0][0];
+        float P01_temp = P[index][0][1];
+
+        P[index][0][0] -= K[0] * P00_temp;
+        P[index][0][1] -= K[0] * P01_temp;
+        P[index][1][0] -= K[1] * P00_temp;
+        P[index][1][1] -= K[1] * P01_temp;
+    }
+
+    const float Q_angle = 0.001f;
+    const float Q_bias = 0.003f;
+    const float R_measure = 0.03f;
+
+    float angle[3];
+    float bias[3];
+    float P[3][2][2];
+};
+
+// attitude_estimator.c as sensor_fusion.c configures it
+class QuaternionEstimator {
+public:
+    const char *name() const {
+        return (SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_MADGWICK) ? "madgwick" : "mahony";
+    }
+    bool estimates_bias() const { return SENSOR_FUSION_ESTIMATOR != SENSOR_FUSION_MADGWICK; }
+    bool decimated() const { return true; }
+
+    void reset(uint16_t divisor = ATTITUDE_CORRECTION_DIVISOR) {
+#if SENSOR_FUSION_ESTIMATOR == SENSOR_FUSION_MADGWICK
+        attitude_estimator_init(&estimator, MADGWICK_BETA, 0.0f, divisor);
+#else
+        attitude_estimator_init(&estimator, MAHONY_KP, MAHONY_KI, divisor);
+#endif
+    }
+
+    void update(const float *gyro, const float *accel, float dt) {
+        attitude_estimator_update(&estimator, gyro, accel, NULL, dt);
+    }
+
+    void gravity(double *g) const {
+        const double q[4] = {estimator.q.w, estimator.q.x, estimator.q.y, estimator.q.z};
+        gravity_of(q, g);
+    }
+
+    void get_bias(float *out) const {
+        attitude_estimator_get_bias(&estimator, out);
+    }
+
+    void euler(float *out) const {
+        attitude_estimator_get_euler(&estimator, &out[0], &out[1], &out[2]);
+    }
+
+private:
+    attitude_estimator_t estimator;
+};
+
+// attitude_ekf.c as sensor_fusion.c configures it
+class EkfEstimator {
+public:
+    const char *name() const { return "ekf"; }
+    bool estimates_bias() const { return true; }
+    bool decimated() const { return true; }
+
+    void reset(uint16_t divisor = ATTITUDE_CORRECTION_DIVISOR) {
+        ekf.initialize(EKF_GYRO_NOISE, EKF_BIAS_NOISE, EKF_ACCEL_NOISE, divisor);
+    }
+
+    void update(const float *gyro, const float *accel, float dt) {
+        ekf.update(gyro, accel, dt);
+    }
+
+    void gravity(double *g) const {
+        quaternion_t q;
+        ekf.getQuaternion(q);
+        const double components[4] = {q.w, q.x, q.y, q.z};
+        gravity_of(components, g);
+    }
+
+    void get_bias(float *out) const {
+        ekf.getBias(out);
+    }
+
+    void euler(float *out) const {
+        ekf.getEuler(out[0], out[1], out[2]);
+    }
+
+private:
+    AttitudeEKF ekf;
+};
+
+struct Accuracy {
+    double sum_sq[SEGMENTS] = {};
+    double max[SEGMENTS] = {};
+    long count[SEGMENTS] = {};
+    double bias_error = 0.0;
+    bool has_bias = true;
+};
+
+// Tilt error in radians between two gravity directions
+double tilt_error(const double *estimate, const double *truth) {
+    double dot = 0.0;
+    double norm_sq = 0.0;
+    for (int i = 0; i < 3; i++) {
+        dot += estimate[i] * truth[i];
+        norm_sq += estimate[i] * estimate[i];
+    }
+    double cosine = dot / std::sqrt(norm_sq);
+    return std::acos(std::fmax(-1.0, std::fmin(1.0, cosine)));
+}
+
+template <typename Filter>
+Accuracy measure_accuracy(Filter &filter, const Trace &trace) {
+    Accuracy accuracy;
+    filter.reset();
+    const int segment_samples = (int)(SEGMENT_SECONDS * SAMPLE_HZ);
+    const int settle_samples = (int)(SETTLE_SECONDS * SAMPLE_HZ);
+    for (int n = 0; n < trace.samples; n++) {
+        filter.update(&trace.gyro[n * 3], &trace.accel[n * 3], DT);
+        if (n < settle_samples) {
+            continue;
+        }
+        int segment = n / segment_samples;
+        double estimate[3];
+        filter.gravity(estimate);
+        double error = tilt_error(estimate, &trace.gravity[n * 3]);
+        accuracy.sum_sq[segment] += error * error;
+        accuracy.max[segment] = std::fmax(accuracy.max[segment], error);
+        accuracy.count[segment]++;
+    }
+
+    float bias[3];
+    filter.get_bias(bias);
+    double sum_sq = 0.0;
+    for (int i = 0; i < 3; i++) {
+        sum_sq += (bias[i] - GYRO_BIAS[i]) * (bias[i] - GYRO_BIAS[i]);
+    }
+    accuracy.bias_error = std::sqrt(sum_sq);
+    accuracy.has_bias = filter.estimates_bias();
+    return accuracy;
+}
+
+// Prints one row and returns whether it is within the limits
+bool print_accuracy(const char *name, const Accuracy &accuracy) {
+    // Without a bias estimate the error is just the true bias
+    bool pass = !accuracy.has_bias || accuracy.bias_error <= MAX_BIAS_ERROR;
+    std::printf("  %-9s", name);
+    for (int s = 0; s < SEGMENTS; s++) {
+        double rms = DEG * std::sqrt(accuracy.sum_sq[s] / accuracy.count[s]);
+        double max = DEG * accuracy.max[s];
+        pass = pass && rms <= MAX_TILT_RMS && max <= MAX_TILT;
+        std::printf("  %6.2f %7.2f", rms, max);
+    }
+    std::printf("  %8.4f%s\n", accuracy.bias_error, accuracy.has_bias ? "" : " (none)");
+    return pass;
+}
+
+struct Timer {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#if HAVE_TSC
+    uint64_t start_ticks = __rdtsc();
+#endif
+
+    // Nanoseconds per call, and ticks per call where there is a TSC
+    double elapsed(long calls, double *ticks) const {
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+#if HAVE_TSC
+        *ticks = (double)(__rdtsc() - start_ticks) / calls;
+#else
+        *ticks = 0.0;
+#endif
+        return ns / calls;
+    }
+
+    void report(const char *name, long calls) const {
+        double ticks;
+        double ns = elapsed(calls, &ticks);
+#if HAVE_TSC
+        std::printf("  %-9s %7.1f ns %7.1f ticks per call\n", name, ns, ticks);
+#else
+        std::printf("  %-9s %7.1f ns per call\n", name, ns);
+#endif
+    }
+};
+
+template <typename Filter>
+double run_updates(Filter &filter, const Trace &trace, int passes, uint16_t divisor, double *ticks) {
+    filter.reset(divisor);
+    float angles[3];
+    Timer timer;
+    for (int pass = 0; pass < passes; pass++) {
+        for (int n = 0; n < trace.samples; n++) {
+            filter.update(&trace.gyro[n * 3], &trace.accel[n * 3], DT);
+        }
+    }
+    double ns = timer.elapsed((long)passes * trace.samples, ticks);
+    filter.euler(angles);
+    sink = angles[0];
+    return ns;
+}
+
+// Mean per update as configured, then the gyro integration alone and the
+// correction alone, the latter from runs that correct on every sample
+template <typename Filter>
+void time_updates(Filter &filter, const Trace &trace, int passes) {
+    double ticks;
+    double integrate_ticks;
+    double every_ticks;
+    double ns = run_updates(filter, trace, passes, ATTITUDE_CORRECTION_DIVISOR, &ticks);
+    if (!filter.decimated()) {
+#if HAVE_TSC
+        std::printf("  %-9s %7.1f ns %7.1f ticks  (corrects every sample)\n", filter.name(), ns, ticks);
+#else
+        std::printf("  %-9s %7.1f ns  (corrects every sample)\n", filter.name(), ns);
+#endif
+        return;
+    }
+    double integrate_ns = run_updates(filter, trace, passes, NO_CORRECTION, &integrate_ticks);
+    double every_ns = run_updates(filter, trace, passes, 1, &every_ticks);
+#if HAVE_TSC
+    std::printf("  %-9s %7.1f ns %7.1f ticks  integrate %6.1f ns %6.1f ticks  correct %7.1f ns %7.1f ticks\n",
+                filter.name(), ns, ticks, integrate_ns, integrate_ticks, every_ns - integrate_ns,
+                every_ticks - integrate_ticks);
+#else
+    std::printf("  %-9s %7.1f ns  integrate %6.1f ns  correct %7.1f ns\n", filter.name(), ns, integrate_ns,
+                every_ns - integrate_ns);
+#endif
+}
+
+// Euler angles are only derived on request in the quaternion estimator
+template <typename Filter>
+void time_euler(Filter &filter, long calls) {
+    float angles[3];
+    float sum = 0.0f;
+    Timer timer;
+    for (long n = 0; n < calls; n++) {
+        filter.euler(angles);
+        sum += angles[0];
+    }
+    timer.report("  euler", calls);
+    sink = sum;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int passes = (argc > 1) ? std::atoi(argv[1]) : 20;
+    if (passes <= 0) {
+        std::fprintf(stderr, "usage: %s [passes]\n", argv[0]);
+        return 2;
+    }
+
+    Trace trace = make_trace();
+    KalmanReference kalman;
+    QuaternionEstimator estimator;
+    EkfEstimator ekf;
+
+    std::printf("%.0f s trace at %d Hz, correction every %d samples\n", SEGMENTS * SEGMENT_SECONDS, SAMPLE_HZ,
+                ATTITUDE_CORRECTION_DIVISOR);
+    std::printf("tilt error in degrees, rms and max per segment, and gyro bias error in rad/s\n");
+    std::printf("  %-9s", "");
+    for (int s = 0; s < SEGMENTS; s++) {
+        std::printf("  %-14s", SEGMENT_NAMES[s]);
+    }
+    std::printf("  %8s\n", "bias");
+    // The Kalman filter is the baseline and is not held to the limits
+    print_accuracy(kalman.name(), measure_accuracy(kalman, trace));
+    bool pass = print_accuracy(estimator.name(), measure_accuracy(estimator, trace));
+    pass = print_accuracy(ekf.name(), measure_accuracy(ekf, trace)) && pass;
+    std::printf("  limits: tilt rms %.1f, max %.1f degrees, bias %.3f rad/s: %s\n", MAX_TILT_RMS, MAX_TILT,
+                MAX_BIAS_ERROR, pass ? "ok" : "FAIL");
+
+    std::printf("time per update, %d passes\n", passes);
+    time_updates(kalman, trace, passes);
+    time_updates(estimator, trace, passes);
+    time_updates(ekf, trace, passes);
+    time_euler(estimator, (long)passes * trace.samples / 10);
+    return pass ? 0 : 1;
+}
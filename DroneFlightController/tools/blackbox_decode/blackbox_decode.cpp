@@ -0,0 +1,1241 @@
+//
+//  blackbox_decode.cpp
+//  DroneFlightController
+//
+//  Host decoder and analyzer for blackbox logs. Memory-maps the log, cuts
+//  it into chunks and decodes them on every core; each chunk finds its
+//  first frame by resynchronizing on the sync byte and a run of frames
+//  with consecutive sequences, and the chunks are then stitched back in
+//  order, re-decoding any whose start disagrees with where the previous
+//  one ended. Bytes that do not decode, such as a frame cut short by a
+//  power loss, are skipped the same way.
+//
+//  Reads a blackbox file (flight.bbl) or an image of the log store flash
+//  region, from which it rebuilds the blackbox stream by page sequence and
+//  can extract the trace and text streams for tools/trace_decode.
+//
+//  Prints per boot: frames, dropped frames, loop interval and jitter, PID
+//  term RMS, motor saturation time and the gyro noise spectrum (Welch,
+//  Hann window, 50% overlap). Exports every frame as CSV or one NumPy
+//  .npy file per column, and the spectrum as CSV.
+//
+//  Build: c++ -std=c++17 -O2 -pthread -I../../src -o blackbox_decode blackbox_decode.cpp ../../src/utils/crc32.c
+//  Usage: blackbox_decode [options] flight.bbl|flash.img
+//
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/blackbox.h"
+#include "utils/log_store.h"
+#include "utils/crc32.h"
+
+namespace {
+
+// Frames checked ahead when resynchronizing
+const int RESYNC_CHAIN = 8;
+
+// Largest sequence step accepted between frames: drops while the drain
+// task was starved
+const uint16_t MAX_SEQUENCE_STEP = 8192;
+
+// Largest timestamp step accepted between frames
+const uint32_t MAX_TIMESTAMP_STEP_US = 2000000;
+
+// Smallest chunk worth a thread
+const size_t MIN_CHUNK_BYTES = 1 << 20;
+
+// Gyro noise is reported above this frequency, below it is flight
+const double NOISE_FLOOR_HZ = 50.0;
+
+const size_t FIELD_SIZE[BLACKBOX_FIELD_COUNT] = {
+    BLACKBOX_FIELD_GYRO_SIZE, BLACKBOX_FIELD_ATTITUDE_SIZE, BLACKBOX_FIELD_SETPOINT_SIZE,
+    BLACKBOX_FIELD_PID_SIZE, BLACKBOX_FIELD_MOTOR_SIZE,
+};
+
+const size_t MAX_FRAME_BYTES = sizeof(blackbox_frame_header_t) + BLACKBOX_FIELD_GYRO_SIZE +
+    BLACKBOX_FIELD_ATTITUDE_SIZE + BLACKBOX_FIELD_SETPOINT_SIZE + BLACKBOX_FIELD_PID_SIZE + BLACKBOX_FIELD_MOTOR_SIZE;
+
+template <typename Fn>
+void parallel_for(size_t count, unsigned threads, Fn fn) {
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < count;) {
+            fn(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < count; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &t : pool) {
+        t.join();
+    }
+}
+
+// Whole file, mapped where possible and read otherwise (pipes, stdin)
+class Input {
+public:
+    ~Input() {
+        if (mapped != nullptr) {
+            munmap(mapped, size);
+        }
+    }
+
+    bool open(const char *path) {
+        int fd = std::strcmp(path, "-") == 0 ? STDIN_FILENO : ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                mapped = p;
+                size = (size_t)st.st_size;
+                data = static_cast<const uint8_t *>(p);
+                madvise(p, size, MADV_SEQUENTIAL);
+            }
+        }
+        if (mapped == nullptr) {
+            uint8_t buf[1 << 16];
+            ssize_t n;
+            while ((n = read(fd, buf, sizeof(buf))) > 0) {
+                owned.insert(owned.end(), buf, buf + n);
+            }
+            data = owned.data();
+            size = owned.size();
+        }
+        if (fd != STDIN_FILENO) {
+            close(fd);
+        }
+        return true;
+    }
+
+    // Replace the contents, e.g. with a stream rebuilt from a flash image
+    void assign(std::vector<uint8_t> bytes) {
+        if (mapped != nullptr) {
+            munmap(mapped, size);
+            mapped = nullptr;
+        }
+        owned = std::move(bytes);
+        data = owned.data();
+        size = owned.size();
+    }
+
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+private:
+    void *mapped = nullptr;
+    std::vector<uint8_t> owned;
+};
+
+// ---------------------------------------------------------------------------
+// Log store flash images
+
+struct StorePage {
+    uint32_t sequence;
+    uint8_t stream;
+    uint16_t length;
+    const uint8_t *payload;
+};
+
+bool looks_like_store(const uint8_t *data, size_t size) {
+    if (size < LOG_FLASH_SECTOR_SIZE || size % LOG_FLASH_PAGE_SIZE != 0) {
+        return false;
+    }
+    for (size_t at = 0; at < size; at += LOG_FLASH_PAGE_SIZE) {
+        if (data[at + offsetof(log_store_page_header_t, magic)] == LOG_STORE_PAGE_MAGIC) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Every page with a valid CRC, in sequence order; pages torn by a power
+// loss or never written are left out
+std::vector<StorePage> read_store(const uint8_t *data, size_t size, unsigned threads) {
+    size_t count = size / LOG_FLASH_PAGE_SIZE;
+    std::vector<StorePage> slots(count);
+    std::vector<uint8_t> valid(count, 0);
+    parallel_for(count, threads, [&](size_t index) {
+        const uint8_t *page = data + index * LOG_FLASH_PAGE_SIZE;
+        log_store_page_header_t header;
+        std::memcpy(&header, page, sizeof(header));
+        if (header.magic != LOG_STORE_PAGE_MAGIC || header.length > LOG_STORE_PAGE_PAYLOAD ||
+            header.stream >= LOG_STORE_STREAM_COUNT || header.sequence % count != index) {
+            return;
+        }
+        uint32_t crc = crc32(page + sizeof(uint32_t),
+                             (uint32_t)(sizeof(header) - sizeof(uint32_t) + header.length));
+        if (crc != header.crc) {
+            return;
+        }
+        slots[index] = { header.sequence, header.stream, header.length, page + sizeof(header) };
+        valid[index] = 1;
+    });
+
+    std::vector<StorePage> pages;
+    for (size_t i = 0; i < count; i++) {
+        if (valid[i]) {
+            pages.push_back(slots[i]);
+        }
+    }
+    std::sort(pages.begin(), pages.end(),
+              [](const StorePage &a, const StorePage &b) { return a.sequence < b.sequence; });
+    return pages;
+}
+
+std::vector<uint8_t> store_stream(const std::vector<StorePage> &pages, log_store_stream_t stream) {
+    std::vector<uint8_t> bytes;
+    for (const StorePage &page : pages) {
+        if (page.stream == stream) {
+            bytes.insert(bytes.end(), page.payload, page.payload + page.length);
+        }
+    }
+    return bytes;
+}
+
+bool write_file(const char *path, const std::vector<uint8_t> &bytes) {
+    FILE *f = std::fopen(path, "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+// ---------------------------------------------------------------------------
+// Frame decoding
+
+struct Boot {
+    size_t first_frame;      // Index in the chunk of its first frame
+    uint16_t loop_rate_hz;
+};
+
+struct Chunk {
+    size_t begin, end;       // Frames starting in [begin, end) belong here
+    size_t first = SIZE_MAX; // Offset of the first header or frame decoded
+    size_t next = 0;         // Where decoding continues after this chunk
+    size_t skipped = 0;      // Bytes that did not decode
+    bool bad_version = false;
+    std::vector<blackbox_frame_t> frames;
+    std::vector<Boot> boots;
+
+    // Filled by the timeline pass
+    std::vector<uint16_t> session;
+    std::vector<uint64_t> time_us;
+};
+
+class Decoder {
+public:
+    Decoder(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+    // Decode the frames starting in [chunk.begin, chunk.end). A chunk cut
+    // at an arbitrary offset finds its first frame by resync, and the bytes
+    // it passes over belong to the previous chunk. A chunk known to start
+    // on a boundary counts any bytes it cannot decode there; previous is
+    // the frame before it, if any, for the sequence check.
+    void decode(Chunk &chunk, bool on_boundary, const blackbox_frame_header_t *previous) const {
+        chunk.frames.clear();
+        chunk.boots.clear();
+        chunk.first = SIZE_MAX;
+        chunk.skipped = 0;
+
+        blackbox_frame_header_t last{};
+        bool have_last = previous != nullptr;
+        if (have_last) {
+            last = *previous;
+        }
+
+        size_t at = chunk.begin;
+        if (!on_boundary) {
+            at = resync(at);
+        }
+        while (at < chunk.end) {
+            if (is_file_header(at)) {
+                blackbox_file_header_t header;
+                std::memcpy(&header, data + at, sizeof(header));
+                if (header.version != BLACKBOX_VERSION || header.field_count != BLACKBOX_FIELD_COUNT) {
+                    chunk.bad_version = true;
+                }
+                mark_first(chunk, at);
+                chunk.boots.push_back({ chunk.frames.size(), header.loop_rate_hz });
+                at += sizeof(header);
+                have_last = false;
+                continue;
+            }
+
+            size_t length;
+            blackbox_frame_header_t header;
+            if (!frame_at(at, header, length) || (have_last && !follows(last, header)) ||
+                !continues(at + length, header)) {
+                // Not a frame, or one cut short; skip at least this byte
+                size_t found = resync(at + 1);
+                chunk.skipped += found - at;
+                at = found;
+                have_last = false;
+                continue;
+            }
+
+            mark_first(chunk, at);
+            chunk.frames.push_back(unpack(at, header));
+            last = header;
+            have_last = true;
+            at += length;
+        }
+        chunk.next = at;
+    }
+
+private:
+    bool is_file_header(size_t at) const {
+        uint32_t magic;
+        if (at + sizeof(blackbox_file_header_t) > size) {
+            return false;
+        }
+        std::memcpy(&magic, data + at, sizeof(magic));
+        return magic == BLACKBOX_MAGIC;
+    }
+
+    // Frame header at an offset and the packed frame length, if it fits
+    bool frame_at(size_t at, blackbox_frame_header_t &header, size_t &length) const {
+        if (at + sizeof(header) > size || data[at] != BLACKBOX_SYNC) {
+            return false;
+        }
+        std::memcpy(&header, data + at, sizeof(header));
+        if (header.fields == 0 || header.fields >= (1u << BLACKBOX_FIELD_COUNT)) {
+            return false;
+        }
+        length = sizeof(header);
+        for (int f = 0; f < BLACKBOX_FIELD_COUNT; f++) {
+            if (header.fields & BLACKBOX_FIELD_BIT(f)) {
+                length += FIELD_SIZE[f];
+            }
+        }
+        return at + length <= size;
+    }
+
+    static bool follows(const blackbox_frame_header_t &last, const blackbox_frame_header_t &next) {
+        uint16_t step = (uint16_t)(next.sequence - last.sequence);
+        uint32_t elapsed = next.timestamp_us - last.timestamp_us;
+        return step >= 1 && step <= MAX_SEQUENCE_STEP && elapsed <= MAX_TIMESTAMP_STEP_US;
+    }
+
+    // What comes after a frame must be the end, the header of a frame
+    // that follows it (whole or cut short by the end of the data) or a
+    // file header, possibly after a frame cut short by a power loss;
+    // otherwise this frame was the one cut short
+    bool continues(size_t at, const blackbox_frame_header_t &header) const {
+        if (at + sizeof(blackbox_frame_header_t) > size) {
+            return true;
+        }
+        blackbox_frame_header_t next;
+        std::memcpy(&next, data + at, sizeof(next));
+        if (next.sync == BLACKBOX_SYNC && next.fields != 0 && next.fields < (1u << BLACKBOX_FIELD_COUNT) &&
+            follows(header, next)) {
+            return true;
+        }
+        for (size_t i = at; i < at + MAX_FRAME_BYTES && i < size; i++) {
+            if (is_file_header(i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // First offset from at that starts a file header or RESYNC_CHAIN
+    // frames that follow each other
+    size_t resync(size_t at) const {
+        for (; at < size; at++) {
+            if (is_file_header(at)) {
+                return at;
+            }
+            if (data[at] != BLACKBOX_SYNC) {
+                continue;
+            }
+            size_t probe = at;
+            blackbox_frame_header_t last{}, header;
+            size_t length;
+            int chained = 0;
+            while (chained < RESYNC_CHAIN && frame_at(probe, header, length) &&
+                   (chained == 0 || follows(last, header))) {
+                last = header;
+                probe += length;
+                chained++;
+                if (probe >= size || is_file_header(probe)) {
+                    chained = RESYNC_CHAIN;
+                }
+            }
+            if (chained == RESYNC_CHAIN) {
+                return at;
+            }
+        }
+        return size;
+    }
+
+    blackbox_frame_t unpack(size_t at, const blackbox_frame_header_t &header) const {
+        blackbox_frame_t frame;
+        std::memset(&frame, 0, sizeof(frame));
+        frame.header = header;
+        const uint8_t *in = data + at + sizeof(header);
+        if (header.fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_GYRO)) {
+            std::memcpy(frame.gyro, in, BLACKBOX_FIELD_GYRO_SIZE);
+            in += BLACKBOX_FIELD_GYRO_SIZE;
+        }
+        if (header.fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_ATTITUDE)) {
+            std::memcpy(frame.attitude, in, BLACKBOX_FIELD_ATTITUDE_SIZE);
+            in += BLACKBOX_FIELD_ATTITUDE_SIZE;
+        }
+        if (header.fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_SETPOINT)) {
+            std::memcpy(frame.setpoint, in, BLACKBOX_FIELD_SETPOINT_SIZE);
+            in += BLACKBOX_FIELD_SETPOINT_SIZE;
+        }
+        if (header.fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_PID)) {
+            std::memcpy(frame.pid_p, in, sizeof(frame.pid_p));
+            std::memcpy(frame.pid_i, in + 12, sizeof(frame.pid_i));
+            std::memcpy(frame.pid_d, in + 24, sizeof(frame.pid_d));
+            in += BLACKBOX_FIELD_PID_SIZE;
+        }
+        if (header.fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_MOTOR)) {
+            std::memcpy(frame.motor, in, BLACKBOX_FIELD_MOTOR_SIZE);
+        }
+        return frame;
+    }
+
+    static void mark_first(Chunk &chunk, size_t at) {
+        if (chunk.first == SIZE_MAX) {
+            chunk.first = at;
+        }
+    }
+
+    const uint8_t *data;
+    size_t size;
+};
+
+// Decode in parallel, then stitch: a chunk that did not start where the
+// previous one stopped is decoded again from there
+std::vector<Chunk> decode_all(const uint8_t *data, size_t size, unsigned threads) {
+    size_t chunk_bytes = std::max(MIN_CHUNK_BYTES, size / (threads * 4) + 1);
+    std::vector<Chunk> chunks;
+    for (size_t begin = 0; begin < size; begin += chunk_bytes) {
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = std::min(size, begin + chunk_bytes);
+        chunks.push_back(std::move(chunk));
+    }
+
+    Decoder decoder(data, size);
+    parallel_for(chunks.size(), threads, [&](size_t i) {
+        decoder.decode(chunks[i], i == 0, nullptr);
+    });
+
+    const blackbox_frame_header_t *last = nullptr;
+    for (size_t i = 1; i < chunks.size(); i++) {
+        const Chunk &before = chunks[i - 1];
+        if (!before.boots.empty()) {
+            last = before.frames.size() > before.boots.back().first_frame ? &before.frames.back().header : nullptr;
+        } else if (!before.frames.empty()) {
+            last = &before.frames.back().header;
+        }
+
+        Chunk &chunk = chunks[i];
+        size_t expected = before.next;
+        if (expected >= chunk.end) {
+            // The previous chunk's last frame or resync ran past this one
+            chunk.frames.clear();
+            chunk.boots.clear();
+            chunk.skipped = 0;
+            chunk.next = expected;
+        } else if (chunk.first != expected) {
+            chunk.begin = expected;
+            decoder.decode(chunk, true, last);
+        }
+    }
+    return chunks;
+}
+
+// ---------------------------------------------------------------------------
+// Timeline: boots and unwrapped timestamps
+
+struct Session {
+    uint16_t loop_rate_hz = 0;
+    size_t frames = 0;
+    uint64_t dropped = 0;
+    uint64_t first_us = 0, last_us = 0;
+};
+
+std::vector<Session> build_timeline(std::vector<Chunk> &chunks) {
+    std::vector<Session> sessions;
+    uint64_t time_us = 0;
+    blackbox_frame_header_t last{};
+    bool have_last = false;
+
+    for (Chunk &chunk : chunks) {
+        chunk.session.resize(chunk.frames.size());
+        chunk.time_us.resize(chunk.frames.size());
+        size_t boot = 0;
+        for (size_t i = 0; i < chunk.frames.size(); i++) {
+            while (boot < chunk.boots.size() && chunk.boots[boot].first_frame == i) {
+                Session s;
+                s.loop_rate_hz = chunk.boots[boot].loop_rate_hz;
+                sessions.push_back(s);
+                have_last = false;
+                boot++;
+            }
+            if (sessions.empty()) {
+                // Frames before any file header, e.g. the oldest flash pages
+                sessions.push_back(Session());
+            }
+
+            const blackbox_frame_header_t &header = chunk.frames[i].header;
+            Session &s = sessions.back();
+            if (!have_last) {
+                time_us = header.timestamp_us;
+                s.first_us = s.frames == 0 ? time_us : s.first_us;
+            } else {
+                time_us += (uint32_t)(header.timestamp_us - last.timestamp_us);
+                uint16_t step = (uint16_t)(header.sequence - last.sequence);
+                if (step >= 1 && step <= MAX_SEQUENCE_STEP) {
+                    s.dropped += step - 1;
+                }
+            }
+            s.frames++;
+            s.last_us = time_us;
+            chunk.session[i] = (uint16_t)(sessions.size() - 1);
+            chunk.time_us[i] = time_us;
+            last = header;
+            have_last = true;
+        }
+        while (boot < chunk.boots.size()) {
+            Session s;
+            s.loop_rate_hz = chunk.boots[boot++].loop_rate_hz;
+            sessions.push_back(s);
+            have_last = false;
+        }
+    }
+    return sessions;
+}
+
+// Every frame in order with its session and time
+template <typename Fn>
+void for_each_frame(const std::vector<Chunk> &chunks, Fn fn) {
+    for (const Chunk &chunk : chunks) {
+        for (size_t i = 0; i < chunk.frames.size(); i++) {
+            fn(chunk.frames[i], chunk.session[i], chunk.time_us[i]);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+
+double percentile(std::vector<uint32_t> &values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t k = (size_t)(p * (double)(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + (long)k, values.end());
+    return values[k];
+}
+
+struct IntervalStats {
+    size_t count = 0;
+    double median_us = 0, mean_us = 0, stddev_us = 0, p99_us = 0, max_us = 0;
+    size_t late = 0;         // Longer than 1.5 median intervals
+};
+
+// Intervals between consecutive samples of a field within each boot;
+// those spanning dropped frames are counted as drops, not jitter
+IntervalStats intervals(const std::vector<Chunk> &chunks, uint8_t field_bit) {
+    std::vector<uint32_t> dt;
+    uint64_t previous = 0;
+    int session = -1;
+    uint16_t last_sequence = 0;
+    bool gap = true;
+    for_each_frame(chunks, [&](const blackbox_frame_t &frame, uint16_t s, uint64_t t) {
+        if (s != session || (uint16_t)(frame.header.sequence - last_sequence) != 1) {
+            gap = true;
+        }
+        last_sequence = frame.header.sequence;
+        if ((frame.header.fields & field_bit) == 0) {
+            session = s;
+            return;
+        }
+        if (s == session && !gap) {
+            dt.push_back((uint32_t)std::min<uint64_t>(t - previous, UINT32_MAX));
+        }
+        session = s;
+        previous = t;
+        gap = false;
+    });
+
+    IntervalStats stats;
+    stats.count = dt.size();
+    if (dt.empty()) {
+        return stats;
+    }
+    double sum = 0, sum_sq = 0, max = 0;
+    for (uint32_t v : dt) {
+        sum += v;
+        sum_sq += (double)v * v;
+        max = std::max(max, (double)v);
+    }
+    stats.mean_us = sum / (double)dt.size();
+    stats.stddev_us = std::sqrt(std::max(0.0, sum_sq / (double)dt.size() - stats.mean_us * stats.mean_us));
+    stats.max_us = max;
+    stats.median_us = percentile(dt, 0.5);
+    stats.p99_us = percentile(dt, 0.99);
+    for (uint32_t v : dt) {
+        if (v > stats.median_us * 1.5) {
+            stats.late++;
+        }
+    }
+    return stats;
+}
+
+void print_intervals(FILE *out, const char *label, const IntervalStats &s) {
+    if (s.count == 0) {
+        return;
+    }
+    std::fprintf(out, "  %-8s median %.1f us (%.1f Hz), mean %.1f, jitter %.2f us rms, p99 %.1f, max %.0f, "
+                      "%zu late of %zu\n",
+                 label, s.median_us, s.median_us > 0 ? 1e6 / s.median_us : 0.0, s.mean_us, s.stddev_us,
+                 s.p99_us, s.max_us, s.late, s.count);
+}
+
+void print_pid_rms(FILE *out, const std::vector<Chunk> &chunks) {
+    double sum[3][3] = {};
+    size_t count = 0;
+    for_each_frame(chunks, [&](const blackbox_frame_t &frame, uint16_t, uint64_t) {
+        if ((frame.header.fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_PID)) == 0) {
+            return;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            sum[0][axis] += (double)frame.pid_p[axis] * frame.pid_p[axis];
+            sum[1][axis] += (double)frame.pid_i[axis] * frame.pid_i[axis];
+            sum[2][axis] += (double)frame.pid_d[axis] * frame.pid_d[axis];
+        }
+        count++;
+    });
+    if (count == 0) {
+        return;
+    }
+    const char *terms = "PID";
+    std::fprintf(out, "PID term RMS (roll, pitch, yaw) over %zu samples\n", count);
+    for (int term = 0; term < 3; term++) {
+        std::fprintf(out, "  %c  %10.4f %10.4f %10.4f\n", terms[term], std::sqrt(sum[term][0] / (double)count),
+                     std::sqrt(sum[term][1] / (double)count), std::sqrt(sum[term][2] / (double)count));
+    }
+}
+
+// Time each motor spent at either end of the ESC range while armed; a
+// sample holds until the next one, at most two median intervals
+void print_motor_saturation(FILE *out, const std::vector<Chunk> &chunks, double median_us,
+                            uint16_t min_us, uint16_t max_us) {
+    double armed = 0, any = 0, low[4] = {}, high[4] = {};
+    bool have_previous = false;
+    blackbox_frame_t previous;
+    uint16_t previous_session = 0;
+    uint64_t previous_time = 0;
+    double hold_max = median_us * 2;
+
+    auto account = [&](const blackbox_frame_t &frame, double dt) {
+        bool armed_now = false, saturated = false;
+        for (int m = 0; m < 4; m++) {
+            uint16_t us = frame.motor[m];
+            armed_now |= us > 0;
+            if (us >= max_us) {
+                high[m] += dt;
+                saturated = true;
+            } else if (us > 0 && us <= min_us) {
+                low[m] += dt;
+                saturated = true;
+            }
+        }
+        if (armed_now) {
+            armed += dt;
+        }
+        if (saturated) {
+            any += dt;
+        }
+    };
+    for_each_frame(chunks, [&](const blackbox_frame_t &frame, uint16_t s, uint64_t t) {
+        if ((frame.header.fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_MOTOR)) == 0) {
+            return;
+        }
+        if (have_previous) {
+            double dt = s == previous_session ? std::min((double)(t - previous_time), hold_max) : median_us;
+            account(previous, dt * 1e-6);
+        }
+        previous = frame;
+        previous_session = s;
+        previous_time = t;
+        have_previous = true;
+    });
+    if (have_previous) {
+        account(previous, median_us * 1e-6);
+    }
+    if (armed <= 0) {
+        return;
+    }
+
+    std::fprintf(out, "Motor saturation over %.1f s armed (low <= %u us, high >= %u us)\n",
+                 armed, (unsigned)min_us, (unsigned)max_us);
+    for (int m = 0; m < 4; m++) {
+        std::fprintf(out, "  motor %d  low %7.2f s (%5.2f%%)  high %7.2f s (%5.2f%%)\n", m, low[m],
+                     100 * low[m] / armed, high[m], 100 * high[m] / armed);
+    }
+    std::fprintf(out, "  any      %7.2f s (%5.2f%%)\n", any, 100 * any / armed);
+}
+
+// In-place radix-2 FFT, size a power of two
+void fft(std::vector<std::complex<double>> &x, const std::vector<std::complex<double>> &twiddle) {
+    size_t n = x.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(x[i], x[j]);
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        size_t stride = n / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                std::complex<double> w = twiddle[k * stride] * x[i + k + len / 2];
+                x[i + k + len / 2] = x[i + k] - w;
+                x[i + k] += w;
+            }
+        }
+    }
+}
+
+struct Spectrum {
+    double sample_hz = 0;
+    size_t segments = 0;
+    std::vector<double> psd[3];   // One-sided, (rad/s)^2/Hz, bins 0..n/2
+};
+
+// Welch estimate over runs of gyro samples without gaps
+Spectrum gyro_spectrum(const std::vector<Chunk> &chunks, double median_us, size_t n, unsigned threads) {
+    Spectrum spectrum;
+    if (median_us <= 0) {
+        return spectrum;
+    }
+    spectrum.sample_hz = 1e6 / median_us;
+
+    std::vector<float> samples[3];
+    std::vector<size_t> segment_starts;
+    size_t run_start = 0;
+    int session = -1;
+    uint64_t previous = 0;
+    for_each_frame(chunks, [&](const blackbox_frame_t &frame, uint16_t s, uint64_t t) {
+        if ((frame.header.fields & BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_GYRO)) == 0) {
+            return;
+        }
+        size_t index = samples[0].size();
+        if (s != session || (double)(t - previous) > median_us * 1.5) {
+            run_start = index;
+        }
+        session = s;
+        previous = t;
+        for (int axis = 0; axis < 3; axis++) {
+            samples[axis].push_back(frame.gyro[axis]);
+        }
+        // A segment ends at every half length along an unbroken run
+        size_t length = index + 1 - run_start;
+        if (length >= n && (length - n) % (n / 2) == 0) {
+            segment_starts.push_back(index + 1 - n);
+        }
+    });
+    spectrum.segments = segment_starts.size();
+    for (int axis = 0; axis < 3; axis++) {
+        spectrum.psd[axis].assign(n / 2 + 1, 0.0);
+    }
+    if (segment_starts.empty()) {
+        return spectrum;
+    }
+
+    std::vector<double> window(n);
+    double window_power = 0;
+    for (size_t i = 0; i < n; i++) {
+        window[i] = 0.5 - 0.5 * std::cos(2 * M_PI * (double)i / (double)n);
+        window_power += window[i] * window[i];
+    }
+    std::vector<std::complex<double>> twiddle(n / 2);
+    for (size_t k = 0; k < n / 2; k++) {
+        twiddle[k] = std::polar(1.0, -2 * M_PI * (double)k / (double)n);
+    }
+
+    // Each worker sums its own share of the segments
+    unsigned workers = std::max(1u, std::min<unsigned>(threads, (unsigned)segment_starts.size()));
+    std::vector<std::vector<double>> partial(workers * 3, std::vector<double>(n / 2 + 1, 0.0));
+    parallel_for(workers, workers, [&](size_t w) {
+        std::vector<std::complex<double>> x(n);
+        for (size_t seg = w; seg < segment_starts.size(); seg += workers) {
+            size_t start = segment_starts[seg];
+            for (int axis = 0; axis < 3; axis++) {
+                const float *in = &samples[axis][start];
+                double mean = 0;
+                for (size_t i = 0; i < n; i++) {
+                    mean += in[i];
+                }
+                mean /= (double)n;
+                for (size_t i = 0; i < n; i++) {
+                    x[i] = (in[i] - mean) * window[i];
+                }
+                fft(x, twiddle);
+                std::vector<double> &acc = partial[w * 3 + axis];
+                for (size_t k = 0; k <= n / 2; k++) {
+                    acc[k] += std::norm(x[k]);
+                }
+            }
+        }
+    });
+
+    double scale = 1.0 / (spectrum.sample_hz * window_power * (double)segment_starts.size());
+    for (int axis = 0; axis < 3; axis++) {
+        for (unsigned w = 0; w < workers; w++) {
+            for (size_t k = 0; k <= n / 2; k++) {
+                spectrum.psd[axis][k] += partial[w * 3 + axis][k];
+            }
+        }
+        for (size_t k = 0; k <= n / 2; k++) {
+            spectrum.psd[axis][k] *= scale * (k == 0 || k == n / 2 ? 1.0 : 2.0);
+        }
+    }
+    return spectrum;
+}
+
+void print_spectrum(FILE *out, const Spectrum &spectrum) {
+    if (spectrum.segments == 0) {
+        return;
+    }
+    size_t bins = spectrum.psd[0].size();
+    double bin_hz = spectrum.sample_hz / (double)((bins - 1) * 2);
+    std::fprintf(out, "Gyro noise, %zu segments of %zu samples at %.1f Hz (%.2f Hz bins)\n",
+                 spectrum.segments, (bins - 1) * 2, spectrum.sample_hz, bin_hz);
+
+    const char *axes[3] = { "roll", "pitch", "yaw" };
+    for (int axis = 0; axis < 3; axis++) {
+        const std::vector<double> &psd = spectrum.psd[axis];
+        double total = 0, noise = 0;
+        for (size_t k = 1; k < bins; k++) {
+            total += psd[k] * bin_hz;
+            if ((double)k * bin_hz >= NOISE_FLOOR_HZ) {
+                noise += psd[k] * bin_hz;
+            }
+        }
+
+        // Largest local maxima above the noise floor frequency
+        std::vector<size_t> peaks;
+        for (size_t k = 1; k + 1 < bins; k++) {
+            if ((double)k * bin_hz >= NOISE_FLOOR_HZ && psd[k] > psd[k - 1] && psd[k] >= psd[k + 1]) {
+                peaks.push_back(k);
+            }
+        }
+        std::sort(peaks.begin(), peaks.end(), [&](size_t a, size_t b) { return psd[a] > psd[b]; });
+
+        std::fprintf(out, "  %-6s rms %.5f rad/s above %.1f Hz, %.5f above %.0f Hz, peaks", axes[axis],
+                     std::sqrt(total), bin_hz, std::sqrt(noise), NOISE_FLOOR_HZ);
+        for (size_t i = 0; i < peaks.size() && i < 3; i++) {
+            std::fprintf(out, " %.1f Hz (%.2e)", (double)peaks[i] * bin_hz, std::sqrt(psd[peaks[i]]));
+        }
+        std::fprintf(out, "\n");
+    }
+}
+
+bool write_spectrum(const char *path, const Spectrum &spectrum) {
+    FILE *f = std::fopen(path, "w");
+    if (f == nullptr) {
+        return false;
+    }
+    size_t bins = spectrum.psd[0].size();
+    double bin_hz = bins > 1 ? spectrum.sample_hz / (double)((bins - 1) * 2) : 0.0;
+    std::fprintf(f, "freq_hz,psd_roll,psd_pitch,psd_yaw\n");
+    for (size_t k = 0; k < bins; k++) {
+        std::fprintf(f, "%.3f,%.6e,%.6e,%.6e\n", (double)k * bin_hz, spectrum.psd[0][k], spectrum.psd[1][k],
+                     spectrum.psd[2][k]);
+    }
+    return std::fclose(f) == 0;
+}
+
+// ---------------------------------------------------------------------------
+// Export
+
+struct Column {
+    const char *name;
+    blackbox_field_t field;
+    size_t offset;           // In blackbox_frame_t
+    bool is_motor;           // uint16_t rather than float
+};
+
+#define FLOAT_COLUMN(name, field, member) { name, field, offsetof(blackbox_frame_t, member), false }
+#define MOTOR_COLUMN(name, index) \
+    { name, BLACKBOX_FIELD_MOTOR, offsetof(blackbox_frame_t, motor) + (index) * sizeof(uint16_t), true }
+
+const Column COLUMNS[] = {
+    FLOAT_COLUMN("gyro_roll", BLACKBOX_FIELD_GYRO, gyro[0]),
+    FLOAT_COLUMN("gyro_pitch", BLACKBOX_FIELD_GYRO, gyro[1]),
+    FLOAT_COLUMN("gyro_yaw", BLACKBOX_FIELD_GYRO, gyro[2]),
+    FLOAT_COLUMN("roll", BLACKBOX_FIELD_ATTITUDE, attitude[0]),
+    FLOAT_COLUMN("pitch", BLACKBOX_FIELD_ATTITUDE, attitude[1]),
+    FLOAT_COLUMN("yaw", BLACKBOX_FIELD_ATTITUDE, attitude[2]),
+    FLOAT_COLUMN("setpoint_roll", BLACKBOX_FIELD_SETPOINT, setpoint[0]),
+    FLOAT_COLUMN("setpoint_pitch", BLACKBOX_FIELD_SETPOINT, setpoint[1]),
+    FLOAT_COLUMN("setpoint_yaw", BLACKBOX_FIELD_SETPOINT, setpoint[2]),
+    FLOAT_COLUMN("throttle", BLACKBOX_FIELD_SETPOINT, setpoint[3]),
+    FLOAT_COLUMN("p_roll", BLACKBOX_FIELD_PID, pid_p[0]),
+    FLOAT_COLUMN("p_pitch", BLACKBOX_FIELD_PID, pid_p[1]),
+    FLOAT_COLUMN("p_yaw", BLACKBOX_FIELD_PID, pid_p[2]),
+    FLOAT_COLUMN("i_roll", BLACKBOX_FIELD_PID, pid_i[0]),
+    FLOAT_COLUMN("i_pitch", BLACKBOX_FIELD_PID, pid_i[1]),
+    FLOAT_COLUMN("i_yaw", BLACKBOX_FIELD_PID, pid_i[2]),
+    FLOAT_COLUMN("d_roll", BLACKBOX_FIELD_PID, pid_d[0]),
+    FLOAT_COLUMN("d_pitch", BLACKBOX_FIELD_PID, pid_d[1]),
+    FLOAT_COLUMN("d_yaw", BLACKBOX_FIELD_PID, pid_d[2]),
+    MOTOR_COLUMN("motor_0", 0),
+    MOTOR_COLUMN("motor_1", 1),
+    MOTOR_COLUMN("motor_2", 2),
+    MOTOR_COLUMN("motor_3", 3),
+};
+
+float column_value(const blackbox_frame_t &frame, const Column &column) {
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(&frame) + column.offset;
+    if (column.is_motor) {
+        uint16_t value;
+        std::memcpy(&value, base, sizeof(value));
+        return value;
+    }
+    float value;
+    std::memcpy(&value, base, sizeof(value));
+    return value;
+}
+
+void append_number(std::string &out, double value) {
+    char buf[32];
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, r.ptr);
+}
+
+void append_number(std::string &out, float value) {
+    char buf[32];
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, r.ptr);
+}
+
+void append_number(std::string &out, uint64_t value) {
+    char buf[24];
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, r.ptr);
+}
+
+// Fields a frame does not carry are left empty
+void format_csv(const Chunk &chunk, std::string &out) {
+    out.reserve(chunk.frames.size() * 160);
+    for (size_t i = 0; i < chunk.frames.size(); i++) {
+        const blackbox_frame_t &frame = chunk.frames[i];
+        append_number(out, (uint64_t)chunk.session[i]);
+        out.push_back(',');
+        append_number(out, (uint64_t)frame.header.sequence);
+        out.push_back(',');
+        append_number(out, (double)chunk.time_us[i] * 1e-6);
+        for (const Column &column : COLUMNS) {
+            out.push_back(',');
+            if (frame.header.fields & BLACKBOX_FIELD_BIT(column.field)) {
+                if (column.is_motor) {
+                    append_number(out, (uint64_t)column_value(frame, column));
+                } else {
+                    append_number(out, column_value(frame, column));
+                }
+            }
+        }
+        out.push_back('\n');
+    }
+}
+
+// Chunks are formatted a batch at a time, in parallel, and written in
+// order; the batch bounds the text held in memory
+bool write_csv(FILE *out, const std::vector<Chunk> &chunks, unsigned threads) {
+    std::string header = "boot,sequence,time_s";
+    for (const Column &column : COLUMNS) {
+        header += ',';
+        header += column.name;
+    }
+    header += '\n';
+    bool ok = std::fwrite(header.data(), 1, header.size(), out) == header.size();
+
+    size_t batch = threads * 2;
+    std::vector<std::string> text(batch);
+    for (size_t first = 0; first < chunks.size() && ok; first += batch) {
+        size_t count = std::min(batch, chunks.size() - first);
+        parallel_for(count, threads, [&](size_t i) {
+            text[i].clear();
+            format_csv(chunks[first + i], text[i]);
+        });
+        for (size_t i = 0; i < count && ok; i++) {
+            ok = std::fwrite(text[i].data(), 1, text[i].size(), out) == text[i].size();
+        }
+    }
+    return ok;
+}
+
+// One .npy file: a version 1.0 header padded to 64 bytes, then the data
+bool write_npy(const std::string &path, const char *dtype, size_t count, size_t item_size,
+               const std::vector<uint8_t> &data) {
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    char dict[128];
+    int length = std::snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (%zu,), }",
+                               dtype, count);
+    std::string header(dict, (size_t)length);
+    size_t total = 10 + header.size() + 1;
+    header.append((64 - total % 64) % 64, ' ');
+    header.push_back('\n');
+    uint16_t header_length = (uint16_t)header.size();
+
+    bool ok = std::fwrite("\x93NUMPY\x01\x00", 1, 8, f) == 8 &&
+              std::fwrite(&header_length, sizeof(header_length), 1, f) == 1 &&
+              std::fwrite(header.data(), 1, header.size(), f) == header.size() &&
+              std::fwrite(data.data(), 1, count * item_size, f) == count * item_size;
+    return std::fclose(f) == 0 && ok;
+}
+
+// Columns as float32 with NaN where a frame lacks the field; boot as
+// uint16, sequence as uint16 and time as float64 seconds
+bool write_columns(const std::string &dir, const std::vector<Chunk> &chunks, unsigned threads) {
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error) {
+        return false;
+    }
+    size_t count = 0;
+    for (const Chunk &chunk : chunks) {
+        count += chunk.frames.size();
+    }
+
+    const size_t column_count = sizeof(COLUMNS) / sizeof(COLUMNS[0]);
+    std::atomic<bool> ok{true};
+    parallel_for(column_count + 3, threads, [&](size_t c) {
+        std::vector<uint8_t> data;
+        bool written;
+        if (c < column_count) {
+            const Column &column = COLUMNS[c];
+            data.resize(count * sizeof(float));
+            float *out = reinterpret_cast<float *>(data.data());
+            for_each_frame(chunks, [&](const blackbox_frame_t &frame, uint16_t, uint64_t) {
+                *out++ = (frame.header.fields & BLACKBOX_FIELD_BIT(column.field)) ? column_value(frame, column)
+                                                                                  : NAN;
+            });
+            written = write_npy(dir + "/" + column.name + ".npy", "<f4", count, sizeof(float), data);
+        } else if (c == column_count) {
+            data.resize(count * sizeof(double));
+            double *out = reinterpret_cast<double *>(data.data());
+            for_each_frame(chunks, [&](const blackbox_frame_t &, uint16_t, uint64_t t) { *out++ = (double)t * 1e-6; });
+            written = write_npy(dir + "/time_s.npy", "<f8", count, sizeof(double), data);
+        } else {
+            bool boot = c == column_count + 1;
+            data.resize(count * sizeof(uint16_t));
+            uint16_t *out = reinterpret_cast<uint16_t *>(data.data());
+            for_each_frame(chunks, [&](const blackbox_frame_t &frame, uint16_t s, uint64_t) {
+                *out++ = boot ? s : frame.header.sequence;
+            });
+            written = write_npy(dir + (boot ? "/boot.npy" : "/sequence.npy"), "<u2", count, sizeof(uint16_t), data);
+        }
+        if (!written) {
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+void usage(const char *program) {
+    std::fprintf(stderr,
+                 "usage: %s [options] flight.bbl|flash.img\n"
+                 "  -j N                 decoding threads (default: every core)\n"
+                 "  --csv FILE           write every frame as CSV, - for stdout\n"
+                 "  --npy DIR            write one NumPy .npy file per column\n"
+                 "  --spectrum FILE      write the gyro noise spectrum as CSV\n"
+                 "  --fft N              spectrum segment length, a power of two (default 512)\n"
+                 "  --motor-range LO:HI  ESC pulse range in us for saturation (default 1000:2000)\n"
+                 "  --store              read a log store flash image (detected otherwise)\n"
+                 "  --trace-out FILE     from a flash image, write the trace stream for trace_decode\n"
+                 "  --text-out FILE      from a flash image, write the text log\n",
+                 program);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    const char *input_path = nullptr;
+    const char *csv_path = nullptr;
+    const char *npy_dir = nullptr;
+    const char *spectrum_path = nullptr;
+    const char *trace_path = nullptr;
+    const char *text_path = nullptr;
+    size_t fft_size = 512;
+    unsigned motor_min = 1000, motor_max = 2000;
+    bool force_store = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-j" && has_value) {
+            threads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--csv" && has_value) {
+            csv_path = argv[++i];
+        } else if (arg == "--npy" && has_value) {
+            npy_dir = argv[++i];
+        } else if (arg == "--spectrum" && has_value) {
+            spectrum_path = argv[++i];
+        } else if (arg == "--fft" && has_value) {
+            fft_size = (size_t)std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--motor-range" && has_value) {
+            if (std::sscanf(argv[++i], "%u:%u", &motor_min, &motor_max) != 2) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (arg == "--store") {
+            force_store = true;
+        } else if (arg == "--trace-out" && has_value) {
+            trace_path = argv[++i];
+        } else if (arg == "--text-out" && has_value) {
+            text_path = argv[++i];
+        } else if (arg[0] != '-' || arg == "-") {
+            input_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (input_path == nullptr || fft_size < 16 || (fft_size & (fft_size - 1)) != 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // The summary moves to stderr when the CSV takes stdout
+    FILE *report = csv_path != nullptr && std::strcmp(csv_path, "-") == 0 ? stderr : stdout;
+
+    Input input;
+    if (!input.open(input_path)) {
+        std::fprintf(stderr, "%s: cannot read\n", input_path);
+        return 1;
+    }
+
+    bool is_bbl = input.size >= sizeof(uint32_t) && std::memcmp(input.data, "FCBB", 4) == 0;
+    if (force_store || (!is_bbl && looks_like_store(input.data, input.size))) {
+        std::vector<StorePage> pages = read_store(input.data, input.size, threads);
+        if (pages.empty()) {
+            std::fprintf(stderr, "%s: no valid log store pages\n", input_path);
+            return 1;
+        }
+        std::vector<uint8_t> streams[LOG_STORE_STREAM_COUNT];
+        for (int s = 0; s < LOG_STORE_STREAM_COUNT; s++) {
+            streams[s] = store_stream(pages, (log_store_stream_t)s);
+        }
+        std::fprintf(report, "Log store image: %zu valid pages, sequences %u to %u; text %zu, trace %zu, "
+                             "blackbox %zu bytes\n",
+                     pages.size(), (unsigned)pages.front().sequence, (unsigned)pages.back().sequence,
+                     streams[LOG_STORE_STREAM_TEXT].size(), streams[LOG_STORE_STREAM_TRACE].size(),
+                     streams[LOG_STORE_STREAM_BLACKBOX].size());
+        if (trace_path != nullptr && !write_file(trace_path, streams[LOG_STORE_STREAM_TRACE])) {
+            std::fprintf(stderr, "%s: cannot write\n", trace_path);
+            return 1;
+        }
+        if (text_path != nullptr && !write_file(text_path, streams[LOG_STORE_STREAM_TEXT])) {
+            std::fprintf(stderr, "%s: cannot write\n", text_path);
+            return 1;
+        }
+        input.assign(std::move(streams[LOG_STORE_STREAM_BLACKBOX]));
+    } else if (trace_path != nullptr || text_path != nullptr) {
+        std::fprintf(stderr, "--trace-out and --text-out need a log store image\n");
+        return 2;
+    }
+
+    std::vector<Chunk> chunks = decode_all(input.data, input.size, threads);
+    for (const Chunk &chunk : chunks) {
+        if (chunk.bad_version) {
+            std::fprintf(stderr, "unsupported blackbox version or field count, expected version %u with %u fields\n",
+                         BLACKBOX_VERSION, BLACKBOX_FIELD_COUNT);
+            return 1;
+        }
+    }
+    std::vector<Session> sessions = build_timeline(chunks);
+
+    size_t frames = 0, skipped = 0;
+    for (const Chunk &chunk : chunks) {
+        frames += chunk.frames.size();
+        skipped += chunk.skipped;
+    }
+    std::fprintf(report, "%zu frames in %zu bytes, %zu bytes skipped, %zu boots\n", frames, input.size, skipped,
+                 sessions.size());
+    for (size_t s = 0; s < sessions.size(); s++) {
+        const Session &session = sessions[s];
+        char rate[32];
+        if (session.loop_rate_hz > 0) {
+            std::snprintf(rate, sizeof(rate), "%u Hz loop", (unsigned)session.loop_rate_hz);
+        } else {
+            std::snprintf(rate, sizeof(rate), "header overwritten");
+        }
+        std::fprintf(report, "  boot %zu: %s, %zu frames, %llu dropped, %.1f s\n", s, rate, session.frames,
+                     (unsigned long long)session.dropped, (double)(session.last_us - session.first_us) * 1e-6);
+    }
+    if (frames == 0) {
+        return 0;
+    }
+
+    IntervalStats loop = intervals(chunks, 0xFF);
+    IntervalStats gyro = intervals(chunks, BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_GYRO));
+    IntervalStats motor = intervals(chunks, BLACKBOX_FIELD_BIT(BLACKBOX_FIELD_MOTOR));
+    std::fprintf(report, "Sample intervals\n");
+    print_intervals(report, "frames", loop);
+    print_intervals(report, "gyro", gyro);
+    print_intervals(report, "motors", motor);
+    print_pid_rms(report, chunks);
+    print_motor_saturation(report, chunks, motor.median_us, (uint16_t)motor_min, (uint16_t)motor_max);
+
+    Spectrum spectrum = gyro_spectrum(chunks, gyro.median_us, fft_size, threads);
+    print_spectrum(report, spectrum);
+    if (spectrum_path != nullptr && !write_spectrum(spectrum_path, spectrum)) {
+        std::fprintf(stderr, "%s: cannot write\n", spectrum_path);
+        return 1;
+    }
+
+    if (csv_path != nullptr) {
+        FILE *out = report == stderr ? stdout : std::fopen(csv_path, "w");
+        if (out == nullptr || !write_csv(out, chunks, threads) || (out != stdout && std::fclose(out) != 0)) {
+            std::fprintf(stderr, "%s: cannot write\n", csv_path);
+            return 1;
+        }
+    }
+    if (npy_dir != nullptr && !write_columns(npy_dir, chunks, threads)) {
+        std::fprintf(stderr, "%s: cannot write\n", npy_dir);
+        return 1;
+    }
+    return 0;
+}
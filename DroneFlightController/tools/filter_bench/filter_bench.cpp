@@ -0,0 +1,218 @@
+//
+//  filter_bench.cpp
+//  DroneFlightController
+//
+//  Host benchmark of the filter bank, built once for the float path and
+//  once with -DFC_USE_FIXED_POINT=1 for the Q16 path:
+//
+//    response    gain of every stage type at its cutoff or notch center,
+//                measured with a steady sine at the firmware's loop rate
+//    constants   compile-time FILTER_STAGE_* coefficients against the
+//                runtime recompute for the same configuration
+//    sample      cost per sample of each stage type and of the gyro and
+//                D-term chains, dynamic notches included
+//    recompute   cost of filter_stage_set_cutoff(), as the dynamic notch
+//                pays it on every retune
+//
+//  Build: c++ -std=c++17 -O2 -I../../src -o filter_bench filter_bench.cpp ../../src/utils/filter_bank.c
+//  Usage: filter_bench [samples]
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "utils/filter_bank.h"
+#include "config/control_config.h"
+
+namespace {
+
+const float SAMPLE_HZ = (float)CONTROL_RATE_LOOP_HZ;
+
+struct StageConfig {
+    const char *name;
+    filter_type_t type;
+    float cutoff_hz;
+    float q;
+};
+
+// The static notch's Q, from frequencies prewarped as FILTER_STAGE_BIQUAD_NOTCH does
+const float NOTCH_Q = (float)FILTER_NOTCH_Q(FILTER_K_CONST(GYRO_NOTCH_HZ, CONTROL_RATE_LOOP_HZ),
+                                            FILTER_K_CONST(GYRO_NOTCH_CUTOFF_HZ, CONTROL_RATE_LOOP_HZ));
+
+const StageConfig STAGES[] = {
+    {"pt1", FILTER_PT1, GYRO_LPF_HZ, 0.0f},
+    {"pt2", FILTER_PT2, GYRO_LPF_HZ, 0.0f},
+    {"pt3", FILTER_PT3, GYRO_LPF_HZ, 0.0f},
+    {"lpf", FILTER_BIQUAD_LPF, DTERM_LPF_HZ, (float)BIQUAD_Q_BUTTERWORTH},
+    {"notch", FILTER_BIQUAD_NOTCH, GYRO_NOTCH_HZ, NOTCH_Q},
+};
+
+// Results are stored so the timed loops are not optimized away
+volatile filter_sample_t sink;
+
+double now_ns() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+filter_sample_t to_sample(float value) {
+#if FC_USE_FIXED_POINT
+    return q16_from_float(value);
+#else
+    return value;
+#endif
+}
+
+float from_sample(filter_sample_t value) {
+#if FC_USE_FIXED_POINT
+    return q16_to_float(value);
+#else
+    return value;
+#endif
+}
+
+float coeff_to_float(filter_coeff_t value) {
+#if FC_USE_FIXED_POINT
+    return (float)value / 1073741824.0f;
+#else
+    return value;
+#endif
+}
+
+// Gain of a chain at frequency_hz from one second of a unit sine, after
+// one second of settling
+double measure_gain(filter_chain_t chain, float frequency_hz) {
+    const int settle = (int)SAMPLE_HZ;
+    const int measure = (int)SAMPLE_HZ;
+    double in_power = 0.0;
+    double out_power = 0.0;
+    for (int n = 0; n < settle + measure; n++) {
+        float input = std::sin(2.0 * M_PI * frequency_hz * n / SAMPLE_HZ);
+        float output = from_sample(filter_chain_apply(&chain, to_sample(input)));
+        if (n >= settle) {
+            in_power += (double)input * input;
+            out_power += (double)output * output;
+        }
+    }
+    return std::sqrt(out_power / in_power);
+}
+
+void run_response() {
+    std::printf("response at %.0f Hz\n", SAMPLE_HZ);
+    for (const StageConfig &config : STAGES) {
+        filter_chain_t chain;
+        filter_chain_init(&chain);
+        filter_chain_add(&chain, config.type, config.cutoff_hz, config.q, SAMPLE_HZ);
+        double gain = measure_gain(chain, config.cutoff_hz);
+        const char *expect = (config.type == FILTER_BIQUAD_NOTCH) ? "notch center" : "-3.0 dB expected";
+        std::printf("  %-6s %6.1f Hz  %7.2f dB  (%s)\n", config.name, config.cutoff_hz,
+                    20.0 * std::log10(std::fmax(gain, 1e-9)), expect);
+    }
+
+    // The lower cutoff given for the static notch
+    filter_chain_t notch;
+    filter_chain_init(&notch);
+    filter_chain_add(&notch, FILTER_BIQUAD_NOTCH, GYRO_NOTCH_HZ, NOTCH_Q, SAMPLE_HZ);
+    std::printf("  notch  %6.1f Hz  %7.2f dB  (lower cutoff, -3.0 dB expected)\n", GYRO_NOTCH_CUTOFF_HZ,
+                20.0 * std::log10(measure_gain(notch, GYRO_NOTCH_CUTOFF_HZ)));
+}
+
+void compare_constants(const char *name, const filter_stage_t &constant, filter_type_t type, float cutoff_hz,
+                       float q) {
+    filter_stage_t runtime;
+    filter_stage_init(&runtime, type, cutoff_hz, q, SAMPLE_HZ);
+    double worst = 0.0;
+    for (int i = 0; i < 5; i++) {
+        worst = std::fmax(worst, std::fabs(coeff_to_float(constant.coeff[i]) - coeff_to_float(runtime.coeff[i])));
+    }
+    std::printf("  %-6s max coefficient difference %.2e\n", name, worst);
+}
+
+void run_constants() {
+    std::printf("constants\n");
+    const filter_stage_t pt1 = FILTER_STAGE_PT1(GYRO_LPF_HZ, CONTROL_RATE_LOOP_HZ);
+    const filter_stage_t pt3 = FILTER_STAGE_PT3(GYRO_LPF_HZ, CONTROL_RATE_LOOP_HZ);
+    const filter_stage_t lpf = FILTER_STAGE_BIQUAD_LPF(DTERM_LPF_HZ, CONTROL_RATE_LOOP_HZ);
+    const filter_stage_t notch = FILTER_STAGE_BIQUAD_NOTCH(GYRO_NOTCH_HZ, GYRO_NOTCH_CUTOFF_HZ, CONTROL_RATE_LOOP_HZ);
+    compare_constants("pt1", pt1, FILTER_PT1, GYRO_LPF_HZ, 0.0f);
+    compare_constants("pt3", pt3, FILTER_PT3, GYRO_LPF_HZ, 0.0f);
+    compare_constants("lpf", lpf, FILTER_BIQUAD_LPF, DTERM_LPF_HZ, (float)BIQUAD_Q_BUTTERWORTH);
+    compare_constants("notch", notch, FILTER_BIQUAD_NOTCH, GYRO_NOTCH_HZ, NOTCH_Q);
+}
+
+// Noisy gyro-like input
+std::vector<filter_sample_t> make_input() {
+    std::vector<filter_sample_t> input(4096);
+    uint32_t seed = 1;
+    for (size_t n = 0; n < input.size(); n++) {
+        seed = seed * 1664525u + 1013904223u;
+        float noise = ((float)(seed >> 8) / 16777216.0f - 0.5f) * 0.5f;
+        input[n] = to_sample(2.0f * std::sin(2.0 * M_PI * 3.0 * n / SAMPLE_HZ) + noise);
+    }
+    return input;
+}
+
+void time_chain(const char *name, filter_chain_t chain, const std::vector<filter_sample_t> &input, long samples) {
+    filter_sample_t output = 0;
+    double start = now_ns();
+    for (long n = 0; n < samples; n++) {
+        output = filter_chain_apply(&chain, input[n & 4095]);
+    }
+    double ns = (now_ns() - start) / samples;
+    sink = output;
+    std::printf("  %-6s %6.1f ns per sample\n", name, ns);
+}
+
+void run_sample(long samples) {
+    std::printf("sample, %ld samples\n", samples);
+    std::vector<filter_sample_t> input = make_input();
+    for (const StageConfig &config : STAGES) {
+        filter_chain_t chain;
+        filter_chain_init(&chain);
+        filter_chain_add(&chain, config.type, config.cutoff_hz, config.q, SAMPLE_HZ);
+        time_chain(config.name, chain, input, samples);
+    }
+
+    filter_chain_t gyro = GYRO_FILTER_CHAIN;
+    for (int i = 0; i < DYN_NOTCH_COUNT; i++) {
+        filter_chain_add(&gyro, FILTER_BIQUAD_NOTCH, DYN_NOTCH_MIN_HZ * (i + 2), DYN_NOTCH_Q, SAMPLE_HZ);
+    }
+    filter_chain_t dterm = DTERM_FILTER_CHAIN;
+    time_chain("gyro", gyro, input, samples);
+    time_chain("dterm", dterm, input, samples);
+}
+
+void run_recompute(long calls) {
+    std::printf("recompute, %ld calls\n", calls);
+    for (const StageConfig &config : STAGES) {
+        filter_stage_t stage;
+        filter_stage_init(&stage, config.type, config.cutoff_hz, config.q, SAMPLE_HZ);
+        double start = now_ns();
+        for (long n = 0; n < calls; n++) {
+            // Sweep the cutoff as the dynamic notch does
+            filter_stage_set_cutoff(&stage, config.cutoff_hz + (float)(n & 63), SAMPLE_HZ);
+        }
+        double ns = (now_ns() - start) / calls;
+        sink = stage.coeff[0];
+        std::printf("  %-6s %6.1f ns per call\n", config.name, ns);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    long samples = (argc > 1) ? std::atol(argv[1]) : 10000000;
+    if (samples <= 0) {
+        std::fprintf(stderr, "usage: %s [samples]\n", argv[0]);
+        return 2;
+    }
+    std::printf("%s path\n", FC_USE_FIXED_POINT ? "Q16" : "float");
+    run_response();
+    run_constants();
+    run_sample(samples);
+    run_recompute(samples / 10);
+    return 0;
+}
@@ -0,0 +1,264 @@
+//
+//  fixed_point_bench.cpp
+//  DroneFlightController
+//
+//  Host accuracy and throughput comparison of the Q16/Q31 kernels against
+//  their float counterparts, on the same synthetic inputs:
+//
+//    pid       pid_compute_axes_q16 against pid_compute_axes, three axes
+//    lowpass   low_pass_filter_q16 against low_pass_filter
+//    map       map_unit_q16 against map, motor output to ESC pulse width
+//    mixer     mixer_mix_q16 against mixer_mix
+//
+//  Errors are the largest difference from the float kernel, in the units
+//  of the output and in Q16 steps; the PID error is mostly its gains
+//  rounded to Q16, e.g. a D gain of 0.002 becomes 131/65536. Times are per call. The host has an
+//  FPU, so its float times are far below the soft-float cost on the
+//  Cortex-M0+; the Q16 times are what the integer kernels cost and scale
+//  with the target's clock. The filter chains are measured by
+//  tools/filter_bench, built once per path.
+//
+//  Build: c++ -std=c++17 -O2 -I../../src -o fixed_point_bench fixed_point_bench.cpp
+//             ../../src/controllers/pid_controller.c ../../src/controllers/mixer.c
+//             ../../src/utils/filter_bank.c ../../src/utils/math_utils.c
+//  Usage: fixed_point_bench [calls]
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "controllers/pid_controller.h"
+#include "controllers/mixer.h"
+#include "utils/math_utils.h"
+#include "config/control_config.h"
+
+namespace {
+
+const int TRACE_LENGTH = 4096;
+const uint32_t PERIOD_US = 1000000 / CONTROL_RATE_LOOP_HZ;
+
+// Results are stored so the timed loops are not optimized away
+volatile float float_sink;
+volatile q16_t fixed_sink;
+
+void keep(float value, q16_t value_q16) {
+    float_sink = value;
+    fixed_sink = value_q16;
+}
+
+double now_ns() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Uniform values in [lo, hi) from a fixed seed
+std::vector<float> make_inputs(int count, float lo, float hi, uint32_t seed) {
+    std::vector<float> values(count);
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        values[i] = lo + (hi - lo) * ((float)(seed >> 8) / 16777216.0f);
+    }
+    return values;
+}
+
+std::vector<q16_t> to_q16(const std::vector<float> &values) {
+    std::vector<q16_t> fixed(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        fixed[i] = q16_from_float(values[i]);
+    }
+    return fixed;
+}
+
+struct Result {
+    double max_error = 0.0;
+    double float_ns = 0.0;
+    double fixed_ns = 0.0;
+};
+
+void print_result(const char *name, const char *unit, const Result &result) {
+    std::printf("  %-8s max error %10.6f %-4s (%6.1f Q16 steps)  float %6.1f ns  q16 %6.1f ns\n", name,
+                result.max_error, unit, result.max_error * 65536.0, result.float_ns, result.fixed_ns);
+}
+
+Result bench_pid(long calls) {
+    const float gains[PID_AXIS_COUNT][3] = {
+        {RATE_ROLL_P, RATE_ROLL_I, RATE_ROLL_D},
+        {RATE_PITCH_P, RATE_PITCH_I, RATE_PITCH_D},
+        {RATE_YAW_P, RATE_YAW_I, RATE_YAW_D},
+    };
+    pid_axes_t pid;
+    pid_axes_q16_t pid_q16;
+    pid_axes_init(&pid);
+    pid_axes_q16_init(&pid_q16);
+    for (int i = 0; i < PID_AXIS_COUNT; i++) {
+        pid_axes_set_gains(&pid, (pid_axis_t)i, gains[i][0], gains[i][1], gains[i][2]);
+        pid_axes_q16_set_gains(&pid_q16, (pid_axis_t)i, gains[i][0], gains[i][1], gains[i][2]);
+    }
+
+    // Rate setpoint sweeps and a lagging, noisy gyro, rad/s
+    std::vector<float> setpoint(TRACE_LENGTH * PID_AXIS_COUNT);
+    std::vector<float> measured = make_inputs(TRACE_LENGTH * PID_AXIS_COUNT, -0.05f, 0.05f, 2);
+    for (int n = 0; n < TRACE_LENGTH; n++) {
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            float t = n * PERIOD_US * 1e-6f;
+            setpoint[n * PID_AXIS_COUNT + i] = 3.0f * std::sin(2.0f * 3.14159265f * (1.0f + i) * t);
+            measured[n * PID_AXIS_COUNT + i] += 3.0f * std::sin(2.0f * 3.14159265f * (1.0f + i) * (t - 0.01f));
+        }
+    }
+    std::vector<q16_t> setpoint_q16 = to_q16(setpoint);
+    std::vector<q16_t> measured_q16 = to_q16(measured);
+
+    const float dt = PERIOD_US * 1e-6f;
+    const q31_t dt_q31 = (q31_t)((int64_t)PERIOD_US * ((int64_t)1 << Q31_FRAC_BITS) / 1000000);
+    const q16_t inv_dt_q16 = (q16_t)((int64_t)Q16_ONE * 1000000 / PERIOD_US);
+
+    Result result;
+    float output[PID_AXIS_COUNT];
+    q16_t output_q16[PID_AXIS_COUNT];
+    for (int n = 0; n < TRACE_LENGTH; n++) {
+        pid_compute_axes(&pid, &setpoint[n * PID_AXIS_COUNT], &measured[n * PID_AXIS_COUNT], output, dt);
+        pid_compute_axes_q16(&pid_q16, &setpoint_q16[n * PID_AXIS_COUNT], &measured_q16[n * PID_AXIS_COUNT],
+                             output_q16, dt_q31, inv_dt_q16);
+        for (int i = 0; i < PID_AXIS_COUNT; i++) {
+            result.max_error = std::fmax(result.max_error, std::fabs(output[i] - q16_to_float(output_q16[i])));
+        }
+    }
+
+    float sink = 0.0f;
+    double start = now_ns();
+    for (long n = 0; n < calls; n++) {
+        int row = (int)(n % TRACE_LENGTH) * PID_AXIS_COUNT;
+        pid_compute_axes(&pid, &setpoint[row], &measured[row], output, dt);
+        sink += output[0];
+    }
+    result.float_ns = (now_ns() - start) / calls;
+
+    q16_t sink_q16 = 0;
+    start = now_ns();
+    for (long n = 0; n < calls; n++) {
+        int row = (int)(n % TRACE_LENGTH) * PID_AXIS_COUNT;
+        pid_compute_axes_q16(&pid_q16, &setpoint_q16[row], &measured_q16[row], output_q16, dt_q31, inv_dt_q16);
+        sink_q16 += output_q16[0];
+    }
+    result.fixed_ns = (now_ns() - start) / calls;
+    keep(sink, sink_q16);
+    return result;
+}
+
+Result bench_lowpass(long calls) {
+    std::vector<float> input = make_inputs(TRACE_LENGTH, -4.0f, 4.0f, 3);
+    std::vector<q16_t> input_q16 = to_q16(input);
+    const float alpha = 0.2f;
+    const q31_t alpha_q31 = q31_from_float(alpha);
+
+    Result result;
+    float output = 0.0f;
+    q16_t output_q16 = 0;
+    for (int n = 0; n < TRACE_LENGTH; n++) {
+        output = low_pass_filter(input[n], output, alpha);
+        output_q16 = low_pass_filter_q16(input_q16[n], output_q16, alpha_q31);
+        result.max_error = std::fmax(result.max_error, std::fabs(output - q16_to_float(output_q16)));
+    }
+
+    double start = now_ns();
+    for (long n = 0; n < calls; n++) {
+        output = low_pass_filter(input[n % TRACE_LENGTH], output, alpha);
+    }
+    result.float_ns = (now_ns() - start) / calls;
+
+    start = now_ns();
+    for (long n = 0; n < calls; n++) {
+        output_q16 = low_pass_filter_q16(input_q16[n % TRACE_LENGTH], output_q16, alpha_q31);
+    }
+    result.fixed_ns = (now_ns() - start) / calls;
+    keep(output, output_q16);
+    return result;
+}
+
+Result bench_map(long calls) {
+    std::vector<float> input = make_inputs(TRACE_LENGTH, 0.0f, 1.0f, 4);
+    std::vector<q16_t> input_q16 = to_q16(input);
+    const q16_t low = Q16_CONST(1000);
+    const q16_t high = Q16_CONST(2000);
+
+    Result result;
+    for (int n = 0; n < TRACE_LENGTH; n++) {
+        float output = map(input[n], 0.0f, 1.0f, 1000.0f, 2000.0f);
+        q16_t output_q16 = map_unit_q16(input_q16[n], low, high);
+        result.max_error = std::fmax(result.max_error, std::fabs(output - q16_to_float(output_q16)));
+    }
+
+    float sink = 0.0f;
+    double start = now_ns();
+    for (long n = 0; n < calls; n++) {
+        sink += map(input[n % TRACE_LENGTH], 0.0f, 1.0f, 1000.0f, 2000.0f);
+    }
+    result.float_ns = (now_ns() - start) / calls;
+
+    q16_t sink_q16 = 0;
+    start = now_ns();
+    for (long n = 0; n < calls; n++) {
+        sink_q16 += map_unit_q16(input_q16[n % TRACE_LENGTH], low, high);
+    }
+    result.fixed_ns = (now_ns() - start) / calls;
+    keep(sink, sink_q16);
+    return result;
+}
+
+Result bench_mixer(long calls) {
+    std::vector<float> throttle = make_inputs(TRACE_LENGTH, 0.0f, 1.0f, 5);
+    std::vector<float> axis = make_inputs(TRACE_LENGTH * PID_AXIS_COUNT, -1.0f, 1.0f, 6);
+    std::vector<q16_t> throttle_q16 = to_q16(throttle);
+    std::vector<q16_t> axis_q16 = to_q16(axis);
+
+    Result result;
+    float motor[MIXER_MOTOR_COUNT];
+    q16_t motor_q16[MIXER_MOTOR_COUNT];
+    for (int n = 0; n < TRACE_LENGTH; n++) {
+        mixer_mix(throttle[n], &axis[n * PID_AXIS_COUNT], motor);
+        mixer_mix_q16(throttle_q16[n], &axis_q16[n * PID_AXIS_COUNT], motor_q16);
+        for (int m = 0; m < MIXER_MOTOR_COUNT; m++) {
+            result.max_error = std::fmax(result.max_error, std::fabs(motor[m] - q16_to_float(motor_q16[m])));
+        }
+    }
+
+    float sink = 0.0f;
+    double start = now_ns();
+    for (long n = 0; n < calls; n++) {
+        int row = (int)(n % TRACE_LENGTH);
+        mixer_mix(throttle[row], &axis[row * PID_AXIS_COUNT], motor);
+        sink += motor[0];
+    }
+    result.float_ns = (now_ns() - start) / calls;
+
+    q16_t sink_q16 = 0;
+    start = now_ns();
+    for (long n = 0; n < calls; n++) {
+        int row = (int)(n % TRACE_LENGTH);
+        mixer_mix_q16(throttle_q16[row], &axis_q16[row * PID_AXIS_COUNT], motor_q16);
+        sink_q16 += motor_q16[0];
+    }
+    result.fixed_ns = (now_ns() - start) / calls;
+    keep(sink, sink_q16);
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    long calls = (argc > 1) ? std::atol(argv[1]) : 2000000;
+    if (calls <= 0) {
+        std::fprintf(stderr, "usage: %s [calls]\n", argv[0]);
+        return 2;
+    }
+
+    std::printf("%ld calls per kernel, errors over %d inputs\n", calls, TRACE_LENGTH);
+    print_result("pid", "", bench_pid(calls));
+    print_result("lowpass", "rad", bench_lowpass(calls));
+    print_result("map", "us", bench_map(calls));
+    print_result("mixer", "", bench_mixer(calls));
+    return 0;
+}
@@ -0,0 +1,165 @@
+//
+//  gyro_analyzer_bench.cpp
+//  DroneFlightController
+//
+//  Host benchmark of the dynamic notch analyzer. Feeds gyro_analyzer.c a
+//  synthetic gyro at the loop rate: a slow attitude signal, motor noise
+//  whose fundamental sweeps with throttle plus its second harmonic, and
+//  white noise. Every gyro_analyzer_push() and gyro_analyzer_update() call
+//  is timed on its own, as the fastest of a few runs on copies of the
+//  analyzer so preemption does not count, and the worst step, the one the
+//  control loop has to budget for, is reported per phase next to the mean.
+//  It also prints how closely the notch centers track the motor noise.
+//
+//  Build: c++ -std=c++17 -O2 -I../../src -o gyro_analyzer_bench gyro_analyzer_bench.cpp
+//             ../../src/sensors/gyro_analyzer.c ../../src/utils/filter_bank.c
+//  Usage: gyro_analyzer_bench [seconds] [work per step]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "sensors/gyro_analyzer.h"
+#include "config/control_config.h"
+
+namespace {
+
+const float LOOP_HZ = (float)CONTROL_RATE_LOOP_HZ;
+const char *PHASE_NAMES[] = {"window", "fft", "magnitude", "peaks"};
+const int PHASE_COUNT = 4;
+
+struct PhaseStats {
+    uint64_t calls = 0;
+    double total_ns = 0.0;
+    double max_ns = 0.0;
+};
+
+double now_ns() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Cost of reading the clock twice, taken off every measurement
+double timer_overhead_ns() {
+    double best = 1e9;
+    for (int i = 0; i < 100000; i++) {
+        double start = now_ns();
+        best = std::min(best, now_ns() - start);
+    }
+    return best;
+}
+
+// Fastest of a few runs of step on copies of the analyzer. Notch retunes
+// write the real filter chains, which only repeats the same values.
+template <typename Step>
+double time_step(const gyro_analyzer_t &analyzer, double overhead_ns, Step step) {
+    static gyro_analyzer_t copy;
+    double best = 1e9;
+    for (int run = 0; run < 3; run++) {
+        copy = analyzer;
+        double start = now_ns();
+        step(&copy);
+        best = std::min(best, now_ns() - start);
+    }
+    return std::max(0.0, best - overhead_ns);
+}
+
+// Motor noise fundamental: throttle ramps up and down over 10 s
+float motor_hz(double t) {
+    double phase = std::fmod(t, 10.0) / 10.0;
+    double throttle = phase < 0.5 ? 2.0 * phase : 2.0 - 2.0 * phase;
+    return (float)(DYN_NOTCH_MIN_HZ + 40.0 + throttle * 120.0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    int seconds = (argc > 1) ? std::atoi(argv[1]) : 60;
+    int work_per_step = (argc > 2) ? std::atoi(argv[2]) : GYRO_ANALYZER_WORK_PER_STEP;
+    if (seconds <= 0 || work_per_step <= 0) {
+        std::fprintf(stderr, "usage: %s [seconds] [work per step]\n", argv[0]);
+        return 2;
+    }
+
+    filter_chain_t chains[GYRO_ANALYZER_AXES] = { GYRO_FILTER_CHAIN, GYRO_FILTER_CHAIN, GYRO_FILTER_CHAIN };
+    static gyro_analyzer_t analyzer;
+    if (!gyro_analyzer_init(&analyzer, chains, DYN_NOTCH_COUNT, DYN_NOTCH_Q, LOOP_HZ, GYRO_ANALYZER_SAMPLE_HZ,
+                            DYN_NOTCH_MIN_HZ, DYN_NOTCH_MAX_HZ, (uint16_t)work_per_step)) {
+        std::fprintf(stderr, "gyro_analyzer_init failed\n");
+        return 1;
+    }
+
+    double overhead_ns = timer_overhead_ns();
+    PhaseStats stats[PHASE_COUNT];
+    PhaseStats push;
+    double worst_step_ns = 0.0;
+    const char *worst_phase = "";
+
+    // Tracking error of the first notch against the fundamental, last half
+    double tracking_sum = 0.0;
+    double tracking_max = 0.0;
+    uint64_t tracking_count = 0;
+
+    uint32_t seed = 1;
+    double motor_phase = 0.0;
+    const long loops = (long)(seconds * LOOP_HZ);
+    for (long n = 0; n < loops; n++) {
+        double t = n / LOOP_HZ;
+        float fundamental = motor_hz(t);
+        motor_phase += 2.0 * M_PI * fundamental / LOOP_HZ;
+
+        float gyro[GYRO_ANALYZER_AXES];
+        for (int axis = 0; axis < GYRO_ANALYZER_AXES; axis++) {
+            seed = seed * 1664525u + 1013904223u;
+            float noise = ((float)(seed >> 8) / 16777216.0f - 0.5f) * 0.2f;
+            gyro[axis] = 0.5f * (float)std::sin(2.0 * M_PI * 2.0 * t + axis) +
+                         0.3f * (float)std::sin(motor_phase + axis) +
+                         0.15f * (float)std::sin(2.0 * motor_phase + axis) + noise;
+        }
+
+        double ns = time_step(analyzer, overhead_ns, [&](gyro_analyzer_t *a) { gyro_analyzer_push(a, gyro); });
+        gyro_analyzer_push(&analyzer, gyro);
+        push.calls++;
+        push.total_ns += ns;
+        push.max_ns = std::max(push.max_ns, ns);
+
+        int phase = analyzer.phase;
+        ns = time_step(analyzer, overhead_ns, [](gyro_analyzer_t *a) { gyro_analyzer_update(a); });
+        gyro_analyzer_update(&analyzer);
+        stats[phase].calls++;
+        stats[phase].total_ns += ns;
+        if (ns > stats[phase].max_ns) {
+            stats[phase].max_ns = ns;
+        }
+        if (ns > worst_step_ns) {
+            worst_step_ns = ns;
+            worst_phase = PHASE_NAMES[phase];
+        }
+
+        if (n >= loops / 2) {
+            double error = std::fabs(gyro_analyzer_get_center(&analyzer, 0, 0) - fundamental);
+            tracking_sum += error;
+            tracking_max = std::max(tracking_max, error);
+            tracking_count++;
+        }
+    }
+
+    std::printf("%d s at %.0f Hz, analyzer %d Hz, %d-point FFT, %d units per step, %lu analyses\n", seconds,
+                LOOP_HZ, GYRO_ANALYZER_SAMPLE_HZ, GYRO_ANALYZER_FFT_SIZE, work_per_step,
+                (unsigned long)analyzer.analyses);
+    std::printf("  %-10s %9s %9s %9s\n", "step", "calls", "mean ns", "max ns");
+    std::printf("  %-10s %9lu %9.1f %9.1f\n", "push", (unsigned long)push.calls, push.total_ns / push.calls,
+                push.max_ns);
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        const PhaseStats &s = stats[phase];
+        std::printf("  %-10s %9lu %9.1f %9.1f\n", PHASE_NAMES[phase], (unsigned long)s.calls,
+                    s.calls ? s.total_ns / s.calls : 0.0, s.max_ns);
+    }
+    std::printf("  worst update %.1f ns in %s\n", worst_step_ns, worst_phase);
+    std::printf("  notch tracking: mean %.1f Hz, max %.1f Hz off the motor fundamental\n",
+                tracking_sum / tracking_count, tracking_max);
+    return 0;
+}
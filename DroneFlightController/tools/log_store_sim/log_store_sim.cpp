@@ -0,0 +1,466 @@
+//
+//  log_store_sim.cpp
+//  DroneFlightController
+//
+//  Host simulation of the flash log store. Links the firmware's
+//  log_store.c against a simulated NOR flash with datasheet program and
+//  erase latencies on a virtual clock, then runs four scenarios:
+//
+//    throughput  blackbox, trace and text streams, serviced throughout
+//    flight      the same on the ground, armed and after landing; the log
+//                task only services the store while disarmed
+//    wear        many laps of the region with a reboot every few seconds
+//    powercut    power lost at random flash operations, recovered at boot
+//
+//  Build: c++ -std=c++17 -O2 -DFC_LOG_DEFERRED=0 -I../../src -o log_store_sim
+//             log_store_sim.cpp ../../src/utils/log_store.c ../../src/utils/crc32.c
+//  Usage: log_store_sim [seed]
+//
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "utils/log_store.h"
+#include "utils/blackbox.h"
+#include "config/control_config.h"
+
+namespace {
+
+// W25Q16JV-class serial NOR: page program 0.4 ms typical, 3 ms worst;
+// sector erase 45 ms typical, 400 ms worst
+const uint32_t PROGRAM_TYPICAL_US = 400;
+const uint32_t PROGRAM_MAX_US = 3000;
+const uint32_t ERASE_TYPICAL_US = 45000;
+const uint32_t ERASE_MAX_US = 400000;
+const double WORST_CASE_ODDS = 0.001;
+
+const uint32_t PAGE_COUNT = LOG_STORE_SIZE_BYTES / LOG_FLASH_PAGE_SIZE;
+
+struct PowerCut {};
+
+struct Flash {
+    std::vector<uint8_t> bytes = std::vector<uint8_t>(LOG_STORE_SIZE_BYTES, 0xFF);
+    std::vector<uint32_t> erase_counts = std::vector<uint32_t>(LOG_FLASH_SECTOR_COUNT, 0);
+    // Sequence and bytes of each page whose program completed, -1 once erased
+    std::vector<int64_t> completed = std::vector<int64_t>(PAGE_COUNT, -1);
+    std::vector<std::vector<uint8_t>> completed_bytes = std::vector<std::vector<uint8_t>>(PAGE_COUNT);
+    uint64_t now_us = 0;
+    uint64_t busy_us = 0;
+    uint64_t unerased_programs = 0;  // Programs that needed a 0 -> 1 transition
+    bool in_store = false;           // Inside log_store_init or log_store_service
+    long cut_after = -1;             // Operations until the power fails, -1 never
+    std::mt19937 rng;
+
+    uint32_t latency(uint32_t typical, uint32_t worst) {
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        if (u(rng) < WORST_CASE_ODDS) {
+            return worst;
+        }
+        return (uint32_t)(typical * (0.8 + 0.4 * u(rng)));
+    }
+
+    void advance(uint32_t us) {
+        now_us += us;
+        busy_us += us;
+    }
+
+    bool cut_now() {
+        return cut_after >= 0 && cut_after-- == 0;
+    }
+};
+
+Flash flash;
+
+// Flash operations outside init and service, over every scenario
+uint64_t writer_ops = 0;
+
+}  // namespace
+
+// Firmware dependencies
+uint32_t timing_micros(void) {
+    return (uint32_t)flash.now_us;
+}
+
+volatile uint8_t logger_module_levels[LOG_MODULE_COUNT];
+
+void logger_log(LogLevel level, const char *file, int line, const char *format, ...) {
+    (void)level;
+    (void)file;
+    (void)line;
+    va_list args;
+    va_start(args, format);
+    std::printf("    ");
+    std::vprintf(format, args);
+    std::printf("\n");
+    va_end(args);
+}
+
+void log_flash_read(uint32_t offset, void *data, uint32_t size) {
+    std::memcpy(data, &flash.bytes[offset], size);
+}
+
+bool log_flash_program(uint32_t offset, const uint8_t *page) {
+    if (!flash.in_store) {
+        writer_ops++;
+    }
+    uint8_t *at = &flash.bytes[offset];
+    uint32_t length = LOG_FLASH_PAGE_SIZE;
+    bool cut = flash.cut_now();
+    if (cut) {
+        // Torn: only a prefix made it
+        length = std::uniform_int_distribution<uint32_t>(0, LOG_FLASH_PAGE_SIZE - 1)(flash.rng);
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        if ((page[i] & ~at[i]) != 0) {
+            flash.unerased_programs++;
+        }
+        at[i] &= page[i];   // NOR programming only clears bits
+    }
+    flash.advance(flash.latency(PROGRAM_TYPICAL_US, PROGRAM_MAX_US));
+
+    // A cut after the last byte that is not padding loses nothing
+    bool complete = std::memcmp(at, page, LOG_FLASH_PAGE_SIZE) == 0;
+    if (complete) {
+        log_store_page_header_t header;
+        std::memcpy(&header, page, sizeof(header));
+        flash.completed[offset / LOG_FLASH_PAGE_SIZE] = header.sequence;
+        flash.completed_bytes[offset / LOG_FLASH_PAGE_SIZE].assign(page, page + LOG_FLASH_PAGE_SIZE);
+    }
+    if (cut) {
+        throw PowerCut();
+    }
+    return complete;
+}
+
+bool log_flash_erase(uint32_t offset) {
+    if (!flash.in_store) {
+        writer_ops++;
+    }
+    uint8_t *at = &flash.bytes[offset];
+    for (uint32_t page = 0; page < LOG_FLASH_PAGES_PER_SECTOR; page++) {
+        flash.completed[offset / LOG_FLASH_PAGE_SIZE + page] = -1;
+    }
+    if (flash.cut_now()) {
+        // Interrupted: a random part of the sector reads erased
+        for (uint32_t i = 0; i < LOG_FLASH_SECTOR_SIZE; i++) {
+            if (flash.rng() & 1) {
+                at[i] = 0xFF;
+            }
+        }
+        flash.advance(ERASE_TYPICAL_US / 2);
+        throw PowerCut();
+    }
+    std::memset(at, 0xFF, LOG_FLASH_SECTOR_SIZE);
+    flash.erase_counts[offset / LOG_FLASH_SECTOR_SIZE]++;
+    flash.advance(flash.latency(ERASE_TYPICAL_US, ERASE_MAX_US));
+    return true;
+}
+
+namespace {
+
+// Average packed blackbox bytes per pipeline run at the default decimation
+double blackbox_bytes_per_run() {
+    const uint32_t size[] = { BLACKBOX_FIELD_GYRO_SIZE, BLACKBOX_FIELD_ATTITUDE_SIZE,
+                              BLACKBOX_FIELD_SETPOINT_SIZE, BLACKBOX_FIELD_PID_SIZE,
+                              BLACKBOX_FIELD_MOTOR_SIZE };
+    const uint32_t divisor[] = { BLACKBOX_DECIMATION_GYRO, BLACKBOX_DECIMATION_ATTITUDE,
+                                 BLACKBOX_DECIMATION_SETPOINT, BLACKBOX_DECIMATION_PID,
+                                 BLACKBOX_DECIMATION_MOTOR };
+    const uint32_t period = 8;   // Common multiple of the divisors
+    uint32_t bytes = 0;
+    for (uint32_t run = 0; run < period; run++) {
+        bool any = false;
+        for (int f = 0; f < BLACKBOX_FIELD_COUNT; f++) {
+            if (run % divisor[f] == 0) {
+                bytes += size[f];
+                any = true;
+            }
+        }
+        if (any) {
+            bytes += sizeof(blackbox_frame_header_t);
+        }
+    }
+    return (double)bytes / period;
+}
+
+bool init_store() {
+    flash.in_store = true;
+    bool ok = log_store_init();
+    flash.in_store = false;
+    return ok;
+}
+
+uint32_t service_store() {
+    flash.in_store = true;
+    uint32_t programmed = log_store_service();
+    flash.in_store = false;
+    return programmed;
+}
+
+// Streams fed at flight rates; the log task services the store every
+// 50 ms while disarmed like rtos/tasks/log_task.c, the blackbox task
+// drains every 20 ms
+class Workload {
+public:
+    Workload(double blackbox_bytes_per_s, uint32_t seed) : rate(blackbox_bytes_per_s), rng(seed) {
+        reboot();
+    }
+
+    // Run for duration_us of simulated time
+    void run(uint64_t duration_us) {
+        uint64_t end = flash.now_us + duration_us;
+        while (flash.now_us < end) {
+            uint64_t now = flash.now_us;
+            if (now >= next_blackbox) {
+                feed_blackbox(now);
+                next_blackbox += 20000;
+            }
+            if (now >= next_log) {
+                feed_text_and_trace();
+                log_store_sync(LOG_STORE_STREAM_TEXT);
+                log_store_sync(LOG_STORE_STREAM_TRACE);
+                if (!armed) {
+                    service_store();
+                }
+                next_log += 50000;
+            }
+            // Flash operations advance the clock themselves
+            uint64_t next = std::min(next_blackbox, next_log);
+            if (flash.now_us < next) {
+                flash.now_us = next;
+            }
+        }
+    }
+
+    // Start over after a reboot
+    void reboot() {
+        last_blackbox_us = flash.now_us;
+        next_blackbox = flash.now_us;
+        next_log = flash.now_us;
+        blackbox_credit = 0;
+    }
+
+    uint64_t appended[LOG_STORE_STREAM_COUNT] = {};
+    bool armed = false;
+
+private:
+    void append(log_store_stream_t stream, const void *data, uint32_t size) {
+        log_store_append(stream, data, size);
+        appended[stream] += size;
+    }
+
+    void feed_blackbox(uint64_t now) {
+        // Bytes produced since the last drain, including any flash stall
+        double due = rate * (double)(now - last_blackbox_us) / 1e6 + blackbox_credit;
+        last_blackbox_us = now;
+        uint32_t bytes = (uint32_t)due;
+        blackbox_credit = due - bytes;
+        std::vector<uint8_t> data(bytes);
+        for (uint8_t &b : data) {
+            b = (uint8_t)rng();
+        }
+        append(LOG_STORE_STREAM_BLACKBOX, data.data(), bytes);
+        log_store_sync(LOG_STORE_STREAM_BLACKBOX);
+    }
+
+    void feed_text_and_trace() {
+        // A trace record every 100 ms and a text line every second
+        if (++log_ticks % 2 == 0) {
+            uint8_t record[20] = {};
+            append(LOG_STORE_STREAM_TRACE, record, sizeof(record));
+        }
+        if (log_ticks % 20 == 0) {
+            char line[64];
+            int length = std::snprintf(line, sizeof(line), "[INFO] sim.c:1 - line %lu\n", (unsigned long)lines++);
+            append(LOG_STORE_STREAM_TEXT, line, (uint32_t)length);
+        }
+    }
+
+    double rate;
+    double blackbox_credit = 0;
+    uint64_t last_blackbox_us = 0;
+    uint64_t next_blackbox = 0;
+    uint64_t next_log = 0;
+    uint32_t log_ticks = 0;
+    uint32_t lines = 0;
+    std::mt19937 rng;
+};
+
+// The store's counters live as long as the process, so print the change
+// since before
+void print_stats(const char *label, const log_store_stats_t &before, uint64_t span_us, uint64_t busy_us) {
+    log_store_stats_t s;
+    log_store_get_stats(&s);
+    std::printf("  %s: %lu pages written, %lu dropped, %lu erases, %lu erase waits, "
+                "service max %.1f ms, flash busy %.1f%%\n",
+                label, (unsigned long)(s.pages_written - before.pages_written),
+                (unsigned long)(s.pages_dropped - before.pages_dropped),
+                (unsigned long)(s.erases - before.erases),
+                (unsigned long)(s.erase_waits - before.erase_waits), s.service_max_us / 1000.0,
+                span_us > 0 ? 100.0 * (double)busy_us / (double)span_us : 0.0);
+}
+
+// Blackbox at a fraction of the default decimation's rate at 1 kHz
+void throughput(uint32_t seed) {
+    double full = blackbox_bytes_per_run() * CONTROL_RATE_LOOP_HZ;
+    std::printf("throughput (default decimation at %d Hz is %.1f KB/s of blackbox)\n",
+                CONTROL_RATE_LOOP_HZ, full / 1024);
+    for (double fraction : { 0.125, 0.25, 0.5, 1.0 }) {
+        flash = Flash();
+        flash.rng.seed(seed);
+        init_store();
+        Workload load(full * fraction, seed);
+        log_store_stats_t before;
+        log_store_get_stats(&before);
+        uint64_t start = flash.now_us, busy = flash.busy_us;
+        load.run(60ull * 1000000);
+        char label[48];
+        std::snprintf(label, sizeof(label), "%5.1f KB/s", full * fraction / 1024);
+        print_stats(label, before, flash.now_us - start, flash.busy_us - busy);
+    }
+}
+
+// 10 s on the ground, 60 s armed and 10 s after landing, with the blackbox
+// at an eighth of the default rate
+void flight(uint32_t seed) {
+    flash = Flash();
+    flash.rng.seed(seed);
+    init_store();
+    Workload load(blackbox_bytes_per_run() * CONTROL_RATE_LOOP_HZ / 8, seed);
+    std::printf("flight\n");
+    const struct {
+        const char *label;
+        bool armed;
+        uint64_t duration_us;
+    } phases[] = {
+        { "ground", false, 10000000 },
+        { "armed", true, 60000000 },
+        { "landed", false, 10000000 },
+    };
+    for (const auto &phase : phases) {
+        load.armed = phase.armed;
+        log_store_stats_t before;
+        log_store_get_stats(&before);
+        uint64_t start = flash.now_us, busy = flash.busy_us;
+        load.run(phase.duration_us);
+        print_stats(phase.label, before, flash.now_us - start, flash.busy_us - busy);
+    }
+}
+
+// Laps of the region with a reboot every 10 s; every sector should wear
+// the same
+void wear(uint32_t seed) {
+    flash = Flash();
+    flash.rng.seed(seed);
+    init_store();
+    double rate = blackbox_bytes_per_run() * CONTROL_RATE_LOOP_HZ / 4;
+    Workload load(rate, seed);
+    const int laps = 8;
+    uint64_t duration = (uint64_t)((double)LOG_STORE_SIZE_BYTES * laps / rate * 1e6);
+    int boots = 0;
+    for (uint64_t elapsed = 0; elapsed < duration; elapsed += 10000000) {
+        load.run(10000000);
+        init_store();
+        load.reboot();
+        boots++;
+    }
+    auto range = std::minmax_element(flash.erase_counts.begin(), flash.erase_counts.end());
+    log_store_stats_t s;
+    log_store_get_stats(&s);
+    std::printf("wear: %d boots over %d laps, sector erases min %u max %u, store lap count %lu\n",
+                boots, laps, *range.first, *range.second, (unsigned long)s.erase_count);
+}
+
+// Power fails at a random flash operation; at the next boot every page
+// whose program completed must read back intact and in order
+void powercut(uint32_t seed, int trials) {
+    std::mt19937 rng(seed);
+    int failures = 0;
+    uint64_t checked = 0;
+    uint64_t torn = 0;
+    flash = Flash();
+    flash.rng.seed(seed);
+    init_store();
+    Workload load(blackbox_bytes_per_run() * CONTROL_RATE_LOOP_HZ / 4, seed);
+
+    for (int trial = 0; trial < trials; trial++) {
+        flash.cut_after = std::uniform_int_distribution<long>(0, 400)(rng);
+        try {
+            load.run(3600ull * 1000000);
+        } catch (const PowerCut &) {
+        }
+        flash.cut_after = -1;
+        log_store_stats_t cut;
+        log_store_get_stats(&cut);
+
+        // Reboot
+        if (!init_store()) {
+            std::printf("  trial %d: init failed\n", trial);
+            failures++;
+            continue;
+        }
+        load.reboot();
+        log_store_stats_t recovered;
+        log_store_get_stats(&recovered);
+        if (recovered.head < cut.head - 1 || recovered.head > cut.head + LOG_FLASH_PAGES_PER_SECTOR) {
+            std::printf("  trial %d: head %lu recovered as %lu\n", trial, (unsigned long)cut.head,
+                        (unsigned long)recovered.head);
+            failures++;
+        }
+
+        // Exactly the pages whose program completed come back, in order
+        std::map<uint32_t, uint32_t> expected;
+        uint32_t oldest = log_store_oldest();
+        for (uint32_t index = 0; index < PAGE_COUNT; index++) {
+            int64_t sequence = flash.completed[index];
+            if (sequence >= oldest && sequence < recovered.head) {
+                expected[(uint32_t)sequence] = index;
+            }
+        }
+        uint32_t seq = oldest;
+        log_store_page_header_t header;
+        uint8_t payload[LOG_STORE_PAGE_PAYLOAD];
+        auto next = expected.begin();
+        while (log_store_read(&seq, &header, payload)) {
+            if (next == expected.end() || next->first != header.sequence ||
+                std::memcmp(flash.completed_bytes[next->second].data() + sizeof(header), payload,
+                            header.length) != 0) {
+                std::printf("  trial %d: read page %lu, expected %ld\n", trial, (unsigned long)header.sequence,
+                            next == expected.end() ? -1L : (long)next->first);
+                failures++;
+                break;
+            }
+            ++next;
+            checked++;
+        }
+        if (next != expected.end()) {
+            std::printf("  trial %d: page %lu not read back\n", trial, (unsigned long)next->first);
+            failures++;
+        }
+        torn += recovered.head - cut.head;
+    }
+
+    std::printf("powercut: %d trials, %llu pages verified, %llu pages skipped at boot, "
+                "%llu programs over unerased bits, %d failures\n",
+                trials, (unsigned long long)checked, (unsigned long long)torn,
+                (unsigned long long)flash.unerased_programs, failures);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    uint32_t seed = argc > 1 ? (uint32_t)std::strtoul(argv[1], nullptr, 0) : 1;
+    throughput(seed);
+    flight(seed);
+    wear(seed);
+    powercut(seed, 200);
+    std::printf("flash operations from stream writers: %llu\n", (unsigned long long)writer_ops);
+    return 0;
+}
@@ -0,0 +1,18 @@
+//
+//  sync.h
+//  DroneFlightController
+//
+//  Host stand-in for the SDK header that utils/seqlock.h includes through
+//  utils/timing.h. The data memory barrier becomes a full fence.
+//
+
+#ifndef logger_bench_sync_h
+#define logger_bench_sync_h
+
+#include <atomic>
+
+static inline void __dmb(void) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+#endif /* logger_bench_sync_h */
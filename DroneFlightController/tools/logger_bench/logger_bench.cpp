@@ -0,0 +1,294 @@
+//
+//  logger_bench.cpp
+//  DroneFlightController
+//
+//  Host benchmark and stress test of the firmware's logger.c. Producer
+//  threads stand in for tasks and interrupts on two cores; each thread is
+//  given a core number, so threads on the same core share that core's ring
+//  as tasks and interrupts do on the device.
+//
+//    format    log_vformat against vsnprintf: same output and cost per call
+//    calls     cost of an accepted call, of a call that finds the ring full
+//              and of draining a message, against the previous design of
+//              vsnprintf and fprintf behind a mutex
+//    stress    1 to 8 producers against a draining log task; every message
+//              is written or counted as dropped, and every written line is
+//              whole and in order per producer
+//
+//  Build: c++ -std=c++17 -O2 -pthread -I. -I../../src -o logger_bench logger_bench.cpp
+//             -x c++ ../../src/utils/logger.c ../../src/utils/log_format.c
+//  Usage: logger_bench [messages per producer]
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utils/logger.h"
+#include "utils/log_format.h"
+#include "utils/log_store.h"
+#include "utils/timing.h"
+#include "pico/platform.h"
+
+namespace {
+
+const char *LOG_PATH = "logger_bench.log";
+const char *BENCH_FORMAT = "producer %d seq %d value %f";
+
+thread_local uint32_t thread_core = 0;
+const auto start_time = std::chrono::steady_clock::now();
+
+double now_ns() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// Formats the same arguments with both formatters
+int check_format(int *mismatches, const char *format, ...) {
+    char ours[160];
+    char libc[160];
+    va_list args;
+    va_list copy;
+    va_start(args, format);
+    va_copy(copy, args);
+    log_vformat(ours, sizeof(ours), format, args);
+    vsnprintf(libc, sizeof(libc), format, copy);
+    va_end(copy);
+    va_end(args);
+    if (std::strcmp(ours, libc) != 0) {
+        std::printf("  mismatch \"%s\": \"%s\", libc \"%s\"\n", format, ours, libc);
+        (*mismatches)++;
+    }
+    return 1;
+}
+
+uint32_t format_with(bool ours, char *buffer, uint32_t size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    uint32_t length = ours ? log_vformat(buffer, size, format, args)
+                           : (uint32_t)vsnprintf(buffer, size, format, args);
+    va_end(args);
+    return length;
+}
+
+void run_format() {
+    std::printf("format\n");
+    int mismatches = 0;
+    int cases = 0;
+    cases += check_format(&mismatches, "%d %i %u %d", -42, 7, 4000000000u, 0);
+    cases += check_format(&mismatches, "%6lu|%-6lu|%06lu|%lu", 12ul, 34ul, 56ul, 4294967295ul);
+    cases += check_format(&mismatches, "%x %X %08x %o", 255, 255, 0xbeef, 8);
+    cases += check_format(&mismatches, "%f %f %.2f %8.3f %-8.1f|", 3.14159, -2.5, 0.005, -1.0, 9.99);
+    cases += check_format(&mismatches, "%+f % f %.3f %.3f %f", 1.0, 1.0, 0.0005, -0.0004, 1e12);
+    cases += check_format(&mismatches, "%s|%5s|%-5s|%.2s|%c%c%%", "ab", "cd", "ef", "ghij", 'a', 'b');
+    cases += check_format(&mismatches, "%lld %llu %zu", -123456789012LL, 123456789012ULL, (size_t)99);
+    cases += check_format(&mismatches, "%5.3d|%.0d|%-+5d|%*d|%-*d|%.*f", 7, 0, 3, 4, 1, 4, 2, 2, 1.23456);
+    cases += check_format(&mismatches, "%hhd %hd %p", 5, 6, (void *)0x1234);
+    cases += check_format(&mismatches, BENCH_FORMAT, 3, 12345, 6172.5);
+    std::printf("  %d cases, %d mismatches\n", cases, mismatches);
+
+    const int calls = 200000;
+    char buffer[MAX_LOG_LENGTH];
+    for (int ours = 1; ours >= 0; ours--) {
+        double start = now_ns();
+        uint32_t total = 0;
+        for (int i = 0; i < calls; i++) {
+            total += format_with(ours != 0, buffer, sizeof(buffer), BENCH_FORMAT, i & 7, i, i * 0.5);
+        }
+        std::printf("  %-12s %6.0f ns per call (%u chars)\n", ours ? "log_vformat" : "vsnprintf",
+                    (now_ns() - start) / calls, total / calls);
+    }
+}
+
+// The previous logger_log body: format on the stack, write under a lock
+std::mutex baseline_lock;
+FILE *baseline_file = NULL;
+
+void baseline_log(int producer, int seq, double value) {
+    char buffer[MAX_LOG_LENGTH];
+    std::snprintf(buffer, sizeof(buffer), BENCH_FORMAT, producer, seq, value);
+    std::lock_guard<std::mutex> guard(baseline_lock);
+    std::fprintf(baseline_file, "[INFO] logger_bench.cpp:%d - %s\n", __LINE__, buffer);
+}
+
+void run_calls() {
+    std::printf("calls\n");
+    std::remove(LOG_PATH);
+    logger_init(LOG_PATH, LOG_DEBUG, LOG_TO_FILE);
+
+    // Half a ring per batch, so every call is accepted
+    const int batches = 20000;
+    const int batch = LOGGER_RING_SLOTS / 2;
+    double log_ns = 0.0;
+    double drain_ns = 0.0;
+    for (int b = 0; b < batches; b++) {
+        double start = now_ns();
+        for (int i = 0; i < batch; i++) {
+            logger_log(LOG_INFO, "logger_bench.cpp", __LINE__, BENCH_FORMAT, 0, b * batch + i, i * 0.5);
+        }
+        double middle = now_ns();
+        logger_drain();
+        log_ns += middle - start;
+        drain_ns += now_ns() - middle;
+    }
+    std::printf("  accepted call  %6.0f ns\n", log_ns / (batches * batch));
+    std::printf("  drain          %6.0f ns per message\n", drain_ns / (batches * batch));
+
+    // Fill the ring, then every call is dropped
+    for (uint32_t i = 0; i < LOGGER_RING_SLOTS; i++) {
+        logger_log(LOG_INFO, "logger_bench.cpp", __LINE__, BENCH_FORMAT, 0, (int)i, 0.0);
+    }
+    const int full_calls = 1000000;
+    uint32_t dropped_before = logger_get_dropped();
+    double start = now_ns();
+    for (int i = 0; i < full_calls; i++) {
+        logger_log(LOG_INFO, "logger_bench.cpp", __LINE__, BENCH_FORMAT, 0, i, 0.0);
+    }
+    std::printf("  ring full      %6.0f ns (%u dropped)\n", (now_ns() - start) / full_calls,
+                logger_get_dropped() - dropped_before);
+    logger_close();
+
+    baseline_file = std::fopen(LOG_PATH, "w");
+    if (baseline_file == NULL) {
+        std::fprintf(stderr, "cannot open %s\n", LOG_PATH);
+        return;
+    }
+    const int baseline_calls = batches * batch;
+    start = now_ns();
+    for (int i = 0; i < baseline_calls; i++) {
+        baseline_log(0, i, i * 0.5);
+    }
+    std::printf("  mutex baseline %6.0f ns\n", (now_ns() - start) / baseline_calls);
+    std::fclose(baseline_file);
+}
+
+struct Check {
+    uint64_t lines = 0;
+    uint64_t bad = 0;
+    uint64_t out_of_order = 0;
+};
+
+// Every INFO line must be one whole producer message with its own value,
+// and each producer's sequence numbers must only increase
+Check check_output(int producers) {
+    Check check;
+    std::vector<long> last(producers, -1);
+    FILE *file = std::fopen(LOG_PATH, "r");
+    if (file == NULL) {
+        check.bad = 1;
+        return check;
+    }
+    char line[512];
+    while (std::fgets(line, sizeof(line), file) != NULL) {
+        if (std::strstr(line, "] [INFO] ") == NULL) {
+            continue;
+        }
+        check.lines++;
+        const char *text = std::strstr(line, " - ");
+        int producer = -1;
+        int seq = -1;
+        double value = 0.0;
+        int end = 0;
+        if (text == NULL ||
+            std::sscanf(text, " - producer %d seq %d value %lf\n%n", &producer, &seq, &value, &end) != 3 ||
+            text[end] != '\0' || producer < 0 || producer >= producers || value != seq * 0.5) {
+            check.bad++;
+            continue;
+        }
+        if (seq <= last[producer]) {
+            check.out_of_order++;
+        }
+        last[producer] = seq;
+    }
+    std::fclose(file);
+    return check;
+}
+
+bool run_stress(int per_producer) {
+    std::printf("stress, %d messages per producer\n", per_producer);
+    bool ok = true;
+    for (int producers = 1; producers <= 8; producers *= 2) {
+        std::remove(LOG_PATH);
+        logger_init(LOG_PATH, LOG_DEBUG, LOG_TO_FILE);
+        uint32_t dropped_before = logger_get_dropped();
+
+        std::atomic<int> running(producers);
+        uint64_t drained = 0;
+        std::thread log_task([&] {
+            while (running.load() > 0) {
+                drained += logger_drain();
+                std::this_thread::yield();
+            }
+            drained += logger_drain();
+        });
+
+        std::vector<std::thread> threads;
+        double start = now_ns();
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&, p] {
+                thread_core = (uint32_t)p % LOGGER_CORES;
+                for (int seq = 0; seq < per_producer; seq++) {
+                    logger_log(LOG_INFO, "logger_bench.cpp", __LINE__, BENCH_FORMAT, p, seq, seq * 0.5);
+                    // Give way now and then, as tasks that log between work do
+                    if ((seq & 15) == 15) {
+                        std::this_thread::yield();
+                    }
+                }
+                running.fetch_sub(1);
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        log_task.join();
+        double elapsed_ns = now_ns() - start;
+        logger_close();
+
+        uint64_t logged = (uint64_t)producers * per_producer;
+        uint64_t dropped = logger_get_dropped() - dropped_before;
+        Check check = check_output(producers);
+        bool pass = drained + dropped == logged && check.lines == drained && check.bad == 0 &&
+                    check.out_of_order == 0;
+        ok = ok && pass;
+        std::printf("  %d producers: %llu logged, %llu written, %llu dropped, %llu bad, %llu out of order, "
+                    "%.0f ns per message: %s\n",
+                    producers, (unsigned long long)logged, (unsigned long long)drained,
+                    (unsigned long long)dropped, (unsigned long long)check.bad,
+                    (unsigned long long)check.out_of_order, elapsed_ns / logged, pass ? "ok" : "FAIL");
+    }
+    std::remove(LOG_PATH);
+    return ok;
+}
+
+}  // namespace
+
+// Firmware hooks logger.c links against
+uint32_t get_core_num(void) {
+    return thread_core;
+}
+
+uint32_t timing_micros(void) {
+    return (uint32_t)(now_ns() / 1000.0);
+}
+
+void log_store_append(log_store_stream_t, const void *, uint32_t) {}
+void log_store_sync(log_store_stream_t) {}
+void log_store_flush(log_store_stream_t) {}
+
+int main(int argc, char **argv) {
+    int per_producer = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    if (per_producer <= 0) {
+        std::fprintf(stderr, "usage: %s [messages per producer]\n", argv[0]);
+        return 2;
+    }
+
+    run_format();
+    run_calls();
+    return run_stress(per_producer) ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+//
+//  platform.h
+//  DroneFlightController
+//
+//  Host stand-in for the SDK header logger.c includes. logger_bench
+//  assigns each producer thread a core number.
+//
+
+#ifndef logger_bench_platform_h
+#define logger_bench_platform_h
+
+#include <stdint.h>
+
+uint32_t get_core_num(void);
+
+#endif /* logger_bench_platform_h */
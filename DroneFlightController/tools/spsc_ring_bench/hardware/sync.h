@@ -0,0 +1,19 @@
+//
+//  sync.h
+//  DroneFlightController
+//
+//  Host stand-in for the SDK header spsc_ring.h includes. The data memory
+//  barrier becomes a full fence, which also stops the compiler moving the
+//  slot copies across the index updates.
+//
+
+#ifndef spsc_ring_bench_sync_h
+#define spsc_ring_bench_sync_h
+
+#include <atomic>
+
+static inline void __dmb(void) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+#endif /* spsc_ring_bench_sync_h */
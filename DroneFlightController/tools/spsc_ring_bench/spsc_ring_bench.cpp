@@ -0,0 +1,366 @@
+//
+//  spsc_ring_bench.cpp
+//  DroneFlightController
+//
+//  Host stress test and throughput benchmark of utils/spsc_ring.h. One
+//  producer and one consumer thread stand in for the ISR or core on each
+//  side of a ring:
+//
+//    stress       a small ring driven through full and empty with random
+//                 mixes of push/pushBatch and pop/popBatch; every item is
+//                 checked for order, loss, duplicates and torn copies
+//    throughput   items per second through SpscRing and through a copy of
+//                 the xQueue design it replaced, for two item sizes and
+//                 with single and batched calls
+//
+//  The baseline keeps xQueue's shape: a fixed item size copied with
+//  memcpy, and a critical section around every send and receive, here a
+//  mutex standing in for taskENTER_CRITICAL and its SMP spinlock.
+//  Two-thread results on a one-CPU host measure hand-offs between time
+//  slices more than contention, so the uncontended cost of a push and pop
+//  from one thread is printed as well.
+//
+//  Build: c++ -std=c++17 -O2 -pthread -I. -I../../src -o spsc_ring_bench spsc_ring_bench.cpp
+//  Usage: spsc_ring_bench [items]
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "utils/spsc_ring.h"
+
+namespace {
+
+// Results are stored so the timed loops are not optimized away
+volatile uint32_t sink;
+
+double now_ns() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Sequence number plus a payload derived from it, so a copy torn between
+// two items shows up as a mismatch
+template <int Bytes>
+struct Item {
+    static const int WORDS = Bytes / 4 - 1;
+    uint32_t seq;
+    uint32_t payload[WORDS];
+
+    void fill(uint32_t value) {
+        seq = value;
+        for (int i = 0; i < WORDS; i++) {
+            payload[i] = value * 2654435761u + (uint32_t)i;
+        }
+    }
+
+    bool valid() const {
+        for (int i = 0; i < WORDS; i++) {
+            if (payload[i] != seq * 2654435761u + (uint32_t)i) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// The FreeRTOS queue the rings replaced: byte copies of a fixed item size
+// inside a critical section on both sides
+template <typename T, uint32_t N>
+class CopyQueue {
+public:
+    CopyQueue() : count(0), write(0), read(0) {}
+
+    bool send(const T *item) {
+        std::lock_guard<std::mutex> guard(critical);
+        if (count == N) {
+            return false;
+        }
+        std::memcpy(&storage[write * sizeof(T)], item, sizeof(T));
+        write = (write + 1 == N) ? 0 : write + 1;
+        count++;
+        return true;
+    }
+
+    bool receive(T *item) {
+        std::lock_guard<std::mutex> guard(critical);
+        if (count == 0) {
+            return false;
+        }
+        std::memcpy(item, &storage[read * sizeof(T)], sizeof(T));
+        read = (read + 1 == N) ? 0 : read + 1;
+        count--;
+        return true;
+    }
+
+private:
+    std::mutex critical;
+    uint8_t storage[N * sizeof(T)];
+    uint32_t count;
+    uint32_t write;
+    uint32_t read;
+};
+
+struct Lcg {
+    uint32_t seed;
+
+    explicit Lcg(uint32_t initial) : seed(initial) {}
+
+    uint32_t next(uint32_t range) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) % range;
+    }
+};
+
+struct StressResult {
+    uint64_t received = 0;
+    uint64_t out_of_order = 0;   // Skipped ahead: lost items
+    uint64_t repeated = 0;       // Went back: duplicates or reordering
+    uint64_t torn = 0;
+    uint64_t over_capacity = 0;  // size() above the capacity
+    uint64_t full = 0;
+    uint64_t empty = 0;
+};
+
+bool run_stress(uint32_t items) {
+    typedef Item<32> StressItem;
+    const uint32_t BATCH = 8;
+    static SpscRing<StressItem, 16> ring;
+    ring.reset();
+    StressResult result;
+
+    std::thread producer([&] {
+        Lcg random(1);
+        StressItem batch[BATCH];
+        uint32_t seq = 0;
+        while (seq < items) {
+            uint32_t count = 1 + random.next(BATCH);
+            if (count > items - seq) {
+                count = items - seq;
+            }
+            uint32_t pushed;
+            if (count == 1) {
+                batch[0].fill(seq);
+                pushed = ring.push(batch[0]) ? 1 : 0;
+            } else {
+                for (uint32_t i = 0; i < count; i++) {
+                    batch[i].fill(seq + i);
+                }
+                pushed = ring.pushBatch(batch, count);
+            }
+            seq += pushed;
+            if (pushed < count) {
+                result.full++;
+                std::this_thread::yield();
+            } else if (random.next(64) == 0) {
+                // Hand over at other fill levels too, not only when full
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread consumer([&] {
+        Lcg random(2);
+        StressItem batch[BATCH];
+        uint32_t expected = 0;
+        while (expected < items) {
+            if (ring.size() > ring.CAPACITY) {
+                result.over_capacity++;
+            }
+            uint32_t max = 1 + random.next(BATCH);
+            uint32_t popped = (max == 1) ? (ring.pop(batch[0]) ? 1 : 0) : ring.popBatch(batch, max);
+            if (popped == 0) {
+                result.empty++;
+                std::this_thread::yield();
+                continue;
+            }
+            for (uint32_t i = 0; i < popped; i++) {
+                const StressItem &item = batch[i];
+                if (!item.valid()) {
+                    result.torn++;
+                }
+                if (item.seq > expected) {
+                    result.out_of_order++;
+                } else if (item.seq < expected) {
+                    result.repeated++;
+                }
+                expected = item.seq + 1;
+                result.received++;
+            }
+            if (random.next(64) == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    // Nothing may be left over once every item has been taken
+    bool pass = result.received == items && result.out_of_order == 0 && result.repeated == 0 &&
+                result.torn == 0 && result.over_capacity == 0 && ring.empty();
+    std::printf("stress, %u items through a 16-slot ring\n", items);
+    std::printf("  %llu received, %llu skipped, %llu repeated, %llu torn, %llu over capacity; "
+                "%llu full and %llu empty calls: %s\n",
+                (unsigned long long)result.received, (unsigned long long)result.out_of_order,
+                (unsigned long long)result.repeated, (unsigned long long)result.torn,
+                (unsigned long long)result.over_capacity, (unsigned long long)result.full,
+                (unsigned long long)result.empty, pass ? "ok" : "FAIL");
+    return pass;
+}
+
+const uint32_t QUEUE_LENGTH = 64;
+
+// Million items per second between two threads, pushed and popped in
+// batches of batch (1 uses push and pop); 0 if the items did not add up
+template <int Bytes>
+double ring_throughput(uint32_t items, uint32_t batch) {
+    typedef Item<Bytes> T;
+    static SpscRing<T, QUEUE_LENGTH> ring;
+    ring.reset();
+    std::atomic<uint32_t> checksum(0);
+
+    double start = now_ns();
+    std::thread producer([&] {
+        T buffer[QUEUE_LENGTH];
+        uint32_t seq = 0;
+        while (seq < items) {
+            uint32_t count = (batch < items - seq) ? batch : items - seq;
+            uint32_t pushed;
+            if (count == 1) {
+                buffer[0].seq = seq;
+                pushed = ring.push(buffer[0]) ? 1 : 0;
+            } else {
+                for (uint32_t i = 0; i < count; i++) {
+                    buffer[i].seq = seq + i;
+                }
+                pushed = ring.pushBatch(buffer, count);
+            }
+            seq += pushed;
+            if (pushed == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread consumer([&] {
+        T buffer[QUEUE_LENGTH];
+        uint32_t received = 0;
+        uint32_t sum = 0;
+        while (received < items) {
+            uint32_t popped = (batch == 1) ? (ring.pop(buffer[0]) ? 1 : 0) : ring.popBatch(buffer, batch);
+            for (uint32_t i = 0; i < popped; i++) {
+                sum += buffer[i].seq;
+            }
+            received += popped;
+            if (popped == 0) {
+                std::this_thread::yield();
+            }
+        }
+        checksum = sum;
+    });
+    producer.join();
+    consumer.join();
+    double ns = now_ns() - start;
+    return checksum.load() == (uint32_t)((uint64_t)items * (items - 1) / 2) ? items / ns * 1e3 : 0.0;
+}
+
+// Same hand-off through the baseline queue, one item per call as xQueue
+template <int Bytes>
+double queue_throughput(uint32_t items) {
+    typedef Item<Bytes> T;
+    static CopyQueue<T, QUEUE_LENGTH> queue;
+    std::atomic<uint32_t> checksum(0);
+
+    double start = now_ns();
+    std::thread producer([&] {
+        T item;
+        for (uint32_t seq = 0; seq < items;) {
+            item.seq = seq;
+            if (queue.send(&item)) {
+                seq++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread consumer([&] {
+        T item;
+        uint32_t sum = 0;
+        for (uint32_t received = 0; received < items;) {
+            if (queue.receive(&item)) {
+                sum += item.seq;
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        checksum = sum;
+    });
+    producer.join();
+    consumer.join();
+    double ns = now_ns() - start;
+    return checksum.load() == (uint32_t)((uint64_t)items * (items - 1) / 2) ? items / ns * 1e3 : 0.0;
+}
+
+// Uncontended cost of one push and one pop, from one thread
+template <int Bytes>
+void single_thread(uint32_t items, double *ring_ns, double *queue_ns) {
+    typedef Item<Bytes> T;
+    static SpscRing<T, QUEUE_LENGTH> ring;
+    static CopyQueue<T, QUEUE_LENGTH> queue;
+    ring.reset();
+    T item;
+    item.fill(0);
+    uint32_t sum = 0;
+
+    double start = now_ns();
+    for (uint32_t i = 0; i < items; i++) {
+        item.seq = i;
+        ring.push(item);
+        ring.pop(item);
+        sum += item.seq;
+    }
+    *ring_ns = (now_ns() - start) / items;
+
+    start = now_ns();
+    for (uint32_t i = 0; i < items; i++) {
+        item.seq = i;
+        queue.send(&item);
+        queue.receive(&item);
+        sum += item.seq;
+    }
+    *queue_ns = (now_ns() - start) / items;
+    sink = sum;
+}
+
+template <int Bytes>
+void run_throughput(uint32_t items) {
+    double ring_ns;
+    double queue_ns;
+    single_thread<Bytes>(items, &ring_ns, &queue_ns);
+    std::printf("  %2d-byte items  push+pop %5.1f ns, queue %5.1f ns   two threads, million items/s: "
+                "ring %6.2f, ring x8 %6.2f, queue %6.2f\n",
+                Bytes, ring_ns, queue_ns, ring_throughput<Bytes>(items, 1), ring_throughput<Bytes>(items, 8),
+                queue_throughput<Bytes>(items));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    long items = (argc > 1) ? std::atol(argv[1]) : 2000000;
+    if (items <= 0 || items > 0x7fffffffL) {
+        std::fprintf(stderr, "usage: %s [items]\n", argv[0]);
+        return 2;
+    }
+
+    bool pass = run_stress((uint32_t)items);
+    std::printf("throughput, %ld items, %u-slot ring and queue\n", items, QUEUE_LENGTH);
+    run_throughput<16>((uint32_t)items);
+    run_throughput<64>((uint32_t)items);
+    return pass ? 0 : 1;
+}
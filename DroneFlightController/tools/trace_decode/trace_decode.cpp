@@ -0,0 +1,299 @@
+//
+//  trace_decode.cpp
+//  DroneFlightController
+//
+//  Host decoder for deferred-formatting trace logs. Reads the firmware ELF
+//  the log was recorded with, looks every message ID up in its fc_trace
+//  section and formats the captured arguments on the host.
+//
+//  Build: c++ -std=c++17 -O2 -I../../src -o trace_decode trace_decode.cpp
+//  Usage: trace_decode firmware.elf flight.trc
+//
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "utils/trace.h"
+
+namespace {
+
+struct Section {
+    std::string name;
+    uint64_t addr;
+    std::vector<uint8_t> data;
+    bool alloc;
+};
+
+bool read_file(const char *path, std::vector<uint8_t> &out) {
+    FILE *f = std::fopen(path, "rb");
+    if (f == nullptr) {
+        return false;
+    }
+    std::fseek(f, 0, SEEK_END);
+    long size = std::ftell(f);
+    std::fseek(f, 0, SEEK_SET);
+    out.resize(size > 0 ? (size_t)size : 0);
+    bool ok = out.empty() || std::fread(out.data(), 1, out.size(), f) == out.size();
+    std::fclose(f);
+    return ok;
+}
+
+template <typename T>
+T load(const std::vector<uint8_t> &buf, size_t offset) {
+    T value{};
+    if (offset + sizeof(T) <= buf.size()) {
+        std::memcpy(&value, &buf[offset], sizeof(T));
+    }
+    return value;
+}
+
+// Section headers of a little-endian ELF32 or ELF64 file
+bool read_sections(const std::vector<uint8_t> &elf, std::vector<Section> &sections) {
+    if (elf.size() < 64 || std::memcmp(elf.data(), "\x7f" "ELF", 4) != 0 || elf[5] != 1) {
+        return false;
+    }
+    bool is64 = elf[4] == 2;
+    uint64_t shoff = is64 ? load<uint64_t>(elf, 0x28) : load<uint32_t>(elf, 0x20);
+    uint16_t shentsize = load<uint16_t>(elf, is64 ? 0x3a : 0x2e);
+    uint16_t shnum = load<uint16_t>(elf, is64 ? 0x3c : 0x30);
+    uint16_t shstrndx = load<uint16_t>(elf, is64 ? 0x3e : 0x32);
+
+    struct Raw { uint32_t name, type; uint64_t flags, addr, offset, size; };
+    std::vector<Raw> raw(shnum);
+    for (uint16_t i = 0; i < shnum; i++) {
+        size_t h = shoff + (size_t)i * shentsize;
+        Raw &r = raw[i];
+        r.name = load<uint32_t>(elf, h);
+        r.type = load<uint32_t>(elf, h + 4);
+        if (is64) {
+            r.flags = load<uint64_t>(elf, h + 8);
+            r.addr = load<uint64_t>(elf, h + 16);
+            r.offset = load<uint64_t>(elf, h + 24);
+            r.size = load<uint64_t>(elf, h + 32);
+        } else {
+            r.flags = load<uint32_t>(elf, h + 8);
+            r.addr = load<uint32_t>(elf, h + 12);
+            r.offset = load<uint32_t>(elf, h + 16);
+            r.size = load<uint32_t>(elf, h + 20);
+        }
+    }
+    if (shstrndx >= shnum) {
+        return false;
+    }
+
+    const uint32_t SHT_NOBITS = 8;
+    const uint64_t SHF_ALLOC = 2;
+    for (const Raw &r : raw) {
+        Section s;
+        size_t name_at = raw[shstrndx].offset + r.name;
+        for (size_t i = name_at; i < elf.size() && elf[i] != 0; i++) {
+            s.name.push_back((char)elf[i]);
+        }
+        s.addr = r.addr;
+        s.alloc = (r.flags & SHF_ALLOC) != 0;
+        if (r.type != SHT_NOBITS && r.offset + r.size <= elf.size()) {
+            s.data.assign(elf.begin() + r.offset, elf.begin() + r.offset + r.size);
+        }
+        sections.push_back(std::move(s));
+    }
+    return true;
+}
+
+class Decoder {
+public:
+    explicit Decoder(std::vector<Section> sections) : sections(std::move(sections)) {
+        for (const Section &s : this->sections) {
+            if (s.name == "fc_trace") {
+                strings = &s;
+            }
+        }
+    }
+
+    bool valid() const { return strings != nullptr; }
+
+    // "file:line" and format of a message ID
+    bool site(uint16_t id, std::string &location, std::string &format) const {
+        if (id >= strings->data.size()) {
+            return false;
+        }
+        std::string entry(reinterpret_cast<const char *>(&strings->data[id]));
+        size_t split = entry.find('\x1f');
+        if (split == std::string::npos) {
+            return false;
+        }
+        location = entry.substr(0, split);
+        format = entry.substr(split + 1);
+        return true;
+    }
+
+    // printf with the captured 32-bit arguments
+    std::string format(const std::string &fmt, const uint32_t *args, unsigned nargs) const {
+        std::string out;
+        unsigned next = 0;
+        auto arg = [&]() -> uint32_t { return next < nargs ? args[next++] : 0; };
+
+        for (size_t i = 0; i < fmt.size(); i++) {
+            if (fmt[i] != '%') {
+                out.push_back(fmt[i]);
+                continue;
+            }
+            if (i + 1 < fmt.size() && fmt[i + 1] == '%') {
+                out.push_back('%');
+                i++;
+                continue;
+            }
+
+            // Flags, width and precision are kept, length modifiers dropped
+            std::string spec = "%";
+            size_t j = i + 1;
+            while (j < fmt.size() && std::strchr("-+ #0", fmt[j]) != nullptr) {
+                spec.push_back(fmt[j++]);
+            }
+            while (j < fmt.size() && (std::isdigit((unsigned char)fmt[j]) || fmt[j] == '.' || fmt[j] == '*')) {
+                if (fmt[j] == '*') {
+                    spec += std::to_string((int32_t)arg());
+                } else {
+                    spec.push_back(fmt[j]);
+                }
+                j++;
+            }
+            while (j < fmt.size() && std::strchr("hlLqjzt", fmt[j]) != nullptr) {
+                j++;
+            }
+            if (j >= fmt.size()) {
+                break;
+            }
+            char conversion = fmt[j];
+            spec.push_back(conversion);
+            i = j;
+
+            char buf[512];
+            uint32_t word = arg();
+            switch (conversion) {
+                case 'd': case 'i':
+                    std::snprintf(buf, sizeof(buf), spec.c_str(), (int)(int32_t)word);
+                    break;
+                case 'u': case 'x': case 'X': case 'o': case 'c':
+                    std::snprintf(buf, sizeof(buf), spec.c_str(), (unsigned)word);
+                    break;
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                    float value;
+                    std::memcpy(&value, &word, sizeof(value));
+                    std::snprintf(buf, sizeof(buf), spec.c_str(), (double)value);
+                    break;
+                }
+                case 's':
+                    std::snprintf(buf, sizeof(buf), spec.c_str(), string_at(word).c_str());
+                    break;
+                case 'p':
+                    std::snprintf(buf, sizeof(buf), "0x%08x", (unsigned)word);
+                    break;
+                default:
+                    std::snprintf(buf, sizeof(buf), "%s", spec.c_str());
+                    break;
+            }
+            out += buf;
+        }
+        return out;
+    }
+
+private:
+    // C string at a target address, if it lies in a section of the ELF
+    std::string string_at(uint32_t address) const {
+        for (const Section &s : sections) {
+            if (s.alloc && address >= s.addr && address < s.addr + s.data.size()) {
+                size_t at = address - s.addr;
+                std::string text;
+                while (at < s.data.size() && s.data[at] != 0) {
+                    text.push_back((char)s.data[at++]);
+                }
+                return text;
+            }
+        }
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "<0x%08x>", (unsigned)address);
+        return buf;
+    }
+
+    std::vector<Section> sections;
+    const Section *strings = nullptr;
+};
+
+const char *level_name(uint8_t level) {
+    switch (level) {
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO:  return "INFO";
+        case LOG_WARN:  return "WARN";
+        case LOG_ERROR: return "ERROR";
+        default:        return "UNKNOWN";
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s firmware.elf log.trc\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> elf, log;
+    std::vector<Section> sections;
+    if (!read_file(argv[1], elf) || !read_sections(elf, sections)) {
+        std::fprintf(stderr, "%s: not a readable little-endian ELF file\n", argv[1]);
+        return 1;
+    }
+    Decoder decoder(std::move(sections));
+    if (!decoder.valid()) {
+        std::fprintf(stderr, "%s: no fc_trace section\n", argv[1]);
+        return 1;
+    }
+    if (!read_file(argv[2], log)) {
+        std::fprintf(stderr, "%s: cannot read\n", argv[2]);
+        return 1;
+    }
+
+    size_t at = 0;
+    unsigned session = 0;
+    unsigned unknown = 0;
+    while (at + sizeof(trace_record_header_t) <= log.size()) {
+        // A file header starts each boot's records
+        if (load<uint32_t>(log, at) == TRACE_MAGIC) {
+            trace_file_header_t header = load<trace_file_header_t>(log, at);
+            if (header.version != TRACE_VERSION) {
+                std::fprintf(stderr, "unsupported trace version %u\n", header.version);
+                return 1;
+            }
+            std::printf("--- boot %u ---\n", ++session);
+            at += sizeof(trace_file_header_t);
+            continue;
+        }
+
+        trace_record_header_t record = load<trace_record_header_t>(log, at);
+        at += sizeof(record);
+        if (record.nargs > TRACE_MAX_ARGS || at + record.nargs * sizeof(uint32_t) > log.size()) {
+            std::fprintf(stderr, "corrupt record at offset %zu\n", at - sizeof(record));
+            return 1;
+        }
+        uint32_t args[TRACE_MAX_ARGS];
+        std::memcpy(args, &log[at], record.nargs * sizeof(uint32_t));
+        at += record.nargs * sizeof(uint32_t);
+
+        std::string location, format;
+        if (!decoder.site(record.id, location, format)) {
+            unknown++;
+            continue;
+        }
+        std::printf("[%10.6f] [%s] %s - %s\n", record.timestamp_us * 1e-6, level_name(record.level),
+                    location.c_str(), decoder.format(format, args, record.nargs).c_str());
+    }
+
+    if (unknown > 0) {
+        std::fprintf(stderr, "%u records with IDs not in this ELF\n", unknown);
+    }
+    return 0;
+}